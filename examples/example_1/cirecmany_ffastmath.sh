@@ -13,6 +13,7 @@ fi
 
 CLANG=/uufs/chpc.utah.edu/common/home/u6068934/Tools/llvm-clone/llvm/build-release/bin/clang
 CIRE=/uufs/chpc.utah.edu/common/home/u6068934/Tools/CIRE/build-debug/bin/CIRE_LLVM
+IRFUNCS=${IRFUNCS:-$(dirname "$0")/../../native/bin/irfuncs}
 LEVELS=(O1 O2 O3 Os)
 INPUT_BIN=/uufs/chpc.utah.edu/common/home/u6068934/Tools/CIRE/inputs/test_input.txt
 # Create consolidated output file with timestamp
@@ -67,9 +68,13 @@ EOF
              "$SRC" -o "$BC"
 
     # pick first function in the module
-    FUNC=$(llvm-dis -o - "$BC" |
+    if [[ -x "$IRFUNCS" ]]; then
+      FUNC=$("$IRFUNCS" -1 "$BC" || true)
+    else
+      FUNC=$(llvm-dis -o - "$BC" |
            grep -m1 -oP 'define\s+.*?@(\w+)' |
            sed -E 's/.*@([A-Za-z0-9_]+).*/\1/')
+    fi
 
     if [[ -z "$FUNC" ]]; then
       echo "[cirecmany] no function detected" > "$OUT"
@@ -1,30 +1,30 @@
 #!/usr/bin/env python3
+import json
 import sys
 import numpy as np
 import matplotlib.pyplot as plt
 
 def main():
-    if len(sys.argv) != 3:
-        print("Usage: python lineplot.py <output_low.csv> <errors.txt>")
+    if len(sys.argv) != 2:
+        print("Usage: python linechart.py <grid prefix>")
+        print("  rstore grid -t cire -k gelu_exp0 -x x0_lo -v out_lo,err_hi -d gelu")
         sys.exit(1)
 
-    # We accept the first arg for interface consistency; we only use the second.
-    out_path = sys.argv[1]
-    err_path = sys.argv[2]
+    prefix = sys.argv[1]
+    with open(prefix + '.json') as f:
+        meta = json.load(f)
 
-    # Read numbers from the .txt, ignore first line, keep file order.
-   
-    outputs = np.loadtxt(out_path, dtype=np.float64, skiprows=1)
-    errors  = np.loadtxt(err_path, dtype=np.float64, skiprows=1)
+    # 1D arrays over the x0 nodes from rstore grid; missing cells are NaN
+    outputs = np.load(prefix + '.out_lo.npy')
+    errors  = np.load(prefix + '.err_hi.npy')
 
     ulp_errors = errors/np.spacing(outputs.astype(np.float32))
 
-    #x = range(len(values))
-    
-    x = np.linspace(-4.0, 4.0, 80)
+    ax0 = meta['axes'][0]
+    x = ax0['lo'] + ax0['step'] * np.arange(ax0['size'])
     fig, ax = plt.subplots(figsize=(7, 4))
     ax.plot(x, ulp_errors)
-    ax.set_xlabel("x0")
+    ax.set_xlabel(ax0['column'])
     ax.set_ylabel("Error in ULPs")
     ax.set_title("GELU w/ Exp fp32 Error in ULPs")
     fig.tight_layout()
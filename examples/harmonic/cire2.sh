@@ -12,6 +12,7 @@ LL="${NAME}_O1.ll"
 
 CLANG=/uufs/chpc.utah.edu/common/home/u1260704/Tools/llvm-clone/llvm/build-release/bin/clang
 CIRE=/uufs/chpc.utah.edu/common/home/u1260704/Tools/CIRE/build-debug/bin/CIRE_LLVM
+IRFUNCS=${IRFUNCS:-$(dirname "$0")/../../native/bin/irfuncs}
 
 # 1) Compile only at -O1
 "$CLANG" -O1 \
@@ -25,8 +26,12 @@ CIRE=/uufs/chpc.utah.edu/common/home/u1260704/Tools/CIRE/build-debug/bin/CIRE_LL
          "$SRC" -o "$LL"
 
 # 2) Extract your kernel's name
-FUNC=$(grep -m1 -oP '^define\s+.*?@(\w+)' "$LL" \
+if [[ -x "$IRFUNCS" ]]; then
+  FUNC=$("$IRFUNCS" -1 "$LL" || true)
+else
+  FUNC=$(grep -m1 -oP '^define\s+.*?@(\w+)' "$LL" \
        | sed -E 's/.*@([A-Za-z0-9_]+).*/\1/')
+fi
 if [[ -z "$FUNC" ]]; then
   echo "❌  Couldn't find any function in $LL" >&2
   exit 1
@@ -44,11 +49,12 @@ Generated: $(date)
 
 EOF
 
-# 3) Prepare the two one‑column CSVs
-OUTCSV="output_low.csv"
-ERRCSV="errors.csv"
-echo "low"   > "$OUTCSV"
-echo "error" > "$ERRCSV"
+# 3) Prepare the keyed grid records: one row per cell with its input box,
+#    so any sweep shape can be ingested with `rstore ingest` and regridded
+#    with `rstore grid`.
+GRIDCSV="${NAME}_cire_grid.csv"
+RSTORE=${RSTORE:-$(dirname "$0")/../../native/bin/rstore}
+echo "tool,kernel,opt,box,x0_lo,x0_hi,x1_lo,x1_hi,status,out_lo,err_hi" > "$GRIDCSV"
 
 # 4) Sweep x0,x1
 STEP=0.01
@@ -66,12 +72,13 @@ INPUTS {
 OUTPUTS { y0 fl64; }
 EOF
 
-    # Run CIRE and log
+    # Run CIRE and log; CIRE runs outside any pipe so CIRE_RC is its own
+    # exit status, and a failure is recorded rather than ending the sweep.
+    CIRE_RC=0
     CIRE_OUT=$(
-      $CIRE "$LL" --function "$FUNC" --input "$INPUT_FILE" --debug-level 1 \
-        2>&1 | tee -a "$LOG"
-    )i
-    CIRE_RC=${PIPESTATUS[0]}
+      $CIRE "$LL" --function "$FUNC" --input "$INPUT_FILE" --debug-level 1 2>&1
+    ) || CIRE_RC=$?
+    printf '%s\n' "$CIRE_OUT" >> "$LOG"
 
     if [[ $CIRE_RC -eq 0 ]]; then
   if read output_lo err_hi < <(
@@ -96,12 +103,14 @@ else
   output_lo=0; err_hi=0
 fi
     
-    # Append just the requested columns
-    echo "$output_lo" >> "$OUTCSV"
-    echo "$err_hi"   >> "$ERRCSV"
+    # Append the keyed record
+    echo "cire,$NAME,O1,grid,${x0},${x0_hi},${x1},${x1_hi},$CIRE_RC,$output_lo,$err_hi" >> "$GRIDCSV"
 
     rm "$INPUT_FILE"
   done
 done
 
-echo "✅ Done! See consolidated results in $LOG"
+if [[ -x "$RSTORE" ]]; then
+  "$RSTORE" ingest -o "${STORE:-results.rstore}" "$GRIDCSV"
+fi
+echo "✅ Done! See consolidated results in $LOG and $GRIDCSV"
@@ -13,6 +13,7 @@ fi
 
 CLANG=/uufs/chpc.utah.edu/common/home/u1260704/Tools/llvm-clone/llvm/build-release/bin/clang
 CIRE=/uufs/chpc.utah.edu/common/home/u1260704/Tools/CIRE/build-debug/bin/CIRE_LLVM
+IRFUNCS=${IRFUNCS:-$(dirname "$0")/../../native/bin/irfuncs}
 LEVELS=(O1 O2 O3 Os)
 FASTMATH_FLAGS=("")
 INPUT_BIN=/uufs/chpc.utah.edu/common/home/u6068923/reu2025/examples/harmonic/inputs/harmonic1.cire
@@ -77,8 +78,12 @@ EOF
 
 	    # pick first function in the module
 
-	    FUNC=$(grep -m1 -oP 'define\s+.*?@(\w+)' "$LL" \
+	    if [[ -x "$IRFUNCS" ]]; then
+	      FUNC=$("$IRFUNCS" -1 "$LL" || true)
+	    else
+	      FUNC=$(grep -m1 -oP 'define\s+.*?@(\w+)' "$LL" \
 	       | sed -E 's/.*@([A-Za-z0-9_]+).*/\1/')
+	    fi
 
 	    if [[ -z "$FUNC" ]]; then
 	      echo "[cirecmany] no function detected" > "$OUT"
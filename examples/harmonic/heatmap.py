@@ -1,39 +1,35 @@
 #!/usr/bin/env python3
+import json
 import sys
 import numpy as np
 import matplotlib.pyplot as plt
 import matplotlib.patches as mpatches
 
 def main():
-    if len(sys.argv) != 3:
-        print("Usage: python heatmap.py <errors.csv>")
+    if len(sys.argv) != 2:
+        print("Usage: python heatmap.py <grid prefix>")
+        print("  rstore grid -t cire -k harmonic0 -x x0_lo -y x1_lo -v out_lo,err_hi -d harmonic")
         sys.exit(1)
 
-    out_file = sys.argv[1]
-    err_file = sys.argv[2] 
+    prefix = sys.argv[1]
+    with open(prefix + '.json') as f:
+        meta = json.load(f)
 
-    # Load the error values (skip header)
-    errors = np.loadtxt(err_file, delimiter=',', skiprows=1)
-    output = np.loadtxt(out_file, delimiter=',', skiprows=1)
+    # Dense (n_x1, n_x0) arrays from rstore grid; nodes without a record are NaN
+    out_grid = np.load(prefix + '.out_lo.npy')
+    err_grid = np.load(prefix + '.err_hi.npy')
+    count = np.load(prefix + '.count.npy')
+    ax0, ax1 = meta['axes'][0], meta['axes'][1]
 
-    # Determine grid dimensions (must be square)
-    N = errors.size
-    side = int(np.sqrt(N))
-    if side * side != N:
-        raise ValueError(f"Expected a square grid, but got {N} values.")
-
-    # Reshape into a 2D array: rows = x1 values, columns = x0 values
-    out_grid = output.reshape((side, side)).T
-    err_grid = errors.reshape((side, side)).T
     err_grid = np.float32(err_grid)
     ulp_grid = np.spacing(np.float32(out_grid))
     ulp_err = err_grid / ulp_grid
     
-    print(np.max(ulp_err))
-    print(np.max(err_grid))
+    print(np.nanmax(ulp_err))
+    print(np.nanmax(err_grid))
 
     # 1) Find the flat index of the max ULP‑error
-    flat_max = np.argmax(ulp_err)
+    flat_max = np.nanargmax(ulp_err)
 
     # 2) Convert to 2D indices
     i_row, i_col = np.unravel_index(flat_max, ulp_err.shape)
@@ -43,10 +39,9 @@ def main():
     max_err   = err_grid[i_row, i_col]
     max_out   = out_grid[i_row, i_col]
 
-    # 4) (Optionally) map back to your x0,x1 coordinates
-    #    if you built x_vals = np.linspace(-10,10,side), y_vals same:
-    x0_vals = np.linspace(0.0,1,side)
-    x1_vals = np.linspace(0.0,1,side)
+    # 4) Map back to the x0,x1 coordinates of the grid nodes
+    x0_vals = ax0['lo'] + ax0['step'] * np.arange(ax0['size'])
+    x1_vals = ax1['lo'] + ax1['step'] * np.arange(ax1['size'])
     x0_star = x0_vals[i_col]
     x1_star = x1_vals[i_row]
 
@@ -55,12 +50,11 @@ def main():
     print(f"  → abs‑error    = {max_err:.3g}")
 
     
-    # Create axis values from -10 to 10 inclusive
-    x_vals = np.linspace(0.0, 1, side)
-    y_vals = np.linspace(0.0, 1, side)
+    x_vals = x0_vals
+    y_vals = x1_vals
 
 
-    anom = err_grid == 0   # mask NaN/Inf and your sentinel 0
+    anom = (err_grid == 0) | (count == 0)   # mask NaN/Inf, the sentinel 0 and missing cells
     Zm   = np.ma.array(ulp_err, mask=anom)            # masked array
     cmap = plt.cm.get_cmap('viridis')
     cmap.set_bad('red')   
@@ -77,8 +71,8 @@ def main():
     )
     bad_patch = mpatches.Patch(facecolor='red', edgecolor='red', label='Error Unbounded (Inf)')
     ax.legend(handles=[bad_patch], loc='upper right', frameon=True)
-    ax.set_xlabel('x0')
-    ax.set_ylabel('x1')
+    ax.set_xlabel(ax0['column'])
+    ax.set_ylabel(ax1['column'])
     ax.set_title('Naive Softmax fp32 CiRE Error in ULPs')
     fig.colorbar(cax, ax=ax, label='Error in ULPs')
     plt.tight_layout()
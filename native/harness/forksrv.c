@@ -0,0 +1,119 @@
+/*
+ * Fork-server harness for kernel mains, after AFL's fork server.
+ *
+ * A verificarlo-compiled kernel pays for exec, the dynamic loading of
+ * libinterflop_*.so and the backend initialisation from VFC_BACKENDS on
+ * every run, milliseconds per sample. Linked into the kernel's main, this
+ * file lets the process initialise once and then fork a fresh child per
+ * batch of inputs on request, which costs tens of microseconds:
+ *
+ *   verificarlo-c -O2 ex1_original.c native/harness/forksrv.c \
+ *       -Wl,--wrap=main -o ex1_original_verificarlo -lm
+ *
+ * --wrap=main routes the C runtime's call to main through __wrap_main below,
+ * after every constructor (including the backend loading) has run. Without
+ * REU_FORKSRV in the environment the binary behaves exactly as before.
+ *
+ * Protocol, driven by the sweep engine (src/forkserver.hpp, fpsweep -X):
+ *   fd 198 (requests, engine -> server), fd 199 (status, server -> engine)
+ *   server:   u32 FORKSRV_HELLO once ready
+ *   request:  u32 count, u64 seed, u32 bytes, then `bytes` of text holding
+ *             `count` lines, each the arguments of one run (split on spaces);
+ *             count 0 shuts the server down
+ *   reply:    u32 child pid, then u32 wait status once the child is done
+ * The child runs main once per line with stdout and stderr going to the
+ * engine, and ends each run with a line holding only "\036" (ASCII RS), so
+ * a crash is pinned to the first run without its separator.
+ *
+ * Re-seeding: the child calls srand48 / srand with the request seed, and
+ * reu_forksrv_reseed(seed) if the program (or a backend shim) defines it.
+ * Interflop's MCA backends seed their generator lazily, per thread, from the
+ * time and thread id unless --seed is given; the server never runs
+ * floating-point code before forking, so each child draws a fresh stream.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define FORKSRV_CTL 198
+#define FORKSRV_ST 199
+#define FORKSRV_HELLO 0x31555245u /* "REU1" */
+#define FORKSRV_MAX_ARGS 64
+
+int __real_main(int argc, char** argv);
+void reu_forksrv_reseed(uint64_t seed) __attribute__((weak));
+
+static int read_all(int fd, void* buf, size_t n) {
+    char* p = (char*)buf;
+    while (n) {
+        ssize_t got = read(fd, p, n);
+        if (got <= 0)
+            return 0;
+        p += got;
+        n -= (size_t)got;
+    }
+    return 1;
+}
+
+static int write_u32(int fd, uint32_t v) {
+    return write(fd, &v, 4) == 4;
+}
+
+static void run_batch(char* prog, char* text, uint32_t count, uint64_t seed) {
+    srand48((long)seed);
+    srand((unsigned)seed);
+    if (reu_forksrv_reseed)
+        reu_forksrv_reseed(seed);
+    char* line = text;
+    for (uint32_t i = 0; i < count && line; i++) {
+        char* next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        char* argv[FORKSRV_MAX_ARGS + 2];
+        int argc = 0;
+        argv[argc++] = prog;
+        for (char* tok = strtok(line, " "); tok && argc <= FORKSRV_MAX_ARGS;
+             tok = strtok(NULL, " "))
+            argv[argc++] = tok;
+        argv[argc] = NULL;
+        __real_main(argc, argv);
+        fputs("\036\n", stdout);
+        fflush(stdout);
+        fflush(stderr);
+        line = next;
+    }
+    _exit(0);
+}
+
+int __wrap_main(int argc, char** argv) {
+    if (!getenv("REU_FORKSRV") || !write_u32(FORKSRV_ST, FORKSRV_HELLO))
+        return __real_main(argc, argv);
+    for (;;) {
+        uint32_t count, bytes;
+        uint64_t seed;
+        if (!read_all(FORKSRV_CTL, &count, 4) || count == 0 || !read_all(FORKSRV_CTL, &seed, 8) ||
+            !read_all(FORKSRV_CTL, &bytes, 4))
+            _exit(0);
+        char* text = (char*)malloc((size_t)bytes + 1);
+        if (!text || !read_all(FORKSRV_CTL, text, bytes))
+            _exit(1);
+        text[bytes] = '\0';
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0)
+            _exit(1);
+        if (pid == 0) {
+            close(FORKSRV_CTL);
+            close(FORKSRV_ST);
+            run_batch(argv[0], text, count, seed);
+        }
+        free(text);
+        int status = 0;
+        if (!write_u32(FORKSRV_ST, (uint32_t)pid) || waitpid(pid, &status, 0) < 0 ||
+            !write_u32(FORKSRV_ST, (uint32_t)status))
+            _exit(1);
+    }
+}
@@ -0,0 +1,443 @@
+// C interface to the kernel registry, the emulated arithmetics, the error
+// bounds, the metric kernels, the result store and the text table codec,
+// built as libreu.so for python/reu.py.
+
+#include "reu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "bnb.hpp"
+#include "errexpr.hpp"
+#include "kernels.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+#include "sigest.hpp"
+#include "store.hpp"
+#include "textcodec.hpp"
+
+using namespace reu;
+
+static thread_local std::string last_error;
+
+static int fail(const std::string& msg) {
+    last_error = msg;
+    return -1;
+}
+
+static unsigned pick_jobs(unsigned jobs, size_t n) {
+    if (jobs == 0)
+        jobs = default_jobs();
+    // Small batches are not worth a thread each.
+    size_t most = n / 1024 + 1;
+    return jobs < most ? jobs : unsigned(most);
+}
+
+static const KernelDef* kernel_or_fail(const char* name) {
+    const KernelDef* k = find_kernel(name ? name : "");
+    if (!k)
+        fail(std::string("unknown kernel '") + (name ? name : "") + "'");
+    return k;
+}
+
+extern "C" {
+
+const char* reu_last_error(void) {
+    return last_error.c_str();
+}
+
+int reu_kernel_count(void) {
+    return int(kernel_registry().size());
+}
+
+int reu_kernel_info(int i, const char** name, const char** source, int* n_in, int* n_out,
+                    unsigned* points) {
+    const auto& reg = kernel_registry();
+    if (i < 0 || size_t(i) >= reg.size())
+        return fail("kernel index out of range");
+    const KernelDef& k = reg[size_t(i)];
+    *name = k.name;
+    *source = k.source;
+    *n_in = k.n_in;
+    *n_out = k.n_out;
+    *points = k.points;
+    return 0;
+}
+
+unsigned reu_parse_points(const char* list) {
+    return parse_points(list ? list : "");
+}
+
+int reu_sample(const char* kernel, const reu_arith* a, const double* x, size_t n,
+               int iterations, unsigned jobs, double* y) {
+    const KernelDef* k = kernel_or_fail(kernel);
+    if (!k)
+        return -1;
+    if (iterations < 1)
+        return fail("iterations must be positive");
+    McaConfig mca;
+    VprecConfig vp;
+    Lowp fmt = Lowp::BF16;
+    unsigned mask = 0;
+    switch (a->arith) {
+    case REU_F64:
+    case REU_F32:
+        break;
+    case REU_MCA:
+        if (a->precision < 1 || a->precision > 53 || a->mca_mode < 0 || a->mca_mode > 2)
+            return fail("MCA needs a precision in [1, 53] and a mode in [0, 2]");
+        mca.precision = a->precision;
+        mca.mode = McaMode(a->mca_mode);
+        break;
+    case REU_LOWP:
+        if (a->format < 0 || a->format > int(Lowp::E5M2))
+            return fail("unknown low-precision format");
+        fmt = Lowp(a->format);
+        mask = a->points & k->points;
+        if (mask == 0)
+            return fail("no valid rounding points for " + std::string(k->name) + " (has: " +
+                        points_name(k->points) + ")");
+        break;
+    case REU_VPREC:
+        if (a->precision < 0 || a->precision > 52 || a->range < 2 || a->range > 11)
+            return fail("VPREC needs a precision in [0, 52] and a range in [2, 11]");
+        vp.precision = a->precision;
+        vp.range = a->range;
+        break;
+    default:
+        return fail("unknown arithmetic");
+    }
+
+    int n_in = k->n_in, n_out = k->n_out;
+    parallel_for(n, pick_jobs(jobs, n * size_t(iterations)), [&](size_t b, size_t e, unsigned) {
+        mca_config = mca;
+        vprec_config = vp;
+        float xf[MAX_IN], yf[MAX_OUT];
+        for (size_t p = b; p < e; p++) {
+            const double* xd = x + p * size_t(n_in);
+            for (int d = 0; d < n_in; d++)
+                xf[d] = float(xd[d]);
+            for (int it = 0; it < iterations; it++) {
+                double* yd = y + (p * size_t(iterations) + size_t(it)) * size_t(n_out);
+                // Same counter space per sample as fpsweep: 2^20 draws.
+                uint64_t ctr = (uint64_t(p) * uint64_t(iterations) + uint64_t(it)) << 20;
+                switch (a->arith) {
+                case REU_F64:
+                    k->eval_f64(xd, yd);
+                    break;
+                case REU_F32:
+                    k->eval_f32(xf, yf);
+                    for (int o = 0; o < n_out; o++)
+                        yd[o] = yf[o];
+                    break;
+                case REU_MCA:
+                    mca_rng = CounterRng(a->seed, ctr);
+                    k->eval_mca(xd, yd);
+                    break;
+                case REU_LOWP: {
+                    LowpQuant q{&lowp_spec(fmt), mask, !a->nearest, CounterRng(a->seed, ctr)};
+                    k->eval_lowp(xf, yf, q);
+                    for (int o = 0; o < n_out; o++)
+                        yd[o] = yf[o];
+                    break;
+                }
+                case REU_VPREC:
+                    k->eval_vprec(xd, yd);
+                    break;
+                }
+            }
+        }
+    });
+    return 0;
+}
+
+int reu_oracle(const char* kernel, const double* x, size_t n, unsigned jobs, long double* ref) {
+    const KernelDef* k = kernel_or_fail(kernel);
+    if (!k)
+        return -1;
+    int n_in = k->n_in, n_out = k->n_out;
+    parallel_for(n, pick_jobs(jobs, n), [&](size_t b, size_t e, unsigned) {
+        long double xl[MAX_IN];
+        for (size_t p = b; p < e; p++) {
+            for (int d = 0; d < n_in; d++)
+                xl[d] = x[p * size_t(n_in) + size_t(d)];
+            k->eval_ref(xl, ref + p * size_t(n_out));
+        }
+    });
+    return 0;
+}
+
+int reu_cancel(const char* kernel, const double* x, size_t n, int max_sites, unsigned jobs,
+               uint8_t* bits, int* sites) {
+    const KernelDef* k = kernel_or_fail(kernel);
+    if (!k)
+        return -1;
+    if (max_sites < 1)
+        return fail("max_sites must be positive");
+    unsigned used = pick_jobs(jobs, n);
+    std::vector<int> most(used, 0);
+    parallel_for(n, used, [&](size_t b, size_t e, unsigned j) {
+        double y[MAX_OUT];
+        for (size_t p = b; p < e; p++) {
+            k->eval_cancel(x + p * size_t(k->n_in), y);
+            const CancelTrace& t = cancel_trace;
+            uint8_t* row = bits + p * size_t(max_sites);
+            for (int s = 0; s < max_sites; s++)
+                row[s] = s < t.sites && s < CANCEL_SITES ? t.bits[s] : 255;
+            most[j] = t.sites > most[j] ? t.sites : most[j];
+        }
+    });
+    *sites = 0;
+    for (int m : most)
+        *sites = m > *sites ? m : *sites;
+    return 0;
+}
+
+int reu_error_bound(const char* kernel, const double* lo, const double* hi, int precision,
+                    double tiny, double rel_tol, size_t max_boxes, unsigned jobs, double* bounds,
+                    double* argmax) {
+    const KernelDef* k = kernel_or_fail(kernel);
+    if (!k)
+        return -1;
+    if (precision < 2 || precision > 53 || !(rel_tol >= 0) || max_boxes < 1)
+        return fail("need precision in [2, 53], rel_tol >= 0 and max_boxes >= 1");
+    BnbOptions opt;
+    opt.jobs = jobs ? jobs : default_jobs();
+    opt.rel_tol = rel_tol;
+    opt.max_boxes = max_boxes;
+    std::vector<double> l(lo, lo + k->n_in), h(hi, hi + k->n_in);
+    for (int o = 0; o < k->n_out; o++) {
+        BnbResult r = max_kernel_error(*k, o, l, h, std::ldexp(1.0, -precision), tiny, opt);
+        bounds[2 * o] = r.lower;
+        bounds[2 * o + 1] = r.upper;
+        std::copy(r.argmax.begin(), r.argmax.end(), argmax + size_t(o) * size_t(k->n_in));
+    }
+    return 0;
+}
+
+int reu_error_expr(const char* kernel, const double* lo, const double* hi, size_t n,
+                   int precision, double tiny, unsigned jobs, double* out_lo, double* out_hi,
+                   double* err) {
+    const KernelDef* k = kernel_or_fail(kernel);
+    if (!k)
+        return -1;
+    if (precision < 2 || precision > 53)
+        return fail("need precision in [2, 53]");
+    // Points to rows per input and back.
+    size_t n_in = size_t(k->n_in), n_out = size_t(k->n_out);
+    std::vector<double> l(n_in * n), h(n_in * n), vl(n_out * n), vh(n_out * n), e(n_out * n);
+    for (size_t b = 0; b < n; b++) {
+        for (size_t i = 0; i < n_in; i++) {
+            l[i * n + b] = lo[b * n_in + i];
+            h[i * n + b] = hi[b * n_in + i];
+        }
+    }
+    std::string msg;
+    if (!eval_error_expr(*k, n, l.data(), h.data(), std::ldexp(1.0, -precision), tiny,
+                         pick_jobs(jobs, n), vl.data(), vh.data(), e.data(), msg))
+        return fail(msg);
+    for (size_t b = 0; b < n; b++) {
+        for (size_t o = 0; o < n_out; o++) {
+            out_lo[b * n_out + o] = vl[o * n + b];
+            out_hi[b * n_out + o] = vh[o * n + b];
+            err[b * n_out + o] = e[o * n + b];
+        }
+    }
+    return 0;
+}
+
+int reu_ulp_error(const double* y, const long double* ref, size_t n, int precision, int emin,
+                  unsigned jobs, double* out) {
+    parallel_for(n, pick_jobs(jobs, n), [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++)
+            out[i] = ulp_error(y[i], ref[i], precision, emin);
+    });
+    return 0;
+}
+
+int reu_sig_digits(const double* y, const long double* ref, size_t n, double cap, unsigned jobs,
+                   double* out) {
+    parallel_for(n, pick_jobs(jobs, n), [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++)
+            out[i] = sig_digits(y[i], ref[i], cap);
+    });
+    return 0;
+}
+
+int reu_mca_sig_digits(const double* y, size_t n, int samples, int m, double cap,
+                       unsigned jobs, double* per_out, double* norm) {
+    if (samples < 1 || m < 1)
+        return fail("samples and outputs must be positive");
+    size_t stride = size_t(samples) * size_t(m);
+    parallel_for(n, pick_jobs(jobs, n * size_t(samples)), [&](size_t b, size_t e, unsigned) {
+        for (size_t p = b; p < e; p++) {
+            const double* yp = y + p * stride;
+            double* po = per_out + p * size_t(m);
+            double nw = m > 1 ? mca_sig_digits_vec(yp, samples, m, cap, po)
+                              : (po[0] = mca_sig_digits(yp, samples, cap));
+            if (norm)
+                norm[p] = nw;
+        }
+    });
+    return 0;
+}
+
+int reu_confident_digits(const double* y, const double* ref, size_t n, int samples, int m,
+                         double probability, double confidence, double cap_bits, unsigned jobs,
+                         double* cnh, double* bern) {
+    if (samples < 1 || m < 1)
+        return fail("samples and outputs must be positive");
+    if (!(probability > 0 && probability < 1 && confidence > 0 && confidence < 1))
+        return fail("probability and confidence must be in (0, 1)");
+    SigLevel level{probability, confidence};
+    size_t stride = size_t(samples) * size_t(m);
+    parallel_for(n, pick_jobs(jobs, n * size_t(samples)), [&](size_t b, size_t e, unsigned) {
+        for (size_t p = b; p < e; p++) {
+            for (size_t o = 0; o < size_t(m); o++) {
+                size_t at = p * size_t(m) + o;
+                SigEstimator est(level, cap_bits, ref ? ref[at] : NAN);
+                for (int s = 0; s < samples; s++)
+                    est.add(y[p * stride + size_t(s) * size_t(m) + o]);
+                cnh[at] = digits_of_bits(est.cnh_bits());
+                if (bern)
+                    bern[at] = digits_of_bits(est.bernoulli_bits());
+            }
+        }
+    });
+    return 0;
+}
+
+struct reu_store {
+    ResultStore store;
+    std::vector<uint32_t> selection;
+};
+
+reu_store* reu_store_open(const char* path) {
+    auto* s = new reu_store;
+    std::string err;
+    if (!ResultStore::load(path ? path : "", s->store, err)) {
+        fail(err);
+        delete s;
+        return nullptr;
+    }
+    return s;
+}
+
+void reu_store_close(reu_store* s) {
+    delete s;
+}
+
+size_t reu_store_rows(const reu_store* s) {
+    return s->store.rows();
+}
+
+int reu_store_columns(const reu_store* s) {
+    return int(s->store.columns().size());
+}
+
+const char* reu_store_column_name(const reu_store* s, int i) {
+    const auto& cols = s->store.columns();
+    return i >= 0 && size_t(i) < cols.size() ? cols[size_t(i)].name.c_str() : nullptr;
+}
+
+int reu_store_column_type(const reu_store* s, const char* name) {
+    const Column* c = s->store.find(name ? name : "");
+    return c ? int(c->type) : fail(std::string("no column '") + (name ? name : "") + "'");
+}
+
+const void* reu_store_data(const reu_store* s, const char* name) {
+    const Column* c = s->store.find(name ? name : "");
+    if (!c) {
+        fail(std::string("no column '") + (name ? name : "") + "'");
+        return nullptr;
+    }
+    switch (c->type) {
+    case ColType::F64: return c->f64.data();
+    case ColType::I64: return c->i64.data();
+    case ColType::STR: return c->codes.data();
+    }
+    return nullptr;
+}
+
+size_t reu_store_dict_size(const reu_store* s, const char* name) {
+    const Column* c = s->store.find(name ? name : "");
+    return c && c->type == ColType::STR ? c->dict.size() : 0;
+}
+
+const char* reu_store_dict(const reu_store* s, const char* name, size_t code) {
+    const Column* c = s->store.find(name ? name : "");
+    if (!c || c->type != ColType::STR || code >= c->dict.size())
+        return nullptr;
+    return c->dict[code].c_str();
+}
+
+int reu_store_select(reu_store* s, const char* tool, const char* kernel, const char* opt,
+                     const char* box, const char* filters, const uint32_t** rows, size_t* n) {
+    auto arg = [](const char* v, const char* dflt) { return std::string(v ? v : dflt); };
+    std::string err;
+    if (!select_rows(s->store, arg(tool, "*"), arg(kernel, "*"), arg(opt, "*"), arg(box, "*"),
+                     arg(filters, ""), s->selection, err))
+        return fail(err);
+    *rows = s->selection.data();
+    *n = s->selection.size();
+    return 0;
+}
+
+struct reu_table {
+    TextTable table;
+};
+
+reu_table* reu_table_read(const char* path, unsigned jobs) {
+    auto* t = new reu_table;
+    std::string err;
+    if (!read_text_table(path ? path : "", jobs ? jobs : default_jobs(), t->table, err)) {
+        fail(err);
+        delete t;
+        return nullptr;
+    }
+    return t;
+}
+
+void reu_table_close(reu_table* t) {
+    delete t;
+}
+
+size_t reu_table_rows(const reu_table* t) {
+    return t->table.rows();
+}
+
+size_t reu_table_skipped(const reu_table* t) {
+    return t->table.skipped;
+}
+
+int reu_table_columns(const reu_table* t) {
+    return int(t->table.names.size());
+}
+
+const char* reu_table_column_name(const reu_table* t, int i) {
+    const auto& names = t->table.names;
+    return i >= 0 && size_t(i) < names.size() ? names[size_t(i)].c_str() : nullptr;
+}
+
+const double* reu_table_data(const reu_table* t, int i) {
+    const auto& cols = t->table.columns;
+    return i >= 0 && size_t(i) < cols.size() ? cols[size_t(i)].data() : nullptr;
+}
+
+int reu_table_write(const char* path, const char* const* names, const double* const* columns,
+                    int ncols, size_t rows, char sep, unsigned jobs) {
+    if (ncols < 1)
+        return fail("no columns to write");
+    if (sep != ' ' && sep != ',')
+        return fail("separator must be ' ' or ','");
+    std::vector<std::string> n(names, names + ncols);
+    std::vector<const double*> c(columns, columns + ncols);
+    std::string err;
+    if (!write_text_table(path ? path : "", n, c, rows, sep, pick_jobs(jobs, rows / 64), err))
+        return fail(err);
+    return 0;
+}
+
+}  // extern "C"
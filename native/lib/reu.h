@@ -0,0 +1,152 @@
+/*
+ * C interface of libreu.so, the shared library behind python/reu.py.
+ *
+ * Every array is caller-owned, C-order and written in place, so numpy
+ * arrays pass through without copies. Functions returning int give 0 on
+ * success and -1 on error, with the message in reu_last_error(). jobs = 0
+ * uses one thread per CPU core.
+ */
+#ifndef REU_H
+#define REU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { REU_F64 = 0, REU_F32 = 1, REU_MCA = 2, REU_LOWP = 3, REU_VPREC = 4 };
+
+/*
+ * Arithmetic a kernel is evaluated in, as fpsweep -t / -M / -q and
+ * precgrid select it. mca_mode and format index McaMode (mca, pb, rr) and
+ * Lowp (bf16, fp16, e4m3, e5m2); points is a mask from reu_parse_points.
+ */
+typedef struct {
+    int arith;
+    int precision;  /* MCA virtual precision, VPREC mantissa bits */
+    int range;      /* VPREC exponent bits */
+    int mca_mode;
+    int format;
+    unsigned points;
+    int nearest;
+    uint64_t seed;
+} reu_arith;
+
+const char* reu_last_error(void);
+
+int reu_kernel_count(void);
+int reu_kernel_info(int i, const char** name, const char** source, int* n_in, int* n_out,
+                    unsigned* points);
+unsigned reu_parse_points(const char* list);
+
+/*
+ * x: n points of n_in inputs. y: n * iterations * n_out samples. Point i
+ * draws from the same counter range as point i of an fpsweep grid, so a
+ * sweep over the same points reproduces fpsweep's .tab samples.
+ */
+int reu_sample(const char* kernel, const reu_arith* a, const double* x, size_t n,
+               int iterations, unsigned jobs, double* y);
+
+/* Long double oracle: ref holds n * n_out values. */
+int reu_oracle(const char* kernel, const double* x, size_t n, unsigned jobs, long double* ref);
+
+/*
+ * Bits cancelled by each addition and subtraction (src/cancel.hpp) at the
+ * points x: bits holds n * max_sites values, 255 where a point did not reach
+ * a site. sites gets the most sites any point reached.
+ */
+int reu_cancel(const char* kernel, const double* x, size_t n, int max_sites, unsigned jobs,
+               uint8_t* bits, int* sites);
+
+/*
+ * Certified maximum absolute rounding error of each output over the box
+ * [lo, hi] (n_in values each), by branch-and-bound over the interval error
+ * model (src/bnb.hpp) with a precision-bit significand and tiny as the
+ * absolute error of an underflow. bounds holds n_out (lower, upper) pairs,
+ * argmax n_out * n_in inputs where the lower bound is attained; upper is
+ * inf where a branch or domain check could not be resolved.
+ */
+int reu_error_bound(const char* kernel, const double* lo, const double* hi, int precision,
+                    double tiny, double rel_tol, size_t max_boxes, unsigned jobs, double* bounds,
+                    double* argmax);
+
+/*
+ * First-order error bound of each output over each of n boxes (lo, hi:
+ * n * n_in values), from the kernel's error expression compiled once per
+ * branch path and cached (src/errexpr.hpp; needs a C++ compiler, $CXX, the
+ * first time). out_lo, out_hi and err hold n * n_out values: the enclosure
+ * of the exact output and the bound, inf where a branch goes both ways
+ * over the box or it leaves the domain of sqrt or /.
+ */
+int reu_error_expr(const char* kernel, const double* lo, const double* hi, size_t n,
+                   int precision, double tiny, unsigned jobs, double* out_lo, double* out_hi,
+                   double* err);
+
+/* Elementwise metrics.hpp kernels over n values. */
+int reu_ulp_error(const double* y, const long double* ref, size_t n, int precision, int emin,
+                  unsigned jobs, double* out);
+int reu_sig_digits(const double* y, const long double* ref, size_t n, double cap, unsigned jobs,
+                   double* out);
+/*
+ * y: n points of `samples` sample-major vectors of m outputs. per_out gets
+ * n * m digits, norm (may be NULL) the n norm-wise digits.
+ */
+int reu_mca_sig_digits(const double* y, size_t n, int samples, int m, double cap,
+                       unsigned jobs, double* per_out, double* norm);
+
+/*
+ * Digits at a probability and confidence (src/sigest.hpp), y as above. ref
+ * holds n * m exact values, or is NULL to measure against the sample mean.
+ * cap_bits is the precision sampled. cnh and bern get n * m digits each
+ * (bern may be NULL); the Bernoulli ones are NaN with too few samples.
+ */
+int reu_confident_digits(const double* y, const double* ref, size_t n, int samples, int m,
+                         double probability, double confidence, double cap_bits, unsigned jobs,
+                         double* cnh, double* bern);
+
+/*
+ * Read-only view of a result store. Column data pointers stay valid until
+ * reu_store_close; a selection stays valid until the next reu_store_select.
+ * Types are 0 = F64 (double), 1 = I64 (int64_t), 2 = STR (uint32_t codes
+ * into the dictionary, code 0 = "").
+ */
+typedef struct reu_store reu_store;
+
+reu_store* reu_store_open(const char* path);
+void reu_store_close(reu_store* s);
+size_t reu_store_rows(const reu_store* s);
+int reu_store_columns(const reu_store* s);
+const char* reu_store_column_name(const reu_store* s, int i);
+int reu_store_column_type(const reu_store* s, const char* name);
+const void* reu_store_data(const reu_store* s, const char* name);
+size_t reu_store_dict_size(const reu_store* s, const char* name);
+const char* reu_store_dict(const reu_store* s, const char* name, size_t code);
+int reu_store_select(reu_store* s, const char* tool, const char* kernel, const char* opt,
+                     const char* box, const char* filters, const uint32_t** rows, size_t* n);
+
+/*
+ * Numeric text tables (.tab, CSV): a header of names, whitespace or comma
+ * separated numbers. Read in chunks parsed on `jobs` threads; written with
+ * the shortest text that reads back to the same doubles. Column data stays
+ * valid until reu_table_close.
+ */
+typedef struct reu_table reu_table;
+
+reu_table* reu_table_read(const char* path, unsigned jobs);
+void reu_table_close(reu_table* t);
+size_t reu_table_rows(const reu_table* t);
+size_t reu_table_skipped(const reu_table* t); /* malformed rows left out */
+int reu_table_columns(const reu_table* t);
+const char* reu_table_column_name(const reu_table* t, int i);
+const double* reu_table_data(const reu_table* t, int i);
+/* columns[c] points to `rows` doubles; sep is ' ' or ','. */
+int reu_table_write(const char* path, const char* const* names, const double* const* columns,
+                    int ncols, size_t rows, char sep, unsigned jobs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
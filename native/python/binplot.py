@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+Plots from pre-aggregated bins written by `native/bin/rstore bins`
+A line plot (value range and mean per x-bin, significant-digit quantiles
+below) for 1D bins, or a heatmap of one bin statistic for (x, y) tiles.
+Memory and plotting time depend only on the number of bins, not on how
+many samples were aggregated.
+"""
+
+import argparse
+import csv
+import os
+import sys
+from pathlib import Path
+
+import numpy as np
+import matplotlib
+matplotlib.use('Agg')
+import matplotlib.pyplot as plt
+
+try:
+    import reu  # native CSV parsing when bin/libreu.so is built
+except (ImportError, OSError):
+    reu = None
+
+
+def parse_arguments():
+    """Parse command line arguments"""
+    parser = argparse.ArgumentParser(
+        description='Plot x-bins or tiles aggregated by rstore bins',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  rstore bins -k gelu_tanh0 -w precision=24 -x x0:2000 -L 400 > gelu.csv
+  %(prog)s gelu.csv
+
+  rstore bins -k softmax_og0 -b softmax8 -w precision=53 -x x0:256 -y x2:256 > sm.csv
+  %(prog)s sm.csv --value sig_min --format png
+        """
+    )
+    parser.add_argument('csvfile', help="CSV written by 'rstore bins'")
+    parser.add_argument('--value', default='sig_min',
+                        help='Tile statistic for heatmaps (default: sig_min)')
+    parser.add_argument('--logy', action='store_true',
+                        help='Log scale for the value axis of line plots')
+    parser.add_argument('--title', help='Custom title for the plot')
+    parser.add_argument('--output', help='Output filename (default: next to the CSV)')
+    parser.add_argument('--format', default='pdf', choices=['pdf', 'png', 'svg'],
+                        help='Output format (default: pdf)')
+    parser.add_argument('--dpi', type=int, default=300,
+                        help='DPI for raster formats (default: 300)')
+    args = parser.parse_args()
+    if not os.path.exists(args.csvfile):
+        parser.error(f"Input file '{args.csvfile}' not found")
+    return args
+
+
+def load_bins(filename):
+    """Columns of the bins CSV as float arrays (empty fields become NaN)"""
+    if reu is not None:
+        bins = reu.read_table(filename)
+        if bins and len(next(iter(bins.values()))):
+            return bins
+    else:
+        with open(filename, newline='') as f:
+            rows = list(csv.DictReader(f))
+        if rows:
+            return {key: np.array([float(r[key]) if r[key] else np.nan for r in rows])
+                    for key in rows[0]}
+    print(f"Error: no bins in {filename}")
+    sys.exit(1)
+
+
+def plot_line(bins, args, ax_val, ax_sig):
+    """Value envelope, min/max of the per-point values and mean per x-bin"""
+    x = 0.5 * (bins['x_lo'] + bins['x_hi'])
+    ax_val.fill_between(x, bins['env_lo'], bins['env_hi'], step='mid', alpha=0.2,
+                        color='tab:blue', label='sample range')
+    ax_val.fill_between(x, bins['min'], bins['max'], step='mid', alpha=0.35,
+                        color='tab:blue', label='min/max of point means')
+    ax_val.plot(x, bins['mean'], color='tab:blue', linewidth=1.0, label='mean')
+    if args.logy:
+        ax_val.set_yscale('log')
+    ax_val.set_ylabel('Result')
+    ax_val.legend(loc='best', fontsize=8)
+    ax_val.grid(True, alpha=0.3)
+
+    ax_sig.fill_between(x, bins['sig_p10'], bins['sig_p90'], step='mid', alpha=0.3,
+                        color='tab:green', label='p10-p90')
+    ax_sig.plot(x, bins['sig_p50'], color='tab:green', linewidth=1.0, label='median')
+    ax_sig.plot(x, bins['sig_min'], color='tab:red', linewidth=0.8, label='min')
+    ax_sig.set_xlabel('x')
+    ax_sig.set_ylabel('Significant digits')
+    ax_sig.legend(loc='best', fontsize=8)
+    ax_sig.grid(True, alpha=0.3)
+
+
+def plot_tiles(bins, args, ax):
+    """One statistic over the (x, y) tiles; missing tiles stay blank"""
+    if args.value not in bins:
+        print(f"Error: no column '{args.value}' in {args.csvfile}")
+        sys.exit(1)
+    xe = np.unique(np.concatenate([bins['x_lo'], bins['x_hi']]))
+    ye = np.unique(np.concatenate([bins['y_lo'], bins['y_hi']]))
+    grid = np.full((len(ye) - 1 if len(ye) > 1 else 1, len(xe) - 1), np.nan)
+    xi = np.searchsorted(xe, bins['x_lo'])
+    yi = np.searchsorted(ye, bins['y_lo'])
+    grid[np.minimum(yi, grid.shape[0] - 1), xi] = bins[args.value]
+    if len(ye) == 1:
+        ye = np.array([ye[0] - 0.5, ye[0] + 0.5])
+    mesh = ax.pcolormesh(xe, ye, np.ma.masked_invalid(grid), shading='flat', cmap='viridis')
+    plt.colorbar(mesh, ax=ax, label=args.value)
+    ax.set_xlabel('x')
+    ax.set_ylabel('y')
+
+
+def main():
+    args = parse_arguments()
+    bins = load_bins(args.csvfile)
+    tiled = 'y_lo' in bins
+
+    if tiled:
+        fig, ax = plt.subplots(figsize=(9, 7))
+        plot_tiles(bins, args, ax)
+        axes = [ax]
+    else:
+        fig, axes = plt.subplots(2, 1, figsize=(10, 8), sharex=True,
+                                 gridspec_kw={'height_ratios': [2, 1]})
+        plot_line(bins, args, axes[0], axes[1])
+    title = args.title or f"{Path(args.csvfile).stem} ({len(bins['count'])} bins, " \
+                          f"{int(np.nansum(bins['count']))} points)"
+    axes[0].set_title(title)
+    fig.tight_layout()
+
+    output = args.output or str(Path(args.csvfile).with_suffix('.' + args.format))
+    fig.savefig(output, dpi=args.dpi)
+    print(f"Plot saved to: {output}")
+
+
+if __name__ == '__main__':
+    main()
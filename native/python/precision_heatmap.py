@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+Precision-space heatmaps from a precgrid CSV
+Plots max ULP error, overflow rate and minimum significant digits over the
+(exponent bits, mantissa bits) plane, and marks the smallest format meeting
+a digit target
+"""
+
+import argparse
+import csv
+import os
+import sys
+from pathlib import Path
+
+import numpy as np
+import matplotlib
+matplotlib.use('Agg')
+import matplotlib.pyplot as plt
+
+
+def parse_arguments():
+    """Parse command line arguments"""
+    parser = argparse.ArgumentParser(
+        description='Plot precgrid precision-space results',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  %(prog)s precgrid_results/gelu_tanh0-precgrid-out.csv
+  %(prog)s precgrid_results/softmax_stable-precgrid-ops.csv --digits 3 --format png
+        """
+    )
+    parser.add_argument('csvfile', help='CSV written by native/bin/precgrid')
+    parser.add_argument('--digits', type=float, default=2.0,
+                        help='Significant-digit target to outline (default: 2)')
+    parser.add_argument('--output', help='Output filename (default: next to the CSV)')
+    parser.add_argument('--format', default='pdf', choices=['pdf', 'png', 'svg'],
+                        help='Output format (default: pdf)')
+    parser.add_argument('--dpi', type=int, default=300,
+                        help='DPI for raster formats (default: 300)')
+    args = parser.parse_args()
+    if not os.path.exists(args.csvfile):
+        parser.error(f"Input file '{args.csvfile}' not found")
+    return args
+
+
+def load_grid(filename):
+    """Pivot the CSV rows into dense arrays indexed by (exp_bits, man_bits)"""
+    with open(filename, newline='') as f:
+        rows = list(csv.DictReader(f))
+    if not rows:
+        print(f"Error: no rows in {filename}")
+        sys.exit(1)
+
+    exp_bits = sorted({int(r['exp_bits']) for r in rows})
+    man_bits = sorted({int(r['man_bits']) for r in rows})
+    ei = {e: i for i, e in enumerate(exp_bits)}
+    mi = {m: i for i, m in enumerate(man_bits)}
+
+    grids = {}
+    for key in ('max_ulp', 'overflow_rate', 'min_sig_digits'):
+        grid = np.full((len(exp_bits), len(man_bits)), np.nan)
+        for r in rows:
+            grid[ei[int(r['exp_bits'])], mi[int(r['man_bits'])]] = float(r[key])
+        grids[key] = grid
+    return np.array(exp_bits), np.array(man_bits), grids
+
+
+def plot(exp_bits, man_bits, grids, args):
+    """Three heatmaps sharing the precision-space axes"""
+    extent = (man_bits[0] - 0.5, man_bits[-1] + 0.5, exp_bits[0] - 0.5, exp_bits[-1] + 0.5)
+    fig, axes = plt.subplots(3, 1, figsize=(10, 11), sharex=True)
+
+    ulp = np.log10(np.clip(grids['max_ulp'], 1e-3, 1e30))
+    panels = [
+        (ulp, 'log10(max ULP error)', 'magma'),
+        (grids['overflow_rate'], 'Overflow rate', 'Reds'),
+        (grids['min_sig_digits'], 'Min significant digits', 'viridis'),
+    ]
+    for ax, (data, label, cmap) in zip(axes, panels):
+        im = ax.imshow(data, origin='lower', extent=extent, aspect='auto',
+                       interpolation='nearest', cmap=cmap)
+        fig.colorbar(im, ax=ax, label=label)
+        ax.set_ylabel('Exponent bits')
+        ax.set_title(label)
+
+    # Outline every format meeting the target and star the smallest one
+    ok = (grids['overflow_rate'] == 0) & (grids['min_sig_digits'] >= args.digits)
+    axes[2].contour(man_bits, exp_bits, ok.astype(float), levels=[0.5], colors='white')
+    if ok.any():
+        ie, im_ = np.nonzero(ok)
+        total = exp_bits[ie] + man_bits[im_]
+        best = np.lexsort((-man_bits[im_], total))[0]
+        for ax in axes:
+            ax.plot(man_bits[im_[best]], exp_bits[ie[best]], 'w*', markersize=14,
+                    markeredgecolor='k')
+        print(f"Smallest format with >= {args.digits} digits and no overflow: "
+              f"{exp_bits[ie[best]]} exponent + {man_bits[im_[best]]} mantissa bits")
+
+    axes[-1].set_xlabel('Mantissa bits')
+    fig.suptitle(Path(args.csvfile).stem)
+    plt.tight_layout()
+    return fig
+
+
+def main():
+    """Main function"""
+    args = parse_arguments()
+    exp_bits, man_bits, grids = load_grid(args.csvfile)
+    fig = plot(exp_bits, man_bits, grids, args)
+
+    output = args.output or str(Path(args.csvfile).with_suffix(f'.{args.format}'))
+    save_kwargs = {'format': args.format}
+    if args.format == 'png':
+        save_kwargs['dpi'] = args.dpi
+    fig.savefig(output, **save_kwargs)
+    print(f"Plot saved to: {output}")
+
+
+if __name__ == "__main__":
+    main()
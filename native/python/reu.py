@@ -0,0 +1,389 @@
+#!/usr/bin/env python3
+"""
+In-process access to the native engines through bin/libreu.so (ctypes)
+Sweeps a registered kernel in any of the emulated arithmetics, evaluates
+the long double oracle, computes ULP errors and significant digits, reads
+result stores, and reads and writes numeric text tables (.tab, CSV).
+Arrays go to and from the library without copies: inputs are passed by
+pointer when already C-contiguous with the right dtype, outputs are numpy
+arrays the library fills in place, and store and table columns are numpy
+views of the loaded columns.
+
+    import reu
+    x = np.linspace(0, 1, 10**6)[:, None]
+    y = reu.sample('ex1_original', x, iterations=20, mca=24)   # (n, 20, 1)
+    sig = reu.mca_sig_digits(y, cap=reu.digits_of_bits(24))   # (n, 1)
+    ulp = reu.ulp_error(y[:, 0, 0], reu.oracle('ex1_original', x)[:, 0], 23, -126)
+
+    st = reu.Store('results.rstore')
+    rows = st.select(kernel='softmax_og0', filters='precision=24')
+    x0, sig = st['x0'][rows], st['sig_digits'][rows]
+
+    df = pd.DataFrame(reu.read_table('results/gelu_tanh0-DOUBLE-vp24-mca.tab'))
+    reu.write_table('out.csv', df, sep=',')
+
+The library is bin/libreu.so next to this directory, or $REU_LIB.
+"""
+
+import ctypes as C
+import math
+import os
+
+import numpy as np
+
+F64, F32, MCA, LOWP, VPREC = range(5)
+MCA_MODES = ('mca', 'pb', 'rr')
+FORMATS = ('bf16', 'fp16', 'e4m3', 'e5m2')
+
+
+class Arith(C.Structure):
+    _fields_ = [('arith', C.c_int), ('precision', C.c_int), ('range', C.c_int),
+                ('mca_mode', C.c_int), ('format', C.c_int), ('points', C.c_uint),
+                ('nearest', C.c_int), ('seed', C.c_uint64)]
+
+
+class ReuError(RuntimeError):
+    pass
+
+
+def _load():
+    path = os.environ.get('REU_LIB') or os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), '..', 'bin', 'libreu.so')
+    lib = C.CDLL(path)
+    ptr, size, uint, cstr = C.c_void_p, C.c_size_t, C.c_uint, C.c_char_p
+    sigs = {
+        'reu_last_error': (cstr, []),
+        'reu_kernel_count': (C.c_int, []),
+        'reu_kernel_info': (C.c_int, [C.c_int, C.POINTER(cstr), C.POINTER(cstr),
+                                      C.POINTER(C.c_int), C.POINTER(C.c_int), C.POINTER(uint)]),
+        'reu_parse_points': (uint, [cstr]),
+        'reu_sample': (C.c_int, [cstr, C.POINTER(Arith), ptr, size, C.c_int, uint, ptr]),
+        'reu_oracle': (C.c_int, [cstr, ptr, size, uint, ptr]),
+        'reu_cancel': (C.c_int, [cstr, ptr, size, C.c_int, uint, ptr, C.POINTER(C.c_int)]),
+        'reu_error_bound': (C.c_int, [cstr, ptr, ptr, C.c_int, C.c_double, C.c_double, size,
+                                      uint, ptr, ptr]),
+        'reu_error_expr': (C.c_int, [cstr, ptr, ptr, size, C.c_int, C.c_double, uint, ptr, ptr,
+                                     ptr]),
+        'reu_ulp_error': (C.c_int, [ptr, ptr, size, C.c_int, C.c_int, uint, ptr]),
+        'reu_sig_digits': (C.c_int, [ptr, ptr, size, C.c_double, uint, ptr]),
+        'reu_mca_sig_digits': (C.c_int, [ptr, size, C.c_int, C.c_int, C.c_double, uint,
+                                         ptr, ptr]),
+        'reu_confident_digits': (C.c_int, [ptr, ptr, size, C.c_int, C.c_int, C.c_double,
+                                           C.c_double, C.c_double, uint, ptr, ptr]),
+        'reu_store_open': (ptr, [cstr]),
+        'reu_store_close': (None, [ptr]),
+        'reu_store_rows': (size, [ptr]),
+        'reu_store_columns': (C.c_int, [ptr]),
+        'reu_store_column_name': (cstr, [ptr, C.c_int]),
+        'reu_store_column_type': (C.c_int, [ptr, cstr]),
+        'reu_store_data': (ptr, [ptr, cstr]),
+        'reu_store_dict_size': (size, [ptr, cstr]),
+        'reu_store_dict': (cstr, [ptr, cstr, size]),
+        'reu_store_select': (C.c_int, [ptr, cstr, cstr, cstr, cstr, cstr,
+                                       C.POINTER(C.POINTER(C.c_uint32)), C.POINTER(size)]),
+        'reu_table_read': (ptr, [cstr, uint]),
+        'reu_table_close': (None, [ptr]),
+        'reu_table_rows': (size, [ptr]),
+        'reu_table_skipped': (size, [ptr]),
+        'reu_table_columns': (C.c_int, [ptr]),
+        'reu_table_column_name': (cstr, [ptr, C.c_int]),
+        'reu_table_data': (ptr, [ptr, C.c_int]),
+        'reu_table_write': (C.c_int, [cstr, C.POINTER(cstr), C.POINTER(ptr), C.c_int, size,
+                                      C.c_char, uint]),
+    }
+    for name, (res, args) in sigs.items():
+        fn = getattr(lib, name)
+        fn.restype, fn.argtypes = res, args
+    return lib
+
+
+_lib = _load()
+
+
+def _check(rc):
+    if rc != 0:
+        raise ReuError(_lib.reu_last_error().decode())
+
+
+def _in(a, dtype):
+    """C-contiguous view of a (a copy only if the layout or dtype differs)"""
+    return np.ascontiguousarray(a, dtype=dtype)
+
+
+def _p(a):
+    return a.ctypes.data_as(C.c_void_p)
+
+
+def digits_of_bits(p):
+    return p * math.log10(2.0)
+
+
+def kernels():
+    """{name: (source, n_in, n_out, points mask)} of the registered kernels"""
+    out = {}
+    name, source = C.c_char_p(), C.c_char_p()
+    n_in, n_out, points = C.c_int(), C.c_int(), C.c_uint()
+    for i in range(_lib.reu_kernel_count()):
+        _check(_lib.reu_kernel_info(i, C.byref(name), C.byref(source), C.byref(n_in),
+                                    C.byref(n_out), C.byref(points)))
+        out[name.value.decode()] = (source.value.decode(), n_in.value, n_out.value,
+                                    points.value)
+    return out
+
+
+def _kernel(name):
+    k = kernels().get(name)
+    if k is None:
+        raise ReuError(f"unknown kernel '{name}'")
+    return k
+
+
+def sample(kernel, x, iterations=1, mca=None, mca_mode='mca', lowp=None, points='all',
+           nearest=False, vprec=None, dtype='DOUBLE', seed=1, jobs=0):
+    """
+    Samples of kernel at the points x (n, n_in) as an (n, iterations, n_out)
+    array. Arithmetic: mca=PRECISION (with mca_mode), lowp=FORMAT (fp32
+    compute, rounding at `points`), vprec=(PRECISION, RANGE), else native
+    dtype 'DOUBLE' or 'FLOAT'. Point i uses fpsweep's random stream for grid
+    point i.
+    """
+    _, n_in, n_out, _ = _kernel(kernel)
+    x = _in(x, np.float64).reshape(-1, n_in)
+    a = Arith(seed=seed)
+    if mca is not None:
+        a.arith, a.precision, a.mca_mode = MCA, mca, MCA_MODES.index(mca_mode)
+    elif lowp is not None:
+        a.arith, a.format, a.nearest = LOWP, FORMATS.index(lowp), int(nearest)
+        a.points = _lib.reu_parse_points(points.encode())
+    elif vprec is not None:
+        a.arith, (a.precision, a.range) = VPREC, vprec
+    else:
+        a.arith = F32 if dtype == 'FLOAT' else F64
+    y = np.empty((len(x), iterations, n_out))
+    _check(_lib.reu_sample(kernel.encode(), C.byref(a), _p(x), len(x), iterations, jobs, _p(y)))
+    return y
+
+
+def oracle(kernel, x, jobs=0):
+    """Long double reference outputs (n, n_out) at the points x (n, n_in)"""
+    _, n_in, n_out, _ = _kernel(kernel)
+    x = _in(x, np.float64).reshape(-1, n_in)
+    ref = np.empty((len(x), n_out), dtype=np.longdouble)
+    _check(_lib.reu_oracle(kernel.encode(), _p(x), len(x), jobs, _p(ref)))
+    return ref
+
+
+def cancellation(kernel, x, max_sites=64, jobs=0):
+    """
+    Bits cancelled by each addition and subtraction of the kernel at the
+    points x (n, n_in), in execution order: uint8 (n, sites), 255 where a
+    point did not reach a site
+    """
+    _, n_in, _, _ = _kernel(kernel)
+    x = _in(x, np.float64).reshape(-1, n_in)
+    bits = np.empty((len(x), max_sites), dtype=np.uint8)
+    sites = C.c_int()
+    _check(_lib.reu_cancel(kernel.encode(), _p(x), len(x), max_sites, jobs, _p(bits),
+                           C.byref(sites)))
+    return bits[:, :min(sites.value, max_sites)]
+
+
+def error_bound(kernel, lo, hi, precision=53, rel_tol=1e-3, max_boxes=1000000, jobs=0):
+    """
+    Certified maximum absolute rounding error of each output over the box
+    [lo, hi] with a `precision`-bit significand (24 gives fp32's range too):
+    (lower, upper) as (n_out, 2) and the inputs attaining lower, (n_out, n_in)
+    """
+    _, n_in, n_out, _ = _kernel(kernel)
+    lo = _in(np.broadcast_to(lo, n_in), np.float64)
+    hi = _in(np.broadcast_to(hi, n_in), np.float64)
+    tiny = 2.0 ** -149 if precision <= 24 else 2.0 ** -1074
+    bounds = np.empty((n_out, 2))
+    argmax = np.empty((n_out, n_in))
+    _check(_lib.reu_error_bound(kernel.encode(), _p(lo), _p(hi), precision, tiny, rel_tol,
+                                int(max_boxes), jobs, _p(bounds), _p(argmax)))
+    return bounds, argmax
+
+
+def error_expr(kernel, lo, hi, precision=53, jobs=0):
+    """
+    First-order error bound of each output over each box [lo, hi] (n, n_in),
+    from the kernel's compiled error expression: the enclosure of the exact
+    output (lo, hi) and the bound, each (n, n_out); the bound is inf where a
+    branch goes both ways over the box
+    """
+    _, n_in, n_out, _ = _kernel(kernel)
+    lo, hi = np.broadcast_arrays(np.asarray(lo, np.float64), np.asarray(hi, np.float64))
+    lo, hi = _in(lo, np.float64).reshape(-1, n_in), _in(hi, np.float64).reshape(-1, n_in)
+    n = lo.shape[0]
+    tiny = 2.0 ** -149 if precision <= 24 else 2.0 ** -1074
+    out_lo, out_hi, err = np.empty((n, n_out)), np.empty((n, n_out)), np.empty((n, n_out))
+    _check(_lib.reu_error_expr(kernel.encode(), _p(lo), _p(hi), n, precision, tiny, jobs,
+                               _p(out_lo), _p(out_hi), _p(err)))
+    return out_lo, out_hi, err
+
+
+def ulp_error(y, ref, precision, emin, jobs=0):
+    """
+    Error of y against ref in ULPs of a format with `precision` explicit
+    mantissa bits and smallest normal exponent emin (23, -126 for fp32)
+    """
+    y, ref = _in(y, np.float64), _in(ref, np.longdouble)
+    out = np.empty(y.shape)
+    _check(_lib.reu_ulp_error(_p(y), _p(ref), y.size, precision, emin, jobs, _p(out)))
+    return out
+
+
+def sig_digits(y, ref, cap, jobs=0):
+    """-log10(|y - ref| / |ref|), capped at cap digits"""
+    y, ref = _in(y, np.float64), _in(ref, np.longdouble)
+    out = np.empty(y.shape)
+    _check(_lib.reu_sig_digits(_p(y), _p(ref), y.size, cap, jobs, _p(out)))
+    return out
+
+
+def mca_sig_digits(y, cap, norm=False, jobs=0):
+    """
+    Significant digits of the samples y (n, samples, n_out) per point and
+    output, (n, n_out); with norm=True also the norm-wise digits (n,)
+    """
+    y = _in(y, np.float64)
+    n, samples, m = y.shape
+    per_out = np.empty((n, m))
+    nw = np.empty(n) if norm else None
+    _check(_lib.reu_mca_sig_digits(_p(y), n, samples, m, cap, jobs, _p(per_out),
+                                   _p(nw) if norm else None))
+    return (per_out, nw) if norm else per_out
+
+
+def confident_digits(y, cap_bits, probability=0.9, confidence=0.95, ref=None, jobs=0):
+    """
+    Digits of the samples y (n, samples, n_out) that a fresh sample keeps
+    with the given probability, at the given confidence: the CNH and the
+    Bernoulli estimates, each (n, n_out). ref (n, n_out) is the exact
+    result, by default the sample mean. Bernoulli digits are NaN with fewer
+    samples than the level needs (29 at the defaults).
+    """
+    y = _in(y, np.float64)
+    n, samples, m = y.shape
+    r = None if ref is None else _in(np.broadcast_to(ref, (n, m)), np.float64)
+    cnh, bern = np.empty((n, m)), np.empty((n, m))
+    _check(_lib.reu_confident_digits(_p(y), None if r is None else _p(r), n, samples, m,
+                                     probability, confidence, cap_bits, jobs, _p(cnh),
+                                     _p(bern)))
+    return cnh, bern
+
+
+class Store:
+    """
+    A result store loaded in native memory. st[name] is a read-only numpy
+    view of a column (float64, int64, or uint32 dictionary codes for string
+    columns; st.strings(name) decodes those). Views keep the store alive.
+    """
+
+    _DTYPES = (np.float64, np.int64, np.uint32)
+
+    def __init__(self, path='results.rstore'):
+        self._h = _lib.reu_store_open(path.encode())
+        if not self._h:
+            raise ReuError(_lib.reu_last_error().decode())
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.reu_store_close(self._h)
+            self._h = None
+
+    def __len__(self):
+        return _lib.reu_store_rows(self._h)
+
+    def columns(self):
+        return [_lib.reu_store_column_name(self._h, i).decode()
+                for i in range(_lib.reu_store_columns(self._h))]
+
+    def __getitem__(self, name):
+        t = _lib.reu_store_column_type(self._h, name.encode())
+        if t < 0:
+            raise KeyError(name)
+        dtype = np.dtype(self._DTYPES[t])
+        addr = _lib.reu_store_data(self._h, name.encode())
+        if not addr or len(self) == 0:
+            return np.empty(0, dtype=dtype)
+        buf = (C.c_char * (len(self) * dtype.itemsize)).from_address(addr)
+        buf._store = self
+        view = np.frombuffer(buf, dtype=dtype)
+        view.flags.writeable = False
+        return view
+
+    def dictionary(self, name):
+        """Distinct values of a string column, indexed by code"""
+        n = _lib.reu_store_dict_size(self._h, name.encode())
+        return [_lib.reu_store_dict(self._h, name.encode(), i).decode() for i in range(n)]
+
+    def strings(self, name, rows=None):
+        codes = self[name] if rows is None else self[name][rows]
+        return np.array(self.dictionary(name), dtype=object)[codes]
+
+    def select(self, tool='*', kernel='*', opt='*', box='*', filters=''):
+        """Row indices of a selection, as rstore -t/-k/-O/-b/-w take it"""
+        rows, n = C.POINTER(C.c_uint32)(), C.c_size_t()
+        _check(_lib.reu_store_select(self._h, tool.encode(), kernel.encode(), opt.encode(),
+                                     box.encode(), filters.encode(), C.byref(rows), C.byref(n)))
+        if n.value == 0:
+            return np.empty(0, dtype=np.uint32)
+        return np.ctypeslib.as_array(rows, shape=(n.value,)).copy()
+
+
+class _Table:
+    """Owner of a native text table; column views keep it alive"""
+
+    def __init__(self, handle):
+        self._h = handle
+
+    def __del__(self):
+        if getattr(self, '_h', None):
+            _lib.reu_table_close(self._h)
+            self._h = None
+
+
+def read_table(path, jobs=0):
+    """
+    Columns of a numeric .tab or CSV file as {name: float64 array}, parsed
+    natively in chunks on `jobs` threads (empty CSV fields are NaN, rows
+    that do not parse are left out). The arrays are read-only views of the
+    native columns; pd.DataFrame(read_table(path)) takes the place of
+    pd.read_csv for result tables.
+    """
+    h = _lib.reu_table_read(path.encode(), jobs)
+    if not h:
+        raise ReuError(_lib.reu_last_error().decode())
+    t = _Table(h)
+    n = _lib.reu_table_rows(h)
+    out = {}
+    for i in range(_lib.reu_table_columns(h)):
+        name = _lib.reu_table_column_name(h, i).decode()
+        if n == 0:
+            out[name] = np.empty(0)
+            continue
+        buf = (C.c_double * n).from_address(_lib.reu_table_data(h, i))
+        buf._table = t
+        view = np.frombuffer(buf, dtype=np.float64)
+        view.flags.writeable = False
+        out[name] = view
+    return out
+
+
+def write_table(path, columns, sep=' ', jobs=0):
+    """
+    Write {name: array} (or a DataFrame) as a text table with a header line,
+    each value as the shortest text that reads back to the same double.
+    sep=' ' gives the .tab layout, sep=',' a CSV.
+    """
+    names = [str(k) for k in columns.keys()]
+    data = [_in(columns[k], np.float64).ravel() for k in columns.keys()]
+    rows = len(data[0]) if data else 0
+    if any(len(d) != rows for d in data):
+        raise ReuError('columns differ in length')
+    c_names = (C.c_char_p * len(names))(*[k.encode() for k in names])
+    c_cols = (C.c_void_p * len(data))(*[d.ctypes.data for d in data])
+    _check(_lib.reu_table_write(path.encode(), c_names, c_cols, len(data), rows,
+                                sep.encode(), jobs))
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Error-map viewer for tile pyramids written by `native/bin/rstore pyramid`
+Picks the coarsest level whose cells are no larger than one pixel of the
+requested view, reads only the tiles that overlap it and mosaics them.
+3D pyramids are shown as one slice through the third axis.
+"""
+
+import argparse
+import json
+import os
+import sys
+from pathlib import Path
+
+import numpy as np
+import matplotlib
+matplotlib.use('Agg')
+import matplotlib.pyplot as plt
+
+STATS = ('count', 'max_ulp', 'min_sig')
+
+
+def parse_arguments():
+    """Parse command line arguments"""
+    parser = argparse.ArgumentParser(
+        description='Render a view of an rstore tile pyramid',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog="""
+Examples:
+  rstore pyramid -k softmax_og0 -b softmax8 -w precision=24 -x x0 -y x2 -d sm.tiles
+  %(prog)s sm.tiles
+  %(prog)s sm.tiles --view -1 1 -1 1 --value min_sig --format png
+  %(prog)s sm3.tiles --slice 0.5
+        """
+    )
+    parser.add_argument('pyramid', help="Directory written by 'rstore pyramid'")
+    parser.add_argument('--value', default='max_ulp', choices=STATS,
+                        help='Cell statistic to draw (default: max_ulp)')
+    parser.add_argument('--view', type=float, nargs=4, metavar=('X0', 'X1', 'Y0', 'Y1'),
+                        help='Visible box (default: the whole pyramid)')
+    parser.add_argument('--slice', type=float,
+                        help='Third-axis value for 3D pyramids (default: the middle)')
+    parser.add_argument('--pixels', type=int, default=1024,
+                        help='Pixel budget per axis used to pick the level (default: 1024)')
+    parser.add_argument('--level', type=int, help='Force a pyramid level')
+    parser.add_argument('--log', action='store_true', help='Log color scale')
+    parser.add_argument('--title', help='Custom title for the plot')
+    parser.add_argument('--output', help='Output filename (default: next to the pyramid)')
+    parser.add_argument('--format', default='pdf', choices=['pdf', 'png', 'svg'],
+                        help='Output format (default: pdf)')
+    parser.add_argument('--dpi', type=int, default=300,
+                        help='DPI for raster formats (default: 300)')
+    args = parser.parse_args()
+    if not os.path.exists(os.path.join(args.pyramid, 'meta.json')):
+        parser.error(f"No meta.json in '{args.pyramid}'")
+    return args
+
+
+def read_tile(path, meta):
+    """(count, max_ulp, min_sig) arrays shaped tile^dims, or None if absent"""
+    if not os.path.exists(path):
+        return None
+    t, dims = meta['tile'], meta['dims']
+    n = t ** dims
+    dtype = np.dtype([('magic', 'S8'), ('hdr', '<u4', 6),
+                      ('count', '<u4', n), ('max_ulp', '<f4', n), ('min_sig', '<f4', n)])
+    rec = np.fromfile(path, dtype=dtype, count=1)
+    if len(rec) != 1 or rec['magic'][0] != b'RTILE01':
+        print(f"Error: '{path}' is not a pyramid tile")
+        sys.exit(1)
+    shape = (t,) * dims
+    return {s: rec[s][0].reshape(shape) for s in STATS}
+
+
+def pick_level(meta, view, pixels):
+    """Coarsest level with at least `pixels` cells across the visible part"""
+    frac = max((v1 - v0) / (ax['hi'] - ax['lo']) if ax['hi'] > ax['lo'] else 1.0
+               for (v0, v1), ax in zip(view, meta['axes'][:2]))
+    for level in range(meta['levels']):
+        if meta['tile'] * (1 << level) * frac >= pixels:
+            return level
+    return meta['levels'] - 1
+
+
+def mosaic(args, meta, level, view, z):
+    """Cells of `level` covering the view, with their (x, y) edges"""
+    t = meta['tile']
+    cells = t << level
+    axes = meta['axes']
+
+    def cell_range(a, v0, v1):
+        lo, hi = axes[a]['lo'], axes[a]['hi']
+        w = (hi - lo) / cells if hi > lo else 1.0
+        c0 = int(np.clip(np.floor((v0 - lo) / w), 0, cells - 1))
+        c1 = int(np.clip(np.ceil((v1 - lo) / w), c0 + 1, cells))
+        return c0, c1, lo + w * np.arange(c0, c1 + 1)
+
+    x0, x1, xe = cell_range(0, *view[0])
+    y0, y1, ye = cell_range(1, *view[1])
+    iz = tz = None
+    if meta['dims'] == 3:
+        lo, hi = axes[2]['lo'], axes[2]['hi']
+        w = (hi - lo) / cells if hi > lo else 1.0
+        cz = int(np.clip((z - lo) // w, 0, cells - 1))
+        iz, tz = divmod(cz, t)
+
+    grid = np.full((y1 - y0, x1 - x0), np.nan)
+    loaded = 0
+    for tx in range(x0 // t, (x1 - 1) // t + 1):
+        for ty in range(y0 // t, (y1 - 1) // t + 1):
+            name = f"{tx}_{ty}" + (f"_{iz}" if iz is not None else '') + '.tile'
+            tile = read_tile(os.path.join(args.pyramid, str(level), name), meta)
+            if tile is None:
+                continue
+            loaded += 1
+            vals = tile[args.value].astype(float)
+            if args.value != 'count':
+                vals[tile['count'] == 0] = np.nan
+            else:
+                vals[vals == 0] = np.nan
+            if tz is not None:
+                vals = vals[:, :, tz]
+            # Tile cells are x-major; clip to the view and transpose to (y, x).
+            gx0, gy0 = tx * t, ty * t
+            sx0, sx1 = max(x0, gx0), min(x1, gx0 + t)
+            sy0, sy1 = max(y0, gy0), min(y1, gy0 + t)
+            grid[sy0 - y0:sy1 - y0, sx0 - x0:sx1 - x0] = \
+                vals[sx0 - gx0:sx1 - gx0, sy0 - gy0:sy1 - gy0].T
+    return xe, ye, grid, loaded
+
+
+def main():
+    args = parse_arguments()
+    with open(os.path.join(args.pyramid, 'meta.json')) as f:
+        meta = json.load(f)
+    axes = meta['axes']
+    view = [(args.view[0], args.view[1]), (args.view[2], args.view[3])] if args.view \
+        else [(axes[0]['lo'], axes[0]['hi']), (axes[1]['lo'], axes[1]['hi'])]
+    z = None
+    if meta['dims'] == 3:
+        z = args.slice if args.slice is not None else 0.5 * (axes[2]['lo'] + axes[2]['hi'])
+    level = args.level if args.level is not None else pick_level(meta, view, args.pixels)
+    if not 0 <= level < meta['levels']:
+        print(f"Error: level {level} not in [0, {meta['levels']})")
+        sys.exit(1)
+
+    xe, ye, grid, loaded = mosaic(args, meta, level, view, z)
+    print(f"Level {level}: {loaded} tiles, {grid.shape[1]}x{grid.shape[0]} cells")
+
+    fig, ax = plt.subplots(figsize=(9, 7))
+    data = np.ma.masked_invalid(grid)
+    norm = None
+    if args.log and data.count():
+        norm = matplotlib.colors.LogNorm(vmin=max(data.min(), 1e-3), vmax=max(data.max(), 1e-3))
+    cmap = 'viridis_r' if args.value == 'max_ulp' else 'viridis'
+    mesh = ax.pcolormesh(xe, ye, data, shading='flat', cmap=cmap, norm=norm)
+    label = {'count': 'points', 'max_ulp': f"max ULP error ({meta['ulp']})",
+             'min_sig': f"min {meta['sig']}"}[args.value]
+    plt.colorbar(mesh, ax=ax, label=label)
+    ax.set_xlim(*view[0])
+    ax.set_ylim(*view[1])
+    ax.set_xlabel(axes[0]['column'])
+    ax.set_ylabel(axes[1]['column'])
+    title = args.title or f"{Path(args.pyramid).name} (level {level}" + \
+        (f", {axes[2]['column']} = {z:g})" if z is not None else ')')
+    ax.set_title(title)
+    fig.tight_layout()
+
+    output = args.output or str(Path(args.pyramid).with_suffix('')) + f"_L{level}.{args.format}"
+    fig.savefig(output, dpi=args.dpi)
+    print(f"Plot saved to: {output}")
+
+
+if __name__ == '__main__':
+    main()
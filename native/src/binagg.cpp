@@ -0,0 +1,197 @@
+#include "binagg.hpp"
+
+#include <algorithm>
+
+#include "parallel.hpp"
+
+namespace reu {
+
+void Bin::add(double v, double lo, double hi, double sig) {
+    count++;
+    if (!std::isnan(v)) {
+        value_count++;
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+        sum += v;
+    }
+    env_lo = lo < env_lo ? lo : env_lo;
+    env_hi = hi > env_hi ? hi : env_hi;
+    if (!std::isnan(sig)) {
+        sig_count++;
+        sig_min = sig < sig_min ? sig : sig_min;
+        sig_max = sig > sig_max ? sig : sig_max;
+        int b = int(sig / SIG_STEP);
+        sig_hist[b < 0 ? 0 : b >= SIG_BUCKETS ? SIG_BUCKETS - 1 : b]++;
+    }
+}
+
+void Bin::merge(const Bin& o) {
+    count += o.count;
+    value_count += o.value_count;
+    min = o.min < min ? o.min : min;
+    max = o.max > max ? o.max : max;
+    sum += o.sum;
+    env_lo = o.env_lo < env_lo ? o.env_lo : env_lo;
+    env_hi = o.env_hi > env_hi ? o.env_hi : env_hi;
+    sig_count += o.sig_count;
+    sig_min = o.sig_min < sig_min ? o.sig_min : sig_min;
+    sig_max = o.sig_max > sig_max ? o.sig_max : sig_max;
+    for (int b = 0; b < SIG_BUCKETS; b++)
+        sig_hist[b] += o.sig_hist[b];
+}
+
+double Bin::sig_quantile(double q) const {
+    if (sig_count == 0)
+        return NAN;
+    uint64_t rank = uint64_t(std::ceil(q * double(sig_count)));
+    rank = rank < 1 ? 1 : rank;
+    uint64_t seen = 0;
+    for (int b = 0; b < SIG_BUCKETS; b++) {
+        seen += sig_hist[b];
+        if (seen >= rank)
+            return std::min(sig_max, std::max(sig_min, double(b + 1) * SIG_STEP));
+    }
+    return sig_max;
+}
+
+static double value_at(const Column* c, uint32_t r) {
+    return c ? c->num(r) : NAN;
+}
+
+bool aggregate_bins(const ResultStore& store, const std::vector<uint32_t>& rows,
+                    std::vector<BinAxis>& axes, const std::string& value,
+                    const std::string& sig, unsigned jobs, std::vector<Bin>& out,
+                    std::string& err) {
+    if (axes.empty() || axes.size() > 2) {
+        err = "binning takes one or two axes";
+        return false;
+    }
+    const Column* ac[2] = {nullptr, nullptr};
+    for (size_t a = 0; a < axes.size(); a++) {
+        ac[a] = store.find(axes[a].column);
+        if (!ac[a] || ac[a]->type == ColType::STR) {
+            err = "no numeric column '" + axes[a].column + "'";
+            return false;
+        }
+        if (axes[a].bins == 0) {
+            err = "zero bins on '" + axes[a].column + "'";
+            return false;
+        }
+        // Missing bounds come from the data.
+        if (std::isnan(axes[a].lo) || std::isnan(axes[a].hi)) {
+            double lo = INFINITY, hi = -INFINITY;
+            for (uint32_t r : rows) {
+                double v = value_at(ac[a], r);
+                if (!std::isnan(v)) {
+                    lo = v < lo ? v : lo;
+                    hi = v > hi ? v : hi;
+                }
+            }
+            if (lo > hi)
+                lo = hi = 0.0;
+            if (std::isnan(axes[a].lo))
+                axes[a].lo = lo;
+            if (std::isnan(axes[a].hi))
+                axes[a].hi = hi;
+        }
+        if (!(axes[a].lo <= axes[a].hi)) {
+            err = "empty range on '" + axes[a].column + "'";
+            return false;
+        }
+    }
+    const Column* vc = store.find(value);
+    if (!vc || vc->type == ColType::STR) {
+        err = "no numeric column '" + value + "'";
+        return false;
+    }
+    const Column* sc = sig.empty() ? nullptr : store.find(sig);
+    const Column* lo_c = store.find("out_lo");
+    const Column* hi_c = store.find("out_hi");
+
+    size_t nx = axes[0].bins, ny = axes.size() > 1 ? axes[1].bins : 1;
+    if (jobs == 0)
+        jobs = 1;
+    jobs = unsigned(std::min<size_t>(jobs, rows.size() / 4096 + 1));
+    std::vector<std::vector<Bin>> parts(jobs, std::vector<Bin>(nx * ny));
+
+    // Index of v in the axis bins; the upper edge belongs to the last bin.
+    auto slot = [](const BinAxis& ax, double v, size_t& i) {
+        if (std::isnan(v) || v < ax.lo || v > ax.hi)
+            return false;
+        double w = ax.hi - ax.lo;
+        i = w > 0 ? size_t((v - ax.lo) / w * double(ax.bins)) : 0;
+        if (i >= ax.bins)
+            i = ax.bins - 1;
+        return true;
+    };
+    parallel_for(rows.size(), jobs, [&](size_t b, size_t e, unsigned j) {
+        std::vector<Bin>& bins = parts[j];
+        for (size_t i = b; i < e; i++) {
+            uint32_t r = rows[i];
+            size_t ix = 0, iy = 0;
+            if (!slot(axes[0], value_at(ac[0], r), ix))
+                continue;
+            if (ac[1] && !slot(axes[1], value_at(ac[1], r), iy))
+                continue;
+            double v = value_at(vc, r);
+            double lo = lo_c ? value_at(lo_c, r) : NAN;
+            double hi = hi_c ? value_at(hi_c, r) : NAN;
+            bins[ix * ny + iy].add(v, std::isnan(lo) ? v : lo, std::isnan(hi) ? v : hi,
+                                   value_at(sc, r));
+        }
+    });
+    out.swap(parts[0]);
+    for (unsigned j = 1; j < jobs; j++)
+        for (size_t i = 0; i < out.size(); i++)
+            out[i].merge(parts[j][i]);
+    return true;
+}
+
+std::vector<size_t> lttb(const double* x, const double* y, size_t n, size_t target) {
+    std::vector<size_t> keep;
+    if (n <= target) {
+        for (size_t i = 0; i < n; i++)
+            keep.push_back(i);
+        return keep;
+    }
+    keep.push_back(0);
+    if (target < 3) {
+        keep.push_back(n - 1);
+        return keep;
+    }
+    // n - 2 inner points split into target - 2 buckets
+    double every = double(n - 2) / double(target - 2);
+    size_t a = 0;
+    for (size_t b = 0; b < target - 2; b++) {
+        size_t start = size_t(double(b) * every) + 1;
+        size_t end = std::min(size_t(double(b + 1) * every) + 1, n - 1);
+        // Average of the next bucket (the last point for the final bucket)
+        size_t nstart = end, nend = std::min(size_t(double(b + 2) * every) + 1, n);
+        if (b + 1 == target - 2) {
+            nstart = n - 1;
+            nend = n;
+        }
+        double ax = 0, ay = 0;
+        for (size_t i = nstart; i < nend; i++) {
+            ax += x[i];
+            ay += y[i];
+        }
+        ax /= double(nend - nstart);
+        ay /= double(nend - nstart);
+        double best = -1;
+        size_t pick = start;
+        for (size_t i = start; i < end; i++) {
+            double area = std::fabs((x[a] - ax) * (y[i] - y[a]) - (x[a] - x[i]) * (ay - y[a]));
+            if (area > best) {
+                best = area;
+                pick = i;
+            }
+        }
+        keep.push_back(pick);
+        a = pick;
+    }
+    keep.push_back(n - 1);
+    return keep;
+}
+
+}  // namespace reu
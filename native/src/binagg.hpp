@@ -0,0 +1,69 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "store.hpp"
+
+namespace reu {
+
+/*
+ * Per-bin aggregates of store rows over one input axis (x-bins) or two
+ * (tiles), so plots draw a fixed number of bins however many points and
+ * samples went in. Each bin keeps:
+ *
+ *   count          rows that fell in the bin
+ *   value_count    of which with a value (not null or NaN)
+ *   min/max/mean   of those values (per-point sample mean by default)
+ *   env_lo/env_hi  sample envelope from out_lo/out_hi, if present
+ *   sig quantiles  of the significant-digit column, from a histogram with
+ *                  SIG_STEP resolution (exact min and max kept separately)
+ */
+struct Bin {
+    static constexpr double SIG_STEP = 0.125;
+    static constexpr int SIG_BUCKETS = 144;  // [0, 18) digits
+
+    uint64_t count = 0, value_count = 0;
+    double min = INFINITY, max = -INFINITY, sum = 0.0;
+    double env_lo = INFINITY, env_hi = -INFINITY;
+    uint64_t sig_count = 0;
+    double sig_min = INFINITY, sig_max = -INFINITY;
+    uint32_t sig_hist[SIG_BUCKETS] = {};
+
+    void add(double v, double lo, double hi, double sig);
+    void merge(const Bin& o);
+    double mean() const { return value_count ? sum / double(value_count) : NAN; }
+    // Upper edge of the histogram bucket holding quantile q of the digits,
+    // clamped to the observed range.
+    double sig_quantile(double q) const;
+};
+
+// lo/hi NaN: take the range from the selected rows.
+struct BinAxis {
+    std::string column;
+    size_t bins = 100;
+    double lo = NAN, hi = NAN;
+
+    double edge(size_t i) const { return lo + (hi - lo) * double(i) / double(bins); }
+};
+
+/*
+ * Aggregate rows into bins over one or two axes; out has axes[0].bins
+ * (times axes[1].bins) entries, x-major. Rows with a null axis value or
+ * outside the range are skipped. Threads over rows with per-thread bins.
+ */
+bool aggregate_bins(const ResultStore& store, const std::vector<uint32_t>& rows,
+                    std::vector<BinAxis>& axes, const std::string& value,
+                    const std::string& sig, unsigned jobs, std::vector<Bin>& out,
+                    std::string& err);
+
+/*
+ * Largest-Triangle-Three-Buckets: indices of `target` points of the series
+ * (x, y) that keep its visual shape. Always keeps the first and last point;
+ * returns every index when n <= target.
+ */
+std::vector<size_t> lttb(const double* x, const double* y, size_t n, size_t target);
+
+}  // namespace reu
@@ -0,0 +1,206 @@
+#include "bnb.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+
+#include "kernels.hpp"
+#include "parallel.hpp"
+
+namespace reu {
+
+namespace {
+
+// Sub-box lo[0..d) followed by hi[0..d), with its upper bound.
+struct Node {
+    double upper;
+    std::vector<double> box;
+
+    bool operator<(const Node& o) const { return upper < o.upper; }
+};
+
+// Raises a to v with a compare-and-swap loop; true if this call raised it.
+bool atomic_max(std::atomic<double>& a, double v) {
+    double cur = a.load(std::memory_order_relaxed);
+    while (v > cur) {
+        if (a.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+BnbResult bnb_maximize(const std::vector<double>& lo, const std::vector<double>& hi,
+                       const BnbBound& bound, const BnbValue& value, const BnbOptions& opt) {
+    auto t0 = std::chrono::steady_clock::now();
+    size_t d = lo.size();
+    std::vector<double> scale(d);
+    for (size_t k = 0; k < d; k++)
+        scale[k] = hi[k] - lo[k];
+
+    std::atomic<double> best(0.0), retired(0.0);
+    std::atomic<size_t> boxes(0), narrow(0);
+    std::atomic<bool> budget_hit(false);
+    std::mutex best_mu;  // taken only when a worker raised best
+    double argmax_f = -1.0;
+    std::vector<double> argmax(d);
+
+    // f at a point, raising the lower bound.
+    auto probe_at = [&](const std::vector<double>& x) {
+        double f = value(x.data());
+        if (!std::isfinite(f))
+            return;
+        if (atomic_max(best, f)) {
+            std::lock_guard<std::mutex> lk(best_mu);
+            if (f > argmax_f) {
+                argmax_f = f;
+                argmax = x;
+            }
+        }
+    };
+    auto probe = [&](const double* box) {
+        std::vector<double> x(d);
+        for (size_t k = 0; k < d; k++)
+            x[k] = box[k] + (box[d + k] - box[k]) / 2;
+        probe_at(x);
+    };
+    auto evaluate = [&](const std::vector<double>& box, double parent) {
+        boxes.fetch_add(1, std::memory_order_relaxed);
+        double u = bound(box.data(), box.data() + d);
+        probe(box.data());
+        // A sub-box is bounded by its parent's bound as well.
+        return std::isnan(u) || u > parent ? parent : u;
+    };
+    auto prunable = [&](double u) {
+        return u <= best.load(std::memory_order_relaxed) * (1.0 + opt.rel_tol);
+    };
+
+    std::mutex mu;
+    std::condition_variable cv;
+    std::priority_queue<Node> queue;
+    unsigned busy = 0;
+
+    std::vector<double> root(2 * d);
+    std::copy(lo.begin(), lo.end(), root.begin());
+    std::copy(hi.begin(), hi.end(), root.begin() + long(d));
+    double u0 = evaluate(root, INFINITY);
+    // Error maxima often sit at extreme inputs, which midpoints only approach.
+    if (d <= 16) {
+        std::vector<double> x(d);
+        for (size_t c = 0; c < (size_t(1) << d); c++) {
+            for (size_t k = 0; k < d; k++)
+                x[k] = c >> k & 1 ? hi[k] : lo[k];
+            probe_at(x);
+        }
+    }
+    if (argmax_f < 0) {
+        for (size_t k = 0; k < d; k++)
+            argmax[k] = lo[k] + (hi[k] - lo[k]) / 2;
+    }
+    queue.push({u0, root});
+
+    auto worker = [&]() {
+        for (;;) {
+            Node n;
+            {
+                std::unique_lock<std::mutex> lk(mu);
+                cv.wait(lk, [&] { return !queue.empty() || busy == 0; });
+                if (queue.empty()) {
+                    cv.notify_all();
+                    return;
+                }
+                n = queue.top();
+                queue.pop();
+                bool done = prunable(n.upper);
+                if (!done && boxes.load(std::memory_order_relaxed) >= opt.max_boxes) {
+                    budget_hit = true;
+                    done = true;
+                }
+                if (done) {
+                    atomic_max(retired, n.upper);
+                    continue;
+                }
+                busy++;
+            }
+            // Bisect the widest input, relative to the initial box.
+            size_t split = d;
+            double widest = 0.0;
+            for (size_t k = 0; k < d; k++) {
+                if (scale[k] <= 0.0)
+                    continue;
+                double w = (n.box[d + k] - n.box[k]) / scale[k];
+                if (w > widest) {
+                    widest = w;
+                    split = k;
+                }
+            }
+            Node kids[2];
+            int nkids = 0;
+            if (split == d || widest < opt.min_width) {
+                narrow.fetch_add(1, std::memory_order_relaxed);
+                atomic_max(retired, n.upper);
+            } else {
+                double m = n.box[split] + (n.box[d + split] - n.box[split]) / 2;
+                kids[0].box = n.box;
+                kids[0].box[d + split] = m;
+                kids[1].box = std::move(n.box);
+                kids[1].box[split] = m;
+                for (Node& c : kids)
+                    c.upper = evaluate(c.box, n.upper);
+                nkids = 2;
+            }
+            std::lock_guard<std::mutex> lk(mu);
+            for (int i = 0; i < nkids; i++) {
+                if (prunable(kids[i].upper))
+                    atomic_max(retired, kids[i].upper);
+                else
+                    queue.push(std::move(kids[i]));
+            }
+            busy--;
+            cv.notify_all();
+        }
+    };
+    unsigned jobs = opt.jobs ? opt.jobs : 1;
+    parallel_for(jobs, jobs, [&](size_t, size_t, unsigned) { worker(); });
+
+    BnbResult r;
+    r.lower = best.load();
+    r.upper = std::max(retired.load(), r.lower);
+    r.argmax = argmax;
+    r.boxes = boxes.load();
+    r.narrow = narrow.load();
+    r.budget_hit = budget_hit.load();
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+BnbResult max_kernel_error(const KernelDef& k, int out, const std::vector<double>& lo,
+                           const std::vector<double>& hi, double unit, double tiny,
+                           const BnbOptions& opt, unsigned* flags) {
+    std::atomic<unsigned> seen(0);
+    auto bound = [&](const double* l, const double* h) {
+        Interval x[MAX_IN], v[MAX_OUT], e[MAX_OUT];
+        for (int d = 0; d < k.n_in; d++)
+            x[d] = Interval(l[d], h[d]);
+        err_unit = unit;
+        err_tiny = tiny;
+        interval_flags = 0;
+        k.eval_error(x, v, e);
+        if (interval_flags) {
+            seen.fetch_or(interval_flags, std::memory_order_relaxed);
+            return double(INFINITY);
+        }
+        return e[out].mag();
+    };
+    auto value = [&](const double* x) { return bound(x, x); };
+    BnbResult r = bnb_maximize(lo, hi, bound, value, opt);
+    if (flags)
+        *flags |= seen.load();
+    return r;
+}
+
+}  // namespace reu
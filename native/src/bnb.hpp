@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Parallel branch-and-bound maximizer of f over a box, for certified error
+ * bounds. `bound` encloses f over a sub-box (an upper bound; +inf when it
+ * cannot tell) and `value` evaluates f at a point. Boxes wait in one
+ * best-first queue, largest upper bound first. A worker takes a box,
+ * bisects it along its widest input (relative to the initial box), and
+ * queues each half unless the best value found so far shows that the half
+ * cannot improve it by more than the relative tolerance.
+ *
+ * The best value (the lower bound) is shared as an atomic and raised with
+ * a compare-and-swap loop, so every worker prunes against every other
+ * worker's finds without taking a lock. The same holds for the largest
+ * bound of the retired boxes. Every part of the initial box ends in exactly
+ * one retired box: pruned, too narrow to split, or still queued when the
+ * budget ran out. The maximum of f therefore lies in [lower, upper].
+ */
+struct BnbOptions {
+    unsigned jobs = 1;
+    double rel_tol = 1e-3;     // stop refining once upper <= lower * (1 + rel_tol)
+    size_t max_boxes = 1000000;  // bound evaluations before giving up
+    double min_width = 1e-12;  // widest relative side below which a box is not split
+};
+
+struct BnbResult {
+    double lower = 0, upper = 0;  // max f in [lower, upper]
+    std::vector<double> argmax;   // a point where f = lower
+    size_t boxes = 0;             // bound evaluations
+    size_t narrow = 0;            // boxes retired unresolved at min_width
+    bool budget_hit = false;      // stopped at max_boxes with boxes still queued
+    double seconds = 0;
+};
+
+using BnbBound = std::function<double(const double* lo, const double* hi)>;
+using BnbValue = std::function<double(const double* x)>;
+
+/*
+ * f must be >= 0 (an error magnitude). Inputs with lo == hi are fixed.
+ * Non-finite values are ignored for the lower bound; NaN bounds count as +inf.
+ */
+BnbResult bnb_maximize(const std::vector<double>& lo, const std::vector<double>& hi,
+                       const BnbBound& bound, const BnbValue& value, const BnbOptions& opt);
+
+struct KernelDef;
+
+/*
+ * Maximum absolute rounding error of output `out` of k over the box, from
+ * KernelDef::eval_error with the given err_unit / err_tiny. Boxes where a
+ * branch or domain check is ambiguous are unbounded; the interval_flags
+ * seen are or-ed into *flags when given.
+ */
+BnbResult max_kernel_error(const KernelDef& k, int out, const std::vector<double>& lo,
+                           const std::vector<double>& hi, double unit, double tiny,
+                           const BnbOptions& opt, unsigned* flags = nullptr);
+
+}  // namespace reu
@@ -0,0 +1,76 @@
+#include "cancel.hpp"
+
+#include <cmath>
+
+namespace reu {
+
+thread_local CancelTrace cancel_trace;
+
+void CancelHistogram::grow(int sites) {
+    if (sites <= int(counts_.size()))
+        return;
+    std::array<uint64_t, CANCEL_BINS> zero{};
+    counts_.resize(size_t(sites), zero);
+    sub_.resize(size_t(sites), 0);
+    max_.resize(size_t(sites), -1);
+    max_point_.resize(size_t(sites), 0);
+}
+
+void CancelHistogram::add_trace(uint64_t point) {
+    const CancelTrace& t = cancel_trace;
+    int n = t.sites < CANCEL_SITES ? t.sites : CANCEL_SITES;
+    grow(n);
+    for (int s = 0; s < n; s++) {
+        int b = t.bits[s];
+        counts_[size_t(s)][size_t(b)]++;
+        sub_[size_t(s)] |= char(t.sub[s]);
+        if (b > max_[size_t(s)]) {
+            max_[size_t(s)] = b;
+            max_point_[size_t(s)] = point;
+        }
+    }
+    evaluations_++;
+    untracked_ += uint64_t(t.sites - n);
+}
+
+void CancelHistogram::merge(const CancelHistogram& o) {
+    grow(o.sites());
+    for (int s = 0; s < o.sites(); s++) {
+        for (int b = 0; b < CANCEL_BINS; b++)
+            counts_[size_t(s)][size_t(b)] += o.counts_[size_t(s)][size_t(b)];
+        sub_[size_t(s)] |= o.sub_[size_t(s)];
+        // Ties keep the earlier point, so the merge order of blocks does not matter.
+        int ob = o.max_[size_t(s)];
+        if (ob > max_[size_t(s)] ||
+            (ob == max_[size_t(s)] && o.max_point_[size_t(s)] < max_point_[size_t(s)])) {
+            max_[size_t(s)] = ob;
+            max_point_[size_t(s)] = o.max_point_[size_t(s)];
+        }
+    }
+    evaluations_ += o.evaluations_;
+    untracked_ += o.untracked_;
+}
+
+uint64_t CancelHistogram::executed(int site) const {
+    uint64_t n = 0;
+    for (uint64_t c : counts_[size_t(site)])
+        n += c;
+    return n;
+}
+
+int CancelHistogram::quantile(int site, double q) const {
+    uint64_t n = executed(site);
+    if (n == 0)
+        return -1;
+    uint64_t rank = uint64_t(std::ceil(q * double(n)));
+    rank = rank < 1 ? 1 : rank;
+    uint64_t seen = 0;
+    for (int b = 0; b < CANCEL_BINS; b++) {
+        seen += counts_[size_t(site)][size_t(b)];
+        if (seen >= rank)
+            return b;
+    }
+    return CANCEL_ZERO;
+}
+
+}  // namespace reu
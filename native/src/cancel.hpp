@@ -0,0 +1,124 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Cancellation tracking: a number type that computes in double and, on
+ * every addition and subtraction, records how many leading bits cancelled:
+ * the drop from the larger operand's exponent to the result's. 0 means no
+ * cancellation (or an effective addition); a result that cancels to exactly
+ * zero records CANCEL_ZERO. Other operations and libm calls pass through.
+ *
+ * Sites are the additions and subtractions of one kernel evaluation in the
+ * order they execute, site 0 first, so a kernel without data-dependent
+ * branches has the same sites at every input. The trace is thread-local:
+ * cancel_begin() before an evaluation, then read the bits of that
+ * evaluation from cancel_trace and fold them into a CancelHistogram.
+ */
+constexpr int CANCEL_SITES = 64;  // sites tracked per evaluation
+constexpr int CANCEL_ZERO = 64;   // bits recorded for an exact zero
+constexpr int CANCEL_BINS = CANCEL_ZERO + 1;
+
+struct CancelTrace {
+    int sites = 0;  // add/sub executed by the current evaluation, tracked or not
+    uint8_t bits[CANCEL_SITES];
+    bool sub[CANCEL_SITES];  // written as a subtraction (operator-)
+};
+
+extern thread_local CancelTrace cancel_trace;
+
+inline void cancel_begin() { cancel_trace.sites = 0; }
+
+// Unbiased exponent of a finite nonzero double, from its bits (ilogb only
+// for subnormals).
+inline int cancel_exponent(double v) {
+    uint64_t u;
+    memcpy(&u, &v, 8);
+    int e = int((u >> 52) & 0x7ff);
+    return e ? e - 1023 : std::ilogb(v);
+}
+
+inline int cancelled_bits(double a, double b, double r) {
+    if (a == 0.0 || b == 0.0 || !std::isfinite(r))
+        return 0;
+    if (r == 0.0)
+        return CANCEL_ZERO;
+    int ea = cancel_exponent(a), eb = cancel_exponent(b);
+    int d = (ea > eb ? ea : eb) - cancel_exponent(r);
+    return d <= 0 ? 0 : d >= CANCEL_ZERO ? CANCEL_ZERO - 1 : d;
+}
+
+inline double cancel_record(double a, double b, double r, bool sub) {
+    CancelTrace& t = cancel_trace;
+    if (t.sites < CANCEL_SITES) {
+        t.bits[t.sites] = uint8_t(cancelled_bits(a, b, r));
+        t.sub[t.sites] = sub;
+    }
+    t.sites++;
+    return r;
+}
+
+struct Cancel {
+    double v = 0.0;
+
+    Cancel() = default;
+    Cancel(double x) : v(x) {}
+};
+
+inline Cancel operator+(Cancel a, Cancel b) { return cancel_record(a.v, b.v, a.v + b.v, false); }
+inline Cancel operator-(Cancel a, Cancel b) { return cancel_record(a.v, b.v, a.v - b.v, true); }
+inline Cancel operator*(Cancel a, Cancel b) { return Cancel(a.v * b.v); }
+inline Cancel operator/(Cancel a, Cancel b) { return Cancel(a.v / b.v); }
+inline Cancel operator-(Cancel a) { return Cancel(-a.v); }
+inline bool operator<(Cancel a, Cancel b) { return a.v < b.v; }
+inline bool operator>(Cancel a, Cancel b) { return a.v > b.v; }
+inline bool operator<=(Cancel a, Cancel b) { return a.v <= b.v; }
+inline Cancel exp(Cancel a) { return Cancel(std::exp(a.v)); }
+inline Cancel tanh(Cancel a) { return Cancel(std::tanh(a.v)); }
+inline Cancel sqrt(Cancel a) { return Cancel(std::sqrt(a.v)); }
+inline Cancel pow(Cancel a, Cancel b) { return Cancel(std::pow(a.v, b.v)); }
+// The addend of an fma cancels against the exact product.
+inline Cancel fma(Cancel a, Cancel b, Cancel c) {
+    return cancel_record(a.v * b.v, c.v, std::fma(a.v, b.v, c.v), false);
+}
+
+/*
+ * Per-site distributions of cancelled bits over many evaluations: one
+ * counter per site and bit count, plus the largest cancellation of each
+ * site and the evaluation it happened in. Kept per thread and merged.
+ */
+class CancelHistogram {
+public:
+    // Folds in the current cancel_trace; `point` identifies the evaluation.
+    void add_trace(uint64_t point);
+    void merge(const CancelHistogram& other);
+
+    int sites() const { return int(counts_.size()); }
+    uint64_t evaluations() const { return evaluations_; }
+    uint64_t untracked() const { return untracked_; }  // add/sub past CANCEL_SITES
+    const std::array<uint64_t, CANCEL_BINS>& counts(int site) const {
+        return counts_[size_t(site)];
+    }
+    uint64_t executed(int site) const;  // evaluations that reached the site
+    bool sub(int site) const { return sub_[size_t(site)] != 0; }
+    int max_bits(int site) const { return max_[size_t(site)]; }
+    uint64_t max_point(int site) const { return max_point_[size_t(site)]; }
+    // Fewest bits with a fraction q of the site's executions at or below them.
+    int quantile(int site, double q) const;
+
+private:
+    void grow(int sites);
+
+    std::vector<std::array<uint64_t, CANCEL_BINS>> counts_;
+    std::vector<char> sub_;
+    std::vector<int> max_;
+    std::vector<uint64_t> max_point_;
+    uint64_t evaluations_ = 0, untracked_ = 0;
+};
+
+}  // namespace reu
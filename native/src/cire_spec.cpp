@@ -0,0 +1,211 @@
+#include "cire_spec.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace reu {
+
+std::vector<std::pair<double, double>> CireSpec::box() const {
+    std::vector<std::pair<double, double>> b;
+    for (const auto& v : inputs)
+        b.emplace_back(v.lo, v.hi);
+    return b;
+}
+
+namespace {
+
+struct Token {
+    enum Kind { WORD, NUMBER, PUNCT, END } kind;
+    std::string text;
+    int line;
+};
+
+bool tokenize(const std::string& s, std::vector<Token>& toks, std::string& err) {
+    int line = 1;
+    size_t i = 0;
+    while (i < s.size()) {
+        char c = s[i];
+        if (c == '\n') {
+            line++;
+            i++;
+        } else if (isspace((unsigned char)c)) {
+            i++;
+        } else if (c == '#' || (c == '/' && i + 1 < s.size() && s[i + 1] == '/')) {
+            while (i < s.size() && s[i] != '\n')
+                i++;
+        } else if (isalpha((unsigned char)c) || c == '_') {
+            size_t j = i;
+            while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j] == '_'))
+                j++;
+            toks.push_back({Token::WORD, s.substr(i, j - i), line});
+            i = j;
+        } else if (isdigit((unsigned char)c) || c == '-' || c == '+' || c == '.') {
+            const char* start = s.c_str() + i;
+            char* end = nullptr;
+            strtod(start, &end);
+            if (end == start) {
+                err = "line " + std::to_string(line) + ": bad number";
+                return false;
+            }
+            toks.push_back({Token::NUMBER, std::string(start, size_t(end - start)), line});
+            i += size_t(end - start);
+        } else if (c == '{' || c == '}' || c == '(' || c == ')' || c == ':' || c == ';' ||
+                   c == ',') {
+            toks.push_back({Token::PUNCT, std::string(1, c), line});
+            i++;
+        } else {
+            err = "line " + std::to_string(line) + ": unexpected '" + std::string(1, c) + "'";
+            return false;
+        }
+    }
+    toks.push_back({Token::END, "", line});
+    return true;
+}
+
+struct Parser {
+    const std::vector<Token>& t;
+    size_t i = 0;
+    std::string err;
+
+    const Token& peek() const { return t[i]; }
+    bool is(const char* p) const { return t[i].kind == Token::PUNCT && t[i].text == p; }
+
+    bool fail(const std::string& what) {
+        const Token& k = t[i];
+        err = "line " + std::to_string(k.line) + ": " + what +
+              (k.kind == Token::END ? " at end of file" : ", got '" + k.text + "'");
+        return false;
+    }
+
+    bool expect(const char* p) {
+        if (!is(p))
+            return fail(std::string("expected '") + p + "'");
+        i++;
+        return true;
+    }
+
+    bool number(double& v) {
+        if (peek().kind != Token::NUMBER)
+            return fail("expected a number");
+        v = strtod(t[i++].text.c_str(), nullptr);
+        return true;
+    }
+
+    // NAME TYPE [: (LO, HI)] ;
+    bool decl(CireVar& v, bool ranged) {
+        if (peek().kind != Token::WORD)
+            return fail("expected a variable name");
+        v.name = t[i++].text;
+        if (peek().kind != Token::WORD)
+            return fail("expected a type after '" + v.name + "'");
+        v.type = peek().text;
+        if (v.type != "fl16" && v.type != "fl32" && v.type != "fl64")
+            return fail("unknown type (expected fl16, fl32 or fl64)");
+        i++;
+        if (is(":")) {
+            i++;
+            int line = peek().line;
+            if (!expect("(") || !number(v.lo) || !expect(",") || !number(v.hi) || !expect(")"))
+                return false;
+            if (v.lo > v.hi) {
+                err = "line " + std::to_string(line) + ": empty range for '" + v.name + "'";
+                return false;
+            }
+            v.has_range = true;
+        } else if (ranged) {
+            return fail("expected ': (lo, hi)' for input '" + v.name + "'");
+        }
+        return expect(";");
+    }
+
+    bool section(std::vector<CireVar>& vars, bool ranged) {
+        if (!expect("{"))
+            return false;
+        while (!is("}")) {
+            if (peek().kind == Token::END)
+                return fail("expected '}'");
+            vars.emplace_back();
+            if (!decl(vars.back(), ranged))
+                return false;
+        }
+        i++;
+        return true;
+    }
+
+    bool spec(CireSpec& s) {
+        bool seen_in = false, seen_out = false;
+        while (peek().kind != Token::END) {
+            if (seen_in && seen_out && is("}")) {
+                s.stray_braces++;  // the "OUTPUTS { y0 fl64; }}" quirk
+                i++;
+                continue;
+            }
+            if (peek().kind == Token::WORD && peek().text == "INPUTS" && !seen_in) {
+                i++;
+                seen_in = true;
+                if (!section(s.inputs, true))
+                    return false;
+            } else if (peek().kind == Token::WORD && peek().text == "OUTPUTS" && !seen_out) {
+                i++;
+                seen_out = true;
+                if (!section(s.outputs, false))
+                    return false;
+            } else {
+                return fail("expected INPUTS or OUTPUTS");
+            }
+        }
+        if (!seen_in)
+            return fail("missing INPUTS section");
+        return true;
+    }
+};
+
+}  // namespace
+
+bool parse_cire(const std::string& text, CireSpec& spec, std::string& err) {
+    spec = CireSpec();
+    std::vector<Token> toks;
+    if (!tokenize(text, toks, err))
+        return false;
+    Parser p{toks, 0, ""};
+    if (!p.spec(spec)) {
+        err = p.err;
+        return false;
+    }
+    return true;
+}
+
+bool load_cire(const std::string& path, CireSpec& spec, std::string& err) {
+    std::ifstream in(path);
+    if (!in) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    if (!parse_cire(ss.str(), spec, err)) {
+        err = path + ": " + err;
+        return false;
+    }
+    return true;
+}
+
+std::string format_cire(const CireSpec& spec) {
+    std::string out = "INPUTS {\n";
+    char buf[128];
+    for (const auto& v : spec.inputs) {
+        snprintf(buf, sizeof buf, "  %s %s : (%.17g, %.17g);\n", v.name.c_str(), v.type.c_str(),
+                 v.lo, v.hi);
+        out += buf;
+    }
+    out += "}\nOUTPUTS {";
+    for (const auto& v : spec.outputs)
+        out += " " + v.name + " " + v.type + ";";
+    out += " }\n";
+    return out;
+}
+
+}  // namespace reu
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace reu {
+
+/*
+ * The INPUTS / OUTPUTS specification CIRE reads (examples/<kernel>/inputs/):
+ *
+ *   INPUTS {
+ *     x0 fl64 : (-10.0, 10.0);
+ *     x1 fl64 : (0.0, 0.0);
+ *   }
+ *   OUTPUTS { y0 fl64; }
+ *
+ * Several files in the examples close OUTPUTS with "}}"; stray closing
+ * braces after the last section are accepted and counted. '#' and '//'
+ * start comments.
+ */
+struct CireVar {
+    std::string name;
+    std::string type;  // fl16 | fl32 | fl64
+    double lo = 0.0;
+    double hi = 0.0;
+    bool has_range = false;
+};
+
+struct CireSpec {
+    std::vector<CireVar> inputs;
+    std::vector<CireVar> outputs;
+    int stray_braces = 0;
+
+    // Input box as (lo, hi) per input, in declaration order.
+    std::vector<std::pair<double, double>> box() const;
+};
+
+// Returns false and sets err ("line L: ...") on a syntax or range error.
+bool parse_cire(const std::string& text, CireSpec& spec, std::string& err);
+bool load_cire(const std::string& path, CireSpec& spec, std::string& err);
+
+// Canonical text of a spec, readable by CIRE and by parse_cire.
+std::string format_cire(const CireSpec& spec);
+
+}  // namespace reu
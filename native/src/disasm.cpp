@@ -0,0 +1,300 @@
+#include "disasm.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
+
+#include "subprocess.hpp"
+
+namespace reu {
+
+std::string FpOps::libm_list() const {
+    std::string out;
+    for (const auto& kv : libm)
+        out += (out.empty() ? "" : ",") + kv.first;
+    return out;
+}
+
+const DisasmFunction* Disassembly::at(uint64_t addr) const {
+    auto it = by_addr.find(addr);
+    return it == by_addr.end() ? nullptr : &funcs[it->second];
+}
+
+const DisasmFunction* Disassembly::named(const std::string& name) const {
+    auto it = by_name.find(name);
+    return it == by_name.end() ? nullptr : &funcs[it->second];
+}
+
+namespace {
+
+bool ends_with(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+bool starts_with(const std::string& s, const char* prefix) {
+    return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// "sqrt@plt", "expf@GLIBC_2.2.5", "foo+0x1c" -> "sqrt", "expf", "foo"
+std::string bare_symbol(std::string s) {
+    size_t at = s.find('@');
+    if (at != std::string::npos)
+        s.resize(at);
+    size_t off = s.rfind("+0x");
+    if (off != std::string::npos)
+        s.resize(off);
+    return s;
+}
+
+// libm entry points, by base name without the f / l suffix.
+bool is_libm(const std::string& sym) {
+    static const std::set<std::string> names = {
+        "exp",   "exp2",  "expm1", "log",   "log2",   "log10", "log1p", "pow",   "sqrt",
+        "cbrt",  "hypot", "sin",   "cos",   "tan",    "sinh",  "cosh",  "tanh",  "asin",
+        "acos",  "atan",  "atan2", "asinh", "acosh",  "atanh", "erf",   "erfc",  "fma",
+        "fmin",  "fmax",  "fmod",  "floor", "ceil",   "round", "trunc", "rint",  "lgamma",
+        "tgamma", "ldexp", "frexp", "sincos", "nearbyint", "remainder"};
+    std::string s = sym;
+    if (starts_with(s, "__") && ends_with(s, "_finite"))
+        s = s.substr(2, s.size() - 9);
+    if (names.count(s))
+        return true;
+    if (!s.empty() && (s.back() == 'f' || s.back() == 'l'))
+        return names.count(s.substr(0, s.size() - 1)) > 0;
+    return false;
+}
+
+bool is_call(const std::string& m) {
+    return m == "call" || m == "callq" || m == "bl";
+}
+
+bool is_jump(const std::string& m) {
+    return m == "jmp" || m == "jmpq" || m == "b";
+}
+
+void count_width(const std::string& operands, bool scalar, FpOps& ops) {
+    if (scalar)
+        ops.scalar++;
+    else if (operands.find("zmm") != std::string::npos)
+        ops.v512++;
+    else if (operands.find("ymm") != std::string::npos)
+        ops.v256++;
+    else
+        ops.v128++;
+}
+
+// SSE / AVX / AVX-512. Moves, shuffles and bitwise ops are not counted.
+void classify_x86(const std::string& mnem, const std::string& operands, FpOps& ops) {
+    std::string m = mnem;
+    if (m.size() > 1 && m[0] == 'f') {
+        // x87: only reached for long double
+        static const char* x87_ops[] = {"fadd", "fsub", "fmul", "fdiv", "fsqrt", "fcom", "fucom"};
+        for (const char* op : x87_ops) {
+            if (starts_with(m, op)) {
+                ops.x87++;
+                return;
+            }
+        }
+        return;
+    }
+    if (m[0] == 'v')
+        m = m.substr(1);
+    if (starts_with(m, "cvt")) {
+        // cvtss2sd / cvtsi2sd / cvttsd2si are scalar; cvtps2pd / cvtdq2ps are packed
+        bool scalar = starts_with(m, "cvtss") || starts_with(m, "cvtsd") ||
+                      starts_with(m, "cvtsh") || starts_with(m, "cvtsi") ||
+                      starts_with(m, "cvtts") || starts_with(m, "cvtusi");
+        ops.cvt++;
+        count_width(operands, scalar, ops);
+        return;
+    }
+    bool scalar;
+    if (ends_with(m, "ss") || ends_with(m, "sd") || ends_with(m, "sh"))
+        scalar = true;
+    else if (ends_with(m, "ps") || ends_with(m, "pd") || ends_with(m, "ph"))
+        scalar = false;
+    else
+        return;
+    std::string base = m.substr(0, m.size() - 2);
+    long* slot = nullptr;
+    if (base == "add" || base == "sub" || base == "addsub" || base == "hadd" || base == "hsub")
+        slot = &ops.add;
+    else if (base == "mul")
+        slot = &ops.mul;
+    else if (base == "div" || base == "rcp" || base == "rcp14")
+        slot = &ops.div;
+    else if (base == "sqrt" || base == "rsqrt" || base == "rsqrt14")
+        slot = &ops.sqrt;
+    else if (starts_with(base, "fmadd") || starts_with(base, "fmsub") ||
+             starts_with(base, "fnmadd") || starts_with(base, "fnmsub"))
+        slot = &ops.fma;
+    else if (base == "min" || base == "max")
+        slot = &ops.minmax;
+    else if (starts_with(base, "cmp") || base == "ucomi" || base == "comi")
+        slot = &ops.cmp;
+    if (!slot)
+        return;
+    (*slot)++;
+    count_width(operands, scalar, ops);
+}
+
+// AArch64 scalar FP and NEON: fadd d0, d1, d2 / fadd v0.2d, v1.2d, v2.2d
+void classify_aarch64(const std::string& m, const std::string& operands, FpOps& ops) {
+    long* slot = nullptr;
+    if (m == "fadd" || m == "fsub" || m == "faddp" || m == "fabd")
+        slot = &ops.add;
+    else if (m == "fmul" || m == "fnmul" || m == "fmulx")
+        slot = &ops.mul;
+    else if (m == "fdiv" || m == "frecpe")
+        slot = &ops.div;
+    else if (m == "fsqrt" || m == "frsqrte")
+        slot = &ops.sqrt;
+    else if (m == "fmadd" || m == "fmsub" || m == "fnmadd" || m == "fnmsub" || m == "fmla" ||
+             m == "fmls")
+        slot = &ops.fma;
+    else if (starts_with(m, "fmin") || starts_with(m, "fmax"))
+        slot = &ops.minmax;
+    else if (starts_with(m, "fcm") || m == "fcmp" || m == "fcmpe" || m == "fccmp")
+        slot = &ops.cmp;
+    else if (starts_with(m, "fcvt") || m == "scvtf" || m == "ucvtf")
+        slot = &ops.cvt;
+    if (!slot)
+        return;
+    (*slot)++;
+    bool vector = operands.find(".2d") != std::string::npos ||
+                  operands.find(".4s") != std::string::npos ||
+                  operands.find(".8h") != std::string::npos;
+    count_width(operands, !vector, ops);
+}
+
+void count_rec(const Disassembly& dis, const DisasmFunction& f, FpOps& ops,
+               std::set<const DisasmFunction*>& seen) {
+    if (!seen.insert(&f).second)
+        return;
+    for (const auto& in : f.insns) {
+        if (is_call(in.mnemonic) || is_jump(in.mnemonic)) {
+            std::string sym = bare_symbol(in.target);
+            if (sym.empty())
+                continue;
+            if (is_libm(sym)) {
+                ops.libm[sym]++;
+                continue;
+            }
+            // Branches inside a function have a "+0x" target; only calls and
+            // tail jumps to a function start are followed.
+            if (in.target.find("+0x") != std::string::npos)
+                continue;
+            const DisasmFunction* g = in.target_addr ? dis.at(in.target_addr) : nullptr;
+            if (!g)
+                g = dis.named(sym);
+            if (!g || g == &f)
+                continue;
+            if (!seen.count(g))
+                ops.calls.push_back(g->name);
+            count_rec(dis, *g, ops, seen);
+            continue;
+        }
+        if (dis.aarch64)
+            classify_aarch64(in.mnemonic, in.operands, ops);
+        else
+            classify_x86(in.mnemonic, in.operands, ops);
+    }
+}
+
+}  // namespace
+
+void count_fp_ops(const Disassembly& dis, const DisasmFunction& f, FpOps& ops) {
+    std::set<const DisasmFunction*> seen;
+    count_rec(dis, f, ops, seen);
+}
+
+bool disassemble(const std::string& path, Disassembly& out, std::string& err) {
+    out = Disassembly();
+    const char* env = getenv("OBJDUMP");
+    std::vector<std::string> cmd = {env ? env : "objdump", "-d", "-r", "-C", "-w",
+                                    "--no-show-raw-insn", path};
+    ProcResult pr;
+    if (!run_process(cmd, nullptr, pr, err))
+        return false;
+    if (pr.status != 0) {
+        err = pr.status == 127 ? cmd[0] + " not found (set OBJDUMP)"
+                               : cmd[0] + " failed on " + path + ": " +
+                                     pr.output.substr(0, pr.output.find('\n'));
+        return false;
+    }
+    std::istringstream in(pr.output);
+    std::string line;
+    DisasmFunction* cur = nullptr;
+    while (std::getline(in, line)) {
+        if (line.empty())
+            continue;
+        if (line.find("file format") != std::string::npos) {
+            out.aarch64 = line.find("aarch64") != std::string::npos;
+            continue;
+        }
+        // "0000000000024790 <name>:"
+        if (isxdigit((unsigned char)line[0]) && ends_with(line, ">:")) {
+            size_t lt = line.find(" <");
+            if (lt == std::string::npos)
+                continue;
+            out.funcs.emplace_back();
+            cur = &out.funcs.back();
+            cur->addr = strtoull(line.c_str(), nullptr, 16);
+            cur->name = line.substr(lt + 2, line.size() - lt - 4);
+            continue;
+        }
+        if (!cur)
+            continue;
+        // Relocation: "\t\t\t247d3: R_X86_64_PLT32\tsqrt-0x4"
+        size_t rel = line.find(": R_");
+        if (rel != std::string::npos) {
+            // In an object file the call's own target is a placeholder.
+            DisasmFunction::Insn* last = cur->insns.empty() ? nullptr : &cur->insns.back();
+            size_t tab = line.find('\t', rel + 2);
+            if (last && (is_call(last->mnemonic) || is_jump(last->mnemonic)) &&
+                tab != std::string::npos) {
+                std::string sym = line.substr(tab + 1);
+                last->target = sym.substr(0, sym.find_first_of("+-"));
+                last->target_addr = 0;
+            }
+            continue;
+        }
+        // Instruction: "   24794:\tvmovsd (%rdi),%xmm1"
+        size_t colon = line.find(":\t");
+        if (colon == std::string::npos)
+            continue;
+        std::istringstream is(line.substr(colon + 2));
+        DisasmFunction::Insn insn;
+        is >> insn.mnemonic;
+        static const std::set<std::string> prefixes = {"rep",  "repz", "repnz",  "repe",
+                                                       "bnd",  "lock", "notrack", "data16",
+                                                       "cs",   "ds"};
+        while (prefixes.count(insn.mnemonic) && is >> insn.mnemonic) {
+        }
+        std::getline(is, insn.operands);
+        size_t lt = insn.operands.find('<');
+        size_t gt = insn.operands.rfind('>');
+        if ((is_call(insn.mnemonic) || is_jump(insn.mnemonic)) && lt != std::string::npos &&
+            gt != std::string::npos && gt > lt) {
+            insn.target = insn.operands.substr(lt + 1, gt - lt - 1);
+            // "call 4350 <sqrt@plt>" or "call *0x2fe2(%rip)  # 3ff8 <sqrt@GLIBC_2.2.5>"
+            size_t hash = insn.operands.find('#');
+            const char* a = insn.operands.c_str() + (hash != std::string::npos ? hash + 1 : 0);
+            while (*a == ' ')
+                a++;
+            insn.target_addr = strtoull(a, nullptr, 16);
+            if (insn.target.find('@') != std::string::npos)
+                insn.target_addr = 0;  // PLT / GOT entry, resolved by name
+        }
+        cur->insns.push_back(insn);
+    }
+    for (size_t i = 0; i < out.funcs.size(); i++) {
+        out.by_addr[out.funcs[i].addr] = i;
+        out.by_name.emplace(out.funcs[i].name, i);
+    }
+    return true;
+}
+
+}  // namespace reu
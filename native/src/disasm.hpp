@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Static FP instruction counts of compiled code, from objdump's disassembly
+ * (x86-64 and AArch64). Operations are counted by kind and by width, and
+ * calls into libm are told apart from inlined sequences: a kernel whose
+ * exp() shows up under libm was not inlined, a sqrt that only appears as an
+ * instruction was.
+ */
+struct FpOps {
+    long add = 0, mul = 0, div = 0, sqrt = 0, fma = 0, minmax = 0, cmp = 0, cvt = 0;
+    long scalar = 0, v128 = 0, v256 = 0, v512 = 0;  // SSE/AVX/NEON ops by width
+    long x87 = 0;                                   // long double stack ops
+    std::map<std::string, long> libm;               // called libm functions
+    std::vector<std::string> calls;                 // other functions followed
+
+    long total() const { return add + mul + div + sqrt + fma + minmax + cmp + cvt; }
+    std::string libm_list() const;  // "expf,sqrt" or ""
+};
+
+struct DisasmFunction {
+    std::string name;  // demangled
+    uint64_t addr = 0;
+    // One entry per instruction: mnemonic, operands, and the call/jump
+    // target symbol from objdump's annotation or relocation, if any.
+    struct Insn {
+        std::string mnemonic, operands, target;
+        uint64_t target_addr = 0;
+    };
+    std::vector<Insn> insns;
+};
+
+struct Disassembly {
+    bool aarch64 = false;
+    std::vector<DisasmFunction> funcs;
+    std::unordered_map<uint64_t, size_t> by_addr;
+    std::unordered_map<std::string, size_t> by_name;
+
+    const DisasmFunction* at(uint64_t addr) const;
+    const DisasmFunction* named(const std::string& name) const;
+};
+
+// Runs objdump (or $OBJDUMP) on an executable or object file.
+bool disassemble(const std::string& path, Disassembly& out, std::string& err);
+
+/*
+ * Add the FP ops of f to ops. Direct calls and tail jumps into other
+ * functions of the same file are followed (each function counted once), so
+ * an out-of-line eval<> is attributed to the lambda that calls it.
+ */
+void count_fp_ops(const Disassembly& dis, const DisasmFunction& f, FpOps& ops);
+
+}  // namespace reu
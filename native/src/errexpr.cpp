@@ -0,0 +1,307 @@
+#include "errexpr.hpp"
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "kernels.hpp"
+#include "parallel.hpp"
+#include "subprocess.hpp"
+#include "symexpr.hpp"
+
+namespace reu {
+
+namespace {
+
+// Compiler flags of the generated evaluators; part of the cache key. Without
+// -fno-trapping-math the interval min/max stay branches and the loop over
+// boxes does not vectorize.
+const std::vector<std::string> CXX_FLAGS = {"-O3",     "-march=native",   "-std=c++17",
+                                            "-fPIC",   "-shared",         "-fno-math-errno",
+                                            "-fno-trapping-math"};
+
+struct Path {
+    std::vector<char> outcomes;  // guard outcomes of the traced path
+    ErrExprFn fn = nullptr;
+    size_t nodes = 0;
+};
+
+// Loaded paths per kernel, for the life of the process.
+std::mutex paths_mu;
+std::map<std::string, std::deque<Path>> loaded;
+
+uint64_t fnv1a(const std::string& s, uint64_t h = 0xcbf29ce484222325ull) {
+    for (unsigned char c : s)
+        h = (h ^ c) * 0x100000001b3ull;
+    return h;
+}
+
+/*
+ * What else decides the object code besides the source and flags:
+ * `$CXX --version`, and the predefined macros under -march=native, which
+ * name the target CPU's features (__AVX512F__, ...) for GCC and Clang
+ * alike. Run once per process and compiler; called under paths_mu.
+ */
+bool toolchain_key(const std::string& cxx, std::string& key, std::string& err) {
+    static std::map<std::string, std::string> known;
+    auto it = known.find(cxx);
+    if (it != known.end()) {
+        key = it->second;
+        return true;
+    }
+    key.clear();
+    for (const std::vector<std::string>& argv :
+         {std::vector<std::string>{cxx, "--version"},
+          std::vector<std::string>{cxx, "-march=native", "-dM", "-E", "-x", "c++", "/dev/null"}}) {
+        ProcResult pr;
+        if (!run_process(argv, nullptr, pr, err))
+            return false;
+        if (pr.status != 0) {
+            err = pr.status == 127 ? cxx + " not found (set CXX)"
+                                   : cxx + " " + argv[1] + " failed: " +
+                                         pr.output.substr(0, pr.output.find('\n'));
+            return false;
+        }
+        key += pr.output;
+    }
+    known[cxx] = key;
+    return true;
+}
+
+bool make_dirs(const std::string& dir) {
+    for (size_t at = 1; at <= dir.size(); at++) {
+        if (at < dir.size() && dir[at] != '/')
+            continue;
+        std::string prefix = dir.substr(0, at);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+
+// Traces k at x and compiles (or loads from the cache) the path it takes.
+bool load_path(const KernelDef& k, const double* x, Path& p, bool& compiled,
+               std::string& err) {
+    SymGraph g;
+    Sym in[MAX_IN], out[MAX_OUT];
+    sym_graph = &g;
+    for (int i = 0; i < k.n_in; i++)
+        in[i] = Sym(g.input(i), x[i]);
+    k.eval_sym(in, out);
+    sym_graph = nullptr;
+    if (!g.unsupported.empty()) {
+        err = std::string(k.name) + ": " + g.unsupported;
+        return false;
+    }
+    std::vector<int> outputs, operands;
+    for (int o = 0; o < k.n_out; o++)
+        outputs.push_back(out[o].id);
+    for (const SymGuard& gd : g.guards) {
+        p.outcomes.push_back(gd.taken);
+        operands.push_back(gd.lhs);
+        operands.push_back(gd.rhs);
+    }
+    std::vector<SymError> errors = first_order_error(g, outputs);
+    std::vector<SymError> guard_errors = first_order_error(g, operands);
+    p.nodes = size_t(g.size());
+
+    std::string path;
+    for (char c : p.outcomes)
+        path += c ? 'T' : 'F';
+    std::string src = emit_evaluator(g, outputs, errors, guard_errors,
+                                     "First-order error expression of " + std::string(k.name) +
+                                         " (examples/" + k.source + ")" +
+                                         (path.empty() ? "" : ", branches " + path));
+    const char* env = getenv("CXX");
+    std::vector<std::string> cmd = {env ? env : "c++"};
+    cmd.insert(cmd.end(), CXX_FLAGS.begin(), CXX_FLAGS.end());
+    std::string toolchain;
+    if (!toolchain_key(cmd[0], toolchain, err))
+        return false;
+    uint64_t h = fnv1a(toolchain, fnv1a(src));
+    for (const auto& a : cmd)
+        h = fnv1a(a + '\n', h);
+    char hex[17];
+    snprintf(hex, sizeof hex, "%016llx", (unsigned long long)h);
+
+    std::string dir = errexpr_cache_dir();
+    std::string base = dir + "/errexpr-" + k.name + "-" + hex;
+    compiled = access((base + ".so").c_str(), R_OK) != 0;
+    if (compiled) {
+        if (!make_dirs(dir)) {
+            err = "cannot create cache directory '" + dir + "' (set REU_CACHE)";
+            return false;
+        }
+        // Build under a private name and rename, so concurrent builds of the
+        // same path never load a half-written object.
+        std::string tmp = base + "." + std::to_string(getpid());
+        // Removes what is left under the private name on every way out; after
+        // the renames that is nothing.
+        struct TmpFiles {
+            std::string base;
+            ~TmpFiles() {
+                unlink((base + ".cpp").c_str());
+                unlink((base + ".so").c_str());
+            }
+        } cleanup{tmp};
+        std::ofstream(tmp + ".cpp") << src;
+        cmd.insert(cmd.end(), {"-o", tmp + ".so", tmp + ".cpp"});
+        ProcResult pr;
+        if (!run_process(cmd, nullptr, pr, err))
+            return false;
+        if (pr.status != 0) {
+            err = pr.status == 127 ? cmd[0] + " not found (set CXX)"
+                                   : cmd[0] + " failed on the evaluator of " + k.name +
+                                         ": " + pr.output.substr(0, pr.output.find('\n'));
+            return false;
+        }
+        rename((tmp + ".cpp").c_str(), (base + ".cpp").c_str());
+        rename((tmp + ".so").c_str(), (base + ".so").c_str());
+    }
+    void* lib = dlopen((base + ".so").c_str(), RTLD_NOW | RTLD_LOCAL);
+    p.fn = lib ? reinterpret_cast<ErrExprFn>(dlsym(lib, "reu_errexpr_eval")) : nullptr;
+    if (!p.fn) {
+        err = base + ".so: " + dlerror();
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+std::string errexpr_cache_dir() {
+    if (const char* d = getenv("REU_CACHE"))
+        return d;
+    if (const char* d = getenv("XDG_CACHE_HOME"))
+        return std::string(d) + "/reu";
+    const char* home = getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.cache/reu";
+}
+
+bool eval_error_expr(const KernelDef& k, size_t n, const double* lo, const double* hi,
+                     double unit, double tiny, unsigned jobs, double* out_lo, double* out_hi,
+                     double* err, std::string& errmsg, ErrExprStats* stats) {
+    ErrExprStats st;
+    size_t n_in = size_t(k.n_in), n_out = size_t(k.n_out);
+    std::vector<size_t> pending(n);
+    for (size_t b = 0; b < n; b++)
+        pending[b] = b;
+    auto unbounded = [&](size_t b) {
+        for (size_t o = 0; o < n_out; o++) {
+            out_lo[o * n + b] = -INFINITY;
+            out_hi[o * n + b] = INFINITY;
+            err[o * n + b] = INFINITY;
+        }
+        st.unresolved++;
+    };
+
+    // Try the loaded paths in order, then trace new ones for the boxes left.
+    std::vector<double> glo, ghi, olo, ohi, oerr;
+    std::vector<int> status;
+    for (size_t next = 0; !pending.empty(); next++) {
+        const Path* p = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(paths_mu);
+            std::deque<Path>& paths = loaded[k.name];
+            if (next < paths.size()) {
+                p = &paths[next];
+            } else {
+                std::vector<double> x(n_in);
+                for (size_t i = 0; i < n_in; i++) {
+                    size_t at = i * n + pending[0];
+                    x[i] = lo[at] + (hi[at] - lo[at]) / 2;
+                }
+                Path np;
+                bool compiled = false;
+                auto t0 = std::chrono::steady_clock::now();
+                if (!load_path(k, x.data(), np, compiled, errmsg))
+                    return false;
+                st.compile_seconds +=
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                st.compiled += compiled;
+                bool seen = false;
+                for (const Path& q : paths)
+                    seen = seen || q.outcomes == np.outcomes;
+                if (seen) {
+                    // The midpoint rounds onto a path the box already failed.
+                    unbounded(pending[0]);
+                    pending.erase(pending.begin());
+                    next--;
+                    continue;
+                }
+                paths.push_back(np);
+                p = &paths.back();
+            }
+        }
+
+        // Gather the pending boxes (all of them, in place, on the first
+        // pass), evaluate them in parallel blocks, and keep those that left
+        // this path for the next one.
+        size_t m = pending.size();
+        bool direct = m == n;
+        status.resize(m);
+        if (!direct) {
+            glo.resize(n_in * m);
+            ghi.resize(n_in * m);
+            for (size_t i = 0; i < n_in; i++) {
+                for (size_t j = 0; j < m; j++) {
+                    glo[i * m + j] = lo[i * n + pending[j]];
+                    ghi[i * m + j] = hi[i * n + pending[j]];
+                }
+            }
+            olo.resize(n_out * m);
+            ohi.resize(n_out * m);
+            oerr.resize(n_out * m);
+        }
+        const double* plo = direct ? lo : glo.data();
+        const double* phi = direct ? hi : ghi.data();
+        double* polo = direct ? out_lo : olo.data();
+        double* pohi = direct ? out_hi : ohi.data();
+        double* perr = direct ? err : oerr.data();
+        parallel_for(m, jobs ? jobs : 1, [&](size_t b, size_t e, unsigned) {
+            p->fn(e - b, m, plo + b, phi + b, unit, tiny, polo + b, pohi + b, perr + b,
+                  status.data() + b);
+        });
+        bool used = false;
+        size_t kept = 0;
+        for (size_t j = 0; j < m; j++) {
+            size_t b = pending[j];
+            if (status[j] == 1) {
+                pending[kept++] = b;
+                continue;
+            }
+            used = true;
+            if (status[j] == 2) {
+                unbounded(b);
+                continue;
+            }
+            for (size_t o = 0; !direct && o < n_out; o++) {
+                out_lo[o * n + b] = olo[o * m + j];
+                out_hi[o * n + b] = ohi[o * m + j];
+                err[o * n + b] = oerr[o * m + j];
+            }
+        }
+        pending.resize(kept);
+        if (used) {
+            st.paths++;
+            st.nodes += p->nodes;
+        }
+    }
+    if (stats)
+        *stats = st;
+    return true;
+}
+
+}  // namespace reu
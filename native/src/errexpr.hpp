@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace reu {
+
+struct KernelDef;
+
+/*
+ * Native evaluator of one path of a kernel's first-order error expression
+ * (symexpr.hpp) over n boxes. Arrays hold one row per input or output,
+ * stride apart: box b of input i is [lo, hi][i * stride + b]. Per box it
+ * writes the enclosure of each exact output, the error bound (err_unit
+ * unit, err_tiny tiny; +inf where it cannot be bounded) and status: 0 if
+ * the box follows the path, 1 if a branch is decided the other way over
+ * the whole box, 2 if a branch goes both ways.
+ */
+using ErrExprFn = void (*)(size_t n, size_t stride, const double* lo, const double* hi,
+                           double unit, double tiny, double* out_lo, double* out_hi,
+                           double* err, int* status);
+
+struct ErrExprStats {
+    size_t paths = 0;       // paths used
+    size_t compiled = 0;    // of which compiled by this call, the rest came from the cache
+    size_t nodes = 0;       // expression nodes of the paths used
+    size_t unresolved = 0;  // boxes a branch goes both ways over, left at +inf
+    double compile_seconds = 0;
+};
+
+/*
+ * First-order error bounds of every output of k over n boxes, laid out as
+ * for ErrExprFn with stride n. Each path of the kernel the boxes reach is
+ * traced once, at the midpoint of the first box that needs it, and
+ * compiled with $CXX to a shared object in errexpr_cache_dir(), keyed by
+ * the source, the compiler and the CPU -march=native resolves to. Later
+ * calls, in this process or another, only load and evaluate it. A box a
+ * branch goes both ways over gets err = +inf and an infinite enclosure.
+ * Returns false, with errmsg, if a path cannot be traced or compiled.
+ */
+bool eval_error_expr(const KernelDef& k, size_t n, const double* lo, const double* hi,
+                     double unit, double tiny, unsigned jobs, double* out_lo, double* out_hi,
+                     double* err, std::string& errmsg, ErrExprStats* stats = nullptr);
+
+// $REU_CACHE, else $XDG_CACHE_HOME/reu, else $HOME/.cache/reu.
+std::string errexpr_cache_dir();
+
+}  // namespace reu
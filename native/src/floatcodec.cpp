@@ -0,0 +1,331 @@
+#include "floatcodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef REU_ZSTD
+#include <zstd.h>
+#endif
+
+#include "parallel.hpp"
+
+namespace reu {
+
+enum : uint8_t { BLOCK_RAW = 0, BLOCK_XOR = 1, BLOCK_XOR_ZSTD = 2 };
+
+// Leading zeros are stored as a 4-bit code, rounded down to a multiple of 4.
+static int lead_code(int lead) {
+    return lead >> 2;
+}
+
+static int lead_of_code(uint64_t code) {
+    return int(code) << 2;
+}
+
+static uint64_t low_mask(int n) {
+    return n >= 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+}
+
+// Bits are packed LSB first into little-endian 64-bit words.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint64_t v, int n) {
+        acc_ |= v << fill_;
+        if (fill_ + n >= 64) {
+            emit(8);
+            int used = 64 - fill_;
+            acc_ = used < 64 ? v >> used : 0;
+            fill_ = fill_ + n - 64;
+        } else {
+            fill_ += n;
+        }
+    }
+    void flush() {
+        emit(size_t(fill_ + 7) / 8);
+        acc_ = 0;
+        fill_ = 0;
+    }
+
+private:
+    void emit(size_t bytes) {
+        uint8_t b[8];
+        for (int i = 0; i < 8; i++)
+            b[i] = uint8_t(acc_ >> (8 * i));
+        out_.insert(out_.end(), b, b + bytes);
+    }
+
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int fill_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* p, size_t n) : p_(p), end_(p + n) {}
+
+    uint64_t get(int n) {
+        if (avail_ >= n) {
+            uint64_t r = acc_ & low_mask(n);
+            acc_ = n < 64 ? acc_ >> n : 0;
+            avail_ -= n;
+            return r;
+        }
+        uint64_t next = load();
+        uint64_t r = (avail_ ? acc_ | (next << avail_) : next) & low_mask(n);
+        int take = n - avail_;
+        acc_ = take < 64 ? next >> take : 0;
+        avail_ = 64 - take;
+        return r;
+    }
+    bool overrun() const { return over_; }
+
+private:
+    uint64_t load() {
+        uint64_t w = 0;
+        size_t left = size_t(end_ - p_);
+        if (left >= 8) {
+            memcpy(&w, p_, 8);
+            p_ += 8;
+        } else {
+            over_ = over_ || left == 0;
+            for (size_t i = 0; i < left; i++)
+                w |= uint64_t(p_[i]) << (8 * i);
+            p_ = end_;
+        }
+        return w;
+    }
+
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint64_t acc_ = 0;
+    int avail_ = 0;
+    bool over_ = false;
+};
+
+static void xor_encode(const double* v, size_t n, std::vector<uint8_t>& out) {
+    BitWriter w(out);
+    uint64_t prev;
+    memcpy(&prev, v, 8);
+    w.put(prev, 64);
+    int prev_lead = 65;
+    for (size_t i = 1; i < n; i++) {
+        uint64_t cur;
+        memcpy(&cur, v + i, 8);
+        uint64_t x = cur ^ prev;
+        prev = cur;
+        if (x == 0) {
+            w.put(0, 2);
+            prev_lead = 65;
+            continue;
+        }
+        int code = lead_code(__builtin_clzll(x));
+        int lead = lead_of_code(uint64_t(code));
+        int trail = __builtin_ctzll(x);
+        if (trail > 6) {
+            int centre = 64 - lead - trail;
+            w.put(1, 2);
+            w.put(uint64_t(code), 4);
+            w.put(uint64_t(centre), 6);
+            w.put(x >> trail, centre);
+            prev_lead = 65;
+        } else if (lead == prev_lead) {
+            w.put(2, 2);
+            w.put(x, 64 - lead);
+        } else {
+            w.put(3, 2);
+            w.put(uint64_t(code), 4);
+            w.put(x, 64 - lead);
+            prev_lead = lead;
+        }
+    }
+    w.flush();
+}
+
+static bool xor_decode(const uint8_t* p, size_t size, size_t n, double* out) {
+    BitReader r(p, size);
+    uint64_t prev = r.get(64);
+    memcpy(out, &prev, 8);
+    int lead = 0;
+    for (size_t i = 1; i < n; i++) {
+        switch (r.get(2)) {
+        case 0:
+            break;
+        case 1: {
+            int l = lead_of_code(r.get(4));
+            int centre = int(r.get(6));
+            int trail = 64 - l - centre;
+            if (centre == 0 || trail < 0)
+                return false;
+            prev ^= r.get(centre) << trail;
+            break;
+        }
+        case 2:
+            prev ^= r.get(64 - lead);
+            break;
+        default:
+            lead = lead_of_code(r.get(4));
+            prev ^= r.get(64 - lead);
+            break;
+        }
+        memcpy(out + i, &prev, 8);
+    }
+    return !r.overrun();
+}
+
+bool codec_has_zstd() {
+#ifdef REU_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void encode_block(const double* v, size_t n, int zstd_level, std::vector<uint8_t>& out) {
+    std::vector<uint8_t> xs;
+    xor_encode(v, n, xs);
+    if (xs.size() >= n * 8) {
+        out.push_back(BLOCK_RAW);
+        const uint8_t* b = reinterpret_cast<const uint8_t*>(v);
+        out.insert(out.end(), b, b + n * 8);
+        return;
+    }
+#ifdef REU_ZSTD
+    if (zstd_level != 0) {
+        std::vector<uint8_t> zs(ZSTD_compressBound(xs.size()));
+        size_t z = ZSTD_compress(zs.data(), zs.size(), xs.data(), xs.size(), zstd_level);
+        if (!ZSTD_isError(z) && z + 4 < xs.size()) {
+            uint32_t len = uint32_t(xs.size());
+            out.push_back(BLOCK_XOR_ZSTD);
+            const uint8_t* b = reinterpret_cast<const uint8_t*>(&len);
+            out.insert(out.end(), b, b + 4);
+            out.insert(out.end(), zs.begin(), zs.begin() + long(z));
+            return;
+        }
+    }
+#else
+    (void)zstd_level;
+#endif
+    out.push_back(BLOCK_XOR);
+    out.insert(out.end(), xs.begin(), xs.end());
+}
+
+static bool decode_block(const uint8_t* p, size_t size, size_t n, double* out,
+                         std::string& err) {
+    if (size < 1) {
+        err = "empty block";
+        return false;
+    }
+    switch (p[0]) {
+    case BLOCK_RAW:
+        if (size - 1 != n * 8) {
+            err = "truncated raw block";
+            return false;
+        }
+        memcpy(out, p + 1, n * 8);
+        return true;
+    case BLOCK_XOR:
+        if (!xor_decode(p + 1, size - 1, n, out)) {
+            err = "corrupt XOR block";
+            return false;
+        }
+        return true;
+    case BLOCK_XOR_ZSTD: {
+#ifdef REU_ZSTD
+        uint32_t len;
+        if (size < 5) {
+            err = "truncated zstd block";
+            return false;
+        }
+        memcpy(&len, p + 1, 4);
+        std::vector<uint8_t> xs(len);
+        size_t got = ZSTD_decompress(xs.data(), len, p + 5, size - 5);
+        if (ZSTD_isError(got) || got != len || !xor_decode(xs.data(), len, n, out)) {
+            err = "corrupt zstd block";
+            return false;
+        }
+        return true;
+#else
+        err = "zstd-compressed block; rebuild with ZSTD=1";
+        return false;
+#endif
+    }
+    }
+    err = "unknown block method " + std::to_string(p[0]);
+    return false;
+}
+
+void encode_doubles(const double* v, size_t n, const CodecOptions& opt, unsigned jobs,
+                    std::vector<uint8_t>& out) {
+    uint32_t block = opt.block ? opt.block : 4096;
+    uint32_t nblocks = uint32_t((n + block - 1) / block);
+    std::vector<std::vector<uint8_t>> parts(nblocks);
+    parallel_for(nblocks, jobs, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++) {
+            size_t lo = i * block, cnt = std::min<size_t>(block, n - lo);
+            encode_block(v + lo, cnt, opt.zstd_level, parts[i]);
+        }
+    });
+    uint64_t count = n;
+    auto put = [&](const void* p, size_t k) {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        out.insert(out.end(), b, b + k);
+    };
+    put(&count, 8);
+    put(&block, 4);
+    put(&nblocks, 4);
+    uint64_t end = 0;
+    for (const auto& p : parts) {
+        end += p.size();
+        put(&end, 8);
+    }
+    for (const auto& p : parts)
+        put(p.data(), p.size());
+}
+
+bool decode_doubles(const uint8_t* data, size_t size, unsigned jobs, std::vector<double>& out,
+                    std::string& err) {
+    uint64_t count;
+    uint32_t block, nblocks;
+    if (size < 16) {
+        err = "truncated float stream";
+        return false;
+    }
+    memcpy(&count, data, 8);
+    memcpy(&block, data + 8, 4);
+    memcpy(&nblocks, data + 12, 4);
+    if (block == 0 || (count + block - 1) / block != nblocks ||
+        size < 16 + uint64_t(nblocks) * 8) {
+        err = "corrupt float stream header";
+        return false;
+    }
+    std::vector<uint64_t> ends(nblocks);
+    memcpy(ends.data(), data + 16, size_t(nblocks) * 8);
+    const uint8_t* base = data + 16 + size_t(nblocks) * 8;
+    size_t avail = size - 16 - size_t(nblocks) * 8;
+    for (uint32_t i = 0; i < nblocks; i++) {
+        if (ends[i] > avail || (i && ends[i] < ends[i - 1])) {
+            err = "corrupt float stream offsets";
+            return false;
+        }
+    }
+    out.resize(count);
+    std::vector<std::string> errs(nblocks);
+    parallel_for(nblocks, jobs, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++) {
+            size_t start = i ? ends[i - 1] : 0;
+            size_t lo = i * block, cnt = std::min<size_t>(block, count - lo);
+            decode_block(base + start, ends[i] - start, cnt, out.data() + lo, errs[i]);
+        }
+    });
+    for (const auto& e : errs) {
+        if (!e.empty()) {
+            err = e;
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Lossless XOR compression of double columns, after Chimp (Liakos et al.,
+ * VLDB'22), itself a refinement of Gorilla's XOR scheme. Each value is
+ * XORed with the previous one. MCA samples of one point share sign,
+ * exponent and most of the mantissa, so the XOR is zero or a short run of
+ * low bits:
+ *
+ *   00                  identical to the previous value
+ *   01 lead:4 len:6 b   trailing zeros > 6: `len` centre bits b
+ *   10 b                same leading-zero count as before: 64 - lead bits
+ *   11 lead:4 b         new leading-zero count: 64 - lead bits
+ *
+ * Chimp rounds the leading zeros to 8 levels capped at 24. Samples that
+ * differ only in their last few bits have 50-60 leading zeros, so lead is
+ * stored here as a 4-bit code in steps of 4 instead, up to 60.
+ *
+ * Values are cut into blocks that are encoded and decoded independently,
+ * on several threads, and that each restart from a raw first value.
+ *
+ * Stream layout (little endian):
+ *   u64 count  u32 block size  u32 blocks  u64 end offset per block
+ *   per block: u8 method (0 raw doubles, 1 XOR, 2 XOR + zstd), payload
+ *
+ * Method 2 is only written by builds with -DREU_ZSTD (build.sh: ZSTD=1);
+ * other builds reject such streams with an error.
+ */
+struct CodecOptions {
+    uint32_t block = 4096;  // values per block
+    int zstd_level = 0;     // 0: off; otherwise zstd on top of each XOR block
+};
+
+void encode_doubles(const double* v, size_t n, const CodecOptions& opt, unsigned jobs,
+                    std::vector<uint8_t>& out);
+
+// Decodes a whole stream; out is resized to the stored count.
+bool decode_doubles(const uint8_t* data, size_t size, unsigned jobs, std::vector<double>& out,
+                    std::string& err);
+
+bool codec_has_zstd();
+
+}  // namespace reu
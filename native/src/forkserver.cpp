@@ -0,0 +1,204 @@
+#include "forkserver.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+
+namespace reu {
+
+// Must match harness/forksrv.c.
+static const int FORKSRV_CTL = 198, FORKSRV_ST = 199;
+static const uint32_t FORKSRV_HELLO = 0x31555245u;
+static const char RUN_END[] = "\036\n";
+
+static bool write_all(int fd, const void* buf, size_t n) {
+    const char* p = static_cast<const char*>(buf);
+    while (n) {
+        ssize_t put = write(fd, p, n);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put <= 0)
+            return false;
+        p += put;
+        n -= size_t(put);
+    }
+    return true;
+}
+
+bool ForkServer::fail(const std::string& what, std::string& err) {
+    err = what;
+    // The server may be hung rather than gone; its quit request would wait.
+    if (child_ > 0)
+        kill(child_, SIGKILL);
+    kill(pid_, SIGKILL);
+    child_ = -1;
+    stop();
+    return false;
+}
+
+bool ForkServer::start(const std::vector<std::string>& argv, std::string& err) {
+    stop();
+    if (argv.empty()) {
+        err = "empty command";
+        return false;
+    }
+    // Close-on-exec, as in run_process; the child moves its ends to the
+    // harness descriptors, which dup2 leaves inheritable.
+    int ctl[2], st[2], out[2];
+    if (pipe2(ctl, O_CLOEXEC) != 0 || pipe2(st, O_CLOEXEC) != 0 || pipe2(out, O_CLOEXEC) != 0) {
+        err = std::string("pipe: ") + strerror(errno);
+        return false;
+    }
+    // A server that dies must fail the next write, not kill this process.
+    signal(SIGPIPE, SIG_IGN);
+    std::vector<std::string> args = argv;
+    std::vector<char*> cargv;
+    for (auto& a : args)
+        cargv.push_back(&a[0]);
+    cargv.push_back(nullptr);
+    std::vector<std::string> env_strings;
+    for (char** e = environ; *e; e++)
+        if (strncmp(*e, "REU_FORKSRV=", 12) != 0)
+            env_strings.push_back(*e);
+    env_strings.push_back("REU_FORKSRV=1");
+    std::vector<char*> cenv;
+    for (auto& e : env_strings)
+        cenv.push_back(&e[0]);
+    cenv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        err = std::string("fork: ") + strerror(errno);
+        for (int fd : {ctl[0], ctl[1], st[0], st[1], out[0], out[1]})
+            close(fd);
+        return false;
+    }
+    if (pid == 0) {
+        dup2(ctl[0], FORKSRV_CTL);
+        dup2(st[1], FORKSRV_ST);
+        dup2(out[1], 1);
+        dup2(out[1], 2);
+        execvpe(cargv[0], cargv.data(), cenv.data());
+        _exit(127);
+    }
+    close(ctl[0]);
+    close(st[1]);
+    close(out[1]);
+    pid_ = pid;
+    ctl_ = ctl[1];
+    st_ = st[0];
+    out_ = out[0];
+    fcntl(out_, F_SETFL, O_NONBLOCK);
+
+    uint32_t hello = 0;
+    ssize_t got;
+    while ((got = read(st_, &hello, 4)) < 0 && errno == EINTR) {
+    }
+    if (got != 4 || hello != FORKSRV_HELLO)
+        return fail("'" + argv[0] + "' did not start a fork server (not linked with " +
+                        "harness/forksrv.c and -Wl,--wrap=main?)",
+                    err);
+    return true;
+}
+
+bool ForkServer::run(const std::vector<std::string>& inputs, uint64_t seed, double timeout,
+                     BatchResult& res, std::string& err) {
+    res = BatchResult();
+    if (!running()) {
+        err = "fork server not running";
+        return false;
+    }
+    std::string text;
+    for (const auto& in : inputs)
+        text += in + "\n";
+    uint32_t count = uint32_t(inputs.size()), bytes = uint32_t(text.size());
+    if (count == 0)
+        return true;
+    if (!write_all(ctl_, &count, 4) || !write_all(ctl_, &seed, 8) ||
+        !write_all(ctl_, &bytes, 4) || !write_all(ctl_, text.data(), text.size()))
+        return fail("fork server closed its request pipe", err);
+
+    // Drain the child's output while waiting for the two status words, so a
+    // chatty child never blocks on a full pipe. Every run separator counts
+    // as progress and restarts the time limit.
+    using clock = std::chrono::steady_clock;
+    auto progress = clock::now();
+    uint32_t words[2];
+    size_t have = 0, scan = 0;
+    std::string buf;
+    char chunk[65536];
+    for (;;) {
+        int wait_ms = have == 8 ? 0 : -1;
+        if (have < 8 && timeout > 0 && !res.timed_out) {
+            double left = timeout - std::chrono::duration<double>(clock::now() - progress).count();
+            wait_ms = left > 0 ? int(left * 1000) + 1 : 0;
+        }
+        struct pollfd fds[2] = {{out_, POLLIN, 0}, {st_, POLLIN, 0}};
+        int ready = poll(fds, have < 8 ? 2 : 1, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            return fail(std::string("poll: ") + strerror(errno), err);
+        }
+        if (ready == 0 && have < 8) {
+            if (have < 4)
+                return fail("fork server did not start a child within the time limit", err);
+            kill(child_, SIGKILL);
+            res.timed_out = true;
+            continue;
+        }
+        ssize_t n = read(out_, chunk, sizeof chunk);
+        if (n > 0) {
+            buf.append(chunk, size_t(n));
+            for (size_t at; (at = buf.find(RUN_END, scan)) != std::string::npos;
+                 scan = at + sizeof RUN_END - 1)
+                progress = clock::now();
+            scan = std::max(scan, buf.size() - 1);
+            continue;
+        }
+        if (have == 8)
+            break;  // child gone and its output drained
+        if (fds[1].revents) {
+            n = read(st_, reinterpret_cast<char*>(words) + have, 8 - have);
+            if (n <= 0)
+                return fail("fork server died", err);
+            have += size_t(n);
+            if (have >= 4 && child_ < 0)
+                child_ = pid_t(words[0]);
+        }
+    }
+    child_ = -1;
+    int ws = int(words[1]);
+    res.status = WIFEXITED(ws) ? WEXITSTATUS(ws) : 128 + WTERMSIG(ws);
+
+    size_t start = 0, end;
+    while ((end = buf.find(RUN_END, start)) != std::string::npos) {
+        res.outputs.push_back(buf.substr(start, end - start));
+        start = end + sizeof RUN_END - 1;
+    }
+    res.partial = buf.substr(start);
+    return true;
+}
+
+void ForkServer::stop() {
+    if (pid_ <= 0)
+        return;
+    uint32_t quit = 0;
+    write_all(ctl_, &quit, 4);
+    for (int fd : {ctl_, st_, out_})
+        close(fd);
+    int st;
+    while (waitpid(pid_, &st, 0) < 0 && errno == EINTR) {
+    }
+    pid_ = -1;
+    ctl_ = st_ = out_ = -1;
+}
+
+}  // namespace reu
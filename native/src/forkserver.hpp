@@ -0,0 +1,56 @@
+#pragma once
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace reu {
+
+struct BatchResult {
+    std::vector<std::string> outputs;  // one per completed run
+    std::string partial;               // output of the run that did not complete
+    int status = -1;                   // exit code, or 128 + signal number
+    bool timed_out = false;            // child killed after the time limit
+};
+
+/*
+ * Engine side of the fork-server harness (harness/forksrv.c). start() execs
+ * a kernel binary linked with the harness once; every run() then asks it to
+ * fork a child for a batch of inputs, skipping exec, dynamic loading and
+ * backend initialisation. One ForkServer serves one thread.
+ */
+class ForkServer {
+public:
+    ForkServer() = default;
+    ForkServer(const ForkServer&) = delete;
+    ForkServer& operator=(const ForkServer&) = delete;
+    ~ForkServer() { stop(); }
+
+    // Exec argv with the harness enabled and wait for its handshake.
+    bool start(const std::vector<std::string>& argv, std::string& err);
+
+    /*
+     * Run each input (the space separated arguments of one run) in one
+     * child seeded with seed. res.outputs receives the stdout/stderr text of
+     * the runs that completed, in order; fewer than inputs.size() means the
+     * child died during run res.outputs.size(). A child that completes no
+     * run for timeout seconds (0 for no limit) is killed and reported as
+     * timed_out. res.status is the child's exit code, or 128 + signal
+     * number. Returns false if the server itself failed or stopped
+     * answering, after which it is stopped.
+     */
+    bool run(const std::vector<std::string>& inputs, uint64_t seed, double timeout,
+             BatchResult& res, std::string& err);
+
+    void stop();
+    bool running() const { return pid_ > 0; }
+
+private:
+    bool fail(const std::string& what, std::string& err);
+
+    pid_t pid_ = -1, child_ = -1;
+    int ctl_ = -1, st_ = -1, out_ = -1;
+};
+
+}  // namespace reu
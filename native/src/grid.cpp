@@ -0,0 +1,120 @@
+#include "grid.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace reu {
+
+size_t Axis::size() const {
+    if (hi <= lo || step <= 0.0)
+        return 1;
+    // Matches np.arange(lo, hi + step/2, step) in the runner scripts.
+    return size_t(std::floor((hi - lo) / step + 0.5)) + 1;
+}
+
+double Axis::value(size_t k) const {
+    return lo + double(k) * step;
+}
+
+size_t Grid::size() const {
+    size_t n = 1;
+    for (const auto& a : axes)
+        n *= a.size();
+    return n;
+}
+
+void Grid::point(size_t idx, double* x) const {
+    for (size_t d = axes.size(); d-- > 0;) {
+        size_t m = axes[d].size();
+        x[d] = axes[d].value(idx % m);
+        idx /= m;
+    }
+}
+
+static bool parse_double(const std::string& s, double& v) {
+    char* end = nullptr;
+    v = std::strtod(s.c_str(), &end);
+    return !s.empty() && end && *end == '\0';
+}
+
+static bool parse_range(const std::string& s, double& lo, double& hi) {
+    size_t colon = s.find(':');
+    return colon != std::string::npos && parse_double(s.substr(0, colon), lo) &&
+           parse_double(s.substr(colon + 1), hi);
+}
+
+static Axis* find_axis(Grid& grid, const std::string& name) {
+    for (auto& a : grid.axes) {
+        if (a.name == name)
+            return &a;
+    }
+    return nullptr;
+}
+
+// Apply 'var=value,var=value' pairs through fn(axis, value).
+template <class F>
+static bool for_pairs(Grid& grid, const std::string& list, const char* what,
+                      std::string& err, F fn) {
+    std::stringstream ss(list);
+    std::string pair;
+    while (std::getline(ss, pair, ',')) {
+        size_t eq = pair.find('=');
+        Axis* a = eq == std::string::npos ? nullptr : find_axis(grid, pair.substr(0, eq));
+        if (!a || !fn(*a, pair.substr(eq + 1))) {
+            err = std::string("invalid ") + what + " entry '" + pair + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool make_grid(int n_in, const std::string& range, const std::string& ranges,
+               const std::string& step, const std::string& steps,
+               const std::string& fixed, Grid& grid, std::string& err,
+               const CireSpec* spec) {
+    Axis base;
+    if (!range.empty() && !parse_range(range, base.lo, base.hi)) {
+        err = "invalid range '" + range + "'";
+        return false;
+    }
+    if (!step.empty() && !parse_double(step, base.step)) {
+        err = "invalid step '" + step + "'";
+        return false;
+    }
+
+    grid.axes.clear();
+    for (int i = 0; i < n_in; i++) {
+        Axis a = base;
+        a.name = "x" + std::to_string(i);
+        grid.axes.push_back(a);
+    }
+    if (spec) {
+        if (int(spec->inputs.size()) != n_in) {
+            err = "spec declares " + std::to_string(spec->inputs.size()) +
+                  " inputs, kernel takes " + std::to_string(n_in);
+            return false;
+        }
+        for (int i = 0; i < n_in; i++) {
+            grid.axes[i].lo = spec->inputs[i].lo;
+            grid.axes[i].hi = spec->inputs[i].hi;
+        }
+    }
+
+    return for_pairs(grid, ranges, "range", err,
+                     [](Axis& a, const std::string& v) {
+                         return parse_range(v, a.lo, a.hi);
+                     }) &&
+           for_pairs(grid, steps, "step", err,
+                     [](Axis& a, const std::string& v) {
+                         return parse_double(v, a.step);
+                     }) &&
+           for_pairs(grid, fixed, "fixed value", err,
+                     [](Axis& a, const std::string& v) {
+                         bool ok = parse_double(v, a.lo);
+                         a.hi = a.lo;
+                         return ok;
+                     });
+}
+
+}  // namespace reu
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "cire_spec.hpp"
+
+namespace reu {
+
+// One input dimension of a sweep: lo, lo+step, ... up to hi inclusive.
+struct Axis {
+    std::string name;
+    double lo = -1.0;
+    double hi = 1.0;
+    double step = 0.5;
+
+    size_t size() const;
+    double value(size_t k) const;
+};
+
+/*
+ * Regular grid over the kernel inputs, enumerated with x0 varying slowest
+ * (the same order runp.sh writes its test cases in).
+ */
+struct Grid {
+    std::vector<Axis> axes;
+
+    size_t size() const;
+    void point(size_t idx, double* x) const;
+};
+
+/*
+ * Build a grid from the runner-script options: -r 'start:end' and -s STEP
+ * for every input, -R 'x0=a:b,...' and -S 'x0=step,...' per input, and
+ * -F 'x1=v,...' to pin inputs. A .cire spec, if given, supplies the input box
+ * (its i-th input is x<i>); -R and -F still override it. Returns false and
+ * sets err on bad syntax.
+ */
+bool make_grid(int n_in, const std::string& range, const std::string& ranges,
+               const std::string& step, const std::string& steps,
+               const std::string& fixed, Grid& grid, std::string& err,
+               const CireSpec* spec = nullptr);
+
+}  // namespace reu
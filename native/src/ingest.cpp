@@ -0,0 +1,469 @@
+#include "ingest.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include "json.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+#include "samplefile.hpp"
+#include "sigest.hpp"
+#include "textcodec.hpp"
+
+namespace reu {
+
+static std::string base_name(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void split_cire_key(const std::string& key, std::string& kernel, std::string& opt) {
+    // cirecmany_consolidated.sh tags runs as <name>_<O1|O2|O3|Os>[.<flag>].
+    size_t us = key.find_last_of('_');
+    if (us != std::string::npos && us + 2 <= key.size() && key[us + 1] == 'O') {
+        kernel = key.substr(0, us);
+        opt = key.substr(us + 1);
+    } else {
+        kernel = key;
+        opt.clear();
+    }
+}
+
+std::string default_box(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos)
+        return "";
+    std::string dir = base_name(path.substr(0, slash));
+    if (dir.size() >= 7 && dir.compare(dir.size() - 7, 7, "results") == 0)
+        return "";
+    return dir == "." || dir == ".." ? "" : dir;
+}
+
+static double num_or_nan(const Json* v) {
+    return v && v->is_number() ? v->num : NAN;
+}
+
+static void set_count(ResultStore& out, const char* col, size_t row, const Json* v) {
+    if (v && v->is_number())
+        out.set_int(col, row, int64_t(v->num));
+}
+
+// Lower/upper entries of a two-element [lo, hi] array.
+static void set_pair(ResultStore& out, const std::string& lo, const std::string& hi,
+                     size_t row, const Json* v) {
+    if (!v || !v->is_array() || v->items.size() != 2)
+        return;
+    out.set(lo, row, num_or_nan(&v->items[0]));
+    out.set(hi, row, num_or_nan(&v->items[1]));
+}
+
+// Parse "[a, b]" following `tag` at pos; false if the text does not match.
+static bool bracket_pair(const std::string& text, size_t pos, double v[2]) {
+    size_t open = text.find_first_not_of(" \t", pos);
+    if (open == std::string::npos || text[open] != '[')
+        return false;
+    size_t close = text.find(']', open);
+    if (close == std::string::npos)
+        return false;
+    std::string inner = text.substr(open + 1, close - open - 1);
+    size_t comma = inner.find(',');
+    if (comma == std::string::npos)
+        return false;
+    char* end = nullptr;
+    double a = strtod(inner.c_str(), &end);
+    bool ok = end != inner.c_str();
+    const char* b_str = inner.c_str() + comma + 1;
+    double b = strtod(b_str, &end);
+    if (!ok || end == b_str)
+        return false;
+    v[0] = a;
+    v[1] = b;
+    return true;
+}
+
+bool parse_cire_log(const std::string& text, double output[2], double error[2]) {
+    output[0] = output[1] = error[0] = error[1] = NAN;
+    bool got_out = false, got_err = false;
+    for (size_t pos = text.find("Output:"); pos != std::string::npos;
+         pos = text.find("Output:", pos + 7))
+        got_out = bracket_pair(text, pos + 7, output) || got_out;
+    for (size_t pos = text.find("Error:"); pos != std::string::npos && !got_err;
+         pos = text.find("Error:", pos + 6))
+        got_err = bracket_pair(text, pos + 6, error);
+    return got_out || got_err;
+}
+
+bool ingest_cire_json(const std::string& path, const std::string& box, ResultStore& out,
+                      std::string& err) {
+    Json doc;
+    if (!load_json(path, doc, err))
+        return false;
+    if (!doc.is_object()) {
+        err = path + ": top level is not an object";
+        return false;
+    }
+    for (const auto& run : doc.fields) {
+        const Json* results = run.second.get("Results");
+        if (!results || !results->is_object())
+            continue;
+        std::string kernel, opt;
+        split_cire_key(run.first, kernel, opt);
+        // Every object member of Results is one analysed output (add, div, ...).
+        for (const auto& op : results->fields) {
+            if (!op.second.is_object())
+                continue;
+            size_t row = out.add_row();
+            out.set_str("tool", row, "cire");
+            out.set_str("kernel", row, kernel);
+            out.set_str("opt", row, opt);
+            out.set_str("box", row, box);
+            out.set_str("source", row, path);
+            out.set_str("op", row, op.first);
+            set_pair(out, "out_lo", "out_hi", row, op.second.get("Output"));
+            set_pair(out, "err_lo", "err_hi", row, op.second.get("Error"));
+            if (const Json* optima = op.second.get("Optima")) {
+                for (size_t i = 0; optima->is_array() && i < optima->items.size(); i++) {
+                    std::string x = "optima_x" + std::to_string(i);
+                    set_pair(out, x + "_0", x + "_1", row, &optima->items[i]);
+                }
+            }
+            set_count(out, "height", row, results->get("Height"));
+            set_count(out, "num_ops", row, results->get("NumOperators"));
+            set_count(out, "optimizer_calls", row, results->get("Number of Optimizer Calls"));
+            out.set("t_opt", row, num_or_nan(results->get("Optimization Time")));
+            out.set("t_parse", row, num_or_nan(run.second.get("Parsing Time")));
+            out.set("t_error", row, num_or_nan(run.second.get("Error Analysis Time")));
+            out.set("t_total", row, num_or_nan(run.second.get("Total Time")));
+        }
+    }
+    return true;
+}
+
+/*
+ * Tool, kernel, config and precision from a runner file name:
+ *   ex1_original-DOUBLE-vp24-mca.tab          (run.sh)
+ *   softmax_og0-3inputs-grid-DOUBLE-vp53-mca  (runp.sh)
+ *   vprecex1_original-DOUBLE-binary32.tab     (run_vprec.sh)
+ *   gelu_tanh0-FLOAT-bf16-sr-out.tab          (fpsweep)
+ */
+static void parse_tab_name(const std::string& path, std::string& tool, std::string& kernel,
+                           std::string& config, int64_t& precision) {
+    std::string stem = base_name(path);
+    if (stem.size() > 4 && stem.compare(stem.size() - 4, 4, ".tab") == 0)
+        stem.resize(stem.size() - 4);
+    else if (stem.size() > 5 && stem.compare(stem.size() - 5, 5, ".rsmp") == 0)
+        stem.resize(stem.size() - 5);
+    std::vector<std::string> tok;
+    std::stringstream ss(stem);
+    std::string t;
+    while (std::getline(ss, t, '-'))
+        tok.push_back(t);
+    kernel = tok.empty() ? stem : tok[0];
+    tool = "sweep";
+    precision = I64_NULL;
+    if (kernel.compare(0, 5, "vprec") == 0 && kernel.size() > 5) {
+        kernel = kernel.substr(5);
+        tool = "vprec";
+    }
+    config.clear();
+    for (size_t i = 1; i < tok.size(); i++) {
+        if (tok[i] == "grid" || (tok[i].size() > 6 &&
+                                 tok[i].compare(tok[i].size() - 6, 6, "inputs") == 0))
+            continue;
+        config += (config.empty() ? "" : "-") + tok[i];
+        const char* s = tok[i].c_str();
+        if (s[0] == 'v' && s[1] == 'p')
+            s += 2;
+        else if (s[0] == 'p')
+            s += 1;
+        else
+            continue;
+        char* end = nullptr;
+        long p = strtol(s, &end, 10);
+        if (end != s && *end == '\0')
+            precision = p;
+    }
+    if (!tok.empty() && (tok.back() == "mca" || tok.back() == "pb" || tok.back() == "rr"))
+        tool = "mca";
+}
+
+// Output columns of a .tab header: "result", or y0, y1, ... for kernels
+// with several outputs.
+static bool is_output_column(const std::string& name) {
+    return name == "result" ||
+           (name.size() > 1 && name[0] == 'y' && name.find_first_not_of("0123456789", 1) ==
+                                                     std::string::npos);
+}
+
+static std::string binade_label(double x) {
+    return x == 0 ? "zero" : std::isfinite(x) ? std::to_string(std::ilogb(x)) : "nonfinite";
+}
+
+// Samples of one input point; y holds them sample-major, n_out values each.
+struct SweepPoint {
+    std::vector<double> x;
+    std::vector<double> y;
+};
+
+// One row per point and output with the sample statistics, as described
+// in ingest.hpp; tool, kernel and config come from the file name.
+static void append_points(const std::string& path, const std::string& box,
+                          const std::vector<SweepPoint>& points, size_t n_in, size_t n_out,
+                          ResultStore& out) {
+    std::string tool, kernel, config;
+    int64_t precision;
+    parse_tab_name(path, tool, kernel, config, precision);
+
+    // MCA digits are capped at the virtual precision, otherwise at the type.
+    double cap_bits = precision != I64_NULL ? double(precision)
+                      : config.compare(0, 5, "FLOAT") == 0 ? 24.0 : 53.0;
+    double cap = digits_of_bits(cap_bits);
+    std::vector<double> sig(n_out);
+    // ULPs in the format the samples were computed in, as SampleUlp.
+    bool single = config.compare(0, 5, "FLOAT") == 0;
+    int ulp_bits = precision != I64_NULL ? int(precision) : single ? 24 : 53;
+    int ulp_emin = single && precision == I64_NULL ? -126 : -1022;
+    SketchKey key{tool, kernel, config, box, path, "", "", 0};
+    for (const auto& p : points) {
+        int n = int(p.y.size() / n_out);
+        double norm = n > 1 && n_out > 1
+            ? mca_sig_digits_vec(p.y.data(), n, int(n_out), cap, sig.data())
+            : NAN;
+        // One row per output; outputs of a point share the norm-wise digits.
+        for (size_t o = 0; o < n_out; o++) {
+            size_t row = out.add_row();
+            out.set_str("tool", row, tool);
+            out.set_str("kernel", row, kernel);
+            out.set_str("box", row, box);
+            out.set_str("source", row, path);
+            out.set_str("config", row, config);
+            if (precision != I64_NULL)
+                out.set_int("precision", row, precision);
+            for (size_t d = 0; d < n_in; d++)
+                out.set("x" + std::to_string(d), row, p.x[d]);
+            out.set_int("output", row, int64_t(o));
+            double sum = 0, lo = INFINITY, hi = -INFINITY;
+            for (int i = 0; i < n; i++) {
+                double y = p.y[i * n_out + o];
+                sum += y;
+                lo = y < lo ? y : lo;
+                hi = y > hi ? y : hi;
+            }
+            // Digits at the default SigLevel, against the sample mean.
+            SigEstimator est(SigLevel(), cap_bits);
+            for (int i = 0; i < n; i++)
+                est.add(p.y[i * n_out + o]);
+            double mean = sum / double(n), var = 0;
+            for (int i = 0; i < n; i++)
+                var += (p.y[i * n_out + o] - mean) * (p.y[i * n_out + o] - mean);
+            out.set_int("samples", row, int64_t(n));
+            out.set("mean", row, mean);
+            // Error distributions per output and binade of x0, for quantiles.
+            key.output = int64_t(o);
+            key.region = n_in == 0 ? "" : "binade(x0)=" + binade_label(p.x[0]);
+            key.metric = "ulp";
+            QuantileSketch& ulps = out.sketch(key);
+            for (int i = 0; i < n; i++)
+                ulps.add(ulp_error(p.y[i * n_out + o], mean, ulp_bits - 1, ulp_emin));
+            out.set("std", row, std::sqrt(var / double(n)));
+            out.set("out_lo", row, lo);
+            out.set("out_hi", row, hi);
+            if (n > 1) {
+                double digits = n_out > 1 ? sig[o] : mca_sig_digits(&p.y[o], n, cap, int(n_out));
+                out.set("sig_digits", row, digits);
+                key.metric = "sig_digits";
+                out.sketch(key).add(digits);
+                out.set("sig_digits_cnh", row, digits_of_bits(est.cnh_bits()));
+                if (est.count() >= bernoulli_min_samples(SigLevel()))
+                    out.set("sig_digits_bern", row, digits_of_bits(est.bernoulli_bits()));
+            }
+            if (n_out > 1 && n > 1)
+                out.set("sig_digits_norm", row, norm);
+        }
+    }
+}
+
+bool ingest_tab(const std::string& path, const std::string& box, ResultStore& out,
+                std::string& err, unsigned jobs) {
+    TextTable t;
+    if (!read_text_table(path, jobs, t, err))
+        return false;
+    const std::vector<std::string>& f = t.names;
+    size_t n_out = 0;
+    while (n_out + 1 < f.size() && is_output_column(f[f.size() - 1 - n_out]))
+        n_out++;
+    if (f.size() < 3 || f[0] != "i" || n_out == 0 || n_out + 1 == f.size() || n_out > 64) {
+        err = path + ": missing 'i x... result' header";
+        return false;
+    }
+    size_t n_in = f.size() - 1 - n_out;
+
+    // Samples of one input point are grouped by the exact input values, in
+    // order of first appearance (run.sh and runp.sh interleave differently).
+    std::vector<SweepPoint> points;
+    std::unordered_map<std::string, size_t> seen;
+    std::string key;
+    for (size_t r = 0; r < t.rows(); r++) {
+        key.clear();
+        for (size_t d = 0; d < n_in; d++)
+            key.append(reinterpret_cast<const char*>(&t.columns[d + 1][r]), sizeof(double));
+        auto it = seen.find(key);
+        if (it == seen.end()) {
+            it = seen.emplace(key, points.size()).first;
+            SweepPoint p;
+            for (size_t d = 0; d < n_in; d++)
+                p.x.push_back(t.columns[d + 1][r]);
+            points.push_back(std::move(p));
+        }
+        std::vector<double>& ys = points[it->second].y;
+        for (size_t o = 0; o < n_out; o++)
+            ys.push_back(t.columns[1 + n_in + o][r]);
+    }
+
+    append_points(path, box, points, n_in, n_out, out);
+    return true;
+}
+
+bool ingest_samples(const std::string& path, const std::string& box, ResultStore& out,
+                    std::string& err) {
+    SampleFile sf;
+    if (!read_samples(path, sf, 1, err))
+        return false;
+    size_t n_in = sf.inputs.size(), n_out = size_t(sf.n_out);
+    size_t per_point = size_t(sf.samples) * n_out;
+    std::vector<SweepPoint> points(sf.points);
+    for (size_t p = 0; p < sf.points; p++) {
+        points[p].x.assign(sf.x.begin() + long(p * n_in), sf.x.begin() + long((p + 1) * n_in));
+        points[p].y.assign(sf.y.begin() + long(p * per_point),
+                           sf.y.begin() + long((p + 1) * per_point));
+    }
+    append_points(path, box, points, n_in, n_out, out);
+    return true;
+}
+
+static bool is_int_column(const std::string& name) {
+    return name == "cell" || name == "output" || name == "precision" || name == "samples" ||
+           name == "status" || name == "cancel_site";
+}
+
+bool ingest_csv(const std::string& path, const std::string& box, ResultStore& out,
+                std::string& err) {
+    std::ifstream in(path);
+    if (!in) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    auto split = [](const std::string& line) {
+        std::vector<std::string> f;
+        std::stringstream ls(line);
+        std::string w;
+        while (std::getline(ls, w, ','))
+            f.push_back(w);
+        if (!line.empty() && line.back() == ',')
+            f.emplace_back();
+        return f;
+    };
+    std::string line;
+    std::vector<std::string> names;
+    while (names.empty() && std::getline(in, line))
+        if (!line.empty() && line[0] != '#')
+            names = split(line);
+    if (names.empty()) {
+        err = path + ": empty file";
+        return false;
+    }
+    std::vector<std::vector<std::string>> cells(names.size());
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::vector<std::string> f = split(line);
+        if (f.size() != names.size()) {
+            err = path + ": " + std::to_string(f.size()) + " fields where the header has " +
+                  std::to_string(names.size());
+            return false;
+        }
+        for (size_t c = 0; c < f.size(); c++)
+            cells[c].push_back(std::move(f[c]));
+    }
+    size_t n = cells[0].size(), base = out.rows();
+    for (size_t r = 0; r < n; r++)
+        out.add_row();
+
+    bool has_box = false, has_source = false;
+    for (size_t c = 0; c < names.size(); c++) {
+        has_box = has_box || names[c] == "box";
+        has_source = has_source || names[c] == "source";
+        bool numeric = true;
+        std::vector<double> v(n, NAN);
+        for (size_t r = 0; r < n && numeric; r++) {
+            const std::string& s = cells[c][r];
+            if (s.empty())
+                continue;
+            numeric = parse_double(s.data(), s.data() + s.size(), v[r]);
+        }
+        for (size_t r = 0; r < n; r++) {
+            if (!numeric)
+                out.set_str(names[c], base + r, cells[c][r]);
+            else if (std::isnan(v[r]))
+                continue;
+            else if (is_int_column(names[c]))
+                out.set_int(names[c], base + r, int64_t(v[r]));
+            else
+                out.set(names[c], base + r, v[r]);
+        }
+    }
+    for (size_t r = 0; r < n; r++) {
+        if (!has_box)
+            out.set_str("box", base + r, box);
+        if (!has_source)
+            out.set_str("source", base + r, path);
+    }
+    return true;
+}
+
+static bool ends_with(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+size_t ingest_files(const std::vector<std::string>& paths, const std::string& box,
+                    unsigned jobs, ResultStore& out, std::vector<std::string>& errors) {
+    std::vector<ResultStore> parts(paths.size());
+    std::vector<std::string> errs(paths.size());
+    // Fewer files than jobs: the spare threads parse chunks within each .tab.
+    unsigned file_jobs = paths.empty() || jobs <= paths.size() ? 1 : unsigned(jobs / paths.size());
+    parallel_for(paths.size(), jobs, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++) {
+            const std::string& p = paths[i];
+            std::string bx = box.empty() ? default_box(p) : box;
+            if (ends_with(p, ".json"))
+                ingest_cire_json(p, bx, parts[i], errs[i]);
+            else if (ends_with(p, ".tab"))
+                ingest_tab(p, bx, parts[i], errs[i], file_jobs);
+            else if (ends_with(p, ".rsmp"))
+                ingest_samples(p, bx, parts[i], errs[i]);
+            else if (ends_with(p, ".csv"))
+                ingest_csv(p, bx, parts[i], errs[i]);
+            else
+                errs[i] = p + ": unknown file type (expected .json, .tab, .rsmp or .csv)";
+        }
+    });
+    size_t added = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string err = errs[i];
+        if (err.empty() && !out.append(parts[i], err))
+            err = paths[i] + ": " + err;
+        if (!err.empty()) {
+            errors.push_back(err);
+            continue;
+        }
+        added += parts[i].rows();
+    }
+    return added;
+}
+
+}  // namespace reu
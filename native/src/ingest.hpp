@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "store.hpp"
+
+namespace reu {
+
+/*
+ * Loaders that turn the result files the example scripts produce into
+ * ResultStore rows. Shared columns:
+ *
+ *   tool    cire | mca | vprec | sweep
+ *   kernel  kernel name (softmax_og0, parallel_3, ...)
+ *   opt     optimization level of a CIRE run (O1, O2.ffast-math, ...)
+ *   box     input box / input set label (softmax2, input1, ...)
+ *   source  file the row came from
+ *
+ * CIRE rows (one per analysed output op) add op, out_lo/out_hi, err_lo/err_hi,
+ * optima_x<i>_0/1, height, num_ops, optimizer_calls and the t_* timings.
+ * .tab rows (one per input point and output) add config, precision, x0..,
+ * output, samples, mean, std, sig_digits, out_lo/out_hi (sample min/max)
+ * and, for kernels with several outputs, the norm-wise sig_digits_norm.
+ * sig_digits_cnh and sig_digits_bern are the digits at probability 0.9 and
+ * confidence 0.95 (sigest.hpp), the Bernoulli ones from 29 samples up.
+ * .tab and .rsmp files also add "ulp" and "sig_digits" sketches (store.hpp)
+ * per output and binade of x0, keeping the error distributions the rows
+ * reduce away.
+ */
+
+// "softmax_og0_O1" -> ("softmax_og0", "O1"); keys without a level keep opt "".
+void split_cire_key(const std::string& key, std::string& kernel, std::string& opt);
+
+// Box label from the file location: the parent directory unless that is a
+// generic "*results" directory, in which case "".
+std::string default_box(const std::string& path);
+
+/*
+ * Bounds from CIRE's console output, as cire2.sh scrapes them: the last
+ * "Output: [lo, hi]" and the first "Error: [lo, hi]". Missing entries are
+ * left NaN; returns false if neither is present.
+ */
+bool parse_cire_log(const std::string& text, double output[2], double error[2]);
+
+bool ingest_cire_json(const std::string& path, const std::string& box, ResultStore& out,
+                      std::string& err);
+// Parsed by read_text_table (textcodec.hpp) on `jobs` threads.
+bool ingest_tab(const std::string& path, const std::string& box, ResultStore& out,
+                std::string& err, unsigned jobs = 1);
+// fpsweep -Z sample files; the same rows as the .tab of the same name.
+bool ingest_samples(const std::string& path, const std::string& box, ResultStore& out,
+                    std::string& err);
+
+/*
+ * Keyed records: a .csv with a header naming the store columns, one row per
+ * record (cire2.sh writes tool, kernel, opt, box, x<i>_lo/x<i>_hi, status,
+ * out_lo and err_hi per grid cell). Columns whose values all parse as numbers
+ * are F64 (cell, output, precision, samples, status and cancel_site: I64),
+ * others STR.
+ * box and source are filled in when the file does not have them.
+ */
+bool ingest_csv(const std::string& path, const std::string& box, ResultStore& out,
+                std::string& err);
+
+/*
+ * Ingest a batch of .json / .tab / .rsmp / .csv files, parsing them on `jobs` threads and
+ * appending in argument order. An empty box uses default_box() per file.
+ * Files that fail are reported in errors and skipped.
+ */
+size_t ingest_files(const std::vector<std::string>& paths, const std::string& box,
+                    unsigned jobs, ResultStore& out, std::vector<std::string>& errors);
+
+}  // namespace reu
@@ -0,0 +1,9 @@
+#include "interval.hpp"
+
+namespace reu {
+
+thread_local unsigned interval_flags = 0;
+thread_local double err_unit = 0x1p-53;
+thread_local double err_tiny = 0x1p-1074;
+
+}  // namespace reu
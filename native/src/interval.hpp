@@ -0,0 +1,256 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+namespace reu {
+
+/*
+ * Interval arithmetic for bounding kernels over input boxes. Each bound is
+ * computed in round-to-nearest and then moved one ulp outward. A libm
+ * result moves one ulp more than the function's documented maximum error
+ * (the *_ULPS constants), so results always enclose the exact range.
+ *
+ * Kernel code that cannot be bounded soundly sets thread-local flags
+ * instead of failing: a comparison whose outcome differs across the box
+ * (INTERVAL_BRANCH), or a sqrt / log / pow outside its domain or a divisor
+ * that may be zero (INTERVAL_DOMAIN). Callers clear interval_flags before
+ * an evaluation and treat a flagged result as unbounded.
+ */
+enum : unsigned {
+    INTERVAL_BRANCH = 1u << 0,
+    INTERVAL_DOMAIN = 1u << 1,
+};
+
+extern thread_local unsigned interval_flags;
+
+inline double round_down(double x) { return std::nextafter(x, -INFINITY); }
+inline double round_up(double x) { return std::nextafter(x, INFINITY); }
+
+// Maximum errors of glibc's libm in ulps, as its manual lists them ("Known
+// Maximum Errors in Math Functions"); sqrt is correctly rounded.
+constexpr int EXP_ULPS = 1, EXPM1_ULPS = 1, LOG_ULPS = 1, POW_ULPS = 1, TANH_ULPS = 2;
+
+struct Interval {
+    double lo = 0.0, hi = 0.0;
+
+    Interval() = default;
+    Interval(double x) : lo(x), hi(x) {}
+    Interval(double l, double h) : lo(l), hi(h) {}
+
+    double mid() const { return lo + (hi - lo) / 2; }
+    double width() const { return hi - lo; }
+    double mag() const { return std::max(std::fabs(lo), std::fabs(hi)); }
+    bool contains(double x) const { return lo <= x && x <= hi; }
+};
+
+inline Interval entire() { return Interval(-INFINITY, INFINITY); }
+inline Interval hull(Interval a, Interval b) {
+    return Interval(std::min(a.lo, b.lo), std::max(a.hi, b.hi));
+}
+
+inline Interval operator+(Interval a, Interval b) {
+    return Interval(round_down(a.lo + b.lo), round_up(a.hi + b.hi));
+}
+inline Interval operator-(Interval a, Interval b) {
+    return Interval(round_down(a.lo - b.hi), round_up(a.hi - b.lo));
+}
+inline Interval operator-(Interval a) { return Interval(-a.hi, -a.lo); }
+
+// 0 * inf is 0 for bounds: the zero is exact, the infinity a bound.
+inline double bound_mul(double a, double b) { return a == 0.0 || b == 0.0 ? 0.0 : a * b; }
+
+inline Interval operator*(Interval a, Interval b) {
+    double p[4] = {bound_mul(a.lo, b.lo), bound_mul(a.lo, b.hi), bound_mul(a.hi, b.lo),
+                   bound_mul(a.hi, b.hi)};
+    return Interval(round_down(*std::min_element(p, p + 4)),
+                    round_up(*std::max_element(p, p + 4)));
+}
+inline Interval operator/(Interval a, Interval b) {
+    if (b.contains(0.0)) {
+        if (a.lo == 0.0 && a.hi == 0.0)
+            return Interval(0.0);
+        interval_flags |= INTERVAL_DOMAIN;
+        return entire();
+    }
+    double q[4] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+    return Interval(round_down(*std::min_element(q, q + 4)),
+                    round_up(*std::max_element(q, q + 4)));
+}
+
+// Increasing libm function f, accurate to ulps, applied to the bounds and
+// moved ulps + 1 outward.
+template <class F>
+inline Interval increasing(Interval a, F f, int ulps) {
+    Interval r(f(a.lo), f(a.hi));
+    for (int i = 0; i <= ulps; i++)
+        r = Interval(round_down(r.lo), round_up(r.hi));
+    return r;
+}
+
+inline Interval exp(Interval a) {
+    Interval r = increasing(a, [](double v) { return std::exp(v); }, EXP_ULPS);
+    r.lo = std::max(r.lo, 0.0);
+    return r;
+}
+inline Interval expm1(Interval a) {
+    Interval r = increasing(a, [](double v) { return std::expm1(v); }, EXPM1_ULPS);
+    r.lo = std::max(r.lo, -1.0);
+    return r;
+}
+inline Interval tanh(Interval a) {
+    Interval r = increasing(a, [](double v) { return std::tanh(v); }, TANH_ULPS);
+    return Interval(std::max(r.lo, -1.0), std::min(r.hi, 1.0));
+}
+inline Interval sqrt(Interval a) {
+    if (a.lo < 0.0) {
+        interval_flags |= INTERVAL_DOMAIN;
+        a.lo = 0.0;
+        if (a.hi < 0.0)
+            return entire();
+    }
+    Interval r = increasing(a, [](double v) { return std::sqrt(v); }, 0);
+    r.lo = std::max(r.lo, 0.0);
+    return r;
+}
+inline Interval log(Interval a) {
+    if (!(a.lo > 0.0)) {
+        interval_flags |= INTERVAL_DOMAIN;
+        return entire();
+    }
+    return increasing(a, [](double v) { return std::log(v); }, LOG_ULPS);
+}
+
+// a^b; b is a constant in every kernel, the general case goes through exp/log.
+inline Interval pow(Interval a, Interval b) {
+    if (b.lo == b.hi && b.lo == std::nearbyint(b.lo) && std::fabs(b.lo) <= 64) {
+        int n = int(b.lo);
+        if (n < 0)
+            return Interval(1.0) / pow(a, Interval(double(-n)));
+        Interval r(1.0);
+        for (int i = 0; i < n; i++)
+            r = r * a;
+        if (n % 2 == 0 && a.contains(0.0))
+            r.lo = 0.0;  // a * a is a square
+        return r;
+    }
+    return exp(b * log(a));
+}
+inline Interval sqr(Interval a) { return pow(a, Interval(2.0)); }
+
+/*
+ * Running error model: the exact real value of a kernel's intermediate over
+ * the box (v) and the absolute error of its floating-point value (e), both
+ * enclosures. Every operation computes the exact effect of its operands'
+ * errors and adds one rounding of at most err_unit * |result| (for libm
+ * calls, twice the function's *_ULPS times that, err_unit being half an
+ * ulp), plus err_tiny for a result in the subnormal range. This
+ * is the first-order model of CIRE's symbolic error expressions, kept
+ * rigorous: the higher-order terms are enclosed too. Inputs and constants
+ * are exact.
+ */
+extern thread_local double err_unit;  // 2^-p for a p-bit significand
+extern thread_local double err_tiny;  // smallest subnormal of the format, >= one underflow
+
+struct ErrInterval {
+    Interval v, e;
+
+    ErrInterval() = default;
+    ErrInterval(double x) : v(x), e(0.0) {}
+    ErrInterval(Interval value, Interval err) : v(value), e(err) {}
+};
+
+// Error bound of one rounding of a value in r, units of err_unit.
+inline Interval rounding(Interval r, double units = 1.0) {
+    double t = round_up(round_up(units * err_unit * r.mag()) + units * err_tiny);
+    return Interval(-t, t);
+}
+
+/*
+ * The operators take const&: with 32-byte by-value operands GCC 12 at
+ * -O3 -march=native miscompiles them in the SLP vectorizer, and errbound
+ * gives ex1_original on [1, 1000] a bound of 0.3 instead of 8.78e-15.
+ * build.sh also compiles their instantiations with -fno-tree-slp-vectorize.
+ */
+inline ErrInterval operator+(const ErrInterval& a, const ErrInterval& b) {
+    Interval v = a.v + b.v, e = a.e + b.e;
+    return {v, e + rounding(v + e)};
+}
+inline ErrInterval operator-(const ErrInterval& a, const ErrInterval& b) {
+    Interval v = a.v - b.v, e = a.e - b.e;
+    return {v, e + rounding(v + e)};
+}
+inline ErrInterval operator-(const ErrInterval& a) { return {-a.v, -a.e}; }
+inline ErrInterval operator*(const ErrInterval& a, const ErrInterval& b) {
+    // (x + ex)(y + ey) - xy = x ey + y ex + ex ey
+    Interval v = a.v * b.v, e = a.v * b.e + b.v * a.e + a.e * b.e;
+    return {v, e + rounding(v + e)};
+}
+inline ErrInterval operator/(const ErrInterval& a, const ErrInterval& b) {
+    // (x + ex) / (y + ey) - x / y = (ex - (x / y) ey) / (y + ey)
+    Interval v = a.v / b.v, e = (a.e - v * b.e) / (b.v + b.e);
+    return {v, e + rounding(v + e)};
+}
+inline ErrInterval fma(const ErrInterval& a, const ErrInterval& b, const ErrInterval& c) {
+    Interval v = a.v * b.v + c.v, e = a.v * b.e + b.v * a.e + a.e * b.e + c.e;
+    return {v, e + rounding(v + e)};
+}
+
+// Values between the exact operand and the computed one, for mean-value bounds.
+inline Interval perturbed(const ErrInterval& a) {
+    return a.v + Interval(std::min(a.e.lo, 0.0), std::max(a.e.hi, 0.0));
+}
+
+inline ErrInterval exp(const ErrInterval& a) {
+    // exp(x + ex) - exp(x) = exp(x) expm1(ex)
+    Interval v = exp(a.v), e = v * expm1(a.e);
+    return {v, e + rounding(v + e, 2.0 * EXP_ULPS)};
+}
+inline ErrInterval tanh(const ErrInterval& a) {
+    // tanh' = 1 - tanh^2 on the segment between x and x + ex
+    Interval v = tanh(a.v), t = tanh(perturbed(a));
+    Interval e = a.e * (Interval(1.0) - sqr(t));
+    return {v, e + rounding(v + e, 2.0 * TANH_ULPS)};
+}
+inline ErrInterval sqrt(const ErrInterval& a) {
+    // sqrt(x + ex) - sqrt(x) = ex / (sqrt(x + ex) + sqrt(x)); sqrt is correctly rounded
+    Interval v = sqrt(a.v), e = a.e / (sqrt(a.v + a.e) + v);
+    if (a.e.lo == 0.0 && a.e.hi == 0.0)
+        e = Interval(0.0);
+    return {v, e + rounding(v + e)};
+}
+inline ErrInterval pow(const ErrInterval& a, const ErrInterval& b) {
+    if (b.e.lo != 0.0 || b.e.hi != 0.0 || b.v.lo != b.v.hi) {
+        interval_flags |= INTERVAL_DOMAIN;
+        return {pow(a.v, b.v), entire()};
+    }
+    // d/dx x^y = y x^(y - 1) on the segment between x and x + ex
+    Interval v = pow(a.v, b.v);
+    Interval e = a.e * b.v * pow(perturbed(a), b.v - Interval(1.0));
+    return {v, e + rounding(v + e, 2.0 * POW_ULPS)};
+}
+
+/*
+ * Branches are decided on perturbed(), which holds both the exact and the
+ * computed value: a branch the floating-point run may take differently
+ * from the exact one, which the error model cannot follow, is flagged
+ * like one that goes both ways over the box.
+ */
+inline bool interval_less(Interval a, Interval b, bool or_equal) {
+    if (or_equal ? a.hi <= b.lo : a.hi < b.lo)
+        return true;
+    if (or_equal ? a.lo > b.hi : a.lo >= b.hi)
+        return false;
+    interval_flags |= INTERVAL_BRANCH;
+    return or_equal ? a.mid() <= b.mid() : a.mid() < b.mid();
+}
+inline bool operator<(const ErrInterval& a, const ErrInterval& b) {
+    return interval_less(perturbed(a), perturbed(b), false);
+}
+inline bool operator>(const ErrInterval& a, const ErrInterval& b) {
+    return interval_less(perturbed(b), perturbed(a), false);
+}
+inline bool operator<=(const ErrInterval& a, const ErrInterval& b) {
+    return interval_less(perturbed(a), perturbed(b), true);
+}
+
+}  // namespace reu
@@ -0,0 +1,263 @@
+#include "json.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace reu {
+
+const Json* Json::get(const std::string& key) const {
+    if (type != OBJECT)
+        return nullptr;
+    for (const auto& f : fields) {
+        if (f.first == key)
+            return &f.second;
+    }
+    return nullptr;
+}
+
+namespace {
+
+struct Parser {
+    const char* p;
+    const char* begin;
+    const char* end;
+    std::string err;
+
+    bool fail(const char* what) {
+        err = std::string(what) + " at offset " + std::to_string(p - begin);
+        return false;
+    }
+
+    void skip_ws() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    bool literal(const char* word) {
+        size_t n = strlen(word);
+        if (size_t(end - p) < n || strncmp(p, word, n) != 0)
+            return false;
+        p += n;
+        return true;
+    }
+
+    static void put_utf8(std::string& s, unsigned cp) {
+        if (cp < 0x80) {
+            s += char(cp);
+        } else if (cp < 0x800) {
+            s += char(0xC0 | (cp >> 6));
+            s += char(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            s += char(0xE0 | (cp >> 12));
+            s += char(0x80 | ((cp >> 6) & 0x3F));
+            s += char(0x80 | (cp & 0x3F));
+        } else {
+            s += char(0xF0 | (cp >> 18));
+            s += char(0x80 | ((cp >> 12) & 0x3F));
+            s += char(0x80 | ((cp >> 6) & 0x3F));
+            s += char(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned& cp) {
+        if (end - p < 4)
+            return fail("Truncated \\u escape");
+        cp = 0;
+        for (int i = 0; i < 4; i++, p++) {
+            char c = *p;
+            cp <<= 4;
+            if (c >= '0' && c <= '9') cp |= unsigned(c - '0');
+            else if (c >= 'a' && c <= 'f') cp |= unsigned(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') cp |= unsigned(c - 'A' + 10);
+            else return fail("Bad \\u escape");
+        }
+        return true;
+    }
+
+    bool string(std::string& s) {
+        p++;  // opening quote
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                s += *p++;
+                continue;
+            }
+            if (++p >= end)
+                break;
+            char c = *p++;
+            switch (c) {
+            case '"': s += '"'; break;
+            case '\\': s += '\\'; break;
+            case '/': s += '/'; break;
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'n': s += '\n'; break;
+            case 'r': s += '\r'; break;
+            case 't': s += '\t'; break;
+            case 'u': {
+                unsigned cp = 0;
+                if (!hex4(cp))
+                    return false;
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    p += 2;
+                    unsigned lo = 0;
+                    if (!hex4(lo))
+                        return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                put_utf8(s, cp);
+                break;
+            }
+            default: return fail("Bad escape");
+            }
+        }
+        if (p >= end)
+            return fail("Unterminated string");
+        p++;
+        return true;
+    }
+
+    bool value(Json& v, int depth) {
+        if (depth > 256)
+            return fail("Nesting too deep");
+        skip_ws();
+        if (p >= end)
+            return fail("Unexpected end of input");
+        char c = *p;
+        if (c == '{') {
+            v.type = Json::OBJECT;
+            p++;
+            skip_ws();
+            if (p < end && *p == '}') {
+                p++;
+                return true;
+            }
+            for (;;) {
+                skip_ws();
+                if (p >= end || *p != '"')
+                    return fail("Expected key");
+                v.fields.emplace_back();
+                if (!string(v.fields.back().first))
+                    return false;
+                skip_ws();
+                if (p >= end || *p != ':')
+                    return fail("Expected ':'");
+                p++;
+                if (!value(v.fields.back().second, depth + 1))
+                    return false;
+                skip_ws();
+                if (p < end && *p == ',') {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == '}') {
+                    p++;
+                    return true;
+                }
+                return fail("Expected ',' or '}'");
+            }
+        }
+        if (c == '[') {
+            v.type = Json::ARRAY;
+            p++;
+            skip_ws();
+            if (p < end && *p == ']') {
+                p++;
+                return true;
+            }
+            for (;;) {
+                v.items.emplace_back();
+                if (!value(v.items.back(), depth + 1))
+                    return false;
+                skip_ws();
+                if (p < end && *p == ',') {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == ']') {
+                    p++;
+                    return true;
+                }
+                return fail("Expected ',' or ']'");
+            }
+        }
+        if (c == '"') {
+            v.type = Json::STRING;
+            return string(v.str);
+        }
+        if (literal("true")) {
+            v.type = Json::BOOL;
+            v.b = true;
+            return true;
+        }
+        if (literal("false")) {
+            v.type = Json::BOOL;
+            return true;
+        }
+        if (literal("null"))
+            return true;
+        v.type = Json::NUMBER;
+        if (literal("NaN")) {
+            v.num = NAN;
+            return true;
+        }
+        if (literal("Infinity")) {
+            v.num = INFINITY;
+            return true;
+        }
+        if (literal("-Infinity")) {
+            v.num = -INFINITY;
+            return true;
+        }
+        // strtod needs a terminator; numbers are short, so copy the token.
+        const char* q = p;
+        while (q < end && ((*q && strchr("+-.eE", *q)) || (*q >= '0' && *q <= '9')))
+            q++;
+        if (q == p)
+            return fail("Unexpected character");
+        std::string tok(p, q);
+        char* stop = nullptr;
+        v.num = std::strtod(tok.c_str(), &stop);
+        if (*stop != '\0')
+            return fail("Bad number");
+        p = q;
+        return true;
+    }
+};
+
+}  // namespace
+
+bool parse_json(const std::string& text, Json& out, std::string& err) {
+    Parser ps{text.data(), text.data(), text.data() + text.size(), {}};
+    out = Json();
+    if (!ps.value(out, 0)) {
+        err = ps.err;
+        return false;
+    }
+    ps.skip_ws();
+    if (ps.p != ps.end) {
+        ps.fail("Trailing characters");
+        err = ps.err;
+        return false;
+    }
+    return true;
+}
+
+bool load_json(const std::string& path, Json& out, std::string& err) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    if (!parse_json(ss.str(), out, err)) {
+        err = path + ": " + err;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace reu
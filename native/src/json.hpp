@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Minimal JSON document model, enough for the results.json files CIRE
+ * writes. Objects keep their key order. NaN, Infinity and -Infinity are
+ * accepted as numbers since some writers emit them.
+ */
+struct Json {
+    enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = NUL;
+    bool b = false;
+    double num = 0.0;
+    std::string str;
+    std::vector<Json> items;                           // ARRAY
+    std::vector<std::pair<std::string, Json>> fields;  // OBJECT
+
+    bool is_number() const { return type == NUMBER; }
+    bool is_array() const { return type == ARRAY; }
+    bool is_object() const { return type == OBJECT; }
+
+    // Member lookup; nullptr if this is not an object or has no such key.
+    const Json* get(const std::string& key) const;
+};
+
+// Parse a whole document. Returns false and sets err (with byte offset).
+bool parse_json(const std::string& text, Json& out, std::string& err);
+bool load_json(const std::string& path, Json& out, std::string& err);
+
+}  // namespace reu
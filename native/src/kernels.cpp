@@ -0,0 +1,75 @@
+#include "kernels.hpp"
+
+#include <sstream>
+
+namespace reu {
+
+static const struct {
+    const char* name;
+    unsigned bit;
+} POINT_NAMES[] = {
+    {"in", PT_IN}, {"exp", PT_EXP}, {"acc", PT_ACC}, {"out", PT_OUT},
+};
+
+unsigned parse_points(const std::string& list) {
+    if (list == "all")
+        return ~0u;
+    unsigned mask = 0;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        bool found = false;
+        for (const auto& p : POINT_NAMES) {
+            if (item == p.name) {
+                mask |= p.bit;
+                found = true;
+            }
+        }
+        if (!found)
+            return 0;
+    }
+    return mask;
+}
+
+std::string points_name(unsigned mask) {
+    std::string out;
+    for (const auto& p : POINT_NAMES) {
+        if (mask & p.bit)
+            out += (out.empty() ? "" : "+") + std::string(p.name);
+    }
+    return out.empty() ? "none" : out;
+}
+
+const std::vector<KernelDef>& kernel_registry() {
+    static const std::vector<KernelDef> registry = {
+        make_kernel<Ex1Original>("ex1_original", "example_1/ex1_original.c"),
+        make_kernel<Ex1Alt1>("ex1_alt1", "example_1/ex1_alt1.c"),
+        make_kernel<Ex1Alt2>("ex1_alt2", "example_1/ex1_alt2.c"),
+        make_kernel<Ex1Alt2Branch>("ex1_alt2_branch", "example_1/ex1_alt2.c, commented out"),
+        make_kernel<Ex1Alt3>("ex1_alt3", "example_1/ex1_alt3.c"),
+        make_kernel<Ex1Alt4>("ex1_alt4", "example_1/ex1_alt4.c"),
+        make_kernel<Harmonic>("harmonic0", "harmonic/harmonic0.c"),
+        make_kernel<SoftmaxNaive>("softmax_og0", "softmax/softmax_og0.c"),
+        make_kernel<SoftmaxStable>("softmax_stable", "softmax/softmax_og0_lp_stable.c"),
+        make_kernel<Softmax3>("softmax3", "softmax/softmax_og{0,1,2}.c"),
+        make_kernel<Softmax3Stable>("softmax3_stable", "softmax/softmax_og0_lp_stable.c"),
+        make_kernel<GeluTanh>("gelu_tanh0", "gelu/gelu_tanh0.c"),
+        make_kernel<GeluExp>("gelu_exp0", "gelu/gelu_exp0.c"),
+        make_kernel<ParallelSum<1>>("parallel_1", "parallel_sum/parallel_1.c"),
+        make_kernel<ParallelSum<2>>("parallel_2", "parallel_sum/parallel_2.c"),
+        make_kernel<ParallelSum<3>>("parallel_3", "parallel_sum/parallel_3.c"),
+        make_kernel<ParallelSum<4>>("parallel_4", "parallel_sum/parallel_4.c"),
+        make_kernel<ParallelSum<5>>("parallel_5", "parallel_sum/parallel_5.c"),
+    };
+    return registry;
+}
+
+const KernelDef* find_kernel(const std::string& name) {
+    for (const auto& k : kernel_registry()) {
+        if (name == k.name)
+            return &k;
+    }
+    return nullptr;
+}
+
+}  // namespace reu
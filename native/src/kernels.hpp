@@ -0,0 +1,386 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "cancel.hpp"
+#include "interval.hpp"
+#include "lowp.hpp"
+#include "mca.hpp"
+#include "symexpr.hpp"
+#include "vprec.hpp"
+
+namespace reu {
+
+/*
+ * Templated ports of the example kernels. Each kernel is written once over a
+ * number type R and instantiated for plain double/float as well as for the
+ * emulated arithmetics. Math functions are called unqualified so that
+ * emulated number types can supply their own exp/tanh/sqrt via ADL.
+ *
+ * A kernel also hands selected intermediates to a quantizer q at named
+ * points; this is where values would be stored to memory in a low-precision
+ * format on real hardware.
+ *
+ * Most kernels return one value from eval(x, q). Kernels with several
+ * outputs declare n_out and write them through eval(x, y, q) instead.
+ */
+enum : unsigned {
+    PT_IN = 1u << 0,   // inputs as loaded
+    PT_EXP = 1u << 1,  // exp / tanh / sqrt results
+    PT_ACC = 1u << 2,  // sums and accumulators
+    PT_OUT = 1u << 3,  // final result as stored
+};
+
+unsigned parse_points(const std::string& list);  // "exp,acc" / "all"
+std::string points_name(unsigned mask);
+
+struct NoQuant {
+    template <class T>
+    T operator()(unsigned, T v) const { return v; }
+};
+
+// Rounds values at the selected points to a storage format, stochastically
+// (one counter-based draw per rounding) or to nearest.
+struct LowpQuant {
+    const LowpSpec* fmt;
+    unsigned mask;
+    bool stochastic;
+    CounterRng rng;
+
+    float operator()(unsigned pt, float v) {
+        if (!(mask & pt))
+            return v;
+        return stochastic ? sr_round(v, *fmt, rng.next_u32()) : rn_round(v, *fmt);
+    }
+};
+
+// example_1/ex1_original.c: sqrt(x + 1) - sqrt(x), cancels for large x.
+struct Ex1Original {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::sqrt;
+        R x0 = q(PT_IN, x[0]);
+        R a = q(PT_EXP, R(sqrt(R(x0 + R(1.0)))));
+        R b = q(PT_EXP, R(sqrt(x0)));
+        return q(PT_OUT, R(a - b));
+    }
+};
+
+// ex1_alt1.c: 1 / (sqrt(x) + sqrt(1 + x))
+struct Ex1Alt1 {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::sqrt;
+        R x0 = q(PT_IN, x[0]);
+        R a = q(PT_EXP, R(sqrt(x0)));
+        R b = q(PT_EXP, R(sqrt(R(R(1.0) + x0))));
+        return q(PT_OUT, R(R(1.0) / R(a + b)));
+    }
+};
+
+// ex1_alt2.c: pow(sqrt(x) + 1, -1)
+struct Ex1Alt2 {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::pow;
+        using std::sqrt;
+        R x0 = q(PT_IN, x[0]);
+        R s = q(PT_EXP, R(sqrt(x0)));
+        return q(PT_OUT, R(pow(R(s + R(1.0)), R(-1.0))));
+    }
+};
+
+// The code commented out in ex1_alt2.c: original form, switching to
+// sqrt(1/x) / 2 once it cancels. No example binary builds it.
+struct Ex1Alt2Branch {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::pow;
+        using std::sqrt;
+        R x0 = q(PT_IN, x[0]);
+        R t0 = R(q(PT_EXP, R(sqrt(R(x0 + R(1.0))))) - q(PT_EXP, R(sqrt(x0))));
+        if (t0 <= R(4e-5))
+            t0 = R(q(PT_EXP, R(sqrt(R(pow(x0, R(-1.0)))))) * R(0.5));
+        return q(PT_OUT, t0);
+    }
+};
+
+// ex1_alt3.c: fma(0.5, x, 1 - sqrt(x))
+struct Ex1Alt3 {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::fma;
+        using std::sqrt;
+        R x0 = q(PT_IN, x[0]);
+        R s = q(PT_EXP, R(sqrt(x0)));
+        return q(PT_OUT, R(fma(R(0.5), x0, R(R(1.0) - s))));
+    }
+};
+
+// ex1_alt4.c: 1 - sqrt(x)
+struct Ex1Alt4 {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::sqrt;
+        R x0 = q(PT_IN, x[0]);
+        return q(PT_OUT, R(R(1.0) - q(PT_EXP, R(sqrt(x0)))));
+    }
+};
+
+// harmonic/harmonic0.c: (2 x0 x1) / (x0 + x1), cancels near x0 = -x1.
+struct Harmonic {
+    static constexpr int n_in = 2;
+    static constexpr unsigned points = PT_IN | PT_ACC | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        R x0 = q(PT_IN, x[0]), x1 = q(PT_IN, x[1]);
+        R num = R(R(2.0) * x0 * x1);
+        R den = q(PT_ACC, R(x0 + x1));
+        return q(PT_OUT, R(num / den));
+    }
+};
+
+// softmax_og0.c: naive first component of a 3-way softmax.
+struct SoftmaxNaive {
+    static constexpr int n_in = 3;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_ACC | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::exp;
+        R e0 = q(PT_EXP, R(exp(q(PT_IN, x[0]))));
+        R e1 = q(PT_EXP, R(exp(q(PT_IN, x[1]))));
+        R e2 = q(PT_EXP, R(exp(q(PT_IN, x[2]))));
+        R sum = q(PT_ACC, R(e0 + e1));
+        sum = q(PT_ACC, R(sum + e2));
+        return q(PT_OUT, R(e0 / sum));
+    }
+};
+
+// softmax_og0_lp_stable.c: max-shifted first component.
+struct SoftmaxStable {
+    static constexpr int n_in = 3;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_ACC | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::exp;
+        R a = q(PT_IN, x[0]), b = q(PT_IN, x[1]), c = q(PT_IN, x[2]);
+        R m = a > b ? a : b;
+        m = m > c ? m : c;
+        R e0 = q(PT_EXP, R(exp(R(a - m))));
+        R e1 = q(PT_EXP, R(exp(R(b - m))));
+        R e2 = q(PT_EXP, R(exp(R(c - m))));
+        R sum = q(PT_ACC, R(e0 + e1));
+        sum = q(PT_ACC, R(sum + e2));
+        return q(PT_OUT, R(e0 / sum));
+    }
+};
+
+// softmax_og0.c, softmax_og1.c and softmax_og2.c in one pass: all three
+// components share the exponentials and the sum.
+struct Softmax3 {
+    static constexpr int n_in = 3;
+    static constexpr int n_out = 3;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_ACC | PT_OUT;
+    template <class R, class Q>
+    static void eval(const R* x, R* y, Q& q) {
+        using std::exp;
+        R e[3];
+        for (int i = 0; i < 3; i++)
+            e[i] = q(PT_EXP, R(exp(q(PT_IN, x[i]))));
+        R sum = q(PT_ACC, R(e[0] + e[1]));
+        sum = q(PT_ACC, R(sum + e[2]));
+        for (int i = 0; i < 3; i++)
+            y[i] = q(PT_OUT, R(e[i] / sum));
+    }
+};
+
+// Max-shifted softmax_og0_lp_stable.c, all three components.
+struct Softmax3Stable {
+    static constexpr int n_in = 3;
+    static constexpr int n_out = 3;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_ACC | PT_OUT;
+    template <class R, class Q>
+    static void eval(const R* x, R* y, Q& q) {
+        using std::exp;
+        R v[3];
+        for (int i = 0; i < 3; i++)
+            v[i] = q(PT_IN, x[i]);
+        R m = v[0] > v[1] ? v[0] : v[1];
+        m = m > v[2] ? m : v[2];
+        R e[3];
+        for (int i = 0; i < 3; i++)
+            e[i] = q(PT_EXP, R(exp(R(v[i] - m))));
+        R sum = q(PT_ACC, R(e[0] + e[1]));
+        sum = q(PT_ACC, R(sum + e[2]));
+        for (int i = 0; i < 3; i++)
+            y[i] = q(PT_OUT, R(e[i] / sum));
+    }
+};
+
+// gelu_tanh0.c
+struct GeluTanh {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::tanh;
+        const R c = R(0.7978845608028654);
+        R x0 = q(PT_IN, x[0]);
+        R t = q(PT_EXP, R(tanh(R(c * R(x0 + R(0.044715) * R(x0 * x0 * x0))))));
+        return q(PT_OUT, R(R(0.5) * x0 * R(R(1.0) + t)));
+    }
+};
+
+// gelu_exp0.c: sigmoid form of the tanh approximation.
+struct GeluExp {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_EXP | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        using std::exp;
+        const R c = R(0.7978845608028654);
+        R x0 = q(PT_IN, x[0]);
+        R e = q(PT_EXP, R(exp(R(R(-2.0) * c * R(x0 + R(0.044715) * x0 * x0 * x0)))));
+        return q(PT_OUT, R(x0 / R(R(1.0) + e)));
+    }
+};
+
+// parallel_<L>.c: pairwise tree sum of 2^L copies of x.
+template <int L>
+struct ParallelSum {
+    static constexpr int n_in = 1;
+    static constexpr unsigned points = PT_IN | PT_ACC | PT_OUT;
+    template <class R, class Q>
+    static R eval(const R* x, Q& q) {
+        R v[1 << L];
+        for (int i = 0; i < (1 << L); i++)
+            v[i] = q(PT_IN, x[0]);
+        for (int stride = 1; stride < (1 << L); stride *= 2)
+            for (int i = 0; i < (1 << L); i += 2 * stride)
+                v[i] = q(PT_ACC, R(v[i] + v[i + stride]));
+        return q(PT_OUT, v[0]);
+    }
+};
+
+// Largest input / output count of any registered kernel, for stack buffers.
+constexpr int MAX_IN = 8;
+constexpr int MAX_OUT = 8;
+
+// Uniform vector-output view of a kernel: n outputs written to y.
+template <class K, class = void>
+struct KernelOutputs {
+    static constexpr int n = 1;
+    template <class R, class Q>
+    static void eval(const R* x, R* y, Q& q) { y[0] = K::template eval<R>(x, q); }
+};
+
+template <class K>
+struct KernelOutputs<K, std::void_t<decltype(K::n_out)>> {
+    static constexpr int n = K::n_out;
+    template <class R, class Q>
+    static void eval(const R* x, R* y, Q& q) { K::template eval<R>(x, y, q); }
+};
+
+/*
+ * Type-erased registry entry. One evaluator per supported arithmetic, each
+ * writing the kernel's n_out outputs to y; a new emulated arithmetic adds a
+ * member here and a line in make_kernel.
+ */
+struct KernelDef {
+    const char* name;
+    const char* source;  // example this kernel mirrors
+    int n_in;
+    int n_out;
+    unsigned points;
+    void (*eval_f64)(const double* x, double* y);
+    void (*eval_f32)(const float* x, float* y);
+    void (*eval_lowp)(const float* x, float* y, LowpQuant& q);
+    void (*eval_ref)(const long double* x, long double* y);  // oracle
+    void (*eval_vprec)(const double* x, double* y);           // format in vprec_config
+    void (*eval_vprec_at)(const double* x, double* y, const VprecQuant& q);
+    void (*eval_mca)(const double* x, double* y);  // config and stream in mca_config/mca_rng
+    void (*eval_cancel)(const double* x, double* y);  // bits per add/sub in cancel_trace
+    // Enclosures of the exact outputs and of their rounding errors over the
+    // box x (interval.hpp; unit roundoff in err_unit, flags in interval_flags).
+    void (*eval_error)(const Interval* x, Interval* value, Interval* err);
+    // Records the path taken at x onto sym_graph (symexpr.hpp).
+    void (*eval_sym)(const Sym* x, Sym* y);
+};
+
+template <class K>
+KernelDef make_kernel(const char* name, const char* source) {
+    using Out = KernelOutputs<K>;
+    static_assert(K::n_in <= MAX_IN && Out::n <= MAX_OUT, "raise MAX_IN / MAX_OUT");
+    return {
+        name, source, K::n_in, Out::n, K::points,
+        [](const double* x, double* y) { NoQuant q; Out::template eval<double>(x, y, q); },
+        [](const float* x, float* y) { NoQuant q; Out::template eval<float>(x, y, q); },
+        [](const float* x, float* y, LowpQuant& q) { Out::template eval<float>(x, y, q); },
+        [](const long double* x, long double* y) {
+            NoQuant q;
+            Out::template eval<long double>(x, y, q);
+        },
+        [](const double* x, double* y) {
+            Vprec v[K::n_in], r[Out::n];
+            for (int i = 0; i < K::n_in; i++)
+                v[i] = Vprec(x[i]);
+            NoQuant q;
+            Out::template eval<Vprec>(v, r, q);
+            for (int i = 0; i < Out::n; i++)
+                y[i] = r[i].v;
+        },
+        [](const double* x, double* y, const VprecQuant& q) {
+            Out::template eval<double>(x, y, q);
+        },
+        [](const double* x, double* y) {
+            Mca v[K::n_in], r[Out::n];
+            for (int i = 0; i < K::n_in; i++)
+                v[i] = Mca(x[i]);
+            NoQuant q;
+            Out::template eval<Mca>(v, r, q);
+            for (int i = 0; i < Out::n; i++)
+                y[i] = r[i].v;
+        },
+        [](const double* x, double* y) {
+            Cancel v[K::n_in], r[Out::n];
+            for (int i = 0; i < K::n_in; i++)
+                v[i] = Cancel(x[i]);
+            NoQuant q;
+            cancel_begin();
+            Out::template eval<Cancel>(v, r, q);
+            for (int i = 0; i < Out::n; i++)
+                y[i] = r[i].v;
+        },
+        [](const Interval* x, Interval* value, Interval* err) {
+            ErrInterval v[K::n_in], r[Out::n];
+            for (int i = 0; i < K::n_in; i++)
+                v[i] = ErrInterval(x[i], Interval(0.0));
+            NoQuant q;
+            Out::template eval<ErrInterval>(v, r, q);
+            for (int i = 0; i < Out::n; i++) {
+                value[i] = r[i].v;
+                err[i] = r[i].e;
+            }
+        },
+        [](const Sym* x, Sym* y) { NoQuant q; Out::template eval<Sym>(x, y, q); },
+    };
+}
+
+const std::vector<KernelDef>& kernel_registry();
+const KernelDef* find_kernel(const std::string& name);
+
+}  // namespace reu
@@ -0,0 +1,214 @@
+#include "lowp.hpp"
+
+namespace reu {
+
+static const LowpSpec SPECS[] = {
+    {"bf16", 16, 7, -126, 127, 0x1.fep127f, true},
+    {"fp16", 16, 10, -14, 15, 65504.0f, true},
+    {"e4m3", 8, 3, -6, 8, 448.0f, false},
+    {"e5m2", 8, 2, -14, 15, 57344.0f, true},
+};
+
+const LowpSpec& lowp_spec(Lowp f) {
+    return SPECS[int(f)];
+}
+
+bool parse_lowp(const std::string& name, Lowp& f) {
+    for (int i = 0; i < 4; i++) {
+        if (name == SPECS[i].name) {
+            f = Lowp(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t lowp_encode(float q, const LowpSpec& s) {
+    uint32_t u = f32_bits(q);
+    if (s.bits == 16 && s.mant == 7)
+        return u >> 16;
+
+    uint32_t sign = (u >> 31) << (s.bits - 1);
+    uint32_t emask = (1u << (s.bits - 1 - s.mant)) - 1;
+    uint32_t mmask = (1u << s.mant) - 1;
+    if (std::isnan(q))
+        return sign | ((1u << (s.bits - 1)) - 1);
+    if (std::isinf(q))
+        return sign | (s.has_inf ? emask << s.mant : lowp_encode(s.max, s));
+    if (q == 0.0f)
+        return sign;
+
+    int e = std::ilogb(q);
+    if (e < s.emin)
+        return sign | uint32_t(std::ldexp(std::fabs(q), s.mant - s.emin));
+    uint32_t field = uint32_t(e + 1 - s.emin) << s.mant;
+    return sign | field | ((u >> (23 - s.mant)) & mmask);
+}
+
+float lowp_decode(uint32_t b, const LowpSpec& s) {
+    uint32_t emask = (1u << (s.bits - 1 - s.mant)) - 1;
+    uint32_t mmask = (1u << s.mant) - 1;
+    uint32_t ef = (b >> s.mant) & emask;
+    uint32_t mf = b & mmask;
+    float v;
+    if (s.has_inf && ef == emask)
+        v = mf ? NAN : INFINITY;
+    else if (!s.has_inf && ef == emask && mf == mmask)
+        v = NAN;
+    else if (ef == 0)
+        v = std::ldexp(float(mf), s.emin - s.mant);
+    else
+        v = std::ldexp(float(mf | (mmask + 1)), int(ef) - 1 + s.emin - s.mant);
+    return (b >> (s.bits - 1)) & 1 ? -v : v;
+}
+
+/*
+ * Vector path: stochastic rounding as an integer add on the magnitude bits.
+ * Adding the top `drop` bits of r to the magnitude and truncating rounds
+ * away from zero with exactly the probability given by the dropped bits; a
+ * carry out of the mantissa correctly moves to the next binade. Every step is
+ * a lane-wise integer op (including the per-lane variable shift), so the loop
+ * vectorizes.
+ *
+ * This is only valid while the dropped bits lie inside the fp32 significand,
+ * i.e. for |x| at or above the smallest subnormal of the target. Lanes below
+ * that are redone with the scalar sr_round afterwards.
+ */
+template <int M, int EMIN>
+static inline uint32_t sr_bits(uint32_t u, uint32_t r, uint32_t maxbits,
+                               uint32_t ovf) {
+    uint32_t sign = u & 0x80000000u;
+    uint32_t mag = u ^ sign;
+    int e = int(mag >> 23) - 127;
+    int below = EMIN - (e < -126 ? -126 : e);
+    int drop = 23 - M + (below > 0 ? below : 0);
+    drop = drop > 31 ? 31 : drop;
+    uint32_t mask = (1u << drop) - 1u;
+    uint32_t q = (mag + (r >> (32 - drop))) & ~mask;
+    q = q > maxbits ? ovf : q;
+    q = mag >= 0x7f800000u ? mag : q;
+    return sign | q;
+}
+
+template <int M, int EMIN>
+static void sr_quantize_t(const LowpSpec& s, const float* in, float* out,
+                          size_t n, uint64_t seed, uint64_t offset) {
+    const uint32_t maxbits = f32_bits(s.max);
+    const uint32_t ovf = s.has_inf ? 0x7f800000u : maxbits;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = threefry2x32(seed, offset + i).a;
+        out[i] = f32_from_bits(sr_bits<M, EMIN>(f32_bits(in[i]), r, maxbits, ovf));
+    }
+
+    const uint32_t tiny = f32_bits(std::ldexp(1.0f, EMIN - M));
+    for (size_t i = 0; i < n; i++) {
+        uint32_t mag = f32_bits(in[i]) & 0x7fffffffu;
+        if (mag != 0 && mag < tiny)
+            out[i] = sr_round(in[i], s, threefry2x32(seed, offset + i).a);
+    }
+}
+
+void sr_quantize(Lowp f, const float* in, float* out, size_t n,
+                 uint64_t seed, uint64_t offset) {
+    const LowpSpec& s = lowp_spec(f);
+    switch (f) {
+    case Lowp::BF16: sr_quantize_t<7, -126>(s, in, out, n, seed, offset); break;
+    case Lowp::FP16: sr_quantize_t<10, -14>(s, in, out, n, seed, offset); break;
+    case Lowp::E4M3: sr_quantize_t<3, -6>(s, in, out, n, seed, offset); break;
+    case Lowp::E5M2: sr_quantize_t<2, -14>(s, in, out, n, seed, offset); break;
+    }
+}
+
+void rn_quantize(Lowp f, const float* in, float* out, size_t n) {
+    const LowpSpec& s = lowp_spec(f);
+    for (size_t i = 0; i < n; i++)
+        out[i] = rn_round(in[i], s);
+}
+
+/*
+ * Lane-wise packing of a value already on the grid of an IEEE-like format
+ * with M mantissa bits, normal range from 2^EMIN and an fp32-normal input:
+ * the same selects-only style as sr_bits. Subnormals of the target are the
+ * full significand shifted right by their distance below 2^EMIN.
+ */
+template <int BITS, int M, int EMIN>
+static inline uint32_t pack_bits(uint32_t u, uint32_t inf_code, uint32_t nan_code) {
+    uint32_t sign = (u >> 31) << (BITS - 1);
+    uint32_t mag = u & 0x7fffffffu;
+    int e = int(mag >> 23) - 127;
+    uint32_t normal = (uint32_t(e + 1 - EMIN) << M) | ((mag >> (23 - M)) & ((1u << M) - 1));
+    int sh = 23 - M + EMIN - e;
+    sh = sh > 31 ? 31 : sh < 0 ? 0 : sh;
+    uint32_t sub = ((mag & 0x7fffffu) | 0x800000u) >> sh;
+    uint32_t code = e >= EMIN ? normal : sub;
+    code = mag == 0 ? 0 : code;
+    code = mag == 0x7f800000u ? inf_code : code;
+    code = mag > 0x7f800000u ? nan_code : code;
+    return sign | code;
+}
+
+// Conversions quantize a block into a stack buffer, then pack the bits.
+static constexpr size_t BLOCK = 1024;
+
+template <class T, int BITS, int M, int EMIN>
+static void sr_convert(Lowp f, const float* in, T* out, size_t n,
+                       uint64_t seed, uint64_t offset) {
+    const LowpSpec& s = lowp_spec(f);
+    const uint32_t nan_code = (1u << (BITS - 1)) - 1;
+    const uint32_t inf_code = s.has_inf ? ((1u << (BITS - 1 - M)) - 1) << M
+                                        : lowp_encode(s.max, s);
+    float q[BLOCK];
+    for (size_t base = 0; base < n; base += BLOCK) {
+        size_t m = n - base < BLOCK ? n - base : BLOCK;
+        sr_quantize(f, in + base, q, m, seed, offset + base);
+        for (size_t i = 0; i < m; i++)
+            out[base + i] = T(pack_bits<BITS, M, EMIN>(f32_bits(q[i]), inf_code, nan_code));
+    }
+}
+
+void sr_convert_bf16(const float* in, uint16_t* out, size_t n,
+                     uint64_t seed, uint64_t offset) {
+    float q[BLOCK];
+    for (size_t base = 0; base < n; base += BLOCK) {
+        size_t m = n - base < BLOCK ? n - base : BLOCK;
+        sr_quantize(Lowp::BF16, in + base, q, m, seed, offset + base);
+        for (size_t i = 0; i < m; i++)
+            out[base + i] = uint16_t(f32_bits(q[i]) >> 16);
+    }
+}
+
+void sr_convert_fp16(const float* in, uint16_t* out, size_t n,
+                     uint64_t seed, uint64_t offset) {
+    sr_convert<uint16_t, 16, 10, -14>(Lowp::FP16, in, out, n, seed, offset);
+}
+
+void sr_convert_fp8(Lowp f, const float* in, uint8_t* out, size_t n,
+                    uint64_t seed, uint64_t offset) {
+    if (f == Lowp::E4M3)
+        sr_convert<uint8_t, 8, 3, -6>(f, in, out, n, seed, offset);
+    else
+        sr_convert<uint8_t, 8, 2, -14>(f, in, out, n, seed, offset);
+}
+
+void lowp_decode_array(Lowp f, const void* in, float* out, size_t n) {
+    const LowpSpec& s = lowp_spec(f);
+    if (s.bits == 8) {
+        float table[256];
+        for (uint32_t b = 0; b < 256; b++)
+            table[b] = lowp_decode(b, s);
+        const uint8_t* p = static_cast<const uint8_t*>(in);
+        for (size_t i = 0; i < n; i++)
+            out[i] = table[p[i]];
+        return;
+    }
+    const uint16_t* p = static_cast<const uint16_t*>(in);
+    if (f == Lowp::BF16) {
+        for (size_t i = 0; i < n; i++)
+            out[i] = f32_from_bits(uint32_t(p[i]) << 16);
+    } else {
+        for (size_t i = 0; i < n; i++)
+            out[i] = lowp_decode(p[i], s);
+    }
+}
+
+}  // namespace reu
@@ -0,0 +1,102 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "rng.hpp"
+
+namespace reu {
+
+// Low-precision storage formats used by the accelerators we emulate.
+enum class Lowp { BF16, FP16, E4M3, E5M2 };
+
+struct LowpSpec {
+    const char* name;
+    int bits;        // storage width
+    int mant;        // explicit mantissa bits
+    int emin;        // exponent of the smallest normal
+    int emax;        // exponent of the largest finite binade
+    float max;       // largest finite value
+    bool has_inf;    // false: overflow saturates to +-max (OCP e4m3)
+};
+
+const LowpSpec& lowp_spec(Lowp f);
+bool parse_lowp(const std::string& name, Lowp& f);
+
+inline uint32_t f32_bits(float x) {
+    uint32_t u;
+    std::memcpy(&u, &x, 4);
+    return u;
+}
+
+inline float f32_from_bits(uint32_t u) {
+    float x;
+    std::memcpy(&x, &u, 4);
+    return x;
+}
+
+// Exponent of the grid spacing of format s around x (the ulp is 2^result).
+inline int lowp_ulp_exp(float x, const LowpSpec& s) {
+    int e = std::ilogb(x);
+    return (e < s.emin ? s.emin : e) - s.mant;
+}
+
+inline float lowp_overflow(float q, const LowpSpec& s) {
+    if (std::fabs(q) <= s.max)
+        return q;
+    return std::copysign(s.has_inf ? INFINITY : s.max, q);
+}
+
+/**
+ * @brief Stochastically round x onto the grid of format s.
+ *
+ * Rounds away from zero with probability equal to the distance from the
+ * neighbour below |x|, in ulps, using the 32 random bits in r. Scaling by the
+ * ulp is exact, so the fractional part is computed without error. The draw is
+ * compared as r >= (1 - frac) * 2^32, which makes the decision identical to
+ * the integer-add form used by the bulk kernels. NaN and infinities pass.
+ */
+inline float sr_round(float x, const LowpSpec& s, uint32_t r) {
+    if (!std::isfinite(x) || x == 0.0f)
+        return x;
+    int ue = lowp_ulp_exp(x, s);
+    double t = std::ldexp(std::fabs(double(x)), -ue);
+    double lo = std::floor(t);
+    double q = (double(r) * 0x1p-32 >= 1.0 - (t - lo)) ? lo + 1.0 : lo;
+    return lowp_overflow(float(std::copysign(std::ldexp(q, ue), double(x))), s);
+}
+
+// Deterministic round-to-nearest-even onto the grid of format s.
+inline float rn_round(float x, const LowpSpec& s) {
+    if (!std::isfinite(x) || x == 0.0f)
+        return x;
+    int ue = lowp_ulp_exp(x, s);
+    double q = std::nearbyint(std::ldexp(double(x), -ue));
+    return lowp_overflow(float(std::ldexp(q, ue)), s);
+}
+
+// Bit pattern of a value already on the grid of s, and back.
+uint32_t lowp_encode(float q, const LowpSpec& s);
+float lowp_decode(uint32_t bits, const LowpSpec& s);
+
+/*
+ * Bulk conversion kernels. Element i consumes the random draw at counter
+ * (offset + i) under key seed, so a large array may be converted in chunks
+ * or by several threads and still match a single sequential call.
+ */
+void sr_quantize(Lowp f, const float* in, float* out, size_t n,
+                 uint64_t seed, uint64_t offset);
+void rn_quantize(Lowp f, const float* in, float* out, size_t n);
+
+void sr_convert_bf16(const float* in, uint16_t* out, size_t n,
+                     uint64_t seed, uint64_t offset);
+void sr_convert_fp16(const float* in, uint16_t* out, size_t n,
+                     uint64_t seed, uint64_t offset);
+void sr_convert_fp8(Lowp f, const float* in, uint8_t* out, size_t n,
+                    uint64_t seed, uint64_t offset);
+
+void lowp_decode_array(Lowp f, const void* in, float* out, size_t n);
+
+}  // namespace reu
@@ -0,0 +1,22 @@
+#include "mca.hpp"
+
+#include <cstring>
+
+namespace reu {
+
+thread_local McaConfig mca_config;
+thread_local CounterRng mca_rng;
+
+bool parse_mca_mode(const char* name, McaMode& mode) {
+    if (!strcmp(name, "mca"))
+        mode = McaMode::MCA;
+    else if (!strcmp(name, "pb"))
+        mode = McaMode::PB;
+    else if (!strcmp(name, "rr"))
+        mode = McaMode::RR;
+    else
+        return false;
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,97 @@
+#pragma once
+#include <cmath>
+
+#include "rng.hpp"
+
+namespace reu {
+
+/*
+ * In-process equivalent of verificarlo's MCA backend (libinterflop_mca).
+ * Each +,-,*,/ (and fma) is computed in long double; the operands and/or the
+ * result are then perturbed by the usual inexact() noise
+ *
+ *     x + 2^(e_x - t) * xi,   xi ~ U(-1/2, 1/2),   2^(e_x - 1) <= |x| < 2^e_x
+ *
+ * at virtual precision t. Values exactly representable on t bits are left
+ * alone, as the backend does. Like a verificarlo build, libm calls (exp, tanh,
+ * sqrt, pow) are not instrumented.
+ *
+ * Mode and precision are thread-local, as is the random stream, which the
+ * caller positions per sample so results are reproducible.
+ */
+enum class McaMode { MCA, PB, RR };
+
+struct McaConfig {
+    int precision = 53;
+    McaMode mode = McaMode::MCA;
+};
+
+extern thread_local McaConfig mca_config;
+extern thread_local CounterRng mca_rng;
+
+bool parse_mca_mode(const char* name, McaMode& mode);
+
+inline long double mca_inexact(long double x) {
+    if (x == 0.0L || !std::isfinite(x))
+        return x;
+    int e = std::ilogb(x) + 1;
+    int t = mca_config.precision;
+    long double scaled = std::ldexp(x, t - e);
+    if (scaled == std::nearbyint(scaled))
+        return x;
+    return x + std::ldexp((long double)(mca_rng.uniform() - 0.5), e - t);
+}
+
+template <class F>
+inline double mca_op(double a, double b, F op) {
+    long double la = a, lb = b;
+    if (mca_config.mode != McaMode::RR) {
+        la = mca_inexact(la);
+        lb = mca_inexact(lb);
+    }
+    long double r = op(la, lb);
+    if (mca_config.mode != McaMode::PB)
+        r = mca_inexact(r);
+    return double(r);
+}
+
+// Number type whose arithmetic goes through the MCA noise model.
+struct Mca {
+    double v = 0.0;
+
+    Mca() = default;
+    Mca(double x) : v(x) {}
+};
+
+inline Mca operator+(Mca a, Mca b) {
+    return mca_op(a.v, b.v, [](long double x, long double y) { return x + y; });
+}
+inline Mca operator-(Mca a, Mca b) {
+    return mca_op(a.v, b.v, [](long double x, long double y) { return x - y; });
+}
+inline Mca operator*(Mca a, Mca b) {
+    return mca_op(a.v, b.v, [](long double x, long double y) { return x * y; });
+}
+inline Mca operator/(Mca a, Mca b) {
+    return mca_op(a.v, b.v, [](long double x, long double y) { return x / y; });
+}
+inline Mca operator-(Mca a) { return Mca(-a.v); }
+inline bool operator<(Mca a, Mca b) { return a.v < b.v; }
+inline bool operator>(Mca a, Mca b) { return a.v > b.v; }
+inline bool operator<=(Mca a, Mca b) { return a.v <= b.v; }
+inline Mca exp(Mca a) { return Mca(std::exp(a.v)); }
+inline Mca tanh(Mca a) { return Mca(std::tanh(a.v)); }
+inline Mca sqrt(Mca a) { return Mca(std::sqrt(a.v)); }
+inline Mca pow(Mca a, Mca b) { return Mca(std::pow(a.v, b.v)); }
+inline Mca fma(Mca a, Mca b, Mca c) {
+    long double la = a.v, lb = b.v, lc = c.v;
+    if (mca_config.mode != McaMode::RR) {
+        la = mca_inexact(la);
+        lb = mca_inexact(lb);
+        lc = mca_inexact(lc);
+    }
+    long double r = std::fma(la, lb, lc);
+    return Mca(double(mca_config.mode != McaMode::PB ? mca_inexact(r) : r));
+}
+
+}  // namespace reu
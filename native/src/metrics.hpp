@@ -0,0 +1,116 @@
+#pragma once
+#include <cmath>
+
+namespace reu {
+
+// Decimal digits carried by a binary significand of p bits (incl. implicit).
+inline double digits_of_bits(double p) {
+    return p * std::log10(2.0);
+}
+
+/*
+ * Error of y against the oracle value ref in units of the last place of a
+ * format with `precision` explicit mantissa bits and smallest normal
+ * exponent emin, measured at ref. Non-finite y against a finite ref is inf.
+ */
+inline double ulp_error(double y, long double ref, int precision, int emin) {
+    if (!std::isfinite(y))
+        return std::isfinite(double(ref)) ? INFINITY : 0.0;
+    long double err = std::fabs((long double)y - ref);
+    if (err == 0.0L)
+        return 0.0;
+    int e = ref == 0.0L ? emin : std::ilogb(ref);
+    return double(std::ldexp(err, -((e < emin ? emin : e) - precision)));
+}
+
+/*
+ * Significant decimal digits of y against ref, -log10(|y - ref| / |ref|),
+ * capped at `cap` (the digits the format can hold) and floored at 0.
+ */
+inline double sig_digits(double y, long double ref, double cap) {
+    if (!std::isfinite(y))
+        return 0.0;
+    long double err = std::fabs((long double)y - ref);
+    if (err == 0.0L)
+        return cap;
+    if (ref == 0.0L)
+        return 0.0;
+    double s = -std::log10(double(err / std::fabs(ref)));
+    return s <= 0.0 ? 0.0 : s > cap ? cap : s;
+}
+
+/*
+ * Significant digits of n Monte Carlo samples, -log10(sigma / |mu|) with the
+ * population standard deviation (Stott Parker; what plot.py computes from a
+ * .tab). Samples are y[0], y[stride], ... so one output of sample-major
+ * output vectors can be read in place. Capped at `cap` and floored at 0; any
+ * non-finite sample gives 0.
+ */
+inline double mca_sig_digits(const double* y, int n, double cap, int stride = 1) {
+    double mean = 0.0;
+    for (int i = 0; i < n; i++) {
+        if (!std::isfinite(y[i * stride]))
+            return 0.0;
+        mean += y[i * stride];
+    }
+    mean /= n;
+    double var = 0.0;
+    for (int i = 0; i < n; i++)
+        var += (y[i * stride] - mean) * (y[i * stride] - mean);
+    double sd = std::sqrt(var / n);
+    if (sd == 0.0)
+        return cap;
+    if (mean == 0.0)
+        return 0.0;
+    double s = -std::log10(sd / std::fabs(mean));
+    return s <= 0.0 ? 0.0 : s > cap ? cap : s;
+}
+
+/*
+ * n samples of an m-output kernel stored sample-major (y[s * m + k]).
+ * Writes the per-output digits to per_out[0..m) and returns the norm-wise
+ * digits -log10(sqrt(E||y - mu||^2) / ||mu||), which stays meaningful when
+ * one output is near zero and its own relative spread blows up.
+ */
+inline double mca_sig_digits_vec(const double* y, int n, int m, double cap, double* per_out) {
+    double spread = 0.0, norm = 0.0;
+    bool finite = true;
+    for (int k = 0; k < m; k++) {
+        per_out[k] = mca_sig_digits(y + k, n, cap, m);
+        double mean = 0.0;
+        for (int i = 0; i < n; i++)
+            mean += y[i * m + k];
+        mean /= n;
+        finite = finite && std::isfinite(mean);
+        for (int i = 0; i < n; i++)
+            spread += (y[i * m + k] - mean) * (y[i * m + k] - mean);
+        norm += mean * mean;
+    }
+    if (!finite || !std::isfinite(spread))
+        return 0.0;
+    if (spread == 0.0)
+        return cap;
+    if (norm == 0.0)
+        return 0.0;
+    double s = -std::log10(std::sqrt(spread / n / norm));
+    return s <= 0.0 ? 0.0 : s > cap ? cap : s;
+}
+
+// Norm-wise digits of an m-vector against the oracle, -log10(||y - ref|| / ||ref||).
+inline double sig_digits_norm(const double* y, const long double* ref, int m, double cap) {
+    long double err = 0.0L, norm = 0.0L;
+    for (int k = 0; k < m; k++) {
+        if (!std::isfinite(y[k]))
+            return 0.0;
+        err += ((long double)y[k] - ref[k]) * ((long double)y[k] - ref[k]);
+        norm += ref[k] * ref[k];
+    }
+    if (err == 0.0L)
+        return cap;
+    if (norm == 0.0L)
+        return 0.0;
+    double s = -0.5 * std::log10(double(err / norm));
+    return s <= 0.0 ? 0.0 : s > cap ? cap : s;
+}
+
+}  // namespace reu
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace reu {
+
+inline unsigned default_jobs() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 4;
+}
+
+/*
+ * Split [0, n) into one contiguous block per job and run fn(begin, end, job)
+ * on each in its own thread. Blocks are ordered by job index, so per-job
+ * output buffers can be concatenated to reproduce sequential order.
+ */
+template <class F>
+void parallel_for(size_t n, unsigned jobs, F fn) {
+    if (jobs <= 1 || n <= 1) {
+        fn(size_t(0), n, 0u);
+        return;
+    }
+    if (jobs > n)
+        jobs = unsigned(n);
+    std::vector<std::thread> pool;
+    for (unsigned j = 0; j < jobs; j++) {
+        size_t b = n * j / jobs, e = n * (j + 1) / jobs;
+        pool.emplace_back([=, &fn] { fn(b, e, j); });
+    }
+    for (auto& t : pool)
+        t.join();
+}
+
+}  // namespace reu
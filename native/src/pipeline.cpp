@@ -0,0 +1,756 @@
+#include "pipeline.hpp"
+
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "subprocess.hpp"
+#include "supervisor.hpp"
+#include "telemetry.hpp"
+
+namespace reu {
+
+// --- hashing ---
+
+static inline uint64_t rotl64(uint64_t x, unsigned r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t hash_bytes(const void* data, size_t n, uint64_t seed) {
+    const uint64_t K1 = 0x9E3779B97F4A7C15ull, K2 = 0xC2B2AE3D27D4EB4Full;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = seed ^ (uint64_t(n) * K1);
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = rotl64(h ^ (w * K2), 29) * K1;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, n);
+    h = rotl64(h ^ (w * K2), 29) * K1;
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+static uint64_t hash_str(const std::string& s, uint64_t seed) {
+    return hash_bytes(s.data(), s.size(), seed);
+}
+
+// --- paths ---
+
+// Lexically normalized: no ".", "..", empty or trailing components.
+static std::string normalize(const std::string& path) {
+    std::vector<std::string> parts;
+    std::stringstream ss(path);
+    for (std::string part; std::getline(ss, part, '/');) {
+        if (part.empty() || part == ".")
+            continue;
+        if (part == ".." && !parts.empty() && parts.back() != "..")
+            parts.pop_back();
+        else
+            parts.push_back(part);
+    }
+    std::string out = !path.empty() && path[0] == '/' ? "/" : "";
+    for (size_t i = 0; i < parts.size(); i++)
+        out += (i ? "/" : "") + parts[i];
+    return out.empty() ? "." : out;
+}
+
+static std::string join(const std::string& dir, const std::string& path) {
+    return normalize(!path.empty() && path[0] == '/' ? path : dir + "/" + path);
+}
+
+static bool make_dirs(const std::string& dir) {
+    for (size_t at = 1; at <= dir.size(); at++) {
+        if (at < dir.size() && dir[at] != '/')
+            continue;
+        std::string prefix = dir.substr(0, at);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+
+static std::string parent(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// --- parsing ---
+
+struct SrcLine {
+    int no;
+    std::string text;
+};
+
+static bool expand(const std::string& in, const std::map<std::string, std::string>& vars,
+                   std::string& out, std::string& err) {
+    out.clear();
+    for (size_t i = 0; i < in.size(); i++) {
+        if (in[i] != '$' || i + 1 >= in.size() || in[i + 1] != '{') {
+            out += in[i];
+            continue;
+        }
+        size_t end = in.find('}', i);
+        if (end == std::string::npos) {
+            err = "unterminated ${";
+            return false;
+        }
+        std::string name = in.substr(i + 2, end - i - 2);
+        auto it = vars.find(name);
+        const char* env = getenv(name.c_str());
+        if (it == vars.end() && !env) {
+            err = "unknown variable '" + name + "'";
+            return false;
+        }
+        out += it != vars.end() ? it->second : env;
+        i = end;
+    }
+    return true;
+}
+
+static std::vector<std::string> words(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    for (std::string w; ss >> w;)
+        out.push_back(w);
+    return out;
+}
+
+namespace {
+
+struct Parser {
+    std::string file;
+    const std::map<std::string, std::string>* defines;
+    std::vector<Stage> stages;
+    std::vector<std::string> dirs;  // raw `dir` per stage
+
+    bool fail(int no, const std::string& what, std::string& err) {
+        err = file + ":" + std::to_string(no) + ": " + what;
+        return false;
+    }
+
+    bool process(const std::vector<SrcLine>& lines, std::map<std::string, std::string> vars,
+                 std::string& err) {
+        for (size_t i = 0; i < lines.size(); i++) {
+            const SrcLine& l = lines[i];
+            size_t kw_end = l.text.find_first_of(" \t");
+            std::string kw = l.text.substr(0, kw_end);
+            std::string rest = kw_end == std::string::npos ? "" : l.text.substr(kw_end + 1);
+            rest.erase(0, rest.find_first_not_of(" \t"));
+            if (kw == "for") {
+                // Body up to the matching end, expanded once per value.
+                std::vector<std::string> w = words(rest);
+                if (w.size() < 3 || w[1] != "in")
+                    return fail(l.no, "expected 'for NAME in VALUE...'", err);
+                size_t depth = 1, j = i + 1;
+                for (; j < lines.size(); j++) {
+                    std::string k = lines[j].text.substr(0, lines[j].text.find_first_of(" \t"));
+                    depth += k == "for" ? 1 : k == "end" ? -1 : 0;
+                    if (depth == 0)
+                        break;
+                }
+                if (j == lines.size())
+                    return fail(l.no, "'for' without 'end'", err);
+                std::vector<SrcLine> body(lines.begin() + long(i) + 1, lines.begin() + long(j));
+                for (size_t v = 2; v < w.size(); v++) {
+                    std::string value;
+                    if (!expand(w[v], vars, value, err))
+                        return fail(l.no, err, err);
+                    for (const auto& each : words(value)) {
+                        auto inner = vars;
+                        inner[w[0]] = each;
+                        if (!process(body, inner, err))
+                            return false;
+                    }
+                }
+                i = j;
+                continue;
+            }
+            std::string text;
+            if (!expand(rest, vars, text, err))
+                return fail(l.no, err, err);
+            if (kw == "end") {
+                return fail(l.no, "'end' without 'for'", err);
+            } else if (kw == "set") {
+                size_t eq = text.find('=');
+                std::string name = text.substr(0, eq);
+                name.erase(name.find_last_not_of(" \t") + 1);
+                if (eq == std::string::npos || name.empty())
+                    return fail(l.no, "expected 'set NAME = VALUE'", err);
+                std::string value = text.substr(eq + 1);
+                value.erase(0, value.find_first_not_of(" \t"));
+                if (!defines->count(name))
+                    vars[name] = value;
+            } else if (kw == "stage") {
+                if (words(text).size() != 1)
+                    return fail(l.no, "expected 'stage NAME'", err);
+                stages.emplace_back();
+                stages.back().name = words(text)[0];
+                stages.back().line = l.no;
+                dirs.push_back(".");
+            } else if (stages.empty()) {
+                return fail(l.no, "'" + kw + "' outside a stage", err);
+            } else {
+                Stage& s = stages.back();
+                if (kw == "dir") {
+                    dirs.back() = text;
+                } else if (kw == "in") {
+                    for (const auto& w : words(text))
+                        s.inputs.push_back(w);
+                } else if (kw == "out") {
+                    for (const auto& w : words(text))
+                        s.outputs.push_back(w);
+                } else if (kw == "after") {
+                    for (const auto& w : words(text))
+                        s.after.push_back(w);
+                } else if (kw == "timeout") {
+                    s.timeout = atof(text.c_str());
+                } else if (kw == "run") {
+                    s.command += (s.command.empty() ? "" : "\n") + text;
+                } else {
+                    return fail(l.no, "unknown keyword '" + kw + "'", err);
+                }
+            }
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
+bool load_pipeline(const std::string& path,
+                   const std::vector<std::pair<std::string, std::string>>& defines,
+                   Pipeline& out, std::string& err) {
+    std::ifstream in(path);
+    if (!in) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    std::vector<SrcLine> lines;
+    std::string line, pending;
+    int no = 0, start = 0;
+    while (std::getline(in, line)) {
+        no++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos && (hash == 0 || isspace((unsigned char)line[hash - 1])))
+            line.erase(hash);
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        bool more = !line.empty() && line.back() == '\\';
+        if (more)
+            line.pop_back();
+        if (pending.empty())
+            start = no;
+        pending += line;
+        if (more)
+            continue;
+        pending.erase(0, pending.find_first_not_of(" \t"));
+        if (!pending.empty())
+            lines.push_back({start, pending});
+        pending.clear();
+    }
+
+    std::map<std::string, std::string> defs(defines.begin(), defines.end());
+    Parser ps{path, &defs, {}, {}};
+    if (!ps.process(lines, defs, err))
+        return false;
+
+    out = Pipeline();
+    out.root = parent(path);
+    out.stages = std::move(ps.stages);
+    std::map<std::string, size_t> by_name, by_output;
+    for (size_t i = 0; i < out.stages.size(); i++) {
+        Stage& s = out.stages[i];
+        s.dir = normalize(ps.dirs[i]);
+        auto where = [&] { return path + ":" + std::to_string(s.line) + ": stage " + s.name; };
+        if (s.command.empty()) {
+            err = where() + " has no 'run'";
+            return false;
+        }
+        if (!by_name.emplace(s.name, i).second) {
+            err = where() + " is defined twice";
+            return false;
+        }
+        for (auto& p : s.inputs)
+            p = join(s.dir, p);
+        for (auto& p : s.outputs) {
+            p = join(s.dir, p);
+            if (!by_output.emplace(p, i).second) {
+                err = where() + ": '" + p + "' is also written by stage " +
+                      out.stages[by_output[p]].name;
+                return false;
+            }
+        }
+    }
+    // A stage depends on the writers of its inputs, or of files inside an
+    // input directory, and on the stages named by `after`.
+    auto under = [](const std::string& a, const std::string& dir) {
+        return a.size() > dir.size() && a.compare(0, dir.size(), dir) == 0 && a[dir.size()] == '/';
+    };
+    for (size_t i = 0; i < out.stages.size(); i++) {
+        Stage& s = out.stages[i];
+        for (const auto& p : s.inputs)
+            for (const auto& o : by_output)
+                if (o.second != i && (o.first == p || under(o.first, p) || under(p, o.first)))
+                    s.deps.push_back(o.second);
+        for (const auto& a : s.after) {
+            size_t found = 0;
+            for (size_t j = 0; j < out.stages.size(); j++)
+                if (j != i && fnmatch(a.c_str(), out.stages[j].name.c_str(), 0) == 0) {
+                    s.deps.push_back(j);
+                    found++;
+                }
+            if (!found) {
+                err = path + ":" + std::to_string(s.line) + ": stage " + s.name +
+                      ": no stage matches 'after " + a + "'";
+                return false;
+            }
+        }
+        std::sort(s.deps.begin(), s.deps.end());
+        s.deps.erase(std::unique(s.deps.begin(), s.deps.end()), s.deps.end());
+    }
+    // Kahn's algorithm; whatever is left over sits on a cycle.
+    std::vector<size_t> indeg(out.stages.size());
+    std::vector<std::vector<size_t>> users(out.stages.size());
+    for (size_t i = 0; i < out.stages.size(); i++)
+        for (size_t d : out.stages[i].deps) {
+            indeg[i]++;
+            users[d].push_back(i);
+        }
+    std::vector<size_t> queue;
+    for (size_t i = 0; i < indeg.size(); i++)
+        if (!indeg[i])
+            queue.push_back(i);
+    for (size_t q = 0; q < queue.size(); q++)
+        for (size_t u : users[queue[q]])
+            if (--indeg[u] == 0)
+                queue.push_back(u);
+    for (size_t i = 0; i < indeg.size(); i++)
+        if (indeg[i]) {
+            err = path + ": dependency cycle through stage " + out.stages[i].name;
+            return false;
+        }
+    return true;
+}
+
+// --- cache ---
+
+static const char CACHE_MAGIC[] = "RPIPE01";
+
+bool PipelineCache::load(const std::string& path, std::string& err) {
+    std::ifstream in(path);
+    if (!in)
+        return true;  // no cache yet
+    std::string line;
+    if (!std::getline(in, line) || line != CACHE_MAGIC) {
+        err = path + ": not a pipeline cache";
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* cur = nullptr;
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string kind, rest;
+        ls >> kind;
+        if (kind == "file") {
+            FileHash f;
+            ls >> std::hex >> f.hash >> std::dec >> f.size >> f.mtime;
+            std::getline(ls >> std::ws, rest);
+            files_[rest] = f;
+        } else if (kind == "stage") {
+            uint64_t key;
+            ls >> std::hex >> key;
+            std::getline(ls >> std::ws, rest);
+            cur = &stages_[rest];
+            *cur = Entry();
+            cur->key = key;
+        } else if (kind == "out" && cur) {
+            uint64_t h;
+            ls >> std::hex >> h;
+            std::getline(ls >> std::ws, rest);
+            cur->outputs.emplace_back(rest, h);
+        }
+    }
+    return true;
+}
+
+bool PipelineCache::save(const std::string& path, std::string& err) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) {
+        err = "Cannot write '" + tmp + "'";
+        return false;
+    }
+    fprintf(f, "%s\n", CACHE_MAGIC);
+    for (const auto& e : files_)
+        fprintf(f, "file %016llx %lld %lld %s\n", (unsigned long long)e.second.hash,
+                (long long)e.second.size, (long long)e.second.mtime, e.first.c_str());
+    for (const auto& s : stages_) {
+        fprintf(f, "stage %016llx %s\n", (unsigned long long)s.second.key, s.first.c_str());
+        for (const auto& o : s.second.outputs)
+            fprintf(f, "out %016llx %s\n", (unsigned long long)o.second, o.first.c_str());
+    }
+    bool ok = fclose(f) == 0;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        err = "Cannot write '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+bool PipelineCache::hash_path(const std::string& path, uint64_t& h, std::string& err) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        err = "'" + path + "' does not exist";
+        return false;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        DIR* d = opendir(path.c_str());
+        if (!d) {
+            err = "Cannot read '" + path + "'";
+            return false;
+        }
+        std::vector<std::string> names;
+        while (dirent* e = readdir(d))
+            if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0)
+                names.push_back(e->d_name);
+        closedir(d);
+        std::sort(names.begin(), names.end());
+        h = hash_str(path, 1);
+        for (const auto& name : names) {
+            uint64_t child;
+            if (!hash_path(path + "/" + name, child, err))
+                return false;
+            h = hash_bytes(&child, 8, hash_str(name, h));
+        }
+        return true;
+    }
+    int64_t mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = files_.find(path);
+        if (it != files_.end() && it->second.size == int64_t(st.st_size) &&
+            it->second.mtime == mtime) {
+            h = it->second.hash;
+            return true;
+        }
+    }
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    std::vector<char> buf(1 << 20);
+    h = 0;
+    for (size_t n; (n = fread(buf.data(), 1, buf.size(), f)) > 0;)
+        h = hash_bytes(buf.data(), n, h);
+    fclose(f);
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_[path] = FileHash{int64_t(st.st_size), mtime, h};
+    return true;
+}
+
+bool PipelineCache::lookup(const std::string& stage, Entry& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stages_.find(stage);
+    if (it == stages_.end())
+        return false;
+    out = it->second;
+    return true;
+}
+
+void PipelineCache::store(const std::string& stage, const Entry& e) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_[stage] = e;
+}
+
+void PipelineCache::forget(const std::string& stage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_.erase(stage);
+}
+
+// --- execution ---
+
+const char* state_name(StageState s) {
+    switch (s) {
+    case StageState::PENDING: return "pending";
+    case StageState::CACHED: return "cached";
+    case StageState::RAN: return "ran";
+    case StageState::WOULD_RUN: return "would run";
+    case StageState::FAILED: return "failed";
+    case StageState::BLOCKED: return "blocked";
+    }
+    return "?";
+}
+
+namespace {
+
+struct Executor {
+    const Pipeline& p;
+    PipelineCache& cache;
+    const PipelineOptions& opts;
+    std::mutex save_mutex;
+
+    std::string fs(const std::string& path) const {
+        return path[0] == '/' || p.root == "." ? path : p.root + "/" + path;
+    }
+
+    // Key over everything the command sees; false (with the reason) if an
+    // input is missing.
+    bool key(const Stage& s, uint64_t& k, std::string& why) {
+        k = hash_str(s.command, hash_str(s.dir, 0));
+        for (const auto& o : s.outputs)
+            k = hash_str(o, k);
+        for (const auto& in : s.inputs) {
+            uint64_t h;
+            if (!cache.hash_path(fs(in), h, why))
+                return false;
+            k = hash_bytes(&h, 8, hash_str(in, k));
+        }
+        return true;
+    }
+
+    bool up_to_date(const Stage& s, uint64_t k) {
+        PipelineCache::Entry e;
+        if (opts.force || !cache.lookup(s.name, e) || e.key != k ||
+            e.outputs.size() != s.outputs.size())
+            return false;
+        for (const auto& o : e.outputs) {
+            uint64_t h;
+            std::string ignored;
+            if (!cache.hash_path(fs(o.first), h, ignored) || h != o.second)
+                return false;
+        }
+        return true;
+    }
+
+    void save() {
+        std::lock_guard<std::mutex> lock(save_mutex);
+        std::string ignored;
+        cache.save(opts.cache_path, ignored);
+    }
+
+    StageResult execute(const Stage& s) {
+        StageResult r;
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t k;
+        if (!key(s, k, r.detail)) {
+            r.state = StageState::FAILED;
+            r.detail = "input " + r.detail;
+            return r;
+        }
+        if (up_to_date(s, k)) {
+            r.state = StageState::CACHED;
+            return r;
+        }
+        cache.forget(s.name);
+        for (const auto& o : s.outputs)
+            make_dirs(parent(fs(o)));
+        // $0 is the directory, so no quoting is needed.
+        std::vector<std::string> argv = {"/bin/sh", "-ec", "cd -- \"$0\"\n" + s.command,
+                                         fs(s.dir)};
+        ProcResult pr;
+        TaskAttempt a;
+        a.started = run_process(argv, nullptr, pr, a.error, s.timeout);
+        a.status = pr.status;
+        a.timed_out = pr.timed_out;
+        r.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::string name = s.name;
+        std::replace(name.begin(), name.end(), '/', '_');
+        r.log = opts.log_dir + "/" + name + ".log";
+        make_dirs(opts.log_dir);
+        std::ofstream(r.log, std::ios::binary) << pr.output;
+        r.state = StageState::FAILED;
+        if (classify(a) != TaskFate::OK) {
+            r.detail = describe(a, s.timeout);
+            save();
+            return r;
+        }
+        PipelineCache::Entry e;
+        e.key = k;
+        for (const auto& o : s.outputs) {
+            uint64_t h;
+            std::string ignored;
+            if (!cache.hash_path(fs(o), h, ignored)) {
+                r.detail = "did not write '" + o + "'";
+                save();
+                return r;
+            }
+            e.outputs.emplace_back(o, h);
+        }
+        cache.store(s.name, e);
+        save();
+        r.state = StageState::RAN;
+        return r;
+    }
+};
+
+}  // namespace
+
+bool run_pipeline(const Pipeline& p, PipelineCache& cache, const PipelineOptions& opts,
+                  std::vector<StageResult>& results,
+                  const std::function<void(size_t, const StageResult&)>& progress,
+                  std::string& err) {
+    size_t n = p.stages.size();
+    std::vector<char> selected(n, opts.targets.empty());
+    for (const auto& t : opts.targets) {
+        bool found = false;
+        for (size_t i = 0; i < n; i++)
+            if (fnmatch(t.c_str(), p.stages[i].name.c_str(), 0) == 0)
+                selected[i] = found = true;
+        if (!found) {
+            err = "No stage matches '" + t + "'";
+            return false;
+        }
+    }
+    // Targets bring their dependencies along.
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (size_t i = 0; i < n; i++)
+            if (selected[i])
+                for (size_t d : p.stages[i].deps)
+                    if (!selected[d])
+                        selected[d] = grew = true;
+    }
+    results.assign(n, StageResult());
+    std::vector<std::vector<size_t>> users(n);
+    std::vector<size_t> waiting(n);
+    size_t left = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!selected[i])
+            continue;
+        left++;
+        for (size_t d : p.stages[i].deps) {
+            users[d].push_back(i);
+            waiting[i]++;
+        }
+    }
+    Executor ex{p, cache, opts, {}};
+
+    if (opts.dry_run) {
+        // In dependency order; anything downstream of a stage that would
+        // run may see new inputs, so it is reported as running too.
+        std::vector<size_t> order;
+        for (size_t i = 0; i < n; i++)
+            if (selected[i] && !waiting[i])
+                order.push_back(i);
+        for (size_t q = 0; q < order.size(); q++) {
+            size_t i = order[q];
+            const Stage& s = p.stages[i];
+            StageResult& r = results[i];
+            for (size_t d : s.deps)
+                if (results[d].state == StageState::WOULD_RUN && r.detail.empty()) {
+                    r.state = StageState::WOULD_RUN;
+                    r.detail = "after " + p.stages[d].name;
+                }
+            uint64_t k;
+            if (r.state != StageState::WOULD_RUN) {
+                if (!ex.key(s, k, r.detail))
+                    r.detail = "input " + r.detail;
+                r.state = r.detail.empty() && ex.up_to_date(s, k) ? StageState::CACHED
+                                                                   : StageState::WOULD_RUN;
+            }
+            progress(i, r);
+            for (size_t u : users[i])
+                if (--waiting[u] == 0)
+                    order.push_back(u);
+        }
+        return true;
+    }
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < n; i++)
+        if (selected[i] && !waiting[i])
+            ready.push_back(i);
+    Telemetry* tel = opts.telemetry;
+    size_t running = 0;
+    if (tel)
+        tel->set_total(left);
+    // Under m: report i, then release its users; a failure blocks them.
+    // w is the calling worker, whose telemetry slot this thread owns.
+    std::function<void(size_t, unsigned)> finish = [&](size_t i, unsigned w) {
+        left--;
+        progress(i, results[i]);
+        if (tel) {
+            WorkerCounters& wc = tel->worker(w);
+            StageState st = results[i].state;
+            wc.record(1, st == StageState::BLOCKED ? 0 : uint64_t(results[i].seconds * 1e9));
+            if (st == StageState::CACHED)
+                WorkerCounters::bump(wc.cache_hits, 1);
+            else if (st == StageState::RAN || st == StageState::FAILED)
+                WorkerCounters::bump(wc.cache_misses, 1);
+            if (st == StageState::FAILED || st == StageState::BLOCKED)
+                WorkerCounters::bump(wc.failures, 1);
+        }
+        bool bad = results[i].state == StageState::FAILED || results[i].state == StageState::BLOCKED;
+        for (size_t u : users[i]) {
+            if (bad && results[u].state == StageState::PENDING) {
+                results[u].state = StageState::BLOCKED;
+                results[u].detail = "needs " + p.stages[i].name;
+            }
+            if (--waiting[u] == 0) {
+                if (results[u].state == StageState::BLOCKED)
+                    finish(u, w);
+                else
+                    ready.push_back(u);
+            }
+        }
+    };
+    auto gauges = [&] {
+        if (tel) {
+            tel->set_gauge("ready", double(ready.size()));
+            tel->set_gauge("running", double(running));
+        }
+    };
+    auto worker = [&](unsigned w) {
+        std::unique_lock<std::mutex> lock(m);
+        for (;;) {
+            cv.wait(lock, [&] { return !ready.empty() || left == 0; });
+            if (left == 0)
+                return;
+            size_t i = ready.front();
+            ready.pop_front();
+            running++;
+            gauges();
+            lock.unlock();
+            StageResult r = ex.execute(p.stages[i]);
+            lock.lock();
+            running--;
+            results[i] = r;
+            finish(i, w);
+            gauges();
+            cv.notify_all();
+        }
+    };
+    unsigned jobs = unsigned(std::max<size_t>(1, std::min<size_t>(opts.jobs, left)));
+    std::vector<std::thread> pool;
+    for (unsigned j = 1; j < jobs; j++)
+        pool.emplace_back(worker, j);
+    if (left)
+        worker(0);
+    for (auto& t : pool)
+        t.join();
+    return true;
+}
+
+}  // namespace reu
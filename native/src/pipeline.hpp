@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace reu {
+
+class Telemetry;
+
+/*
+ * Cached DAG executor for studies (compile -> sweep -> aggregate -> plot).
+ * A pipeline file declares stages, each a shell command run in a directory
+ * with the files it reads and writes:
+ *
+ *   # comment
+ *   set BIN = ../../native/bin          ${BIN} below; -D BIN=... overrides
+ *   for K in ex1_original ex1_alt1      the block up to `end` once per value
+ *   stage sweep.${K}
+ *       dir     example_1               relative to the pipeline file
+ *       in      ${BIN}/fpsweep          files or directories, relative to dir
+ *       out     results/${K}.tab
+ *       after   compile                 ordering without a shared file
+ *       timeout 3600                    seconds, killed after
+ *       run     ${BIN}/fpsweep -k ${K} ... \
+ *                   -o results          `run` lines form one `sh -e` script
+ *   end
+ *
+ * A stage depends on every stage writing one of its inputs (or a file
+ * inside an input directory). Its cache key hashes the command, directory,
+ * output names and the content of every input, so a stage reruns only when
+ * something it reads changed, its outputs were touched, or an upstream stage
+ * produced different bytes; a rerun that reproduces the same outputs stops
+ * the invalidation there. File hashes are remembered with size and
+ * modification time, so unchanged multi-gigabyte sample files are not read
+ * again. $NAME without braces is left to the shell.
+ */
+struct Stage {
+    std::string name;
+    std::string dir;                   // relative to the pipeline root
+    std::string command;
+    std::vector<std::string> inputs;   // root-relative, normalized
+    std::vector<std::string> outputs;  // root-relative, normalized
+    std::vector<std::string> after;
+    double timeout = 0;
+    int line = 0;
+    std::vector<size_t> deps;  // stage indices, resolved by load_pipeline
+};
+
+struct Pipeline {
+    std::string root;  // directory holding the pipeline file
+    std::vector<Stage> stages;
+};
+
+bool load_pipeline(const std::string& path,
+                   const std::vector<std::pair<std::string, std::string>>& defines,
+                   Pipeline& out, std::string& err);
+
+// Stable 64-bit content hash, the same across runs and builds; chain calls
+// through seed to hash a stream.
+uint64_t hash_bytes(const void* data, size_t n, uint64_t seed = 0);
+
+class PipelineCache {
+public:
+    bool load(const std::string& path, std::string& err);
+    bool save(const std::string& path, std::string& err);
+
+    // Content hash of a file, or of a directory's files and names;
+    // remembered by size and modification time. Thread-safe.
+    bool hash_path(const std::string& path, uint64_t& h, std::string& err);
+
+    struct Entry {
+        uint64_t key = 0;
+        std::vector<std::pair<std::string, uint64_t>> outputs;
+    };
+    bool lookup(const std::string& stage, Entry& out);
+    void store(const std::string& stage, const Entry& e);
+    void forget(const std::string& stage);
+
+private:
+    struct FileHash {
+        int64_t size = 0, mtime = 0;
+        uint64_t hash = 0;
+    };
+    std::mutex mutex_;
+    std::map<std::string, FileHash> files_;
+    std::map<std::string, Entry> stages_;
+};
+
+enum class StageState { PENDING, CACHED, RAN, WOULD_RUN, FAILED, BLOCKED };
+
+const char* state_name(StageState s);
+
+struct StageResult {
+    StageState state = StageState::PENDING;
+    double seconds = 0;
+    std::string detail;  // why it failed or was blocked
+    std::string log;     // path of the command's output
+};
+
+struct PipelineOptions {
+    unsigned jobs = 1;
+    bool dry_run = false;                // report what would run, run nothing
+    bool force = false;                  // ignore the cache for selected stages
+    std::vector<std::string> targets;    // stage names or globs, empty for all
+    std::string cache_path, log_dir;
+    Telemetry* telemetry = nullptr;      // stages as items, cached ones as hits
+};
+
+/*
+ * Run the selected stages and their dependencies, up to opts.jobs at a time
+ * in dependency order. A failed stage blocks its dependents; independent
+ * stages carry on. The cache is saved after every stage that ran. progress
+ * is called (serialized) as each stage finishes. Returns false on errors
+ * that stop the whole run (unknown target, unwritable cache).
+ */
+bool run_pipeline(const Pipeline& p, PipelineCache& cache, const PipelineOptions& opts,
+                  std::vector<StageResult>& results,
+                  const std::function<void(size_t, const StageResult&)>& progress,
+                  std::string& err);
+
+}  // namespace reu
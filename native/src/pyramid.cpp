@@ -0,0 +1,318 @@
+#include "pyramid.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "metrics.hpp"
+#include "parallel.hpp"
+
+namespace reu {
+
+namespace {
+
+// Tile coordinates packed 21 bits per axis.
+constexpr int KEY_BITS = 21;
+constexpr uint64_t KEY_MASK = (uint64_t(1) << KEY_BITS) - 1;
+
+uint64_t pack(const uint32_t c[3]) {
+    return uint64_t(c[0]) | uint64_t(c[1]) << KEY_BITS | uint64_t(c[2]) << (2 * KEY_BITS);
+}
+
+void unpack(uint64_t key, uint32_t c[3]) {
+    for (int a = 0; a < 3; a++)
+        c[a] = uint32_t((key >> (a * KEY_BITS)) & KEY_MASK);
+}
+
+struct Cells {
+    std::vector<uint32_t> count;
+    std::vector<float> max_ulp, min_sig;
+
+    explicit Cells(size_t n) : count(n, 0), max_ulp(n, NAN), min_sig(n, NAN) {}
+
+    // NaN statistics are skipped, so fmax / fmin keep the other value.
+    void add(size_t c, uint32_t n, float ulp, float sig) {
+        count[c] += n;
+        max_ulp[c] = std::fmax(max_ulp[c], ulp);
+        min_sig[c] = std::fmin(min_sig[c], sig);
+    }
+};
+
+struct Tile {
+    uint64_t key;
+    Cells cells;
+};
+
+struct Entry {
+    uint64_t key;  // finest-level tile, UINT64_MAX if outside the box
+    uint32_t cell;
+    float ulp, sig;
+};
+
+bool make_dir(const std::string& path, std::string& err) {
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        err = "cannot create '" + path + "': " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+// Drop tiles of an earlier build so they are not mixed with this one.
+void clear_tiles(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (!d)
+        return;
+    while (dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".tile") == 0)
+            unlink((dir + "/" + name).c_str());
+    }
+    closedir(d);
+}
+
+bool write_tile(const std::string& path, int dims, int tile, int level, const uint32_t c[3],
+                const Cells& cells, size_t& bytes) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    uint32_t head[6] = {uint32_t(dims), uint32_t(tile), uint32_t(level), c[0], c[1], c[2]};
+    size_t n = cells.count.size();
+    bool ok = fwrite("RTILE01", 1, 8, f) == 8 && fwrite(head, sizeof head, 1, f) == 1 &&
+              fwrite(cells.count.data(), 4, n, f) == n &&
+              fwrite(cells.max_ulp.data(), 4, n, f) == n &&
+              fwrite(cells.min_sig.data(), 4, n, f) == n;
+    ok = fclose(f) == 0 && ok;
+    bytes += 8 + sizeof head + 12 * n;
+    return ok;
+}
+
+}  // namespace
+
+bool build_pyramid(const ResultStore& store, const std::vector<uint32_t>& rows,
+                   PyramidSpec& spec, const std::string& ulp, const std::string& sig,
+                   const std::string& dir, unsigned jobs, PyramidStats& stats,
+                   std::string& err) {
+    int dims = int(spec.axes.size());
+    if (dims < 2 || dims > 3) {
+        err = "a pyramid needs two or three axes";
+        return false;
+    }
+    if (spec.levels < 1 || spec.levels > 16 || spec.tile < 2 || spec.tile % 2 != 0 ||
+        spec.tile > 1024) {
+        err = "levels must lie in [1, 16] and the tile size be even and in [2, 1024]";
+        return false;
+    }
+    // Missing axis bounds come from the selected rows.
+    const Column* ac[3] = {nullptr, nullptr, nullptr};
+    for (int a = 0; a < dims; a++) {
+        BinAxis& ax = spec.axes[size_t(a)];
+        ac[a] = store.find(ax.column);
+        if (!ac[a] || ac[a]->type == ColType::STR) {
+            err = "no numeric column '" + ax.column + "'";
+            return false;
+        }
+        if (std::isnan(ax.lo) || std::isnan(ax.hi)) {
+            double lo = INFINITY, hi = -INFINITY;
+            for (uint32_t r : rows) {
+                double v = ac[a]->num(r);
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+            }
+            if (std::isnan(ax.lo))
+                ax.lo = lo > hi ? 0.0 : lo;
+            if (std::isnan(ax.hi))
+                ax.hi = lo > hi ? 0.0 : hi;
+        }
+        if (!(ax.lo <= ax.hi)) {
+            err = "empty range on '" + ax.column + "'";
+            return false;
+        }
+    }
+    const Column* uc = ulp.empty() ? nullptr : store.find(ulp);
+    const Column* sc = sig.empty() ? nullptr : store.find(sig);
+    if ((!ulp.empty() && !uc) || (!sig.empty() && !sc)) {
+        err = "no column '" + (!ulp.empty() && !uc ? ulp : sig) + "'";
+        return false;
+    }
+    SampleUlp row_ulp(store);
+
+    const uint32_t T = uint32_t(spec.tile);
+    const int finest = spec.levels - 1;
+    const uint64_t per_axis = uint64_t(T) << finest;  // cells per axis at the finest level
+    size_t tile_cells = 1;
+    for (int a = 0; a < dims; a++)
+        tile_cells *= T;
+
+    // 1. Finest-level tile and cell of every row.
+    std::vector<Entry> entries(rows.size());
+    parallel_for(rows.size(), jobs, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++) {
+            uint32_t r = rows[i];
+            Entry& en = entries[i];
+            en.key = UINT64_MAX;
+            uint32_t tc[3] = {0, 0, 0};
+            uint32_t cell = 0;
+            bool inside = true;
+            for (int a = 0; a < dims && inside; a++) {
+                const BinAxis& ax = spec.axes[a];
+                double v = ac[a]->num(r);
+                if (std::isnan(v) || v < ax.lo || v > ax.hi) {
+                    inside = false;
+                    break;
+                }
+                double w = ax.hi - ax.lo;
+                uint64_t g = w > 0 ? uint64_t((v - ax.lo) / w * double(per_axis)) : 0;
+                g = g >= per_axis ? per_axis - 1 : g;
+                tc[a] = uint32_t(g / T);
+                cell = cell * T + uint32_t(g % T);
+            }
+            if (!inside)
+                continue;
+            en.key = pack(tc);
+            en.cell = cell;
+            en.ulp = float(uc ? uc->num(r) : row_ulp.at(r));
+            en.sig = float(sc ? sc->num(r) : NAN);
+        }
+    });
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    while (!entries.empty() && entries.back().key == UINT64_MAX)
+        entries.pop_back();
+    stats.rows = entries.size();
+
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < entries.size(); i++)
+        if (i == 0 || entries[i].key != entries[i - 1].key)
+            starts.push_back(i);
+    starts.push_back(entries.size());
+
+    std::vector<std::vector<Tile>> levels(size_t(spec.levels));
+    std::vector<Tile>& fine = levels[size_t(finest)];
+    fine.reserve(starts.size() - 1);
+    for (size_t t = 0; t + 1 < starts.size(); t++)
+        fine.push_back({entries[starts[t]].key, Cells(0)});
+    parallel_for(fine.size(), jobs, [&](size_t b, size_t e, unsigned) {
+        for (size_t t = b; t < e; t++) {
+            Cells cells(tile_cells);
+            for (size_t i = starts[t]; i < starts[t + 1]; i++)
+                cells.add(entries[i].cell, 1, entries[i].ulp, entries[i].sig);
+            fine[t].cells = std::move(cells);
+        }
+    });
+    std::vector<Entry>().swap(entries);
+
+    // 2. Each coarser level merges 2 child cells per axis.
+    const uint32_t H = T / 2;
+    for (int l = finest - 1; l >= 0; l--) {
+        const std::vector<Tile>& child = levels[size_t(l + 1)];
+        std::vector<std::pair<uint64_t, size_t>> parent(child.size());
+        for (size_t i = 0; i < child.size(); i++) {
+            uint32_t c[3];
+            unpack(child[i].key, c);
+            for (int a = 0; a < 3; a++)
+                c[a] >>= 1;
+            parent[i] = {pack(c), i};
+        }
+        std::sort(parent.begin(), parent.end());
+        std::vector<size_t> ps;
+        for (size_t i = 0; i < parent.size(); i++)
+            if (i == 0 || parent[i].first != parent[i - 1].first)
+                ps.push_back(i);
+        ps.push_back(parent.size());
+        std::vector<Tile>& out = levels[size_t(l)];
+        for (size_t p = 0; p + 1 < ps.size(); p++)
+            out.push_back({parent[ps[p]].first, Cells(0)});
+        parallel_for(out.size(), jobs, [&](size_t b, size_t e, unsigned) {
+            for (size_t p = b; p < e; p++) {
+                Cells cells(tile_cells);
+                for (size_t k = ps[p]; k < ps[p + 1]; k++) {
+                    const Tile& ch = child[parent[k].second];
+                    uint32_t cc[3];
+                    unpack(ch.key, cc);
+                    uint32_t off[3] = {(cc[0] & 1) * H, (cc[1] & 1) * H, (cc[2] & 1) * H};
+                    for (size_t i = 0; i < tile_cells; i++) {
+                        if (!ch.cells.count[i])
+                            continue;
+                        // Child cell (x, y[, z]) -> parent cell (off + x / 2, ...)
+                        size_t rem = i, pc = 0, mul = 1;
+                        for (int a = dims - 1; a >= 0; a--) {
+                            uint32_t x = uint32_t(rem % T);
+                            rem /= T;
+                            pc += (off[a] + x / 2) * mul;
+                            mul *= T;
+                        }
+                        cells.add(pc, ch.cells.count[i], ch.cells.max_ulp[i],
+                                  ch.cells.min_sig[i]);
+                    }
+                }
+                out[p].cells = std::move(cells);
+            }
+        });
+    }
+
+    // 3. Write every level, then the metadata.
+    if (!make_dir(dir, err))
+        return false;
+    stats.tiles.assign(size_t(spec.levels), 0);
+    stats.bytes = 0;
+    for (int l = 0; l < spec.levels; l++) {
+        std::string ldir = dir + "/" + std::to_string(l);
+        if (!make_dir(ldir, err))
+            return false;
+        clear_tiles(ldir);
+        const std::vector<Tile>& tiles = levels[size_t(l)];
+        std::vector<size_t> bytes(jobs ? jobs : 1, 0);
+        std::vector<char> failed(tiles.size(), 0);
+        parallel_for(tiles.size(), jobs, [&](size_t b, size_t e, unsigned j) {
+            for (size_t t = b; t < e; t++) {
+                uint32_t c[3];
+                unpack(tiles[t].key, c);
+                std::string name = ldir + "/" + std::to_string(c[0]) + "_" + std::to_string(c[1]);
+                if (dims == 3)
+                    name += "_" + std::to_string(c[2]);
+                failed[t] = !write_tile(name + ".tile", dims, spec.tile, l, c, tiles[t].cells,
+                                        bytes[j]);
+            }
+        });
+        for (size_t t = 0; t < tiles.size(); t++) {
+            if (failed[t]) {
+                err = "cannot write tiles under '" + ldir + "'";
+                return false;
+            }
+        }
+        stats.tiles[size_t(l)] = tiles.size();
+        for (size_t b : bytes)
+            stats.bytes += b;
+    }
+
+    std::string meta = dir + "/meta.json";
+    FILE* f = fopen(meta.c_str(), "w");
+    if (!f) {
+        err = "cannot write '" + meta + "'";
+        return false;
+    }
+    fprintf(f, "{\n  \"format\": \"RTILE01\",\n  \"dims\": %d,\n  \"tile\": %d,\n  \"levels\": %d,\n",
+            dims, spec.tile, spec.levels);
+    fprintf(f, "  \"axes\": [");
+    for (int a = 0; a < dims; a++)
+        fprintf(f, "%s{\"column\": \"%s\", \"lo\": %.17g, \"hi\": %.17g}", a ? ", " : "",
+                spec.axes[a].column.c_str(), spec.axes[a].lo, spec.axes[a].hi);
+    fprintf(f, "],\n  \"ulp\": \"%s\",\n  \"sig\": \"%s\",\n  \"rows\": %zu,\n  \"tiles\": [",
+            ulp.empty() ? "out_lo/out_hi" : ulp.c_str(), sig.c_str(), stats.rows);
+    for (int l = 0; l < spec.levels; l++)
+        fprintf(f, "%s%zu", l ? ", " : "", stats.tiles[size_t(l)]);
+    fprintf(f, "]\n}\n");
+    if (fclose(f) != 0) {
+        err = "cannot write '" + meta + "'";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "binagg.hpp"
+#include "store.hpp"
+
+namespace reu {
+
+/*
+ * Multi-resolution pyramid of error-map tiles over two or three input
+ * columns. Level l splits each axis into 2^l tiles of `tile` cells, so the
+ * finest level has tile * 2^(levels-1) cells per axis; coarser levels merge
+ * 2 (per axis) child cells. A viewer loads only the tiles of the level
+ * whose cell size matches its zoom, over the visible part of the box.
+ *
+ * Layout under the output directory:
+ *
+ *   meta.json                axes, tile size, levels, tile counts
+ *   <level>/<ix>_<iy>.tile   (2D)   <level>/<ix>_<iy>_<iz>.tile (3D)
+ *
+ * A tile file is "RTILE01\0", then u32 dims, tile, level, ix, iy, iz,
+ * then tile^dims cells (x-major, last axis fastest) of u32 count, f32
+ * max_ulp and f32 min_sig, each as a contiguous array. Empty cells have
+ * count 0 and NaN statistics; tiles with no data are not written.
+ */
+struct PyramidSpec {
+    std::vector<BinAxis> axes;  // 2 or 3; bins is ignored, NaN bounds come from the data
+    int tile = 64;              // cells per axis per tile
+    int levels = 5;
+};
+
+struct PyramidStats {
+    size_t rows = 0;               // rows that fell inside the box
+    std::vector<size_t> tiles;     // tiles written per level
+    size_t bytes = 0;
+};
+
+/*
+ * Per-row error measures: the ulp column if given, otherwise the half-width
+ * of the sample range [out_lo, out_hi] around `mean` in ULPs of the row's
+ * precision (`precision` bits, else FLOAT / DOUBLE from `config`), and the
+ * sig column as the significant digits.
+ */
+bool build_pyramid(const ResultStore& store, const std::vector<uint32_t>& rows,
+                   PyramidSpec& spec, const std::string& ulp, const std::string& sig,
+                   const std::string& dir, unsigned jobs, PyramidStats& stats,
+                   std::string& err);
+
+}  // namespace reu
@@ -0,0 +1,703 @@
+#include "query.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "parallel.hpp"
+
+namespace reu {
+
+static const char MAGIC[8] = {'R', 'Q', 'I', 'D', 'X', '0', '1', '\0'};
+
+std::string Aggregate::label() const {
+    static const char* NAMES[] = {"count", "min", "max", "sum", "mean"};
+    return column.empty() ? NAMES[int(fn)] : std::string(NAMES[int(fn)]) + "(" + column + ")";
+}
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(sep, start);
+        if (end == std::string::npos)
+            end = s.size();
+        if (end > start)
+            out.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return out;
+}
+
+bool parse_predicates(const std::string& expr, std::vector<Predicate>& out, std::string& err) {
+    // Two-character operators first, so "<=" is not read as "<".
+    static const std::pair<const char*, CmpOp> OPS[] = {
+        {"<=", CmpOp::LE}, {">=", CmpOp::GE}, {"!=", CmpOp::NE},
+        {"<", CmpOp::LT},  {">", CmpOp::GT},  {"=", CmpOp::EQ}};
+    for (const auto& item : split(expr, ',')) {
+        Predicate p;
+        size_t pos = std::string::npos, len = 0;
+        for (const auto& op : OPS) {
+            size_t at = item.find(op.first);
+            if (at != std::string::npos && (at < pos || (at == pos && strlen(op.first) > len))) {
+                pos = at;
+                len = strlen(op.first);
+                p.op = op.second;
+            }
+        }
+        if (pos == std::string::npos || pos == 0 || pos + len == item.size()) {
+            err = "invalid predicate '" + item + "' (expected 'column OP value')";
+            return false;
+        }
+        p.column = item.substr(0, pos);
+        p.text = item.substr(pos + len);
+        char* end;
+        p.value = strtod(p.text.c_str(), &end);
+        if (*end)
+            p.value = NAN;  // only valid against a string column
+        out.push_back(p);
+    }
+    return true;
+}
+
+bool parse_aggregates(const std::string& list, std::vector<Aggregate>& out, std::string& err) {
+    static const char* NAMES[] = {"count", "min", "max", "sum", "mean"};
+    for (const auto& item : split(list, ',')) {
+        size_t open = item.find('(');
+        std::string fn = item.substr(0, open);
+        Aggregate a;
+        bool ok = false;
+        for (int i = 0; i < 5 && !ok; i++)
+            if (fn == NAMES[i]) {
+                a.fn = AggFn(i);
+                ok = true;
+            }
+        if (ok && open != std::string::npos) {
+            ok = item.back() == ')' && item.size() > open + 2;
+            a.column = ok ? item.substr(open + 1, item.size() - open - 2) : "";
+        }
+        if (!ok || (a.column.empty() && a.fn != AggFn::COUNT)) {
+            err = "invalid aggregate '" + item + "' (expected count, or min|max|sum|mean(column))";
+            return false;
+        }
+        out.push_back(a);
+    }
+    return true;
+}
+
+// --- Index ------------------------------------------------------------------
+
+const QueryIndex::Zone* QueryIndex::zone(const std::string& column) const {
+    for (const auto& z : zones_)
+        if (z.column == column)
+            return &z;
+    return nullptr;
+}
+
+const QueryIndex::Bitmap* QueryIndex::bitmap(const std::string& column) const {
+    for (const auto& b : bitmaps_)
+        if (b.column == column)
+            return &b;
+    return nullptr;
+}
+
+std::vector<std::string> QueryIndex::indexed() const {
+    std::vector<std::string> names;
+    for (const auto& s : sorted_)
+        names.push_back(s.column);
+    for (const auto& b : bitmaps_)
+        names.push_back(b.column);
+    return names;
+}
+
+bool QueryIndex::build(const ResultStore& store, const std::vector<std::string>& indexed,
+                       int64_t stamp, unsigned jobs, std::string& err) {
+    *this = QueryIndex();
+    rows_ = store.rows();
+    stamp_ = stamp;
+    size_t n = store.rows(), nblocks = (n + BLOCK - 1) / BLOCK;
+    for (const auto& c : store.columns()) {
+        if (c.type == ColType::STR)
+            continue;
+        Zone z;
+        z.column = c.name;
+        z.lo.assign(nblocks, INFINITY);
+        z.hi.assign(nblocks, -INFINITY);
+        parallel_for(nblocks, jobs, [&](size_t b, size_t e, unsigned) {
+            for (size_t k = b; k < e; k++) {
+                double lo = INFINITY, hi = -INFINITY;
+                for (size_t r = k * BLOCK; r < std::min(n, (k + 1) * BLOCK); r++) {
+                    double v = c.num(r);
+                    if (!std::isnan(v)) {
+                        lo = std::min(lo, v);
+                        hi = std::max(hi, v);
+                    }
+                }
+                z.lo[k] = lo;
+                z.hi[k] = hi;
+            }
+        });
+        zones_.push_back(std::move(z));
+    }
+
+    for (const auto& name : indexed) {
+        const Column* c = store.find(name);
+        if (!c) {
+            err = "no column '" + name + "'";
+            return false;
+        }
+        if (c->type == ColType::STR) {
+            if (c->dict.size() > 4096) {
+                err = "'" + name + "' has too many distinct values for a bitmap index";
+                return false;
+            }
+            Bitmap bm;
+            bm.column = name;
+            size_t words = (n + 63) / 64;
+            bm.bits.assign(c->dict.size(), std::vector<uint64_t>(words, 0));
+            parallel_for(words, jobs, [&](size_t b, size_t e, unsigned) {
+                for (size_t r = b * 64; r < std::min(n, e * 64); r++)
+                    bm.bits[c->codes[r]][r / 64] |= uint64_t(1) << (r % 64);
+            });
+            bitmaps_.push_back(std::move(bm));
+            continue;
+        }
+        // Sort per job, then merge neighbouring runs pairwise.
+        Sorted s;
+        s.column = name;
+        for (size_t r = 0; r < n; r++)
+            if (!c->is_null(r))
+                s.rows.push_back(uint32_t(r));
+        auto less = [c](uint32_t a, uint32_t b) {
+            double va = c->num(a), vb = c->num(b);
+            return va < vb || (va == vb && a < b);
+        };
+        unsigned parts = std::max(1u, std::min(jobs, unsigned(s.rows.size() / BLOCK + 1)));
+        std::vector<size_t> cut(parts + 1);
+        for (unsigned j = 0; j <= parts; j++)
+            cut[j] = s.rows.size() * j / parts;
+        parallel_for(parts, parts, [&](size_t b, size_t e, unsigned) {
+            for (size_t j = b; j < e; j++)
+                std::sort(s.rows.begin() + long(cut[j]), s.rows.begin() + long(cut[j + 1]), less);
+        });
+        for (size_t width = 1; width < parts; width *= 2) {
+            size_t merges = (parts + 2 * width - 1) / (2 * width);
+            parallel_for(merges, jobs, [&](size_t b, size_t e, unsigned) {
+                for (size_t m = b; m < e; m++) {
+                    size_t lo = m * 2 * width, mid = lo + width;
+                    size_t hi = std::min(lo + 2 * width, size_t(parts));
+                    if (mid < hi)
+                        std::inplace_merge(s.rows.begin() + long(cut[lo]),
+                                           s.rows.begin() + long(cut[mid]),
+                                           s.rows.begin() + long(cut[hi]), less);
+                }
+            });
+        }
+        sorted_.push_back(std::move(s));
+    }
+    return true;
+}
+
+static void put(FILE* f, const void* p, size_t n) { fwrite(p, 1, n, f); }
+
+static void put_name(FILE* f, const std::string& s) {
+    uint32_t n = uint32_t(s.size());
+    put(f, &n, 4);
+    put(f, s.data(), n);
+}
+
+bool QueryIndex::save(const std::string& path, std::string& err) const {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        err = "Cannot write '" + path + "'";
+        return false;
+    }
+    uint32_t block = BLOCK, count;
+    put(f, MAGIC, 8);
+    put(f, &rows_, 8);
+    put(f, &stamp_, 8);
+    put(f, &block, 4);
+    count = uint32_t(zones_.size());
+    put(f, &count, 4);
+    for (const auto& z : zones_) {
+        put_name(f, z.column);
+        put(f, z.lo.data(), z.lo.size() * 8);
+        put(f, z.hi.data(), z.hi.size() * 8);
+    }
+    count = uint32_t(sorted_.size());
+    put(f, &count, 4);
+    for (const auto& s : sorted_) {
+        uint64_t len = s.rows.size();
+        put_name(f, s.column);
+        put(f, &len, 8);
+        put(f, s.rows.data(), s.rows.size() * 4);
+    }
+    count = uint32_t(bitmaps_.size());
+    put(f, &count, 4);
+    for (const auto& b : bitmaps_) {
+        uint32_t codes = uint32_t(b.bits.size());
+        put_name(f, b.column);
+        put(f, &codes, 4);
+        for (const auto& w : b.bits)
+            put(f, w.data(), w.size() * 8);
+    }
+    bool ok = !ferror(f);
+    if (fclose(f) != 0 || !ok) {
+        err = "Failed writing '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+bool QueryIndex::load(const std::string& path, QueryIndex& out, std::string& err) {
+    out = QueryIndex();
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    auto get = [f](void* p, size_t n) { return fread(p, 1, n, f) == n; };
+    auto get_name = [&](std::string& s) {
+        uint32_t n;
+        if (!get(&n, 4) || n > 4096)
+            return false;
+        s.resize(n);
+        return n == 0 || get(&s[0], n);
+    };
+    char magic[8];
+    uint32_t block, count;
+    bool ok = get(magic, 8) && memcmp(magic, MAGIC, 8) == 0 && get(&out.rows_, 8) &&
+              get(&out.stamp_, 8) && get(&block, 4) && block == BLOCK && get(&count, 4);
+    size_t nblocks = size_t((out.rows_ + BLOCK - 1) / BLOCK);
+    size_t words = size_t((out.rows_ + 63) / 64);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        Zone z;
+        z.lo.resize(nblocks);
+        z.hi.resize(nblocks);
+        ok = get_name(z.column) && get(z.lo.data(), nblocks * 8) && get(z.hi.data(), nblocks * 8);
+        out.zones_.push_back(std::move(z));
+    }
+    ok = ok && get(&count, 4);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        Sorted s;
+        uint64_t len;
+        ok = get_name(s.column) && get(&len, 8) && len <= out.rows_;
+        s.rows.resize(ok ? size_t(len) : 0);
+        ok = ok && get(s.rows.data(), s.rows.size() * 4);
+        for (size_t k = 0; ok && k < s.rows.size(); k++)
+            ok = s.rows[k] < out.rows_;
+        out.sorted_.push_back(std::move(s));
+    }
+    ok = ok && get(&count, 4);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        Bitmap b;
+        uint32_t codes;
+        ok = get_name(b.column) && get(&codes, 4) && codes <= 4096;
+        b.bits.assign(ok ? codes : 0, std::vector<uint64_t>(words));
+        for (auto& w : b.bits)
+            ok = ok && get(w.data(), words * 8);
+        out.bitmaps_.push_back(std::move(b));
+    }
+    fclose(f);
+    if (!ok) {
+        err = "'" + path + "' is not a valid query index";
+        out = QueryIndex();
+        return false;
+    }
+    return true;
+}
+
+// --- Scan -------------------------------------------------------------------
+
+namespace {
+
+// A store column or the derived ULP, read as a double (NaN for null).
+struct Source {
+    const Column* col = nullptr;
+    const SampleUlp* ulp = nullptr;
+
+    double at(uint32_t r) const { return col ? col->num(r) : ulp->at(r); }
+};
+
+struct Bound {
+    const Predicate* p;
+    Source src;
+    uint32_t code = 0;  // string columns
+};
+
+struct Acc {
+    uint64_t n = 0;  // non-null values (rows for a plain count)
+    double min = INFINITY, max = -INFINITY, sum = 0.0;
+};
+
+using Ranked = std::pair<double, uint32_t>;
+
+// Compacts sel[0, n) to the rows whose value passes keep.
+template <class Get, class Keep>
+size_t compact(Get get, Keep keep, uint32_t* sel, size_t n) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = sel[i];
+        sel[k] = r;
+        k += keep(get(r));
+    }
+    return k;
+}
+
+// Rows where get(row) OP x holds; nulls (NaN) never do.
+template <class Get>
+size_t keep_if(Get get, CmpOp op, double x, uint32_t* sel, size_t n) {
+    switch (op) {
+    case CmpOp::LT: return compact(get, [x](double v) { return v < x; }, sel, n);
+    case CmpOp::LE: return compact(get, [x](double v) { return v <= x; }, sel, n);
+    case CmpOp::GT: return compact(get, [x](double v) { return v > x; }, sel, n);
+    case CmpOp::GE: return compact(get, [x](double v) { return v >= x; }, sel, n);
+    case CmpOp::EQ: return compact(get, [x](double v) { return v == x; }, sel, n);
+    default: return compact(get, [x](double v) { return v != x && !std::isnan(v); }, sel, n);
+    }
+}
+
+size_t filter(const Bound& b, uint32_t* sel, size_t n) {
+    const Column* c = b.src.col;
+    if (c && c->type == ColType::STR) {
+        const uint32_t* codes = c->codes.data();
+        uint32_t code = b.code;
+        auto get = [codes](uint32_t r) { return codes[r]; };
+        if (b.p->op == CmpOp::EQ)
+            return compact(get, [code](uint32_t v) { return v == code; }, sel, n);
+        return compact(get, [code](uint32_t v) { return v != code && v != 0; }, sel, n);
+    }
+    double x = b.p->value;
+    if (c && c->type == ColType::F64) {
+        const double* v = c->f64.data();
+        return keep_if([v](uint32_t r) { return v[r]; }, b.p->op, x, sel, n);
+    }
+    if (c) {
+        const int64_t* v = c->i64.data();
+        return keep_if([v](uint32_t r) { return v[r] == I64_NULL ? NAN : double(v[r]); },
+                       b.p->op, x, sel, n);
+    }
+    const SampleUlp* u = b.src.ulp;
+    return keep_if([u](uint32_t r) { return u->at(r); }, b.p->op, x, sel, n);
+}
+
+// Whether no value in [lo, hi] can satisfy OP x.
+bool zone_excludes(CmpOp op, double x, double lo, double hi) {
+    if (lo > hi)
+        return true;  // only nulls
+    switch (op) {
+    case CmpOp::LT: return !(lo < x);
+    case CmpOp::LE: return !(lo <= x);
+    case CmpOp::GT: return !(hi > x);
+    case CmpOp::GE: return !(hi >= x);
+    case CmpOp::EQ: return !(lo <= x && x <= hi);
+    default: return lo == hi && lo == x;
+    }
+}
+
+uint64_t key_bits(double v) {
+    if (std::isnan(v))
+        v = NAN;
+    else if (v == 0.0)
+        v = 0.0;
+    uint64_t u;
+    memcpy(&u, &v, 8);
+    return u;
+}
+
+struct Job {
+    std::unordered_map<uint64_t, std::pair<double, std::vector<Acc>>> groups;
+    std::vector<Ranked> heap;
+    std::vector<uint32_t> sel;
+    size_t candidates = 0, matched = 0, skipped = 0;
+};
+
+}  // namespace
+
+bool run_query(const ResultStore& store, const QueryIndex* index,
+               const std::vector<uint32_t>* rows, const QuerySpec& spec, unsigned jobs,
+               QueryResult& out, std::string& err) {
+    out = QueryResult();
+    SampleUlp ulp(store);
+    auto resolve = [&](const std::string& name, Source& s) {
+        s.col = store.find(name);
+        s.ulp = !s.col && name == "ulp" ? &ulp : nullptr;
+        if (!s.col && !s.ulp)
+            err = "no column '" + name + "'";
+        return s.col || s.ulp;
+    };
+
+    std::vector<Bound> bounds;
+    for (const auto& p : spec.where) {
+        Bound b{&p, {}, 0};
+        if (!resolve(p.column, b.src))
+            return false;
+        if (b.src.col && b.src.col->type == ColType::STR) {
+            if (p.op != CmpOp::EQ && p.op != CmpOp::NE) {
+                err = "string column '" + p.column + "' only supports = and !=";
+                return false;
+            }
+            b.code = b.src.col->find_code(p.text);
+        } else if (std::isnan(p.value)) {
+            err = "'" + p.text + "' is not a number (column '" + p.column + "')";
+            return false;
+        }
+        bounds.push_back(b);
+    }
+    std::vector<Source> agg(spec.aggs.size());
+    for (size_t a = 0; a < spec.aggs.size(); a++)
+        if (!spec.aggs[a].column.empty() && !resolve(spec.aggs[a].column, agg[a]))
+            return false;
+    Source group, top;
+    if (!spec.group.empty() && !resolve(spec.group, group))
+        return false;
+    if (spec.binade && group.col && group.col->type == ColType::STR) {
+        err = "binade() needs a numeric column";
+        return false;
+    }
+    if (spec.top_k && !resolve(spec.top, top))
+        return false;
+
+    // Candidate rows: the selection, or an index range when one is selective
+    // enough to beat a zone-map scan.
+    const size_t n = store.rows();
+    std::vector<uint32_t> cand;
+    bool listed = rows != nullptr;
+    if (rows) {
+        cand = *rows;
+        out.stats.plan = "selection";
+    } else if (index) {
+        size_t best = n / 4;
+        const QueryIndex::Sorted* use_sorted = nullptr;
+        size_t sb = 0, se = 0;
+        for (const auto& s : index->sorted_) {
+            const Column* c = store.find(s.column);
+            size_t b = 0, e = s.rows.size();
+            bool used = false;
+            for (const auto& bd : bounds) {
+                if (bd.p->column != s.column || bd.p->op == CmpOp::NE)
+                    continue;
+                double x = bd.p->value;
+                auto below = [&](uint32_t r) { return c->num(r) < x; };
+                auto at_most = [&](uint32_t r) { return c->num(r) <= x; };
+                size_t lt = size_t(std::partition_point(s.rows.begin(), s.rows.end(), below) -
+                                   s.rows.begin());
+                size_t le = size_t(std::partition_point(s.rows.begin(), s.rows.end(), at_most) -
+                                   s.rows.begin());
+                switch (bd.p->op) {
+                case CmpOp::LT: e = std::min(e, lt); break;
+                case CmpOp::LE: e = std::min(e, le); break;
+                case CmpOp::GT: b = std::max(b, le); break;
+                case CmpOp::GE: b = std::max(b, lt); break;
+                default: b = std::max(b, lt); e = std::min(e, le); break;
+                }
+                used = true;
+            }
+            e = std::max(b, e);
+            if (used && e - b <= best) {
+                best = e - b;
+                use_sorted = &s;
+                sb = b;
+                se = e;
+            }
+        }
+        std::vector<uint64_t> bits;
+        std::string bits_on;
+        for (const auto& bd : bounds) {
+            const QueryIndex::Bitmap* bm = index->bitmap(bd.p->column);
+            if (!bm || bd.p->op != CmpOp::EQ)
+                continue;
+            if (bits.empty())
+                bits.assign((n + 63) / 64, ~uint64_t(0));
+            for (size_t w = 0; w < bits.size(); w++)
+                bits[w] &= bd.code < bm->bits.size() ? bm->bits[bd.code][w] : 0;
+            bits_on += (bits_on.empty() ? "" : ",") + bd.p->column;
+        }
+        size_t nbits = 0;
+        for (uint64_t w : bits)
+            nbits += size_t(__builtin_popcountll(w));
+        if (!bits.empty() && nbits <= best) {
+            cand.reserve(nbits);
+            for (size_t w = 0; w < bits.size(); w++)
+                for (uint64_t m = bits[w]; m; m &= m - 1)
+                    cand.push_back(uint32_t(w * 64 + size_t(__builtin_ctzll(m))));
+            listed = true;
+            out.stats.plan = "bitmap on " + bits_on;
+        } else if (use_sorted) {
+            cand.assign(use_sorted->rows.begin() + long(sb), use_sorted->rows.begin() + long(se));
+            std::sort(cand.begin(), cand.end());
+            listed = true;
+            out.stats.plan = "sorted index on " + use_sorted->column;
+        }
+    }
+    std::vector<std::pair<const Bound*, const QueryIndex::Zone*>> zoned;
+    if (!listed && index)
+        for (const auto& bd : bounds)
+            if (bd.src.col && bd.src.col->type != ColType::STR)
+                if (const QueryIndex::Zone* z = index->zone(bd.p->column))
+                    zoned.emplace_back(&bd, z);
+    if (!listed)
+        out.stats.plan = zoned.empty() ? "full scan" : "zone maps";
+
+    const size_t total = listed ? cand.size() : n;
+    const size_t nblocks = (total + QueryIndex::BLOCK - 1) / QueryIndex::BLOCK;
+    const bool asc = spec.ascending;
+    auto better = [asc](const Ranked& a, const Ranked& b) {
+        return (asc ? a.first < b.first : a.first > b.first) ||
+               (a.first == b.first && a.second < b.second);
+    };
+    auto group_value = [&](uint32_t r) {
+        if (group.col && group.col->type == ColType::STR)
+            return double(group.col->codes[r]);
+        double v = group.at(r);
+        if (spec.binade)
+            return !std::isfinite(v) ? NAN : v == 0.0 ? -INFINITY : double(std::ilogb(v));
+        return v;
+    };
+
+    std::vector<Job> work(std::max(1u, jobs));
+    parallel_for(nblocks, jobs, [&](size_t b, size_t e, unsigned j) {
+        Job& w = work[j];
+        w.sel.resize(QueryIndex::BLOCK);
+        uint64_t last_key = 0;
+        std::vector<Acc>* last = nullptr;
+        for (size_t k = b; k < e; k++) {
+            size_t lo = k * QueryIndex::BLOCK, hi = std::min(total, lo + QueryIndex::BLOCK);
+            bool skip = false;
+            for (const auto& zb : zoned)
+                skip = skip || zone_excludes(zb.first->p->op, zb.first->p->value,
+                                             zb.second->lo[k], zb.second->hi[k]);
+            if (skip) {
+                w.skipped++;
+                continue;
+            }
+            size_t m = hi - lo;
+            for (size_t i = 0; i < m; i++)
+                w.sel[i] = listed ? cand[lo + i] : uint32_t(lo + i);
+            w.candidates += m;
+            for (const auto& bd : bounds)
+                if (m)
+                    m = filter(bd, w.sel.data(), m);
+            w.matched += m;
+            for (size_t i = 0; i < m; i++) {
+                uint32_t r = w.sel[i];
+                if (!spec.aggs.empty()) {
+                    double g = spec.group.empty() ? 0.0 : group_value(r);
+                    uint64_t key = key_bits(g);
+                    if (!last || key != last_key) {
+                        auto& slot = w.groups[key];
+                        if (slot.second.empty()) {
+                            slot.first = g;
+                            slot.second.resize(spec.aggs.size());
+                        }
+                        last = &slot.second;
+                        last_key = key;
+                    }
+                    for (size_t a = 0; a < agg.size(); a++) {
+                        Acc& acc = (*last)[a];
+                        if (spec.aggs[a].column.empty()) {
+                            acc.n++;
+                            continue;
+                        }
+                        double v = agg[a].at(r);
+                        if (std::isnan(v))
+                            continue;
+                        acc.n++;
+                        acc.min = std::min(acc.min, v);
+                        acc.max = std::max(acc.max, v);
+                        acc.sum += v;
+                    }
+                }
+                if (spec.top_k) {
+                    Ranked cur(top.at(r), r);
+                    if (std::isnan(cur.first))
+                        continue;
+                    if (w.heap.size() < spec.top_k) {
+                        w.heap.push_back(cur);
+                        std::push_heap(w.heap.begin(), w.heap.end(), better);
+                    } else if (better(cur, w.heap.front())) {
+                        std::pop_heap(w.heap.begin(), w.heap.end(), better);
+                        w.heap.back() = cur;
+                        std::push_heap(w.heap.begin(), w.heap.end(), better);
+                    }
+                }
+            }
+        }
+    });
+
+    // Merge the per-job partials.
+    std::unordered_map<uint64_t, std::pair<double, std::vector<Acc>>> groups;
+    std::vector<Ranked> ranked;
+    out.stats.blocks = nblocks;
+    for (auto& w : work) {
+        out.stats.candidates += w.candidates;
+        out.stats.matched += w.matched;
+        out.stats.blocks_skipped += w.skipped;
+        ranked.insert(ranked.end(), w.heap.begin(), w.heap.end());
+        for (auto& g : w.groups) {
+            auto& slot = groups[g.first];
+            if (slot.second.empty()) {
+                slot = std::move(g.second);
+                continue;
+            }
+            for (size_t a = 0; a < slot.second.size(); a++) {
+                Acc& d = slot.second[a];
+                const Acc& s = g.second.second[a];
+                d.n += s.n;
+                d.min = std::min(d.min, s.min);
+                d.max = std::max(d.max, s.max);
+                d.sum += s.sum;
+            }
+        }
+    }
+    if (spec.group.empty() && !spec.aggs.empty() && groups.empty())
+        groups[0] = {0.0, std::vector<Acc>(spec.aggs.size())};
+    std::sort(ranked.begin(), ranked.end(), better);
+    if (ranked.size() > spec.top_k)
+        ranked.resize(spec.top_k);
+    for (const auto& r : ranked)
+        out.top.push_back(r.second);
+
+    bool by_text = group.col && group.col->type == ColType::STR;
+    std::vector<std::pair<double, const std::vector<Acc>*>> order;
+    for (const auto& g : groups)
+        order.emplace_back(g.second.first, &g.second.second);
+    auto label = [&](double g) -> std::string {
+        if (spec.group.empty())
+            return "";
+        if (by_text)
+            return group.col->dict[size_t(g)];
+        if (std::isnan(g))
+            return "";
+        char buf[32];
+        snprintf(buf, sizeof buf, "%.17g", g);
+        return buf;
+    };
+    std::sort(order.begin(), order.end(), [&](const auto& a, const auto& b) {
+        if (by_text)
+            return group.col->dict[size_t(a.first)] < group.col->dict[size_t(b.first)];
+        return a.first < b.first || (!std::isnan(a.first) && std::isnan(b.first));
+    });
+    for (const auto& g : order) {
+        QueryGroup qg;
+        qg.key = label(g.first);
+        for (size_t a = 0; a < spec.aggs.size(); a++) {
+            const Acc& acc = (*g.second)[a];
+            double v = NAN;
+            switch (spec.aggs[a].fn) {
+            case AggFn::COUNT: v = double(acc.n); break;
+            case AggFn::MIN: v = acc.n ? acc.min : NAN; break;
+            case AggFn::MAX: v = acc.n ? acc.max : NAN; break;
+            case AggFn::SUM: v = acc.sum; break;
+            case AggFn::MEAN: v = acc.n ? acc.sum / double(acc.n) : NAN; break;
+            }
+            qg.values.push_back(v);
+        }
+        out.groups.push_back(std::move(qg));
+    }
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "store.hpp"
+
+namespace reu {
+
+/*
+ * Filter / aggregate / top-K scans over a result store, e.g. "rows with
+ * sig_digits < 10", "max ULP per binade of x0" or "the 20 worst points",
+ * without exporting the store to pandas.
+ *
+ * A scan evaluates its predicates a block of rows at a time, one predicate
+ * over the whole block before the next, narrowing a list of surviving rows,
+ * and aggregates into per-thread accumulators merged at the end. Blocks are
+ * spread over the worker threads.
+ *
+ * QueryIndex holds the secondary structures that let a scan avoid rows:
+ *   - zone maps: min / max of every numeric column per block; a block whose
+ *     range cannot satisfy a range predicate is skipped whole, which prunes
+ *     well on sweeps ingested in input order;
+ *   - sorted indices (numeric columns, on request): rows in value order, so
+ *     a selective range predicate is two binary searches;
+ *   - bitmaps (string columns, on request): one bit per row and value, for
+ *     equality predicates on kernel, config, box, ...
+ * `rstore index` saves them next to the store; they are only used while the
+ * store has the row count and modification time they were built for.
+ *
+ * The derived column "ulp" (SampleUlp) can be used wherever a column can,
+ * unless the store has a real column of that name.
+ */
+enum class CmpOp { LT, LE, GT, GE, EQ, NE };
+
+struct Predicate {
+    std::string column;
+    CmpOp op = CmpOp::EQ;
+    double value = 0.0;  // numeric columns
+    std::string text;    // string columns (= and != only)
+};
+
+enum class AggFn { COUNT, MIN, MAX, SUM, MEAN };
+
+struct Aggregate {
+    AggFn fn = AggFn::COUNT;
+    std::string column;  // empty for count of rows
+
+    std::string label() const;
+};
+
+struct QuerySpec {
+    std::vector<Predicate> where;  // ANDed
+    std::string group;             // group column, empty for a single group
+    bool binade = false;           // group by floor(log2 |value|)
+    std::vector<Aggregate> aggs;
+    std::string top;               // column to rank by, empty for none
+    size_t top_k = 0;
+    bool ascending = false;        // the K smallest instead of the K largest
+};
+
+struct QueryGroup {
+    std::string key;
+    std::vector<double> values;  // one per aggregate, NaN if no value
+};
+
+struct QueryStats {
+    size_t candidates = 0;      // rows the predicates were evaluated on
+    size_t matched = 0;
+    size_t blocks = 0;
+    size_t blocks_skipped = 0;  // by zone maps
+    std::string plan;
+};
+
+struct QueryResult {
+    std::vector<QueryGroup> groups;  // in key order
+    std::vector<uint32_t> top;       // best first
+    QueryStats stats;
+};
+
+// "sig_digits<10,precision=24,kernel!=ex1_original"
+bool parse_predicates(const std::string& expr, std::vector<Predicate>& out, std::string& err);
+// "count,max(ulp),mean(sig_digits)"
+bool parse_aggregates(const std::string& list, std::vector<Aggregate>& out, std::string& err);
+
+class QueryIndex {
+public:
+    static constexpr uint32_t BLOCK = 8192;  // rows per zone-map block
+
+    // Zone maps over every numeric column, plus sorted indices (numeric) or
+    // bitmaps (string) over the `indexed` columns. stamp identifies the
+    // store file version (its modification time).
+    bool build(const ResultStore& store, const std::vector<std::string>& indexed, int64_t stamp,
+               unsigned jobs, std::string& err);
+
+    bool save(const std::string& path, std::string& err) const;
+    static bool load(const std::string& path, QueryIndex& out, std::string& err);
+
+    bool matches(const ResultStore& store, int64_t stamp) const {
+        return rows_ == store.rows() && stamp_ == stamp;
+    }
+    // Names of the sorted and bitmap indexed columns.
+    std::vector<std::string> indexed() const;
+
+private:
+    friend bool run_query(const ResultStore&, const QueryIndex*, const std::vector<uint32_t>*,
+                          const QuerySpec&, unsigned, QueryResult&, std::string&);
+
+    struct Zone {
+        std::string column;
+        std::vector<double> lo, hi;  // per block, +inf / -inf if all null
+    };
+    struct Sorted {
+        std::string column;
+        std::vector<uint32_t> rows;  // non-null rows by ascending value
+    };
+    struct Bitmap {
+        std::string column;
+        std::vector<std::vector<uint64_t>> bits;  // per dictionary code
+    };
+
+    const Zone* zone(const std::string& column) const;
+    const Bitmap* bitmap(const std::string& column) const;
+
+    uint64_t rows_ = 0;
+    int64_t stamp_ = 0;
+    std::vector<Zone> zones_;
+    std::vector<Sorted> sorted_;
+    std::vector<Bitmap> bitmaps_;
+};
+
+/*
+ * Run spec over the rows of `rows` (a sorted selection), or over the whole
+ * store if rows is null. index may be null; it must match the store.
+ */
+bool run_query(const ResultStore& store, const QueryIndex* index,
+               const std::vector<uint32_t>* rows, const QuerySpec& spec, unsigned jobs,
+               QueryResult& out, std::string& err);
+
+}  // namespace reu
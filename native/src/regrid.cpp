@@ -0,0 +1,217 @@
+#include "regrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "parallel.hpp"
+
+namespace reu {
+
+static const Column* numeric_column(const ResultStore& store, const std::string& name,
+                                    std::string& err) {
+    const Column* c = store.find(name);
+    if (!c || c->type == ColType::STR) {
+        err = "no numeric column '" + name + "'";
+        return nullptr;
+    }
+    return c;
+}
+
+bool infer_axis(const ResultStore& store, const std::vector<uint32_t>& rows, Axis& ax,
+                std::string& err) {
+    const Column* c = numeric_column(store, ax.name, err);
+    if (!c)
+        return false;
+    if (!std::isnan(ax.lo) && !std::isnan(ax.hi) && !std::isnan(ax.step))
+        return true;
+    std::vector<double> v;
+    v.reserve(rows.size());
+    for (uint32_t r : rows) {
+        double x = c->num(r);
+        if (!std::isnan(x))
+            v.push_back(x);
+    }
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+    if (v.empty()) {
+        err = "no values in '" + ax.name + "'";
+        return false;
+    }
+    if (std::isnan(ax.lo))
+        ax.lo = v.front();
+    if (std::isnan(ax.hi))
+        ax.hi = v.back();
+    if (std::isnan(ax.step)) {
+        // Gaps this small are rounding noise in one coordinate, not a step.
+        double noise = AXIS_NOISE * (v.back() - v.front());
+        double gap = INFINITY;
+        for (size_t i = 1; i < v.size(); i++)
+            if (v[i] - v[i - 1] > noise)
+                gap = std::min(gap, v[i] - v[i - 1]);
+        ax.step = std::isfinite(gap) ? gap : 0.0;
+    }
+    if (!(ax.lo <= ax.hi) || ax.step < 0.0) {
+        err = "empty range on '" + ax.name + "'";
+        return false;
+    }
+    return true;
+}
+
+bool regrid(const ResultStore& store, const std::vector<uint32_t>& rows,
+            const std::vector<Axis>& axes, const std::vector<std::string>& values,
+            Reduce reduce, unsigned jobs, std::vector<std::vector<double>>& out,
+            std::vector<uint32_t>& count, RegridStats& stats, std::string& err) {
+    if (axes.empty() || values.empty()) {
+        err = "regridding needs at least one axis and one value";
+        return false;
+    }
+    std::vector<const Column*> ac, vc;
+    size_t nodes = 1;
+    double total = 1.0;  // nodes in double, which cannot overflow
+    for (const auto& a : axes) {
+        ac.push_back(numeric_column(store, a.name, err));
+        if (!ac.back())
+            return false;
+        total *= a.hi > a.lo && a.step > 0.0 ? std::floor((a.hi - a.lo) / a.step + 0.5) + 1 : 1;
+        if (!(total <= double(MAX_REGRID_NODES))) {
+            char buf[160];
+            snprintf(buf, sizeof buf,
+                     "grid has %.3g nodes, more than %zu; give the axes a coarser step", total,
+                     MAX_REGRID_NODES);
+            err = buf;
+            return false;
+        }
+        nodes *= a.size();
+    }
+    for (const auto& v : values) {
+        vc.push_back(numeric_column(store, v, err));
+        if (!vc.back())
+            return false;
+    }
+    size_t nv = values.size();
+
+    if (jobs == 0)
+        jobs = 1;
+    jobs = unsigned(std::min<size_t>(jobs, rows.size() / 4096 + 1));
+    double init = reduce == Reduce::MAX ? -INFINITY : reduce == Reduce::MIN ? INFINITY : 0.0;
+    struct Part {
+        std::vector<double> acc;     // node-major, nv per node
+        std::vector<uint32_t> hits;  // rows per node
+        std::vector<uint32_t> used;  // value samples per node and value (mean)
+        RegridStats stats;
+    };
+    std::vector<Part> parts(jobs);
+
+    parallel_for(rows.size(), jobs, [&](size_t b, size_t e, unsigned j) {
+        Part& p = parts[j];
+        p.acc.assign(nodes * nv, init);
+        p.hits.assign(nodes, 0);
+        p.used.assign(nodes * nv, 0);
+        for (size_t i = b; i < e; i++) {
+            uint32_t r = rows[i];
+            size_t node = 0, stride = 1;
+            bool inside = true, on_grid = true;
+            for (size_t d = 0; d < axes.size() && inside; d++) {
+                const Axis& a = axes[d];
+                double x = ac[d]->num(r);
+                double tol = a.step > 0 ? 1e-3 * a.step : 1e-9 * std::max(1.0, std::fabs(a.lo));
+                if (!(x >= a.lo - tol && x <= a.hi + tol)) {
+                    inside = false;
+                    break;
+                }
+                size_t k = a.step > 0 ? size_t(std::llround((x - a.lo) / a.step)) : 0;
+                k = std::min(k, a.size() - 1);
+                if (std::fabs(x - a.value(k)) > tol)
+                    on_grid = false;
+                node += k * stride;
+                stride *= a.size();
+            }
+            if (!inside) {
+                p.stats.outside++;
+                continue;
+            }
+            if (!on_grid) {
+                p.stats.off_grid++;
+                continue;
+            }
+            p.stats.rows++;
+            p.hits[node]++;
+            for (size_t v = 0; v < nv; v++) {
+                double y = vc[v]->num(r);
+                if (std::isnan(y))
+                    continue;
+                double& a = p.acc[node * nv + v];
+                a = reduce == Reduce::MAX ? std::max(a, y)
+                    : reduce == Reduce::MIN ? std::min(a, y)
+                                            : a + y;
+                p.used[node * nv + v]++;
+            }
+        }
+    });
+
+    // Merge the per-job accumulators into value-major output arrays.
+    out.assign(nv, std::vector<double>(nodes, NAN));
+    count.assign(nodes, 0);
+    stats = RegridStats();
+    for (const Part& p : parts) {
+        stats.rows += p.stats.rows;
+        stats.off_grid += p.stats.off_grid;
+        stats.outside += p.stats.outside;
+    }
+    for (size_t n = 0; n < nodes; n++) {
+        for (const Part& p : parts)
+            count[n] += p.hits[n];
+        for (size_t v = 0; v < nv; v++) {
+            double acc = init;
+            uint32_t used = 0;
+            for (const Part& p : parts) {
+                double a = p.acc[n * nv + v];
+                acc = reduce == Reduce::MAX ? std::max(acc, a)
+                      : reduce == Reduce::MIN ? std::min(acc, a)
+                                              : acc + a;
+                used += p.used[n * nv + v];
+            }
+            if (used)
+                out[v][n] = reduce == Reduce::MEAN ? acc / double(used) : acc;
+        }
+    }
+    return true;
+}
+
+bool write_npy(const std::string& path, const void* data, const char* descr, size_t elem,
+               const std::vector<size_t>& shape, std::string& err) {
+    std::string dims;
+    size_t n = 1;
+    for (size_t s : shape) {
+        dims += std::to_string(s) + ", ";
+        n *= s;
+    }
+    if (shape.size() > 1)
+        dims.resize(dims.size() - 2);
+    std::string header = "{'descr': '" + std::string(descr) +
+                         "', 'fortran_order': False, 'shape': (" + dims + "), }";
+    // Magic, version and length take 10 bytes; pad the whole to 64 bytes.
+    size_t total = 10 + header.size() + 1;
+    header.append((64 - total % 64) % 64, ' ');
+    header += '\n';
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        err = "cannot write '" + path + "'";
+        return false;
+    }
+    unsigned char pre[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                             (unsigned char)(header.size() & 0xff),
+                             (unsigned char)(header.size() >> 8)};
+    bool ok = fwrite(pre, 1, 10, f) == 10 &&
+              fwrite(header.data(), 1, header.size(), f) == header.size() &&
+              fwrite(data, elem, n, f) == n;
+    if (fclose(f) != 0 || !ok) {
+        err = "cannot write '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "grid.hpp"
+#include "store.hpp"
+
+namespace reu {
+
+/*
+ * Dense arrays from keyed store rows: every selected row whose coordinates
+ * land on a node of a regular grid (within 1e-3 step per axis) contributes
+ * its value columns to that node. The grid may be any regular sub-grid of
+ * the sweep, including a coarser stride or a window, and sweeps need not be
+ * square or complete; nodes without rows stay NaN with count 0.
+ *
+ * Arrays are indexed with the first axis fastest, so a 2D result read as
+ * C-order has shape (n_y, n_x) and a[iy][ix] is ready for imshow.
+ */
+enum class Reduce { MAX, MIN, MEAN };
+
+struct RegridStats {
+    size_t rows = 0;      // rows that landed on a node
+    size_t off_grid = 0;  // rows inside the bounds but between nodes
+    size_t outside = 0;   // rows outside the bounds or with null coordinates
+};
+
+// Largest grid regrid() allocates; more is an error.
+constexpr size_t MAX_REGRID_NODES = size_t(1) << 28;
+
+// Gaps below this fraction of an axis's span are noise to infer_axis.
+constexpr double AXIS_NOISE = 1e-6;
+
+/*
+ * Fill in the parts of an axis left NaN from the distinct values of its
+ * column over rows: lo and hi from the extremes and step from the smallest
+ * gap above AXIS_NOISE of the span, so a complete sweep maps onto itself
+ * even when a coordinate was written with rounding noise.
+ */
+bool infer_axis(const ResultStore& store, const std::vector<uint32_t>& rows, Axis& ax,
+                std::string& err);
+
+// out[v] has one entry per node for values[v]; count holds the rows per node.
+bool regrid(const ResultStore& store, const std::vector<uint32_t>& rows,
+            const std::vector<Axis>& axes, const std::vector<std::string>& values,
+            Reduce reduce, unsigned jobs, std::vector<std::vector<double>>& out,
+            std::vector<uint32_t>& count, RegridStats& stats, std::string& err);
+
+/*
+ * Write a C-order .npy file (format 1.0). descr is the numpy type string,
+ * e.g. "<f8" for double or "<u4" for uint32_t.
+ */
+bool write_npy(const std::string& path, const void* data, const char* descr, size_t elem,
+               const std::vector<size_t>& shape, std::string& err);
+
+}  // namespace reu
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+
+namespace reu {
+
+inline uint32_t rotl32(uint32_t x, unsigned r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+struct U32x2 {
+    uint32_t a, b;
+};
+
+/**
+ * @brief Threefry-2x32 with 20 rounds (Salmon et al., SC'11).
+ *
+ * Counter-based: the output is a pure function of (key, counter), so any
+ * random draw can be regenerated without replaying a stream, and results do
+ * not depend on how work is split between threads. Only add/rotate/xor on
+ * 32-bit lanes, so loops over counters auto-vectorize.
+ */
+inline U32x2 threefry2x32(uint64_t key, uint64_t ctr) {
+    constexpr unsigned R[8] = {13, 15, 26, 6, 17, 29, 16, 24};
+    const uint32_t ks[3] = {uint32_t(key), uint32_t(key >> 32),
+                            0x1BD11BDAu ^ uint32_t(key) ^ uint32_t(key >> 32)};
+    uint32_t x0 = uint32_t(ctr) + ks[0];
+    uint32_t x1 = uint32_t(ctr >> 32) + ks[1];
+    for (unsigned i = 0; i < 5; i++) {
+        for (unsigned j = 0; j < 4; j++) {
+            x0 += x1;
+            x1 = rotl32(x1, R[(4 * i + j) % 8]);
+            x1 ^= x0;
+        }
+        x0 += ks[(i + 1) % 3];
+        x1 += ks[(i + 2) % 3] + i + 1;
+    }
+    return {x0, x1};
+}
+
+// Uniform in [0, 1) with 24 (float) or 53 (double) random bits.
+inline float u01f(uint32_t r) { return float(r >> 8) * 0x1p-24f; }
+inline double u01(uint64_t r) { return double(r >> 11) * 0x1p-53; }
+
+// Sequential view of a counter-based stream starting at ctr.
+struct CounterRng {
+    uint64_t key = 0;
+    uint64_t ctr = 0;
+
+    CounterRng() = default;
+    CounterRng(uint64_t k, uint64_t c) : key(k), ctr(c) {}
+
+    uint32_t next_u32() { return threefry2x32(key, ctr++).a; }
+    uint64_t next_u64() {
+        U32x2 r = threefry2x32(key, ctr++);
+        return (uint64_t(r.b) << 32) | r.a;
+    }
+    double uniform() { return u01(next_u64()); }
+};
+
+}  // namespace reu
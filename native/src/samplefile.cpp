@@ -0,0 +1,119 @@
+#include "samplefile.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace reu {
+
+static const char MAGIC[8] = {'R', 'S', 'M', 'P', 'L', '0', '1', '\0'};
+
+bool write_samples(const std::string& path, const SampleFile& sf, const CodecOptions& opt,
+                   unsigned jobs, std::string& err) {
+    size_t n_in = sf.inputs.size(), n_out = size_t(sf.n_out), ns = size_t(sf.samples);
+    if (sf.x.size() != sf.points * n_in || sf.y.size() != sf.points * ns * n_out) {
+        err = "sample arrays do not match the point count";
+        return false;
+    }
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        err = "Cannot write '" + path + "'";
+        return false;
+    }
+    auto put = [f](const void* p, size_t n) { fwrite(p, 1, n, f); };
+    auto put_stream = [&](const std::vector<double>& v) {
+        std::vector<uint8_t> z;
+        encode_doubles(v.data(), v.size(), opt, jobs, z);
+        uint64_t len = z.size();
+        put(&len, 8);
+        put(z.data(), z.size());
+    };
+    uint32_t hdr[3] = {uint32_t(n_in), uint32_t(n_out), uint32_t(ns)};
+    uint64_t points = sf.points;
+    put(MAGIC, 8);
+    put(hdr, sizeof hdr);
+    put(&points, 8);
+    for (const auto& name : sf.inputs) {
+        uint32_t n = uint32_t(name.size());
+        put(&n, 4);
+        put(name.data(), n);
+    }
+    // Columns: one stream per input and per output.
+    std::vector<double> col;
+    for (size_t d = 0; d < n_in; d++) {
+        col.resize(sf.points);
+        for (size_t p = 0; p < sf.points; p++)
+            col[p] = sf.x[p * n_in + d];
+        put_stream(col);
+    }
+    for (size_t o = 0; o < n_out; o++) {
+        col.resize(sf.points * ns);
+        for (size_t i = 0; i < sf.points * ns; i++)
+            col[i] = sf.y[i * n_out + o];
+        put_stream(col);
+    }
+    bool ok = !ferror(f);
+    if (fclose(f) != 0 || !ok) {
+        err = "Failed writing '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+bool read_samples(const std::string& path, SampleFile& sf, unsigned jobs, std::string& err) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    auto get = [f](void* p, size_t n) { return fread(p, 1, n, f) == n; };
+    auto get_stream = [&](size_t expect, std::vector<double>& v) {
+        uint64_t len;
+        if (!get(&len, 8) || len > (uint64_t(1) << 40))
+            return false;
+        std::vector<uint8_t> z(len);
+        return get(z.data(), len) && decode_doubles(z.data(), len, jobs, v, err) &&
+               v.size() == expect;
+    };
+    char magic[8];
+    uint32_t hdr[3];
+    uint64_t points = 0;
+    bool ok = get(magic, 8) && memcmp(magic, MAGIC, 8) == 0 && get(hdr, sizeof hdr) &&
+              get(&points, 8) && hdr[1] >= 1 && hdr[2] >= 1;
+    sf = SampleFile();
+    for (uint32_t d = 0; ok && d < hdr[0]; d++) {
+        uint32_t n;
+        ok = get(&n, 4) && n < 4096;
+        std::string name(ok ? n : 0, '\0');
+        ok = ok && (n == 0 || get(&name[0], n));
+        sf.inputs.push_back(name);
+    }
+    if (ok) {
+        sf.n_out = int(hdr[1]);
+        sf.samples = int(hdr[2]);
+        sf.points = size_t(points);
+        size_t n_in = hdr[0], n_out = hdr[1], ns = hdr[2];
+        std::vector<double> col;
+        sf.x.resize(sf.points * n_in);
+        for (size_t d = 0; ok && d < n_in; d++) {
+            ok = get_stream(sf.points, col);
+            for (size_t p = 0; ok && p < sf.points; p++)
+                sf.x[p * n_in + d] = col[p];
+        }
+        sf.y.resize(sf.points * ns * n_out);
+        for (size_t o = 0; ok && o < n_out; o++) {
+            ok = get_stream(sf.points * ns, col);
+            for (size_t i = 0; ok && i < sf.points * ns; i++)
+                sf.y[i * n_out + o] = col[i];
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        err = "'" + path + "' is not a valid sample file" + (err.empty() ? "" : ": " + err);
+        sf = SampleFile();
+        return false;
+    }
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "floatcodec.hpp"
+
+namespace reu {
+
+/*
+ * Raw sweep samples in binary form (.rsmp), the compressed counterpart of
+ * a .tab file: fpsweep -Z writes one, and rstore ingest reads it like the
+ * .tab of the same name. Inputs and outputs are stored as floatcodec
+ * streams, each output point-major with the samples of a point adjacent,
+ * which is where the XOR coding finds its near-identical neighbours.
+ *
+ * File layout (little endian):
+ *   "RSMPL01\0"  u32 n_in  u32 n_out  u32 samples  u64 points
+ *   n_in input names (u32 length, bytes)
+ *   n_in input streams (points values), n_out output streams
+ *   (points * samples values), each as u64 length and the stream
+ */
+struct SampleFile {
+    std::vector<std::string> inputs;  // x0, x1, ...
+    int n_out = 1;
+    int samples = 1;
+    size_t points = 0;
+    std::vector<double> x;  // points * n_in, point-major
+    std::vector<double> y;  // points * samples * n_out, point, then sample, then output
+};
+
+bool write_samples(const std::string& path, const SampleFile& sf, const CodecOptions& opt,
+                   unsigned jobs, std::string& err);
+bool read_samples(const std::string& path, SampleFile& sf, unsigned jobs, std::string& err);
+
+}  // namespace reu
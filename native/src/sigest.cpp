@@ -0,0 +1,113 @@
+#include "sigest.hpp"
+
+#include <algorithm>
+
+#include "stats.hpp"
+
+namespace reu {
+
+uint64_t bernoulli_min_samples(const SigLevel& level) {
+    double n = std::log(1.0 - level.confidence) / std::log(level.probability);
+    return uint64_t(std::ceil(n - 1e-9));
+}
+
+double cnh_penalty_bits(const SigLevel& level, double df, bool upper) {
+    double alpha = 1.0 - level.confidence;
+    double chi2 = chi2_quantile(upper ? 1.0 - alpha : alpha, df);
+    return 0.5 * std::log2(df / chi2) +
+           std::log2(normal_quantile(0.5 * (1.0 + level.probability)));
+}
+
+SigEstimator::SigEstimator(const SigLevel& level, double cap_bits, double ref)
+    : level_(level), cap_(cap_bits), ref_(ref) {
+    if (!std::isnan(ref_))
+        hits_.assign(size_t(cap_) + 1, 0);
+}
+
+int SigEstimator::whole_bits(double y, double ref) const {
+    if (!std::isfinite(y))
+        return 0;
+    double d = std::fabs(y - ref);
+    if (d == 0.0)
+        return int(cap_);
+    if (ref == 0.0)
+        return 0;
+    double b = -std::log2(d / std::fabs(ref));
+    return b <= 0.0 ? 0 : b >= cap_ ? int(cap_) : int(b);
+}
+
+void SigEstimator::add(double y) {
+    n_++;
+    finite_ = finite_ && std::isfinite(y);
+    double delta = y - mean_;
+    mean_ += delta / double(n_);
+    m2_ += delta * (y - mean_);
+    if (std::isnan(ref_)) {
+        y_.push_back(y);
+    } else {
+        sq_ += (y - ref_) * (y - ref_);
+        hits_[size_t(whole_bits(y, ref_))]++;
+    }
+}
+
+double SigEstimator::cnh(bool upper) const {
+    bool known = !std::isnan(ref_);
+    double df = known ? double(n_) : double(n_) - 1.0;
+    if (df < 1.0)
+        return NAN;
+    if (!finite_)
+        return 0.0;
+    double sigma = known ? std::sqrt(sq_ / df)
+                         : std::sqrt(m2_ / df * (1.0 + 1.0 / double(n_)));
+    double ref = known ? ref_ : mean_;
+    if (sigma == 0.0)
+        return cap_;
+    if (ref == 0.0)
+        return 0.0;
+    double s = -std::log2(sigma / std::fabs(ref)) - cnh_penalty_bits(level_, df, upper);
+    return s <= 0.0 ? 0.0 : s > cap_ ? cap_ : s;
+}
+
+double SigEstimator::cnh_bits() const {
+    return cnh(false);
+}
+
+double SigEstimator::bernoulli_bits() const {
+    // Fewest of n samples that must reach k bits: the smallest m with
+    // P(Binomial(n, p) >= m) = I_p(m, n - m + 1) <= 1 - c.
+    // The tail falls with m and m = n qualifies once p^n <= 1 - c: bisect.
+    double alpha = 1.0 - level_.confidence, p = level_.probability;
+    uint64_t n = n_;
+    if (n == 0 || std::pow(p, double(n)) > alpha)
+        return NAN;
+    uint64_t lo = 1, need = n;
+    while (lo < need) {
+        uint64_t m = lo + (need - lo) / 2;
+        if (incomplete_beta(double(m), double(n - m + 1), p) <= alpha)
+            need = m;
+        else
+            lo = m + 1;
+    }
+    std::vector<uint64_t> hits = hits_;
+    if (std::isnan(ref_)) {
+        hits.assign(size_t(cap_) + 1, 0);
+        for (double y : y_)
+            hits[size_t(whole_bits(y, mean_))]++;
+    }
+    uint64_t seen = 0;
+    for (size_t k = hits.size(); k-- > 0;) {
+        seen += hits[k];
+        if (seen >= need)
+            return double(k);
+    }
+    return 0.0;
+}
+
+bool SigEstimator::decided(double target_bits) const {
+    double lo = cnh(false);
+    if (std::isnan(lo))
+        return false;
+    return lo >= target_bits || cnh(true) < target_bits;
+}
+
+}  // namespace reu
@@ -0,0 +1,87 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Significant bits of Monte Carlo samples at a stated probability and
+ * confidence, after Sohier et al., "Confidence intervals for stochastic
+ * arithmetic" (ACM TOMS 47, 2021). "s bits at probability p and confidence
+ * c" means: with confidence c, a fresh sample agrees with the reference to
+ * s bits with probability at least p. Unlike -log10(sigma / |mu|) the
+ * estimate pays for a small sample: few samples give fewer, but sound, bits.
+ *
+ * The reference is the exact result when one is known (an oracle), else
+ * the sample mean.
+ *
+ * - CNH (centered normal hypothesis): errors are normal around the
+ *   reference. s = -log2(sigma / |ref|) minus a penalty combining the
+ *   chi-square upper bound on sigma at confidence c and the normal quantile
+ *   of p. Against the sample mean, sigma also covers the mean's own error
+ *   (a factor sqrt(1 + 1/n)) and loses a degree of freedom.
+ * - Bernoulli: no assumption on the distribution. s is the largest whole
+ *   number of bits k such that the Clopper-Pearson bound on P(a sample has
+ *   k bits) is at least p at confidence c. It needs p^n <= 1 - c, i.e.
+ *   bernoulli_min_samples(), before it says anything.
+ */
+struct SigLevel {
+    double probability = 0.9;
+    double confidence = 0.95;
+};
+
+// Samples the Bernoulli estimator needs at `level` (29 at the default).
+uint64_t bernoulli_min_samples(const SigLevel& level);
+
+/*
+ * Bits the CNH estimate loses at `level` with df degrees of freedom. The
+ * upper penalty is that of the optimistic end of the confidence interval,
+ * for telling whether more samples can still change a decision.
+ */
+double cnh_penalty_bits(const SigLevel& level, double df, bool upper = false);
+
+/*
+ * Streaming estimator of one output of one input point: add() each sample
+ * as it is drawn and read the estimates at any time. Bits are capped at
+ * cap_bits (the precision of the arithmetic sampled) and floored at 0; any
+ * non-finite sample gives 0. Against a known reference the state is O(cap);
+ * against the sample mean the Bernoulli count needs the final mean, so the
+ * samples are kept.
+ */
+class SigEstimator {
+public:
+    explicit SigEstimator(const SigLevel& level = SigLevel(), double cap_bits = 53,
+                          double ref = NAN);
+
+    void add(double y);
+    uint64_t count() const { return n_; }
+    double mean() const { return n_ ? mean_ : NAN; }
+
+    // NaN with fewer than two samples (one against a known reference).
+    double cnh_bits() const;
+    // NaN below bernoulli_min_samples().
+    double bernoulli_bits() const;
+
+    /*
+     * Adaptive stopping: true once the CNH bits are known to be on one side
+     * of target_bits at the confidence, that is when the estimate already
+     * reaches the target or its optimistic end falls short of it.
+     */
+    bool decided(double target_bits) const;
+
+private:
+    double cnh(bool upper) const;
+    int whole_bits(double y, double ref) const;
+
+    SigLevel level_;
+    double cap_, ref_;
+    uint64_t n_ = 0;
+    bool finite_ = true;
+    double mean_ = 0, m2_ = 0;  // Welford
+    double sq_ = 0;             // sum of (y - ref)^2, known reference
+    std::vector<uint64_t> hits_;  // known reference: samples by whole bits, 0..cap
+    std::vector<double> y_;       // sample-mean reference
+};
+
+}  // namespace reu
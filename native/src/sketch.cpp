@@ -0,0 +1,187 @@
+#include "sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace reu {
+
+namespace {
+
+constexpr int SHIFT = 52 - QuantileSketch::SUB_BITS;
+
+// Bucket of |v| > 0: exponent and top mantissa bits, monotonic in |v|.
+inline int32_t bucket_key(double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, 8);
+    return int32_t((bits & ~(uint64_t(1) << 63)) >> SHIFT);
+}
+
+inline double bucket_edge(int64_t key) {
+    uint64_t bits = uint64_t(key) << SHIFT;
+    double v;
+    memcpy(&v, &bits, 8);
+    return v;
+}
+
+// Magnitude standing for a bucket: its midpoint (the infinity bucket is inf).
+inline double bucket_mid(int32_t key) {
+    double lo = bucket_edge(key), hi = bucket_edge(int64_t(key) + 1);
+    return std::isinf(lo) ? lo : lo + (hi - lo) / 2;
+}
+
+void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += char(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out += char(uint8_t(v));
+}
+
+bool get_varint(const uint8_t*& p, const uint8_t* e, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < e && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+void QuantileSketch::Half::add(int32_t key, uint64_t n) {
+    if (counts.empty()) {
+        base = key;
+        counts.assign(1, 0);
+    } else if (key < base) {
+        counts.insert(counts.begin(), size_t(base - key), 0);
+        base = key;
+    } else if (size_t(key - base) >= counts.size()) {
+        counts.resize(size_t(key - base) + 1, 0);
+    }
+    counts[size_t(key - base)] += n;
+}
+
+void QuantileSketch::add(double v) {
+    if (std::isnan(v)) {
+        nan_++;
+        return;
+    }
+    count_++;
+    sum_ += v;
+    min_ = v < min_ ? v : min_;
+    max_ = v > max_ ? v : max_;
+    if (v == 0)
+        zero_++;
+    else
+        (v > 0 ? pos_ : neg_).add(bucket_key(v), 1);
+}
+
+void QuantileSketch::merge(const QuantileSketch& o) {
+    for (Half* h : {&pos_, &neg_}) {
+        const Half& src = h == &pos_ ? o.pos_ : o.neg_;
+        for (size_t i = 0; i < src.counts.size(); i++)
+            if (src.counts[i])
+                h->add(src.base + int32_t(i), src.counts[i]);
+    }
+    count_ += o.count_;
+    zero_ += o.zero_;
+    nan_ += o.nan_;
+    sum_ += o.sum_;
+    min_ = std::min(min_, o.min_);
+    max_ = std::max(max_, o.max_);
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (count_ == 0)
+        return NAN;
+    if (q <= 0)
+        return min_;
+    if (q >= 1)
+        return max_;
+    // The value of rank ceil(q * count) (1-based), walked from the most negative.
+    uint64_t rank = uint64_t(std::ceil(q * double(count_)));
+    rank = rank < 1 ? 1 : rank;
+    double v = max_;
+    uint64_t seen = 0;
+    bool found = false;
+    for (size_t i = neg_.counts.size(); i-- > 0 && !found;) {
+        seen += neg_.counts[i];
+        if (seen >= rank) {
+            v = -bucket_mid(neg_.base + int32_t(i));
+            found = true;
+        }
+    }
+    if (!found && (seen += zero_) >= rank) {
+        v = 0;
+        found = true;
+    }
+    for (size_t i = 0; i < pos_.counts.size() && !found; i++) {
+        seen += pos_.counts[i];
+        if (seen >= rank) {
+            v = bucket_mid(pos_.base + int32_t(i));
+            found = true;
+        }
+    }
+    return std::min(std::max(v, min_), max_);
+}
+
+void QuantileSketch::encode(std::string& out) const {
+    out += char(1);  // version
+    out += char(SUB_BITS);
+    put_varint(out, count_);
+    put_varint(out, zero_);
+    put_varint(out, nan_);
+    for (double d : {min_, max_, sum_})
+        out.append(reinterpret_cast<const char*>(&d), 8);
+    // Per sign: the non-empty buckets as (key gap, count) pairs.
+    for (const Half* h : {&pos_, &neg_}) {
+        size_t used = size_t(std::count_if(h->counts.begin(), h->counts.end(),
+                                           [](uint64_t c) { return c != 0; }));
+        put_varint(out, used);
+        int64_t prev = 0;
+        for (size_t i = 0; i < h->counts.size(); i++) {
+            if (!h->counts[i])
+                continue;
+            int64_t key = h->base + int64_t(i);
+            put_varint(out, uint64_t(key - prev));
+            put_varint(out, h->counts[i]);
+            prev = key;
+        }
+    }
+}
+
+bool QuantileSketch::decode(const uint8_t*& p, const uint8_t* e) {
+    *this = QuantileSketch();
+    if (e - p < 2 || p[0] != 1 || p[1] != SUB_BITS)
+        return false;
+    p += 2;
+    if (!get_varint(p, e, count_) || !get_varint(p, e, zero_) || !get_varint(p, e, nan_) ||
+        e - p < 24)
+        return false;
+    for (double* d : {&min_, &max_, &sum_}) {
+        memcpy(d, p, 8);
+        p += 8;
+    }
+    uint64_t total = zero_;
+    for (Half* h : {&pos_, &neg_}) {
+        uint64_t used, gap, n;
+        if (!get_varint(p, e, used))
+            return false;
+        int64_t key = 0;
+        for (uint64_t i = 0; i < used; i++) {
+            if (!get_varint(p, e, gap) || !get_varint(p, e, n) || (i && gap == 0))
+                return false;
+            key += int64_t(gap);
+            if (key >= (int64_t(1) << (63 - SHIFT)))
+                return false;
+            h->add(int32_t(key), n);
+            total += n;
+        }
+    }
+    return total == count_;
+}
+
+}  // namespace reu
@@ -0,0 +1,58 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Mergeable quantile sketch of an error distribution (ULPs, significant
+ * digits), after HdrHistogram: a value is counted in a log-linear bucket
+ * taken straight from the top bits of its double, 2^SUB_BITS buckets per
+ * binade. Any quantile is then within 2^-(SUB_BITS + 1) (0.4%) relative
+ * error of the exact sample quantile. Zeros, which exact samples produce
+ * in bulk, have their own count.
+ *
+ * Counts are exact and add, so sketches kept per worker, per file or per
+ * run merge losslessly and in any order. Memory is one counter per bucket
+ * between the smallest and largest binade seen (per sign), a few KiB for a
+ * typical ULP distribution, however many samples go in.
+ */
+class QuantileSketch {
+public:
+    static constexpr int SUB_BITS = 7;
+
+    void add(double v);
+    void merge(const QuantileSketch& other);
+
+    uint64_t count() const { return count_; }  // values other than NaN
+    uint64_t nan_count() const { return nan_; }
+    bool empty() const { return count_ == 0; }
+    double min() const { return count_ ? min_ : NAN; }
+    double max() const { return count_ ? max_ : NAN; }
+    double mean() const { return count_ ? sum_ / double(count_) : NAN; }
+    // q in [0, 1]; NaN when empty. q = 0 and 1 are the exact min and max.
+    double quantile(double q) const;
+
+    // Appends a compact (varint, sparse) encoding to out.
+    void encode(std::string& out) const;
+    // Decodes one sketch from [p, e), advancing p; false on a malformed one.
+    bool decode(const uint8_t*& p, const uint8_t* e);
+
+private:
+    // Buckets of one sign by |value|; counts[i] is key base + i.
+    struct Half {
+        int32_t base = 0;
+        std::vector<uint64_t> counts;
+
+        void add(int32_t key, uint64_t n);
+    };
+
+    Half pos_, neg_;
+    uint64_t count_ = 0, zero_ = 0, nan_ = 0;
+    double min_ = INFINITY, max_ = -INFINITY, sum_ = 0;
+};
+
+}  // namespace reu
@@ -0,0 +1,163 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace reu {
+
+// Continued fraction of I_x(a, b) (modified Lentz), valid for x < (a+1)/(a+b+2).
+static double beta_fraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0);
+    d = 1.0 / (std::fabs(d) < tiny ? tiny : d);
+    double h = d;
+    for (int m = 1; m <= 300; m++) {
+        for (int odd = 0; odd < 2; odd++) {
+            double num = odd ? -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))
+                             : m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+            d = 1.0 + num * d;
+            d = 1.0 / (std::fabs(d) < tiny ? tiny : d);
+            c = 1.0 + num / c;
+            c = std::fabs(c) < tiny ? tiny : c;
+            h *= d * c;
+            if (odd && std::fabs(d * c - 1.0) < 1e-15)
+                return h;
+        }
+    }
+    return h;
+}
+
+double incomplete_beta(double a, double b, double x) {
+    if (x <= 0.0)
+        return 0.0;
+    if (x >= 1.0)
+        return 1.0;
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                            a * std::log(x) + b * std::log1p(-x));
+    if (x < (a + 1.0) / (a + b + 2.0))
+        return front * beta_fraction(a, b, x) / a;
+    return 1.0 - front * beta_fraction(b, a, 1.0 - x) / b;
+}
+
+double student_t_p(double t, double df) {
+    if (std::isnan(t) || !(df > 0.0))
+        return NAN;
+    if (std::isinf(t))
+        return 0.0;
+    return incomplete_beta(0.5 * df, 0.5, df / (df + t * t));
+}
+
+double incomplete_gamma(double a, double x) {
+    if (!(x > 0.0))
+        return 0.0;
+    if (std::isinf(x))
+        return 1.0;
+    double front = std::exp(a * std::log(x) - x - std::lgamma(a));
+    if (x < a + 1.0) {
+        // Series sum x^n / (a (a+1) ... (a+n)).
+        double term = 1.0 / a, sum = term;
+        for (int n = 1; n < 1000 && std::fabs(term) > std::fabs(sum) * 1e-16; n++) {
+            term *= x / (a + n);
+            sum += term;
+        }
+        return std::min(1.0, front * sum);
+    }
+    // Continued fraction of the upper tail (modified Lentz).
+    const double tiny = 1e-300;
+    double b = x + 1.0 - a, c = 1.0 / tiny, d = 1.0 / b, h = d;
+    for (int n = 1; n <= 1000; n++) {
+        double an = -n * (n - a);
+        b += 2.0;
+        d = an * d + b;
+        d = 1.0 / (std::fabs(d) < tiny ? tiny : d);
+        c = b + an / c;
+        c = std::fabs(c) < tiny ? tiny : c;
+        h *= d * c;
+        if (std::fabs(d * c - 1.0) < 1e-15)
+            break;
+    }
+    return std::max(0.0, 1.0 - front * h);
+}
+
+double normal_quantile(double q) {
+    if (!(q > 0.0 && q < 1.0))
+        return q == 0.0 ? -INFINITY : q == 1.0 ? INFINITY : NAN;
+    // Acklam's rational approximation, then one Halley step on erfc.
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                               -2.759285104469687e+02, 1.383577518672690e+02,
+                               -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                               -1.556989798598866e+02, 6.680131188771972e+01,
+                               -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                               -2.400758277161838e+00, -2.549732539343734e+00,
+                               4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01,
+                               2.445134137142996e+00, 3.754408661907416e+00};
+    double x;
+    if (q < 0.02425 || q > 1.0 - 0.02425) {
+        double r = std::sqrt(-2.0 * std::log(q < 0.5 ? q : 1.0 - q));
+        x = (((((c[0] * r + c[1]) * r + c[2]) * r + c[3]) * r + c[4]) * r + c[5]) /
+            ((((d[0] * r + d[1]) * r + d[2]) * r + d[3]) * r + 1.0);
+        x = q < 0.5 ? x : -x;
+    } else {
+        double r = q - 0.5, s = r * r;
+        x = (((((a[0] * s + a[1]) * s + a[2]) * s + a[3]) * s + a[4]) * s + a[5]) * r /
+            (((((b[0] * s + b[1]) * s + b[2]) * s + b[3]) * s + b[4]) * s + 1.0);
+    }
+    double e = 0.5 * std::erfc(-x / std::sqrt(2.0)) - q;
+    double u = e * std::sqrt(2.0 * M_PI) * std::exp(0.5 * x * x);
+    return x - u / (1.0 + 0.5 * x * u);
+}
+
+double chi2_quantile(double q, double df) {
+    if (!(q > 0.0 && q < 1.0) || !(df > 0.0))
+        return q == 0.0 ? 0.0 : q == 1.0 ? INFINITY : NAN;
+    // Wilson-Hilferty start, then Newton on the CDF, kept inside a bracket.
+    double z = normal_quantile(q), h = 2.0 / (9.0 * df);
+    double x = df * std::pow(std::max(1.0 - h + z * std::sqrt(h), 0.01), 3.0);
+    double lo = 0.0, hi = INFINITY;
+    for (int i = 0; i < 100; i++) {
+        double f = incomplete_gamma(0.5 * df, 0.5 * x) - q;
+        (f < 0.0 ? lo : hi) = x;
+        double pdf = std::exp((0.5 * df - 1.0) * std::log(0.5 * x) - 0.5 * x -
+                              std::lgamma(0.5 * df)) * 0.5;
+        double next = pdf > 0.0 ? x - f / pdf : NAN;
+        if (!(next > lo && next < hi))
+            next = std::isinf(hi) ? 2.0 * x + 1.0 : 0.5 * (lo + hi);
+        if (std::fabs(next - x) <= 1e-13 * x)
+            return next;
+        x = next;
+    }
+    return x;
+}
+
+double sign_test_p(size_t k, size_t n) {
+    if (n == 0)
+        return 1.0;
+    size_t lo = std::min(k, n - k);
+    if (2 * lo == n)
+        return 1.0;
+    // P(X <= lo) = I_{1/2}(n - lo, lo + 1), doubled for both tails.
+    return std::min(1.0, 2.0 * incomplete_beta(double(n - lo), double(lo) + 1.0, 0.5));
+}
+
+double ks_p(double d, double n, double m) {
+    if (!(n > 0.0 && m > 0.0) || std::isnan(d))
+        return NAN;
+    double ne = std::sqrt(n * m / (n + m));
+    double lambda = (ne + 0.12 + 0.11 / ne) * d;
+    if (lambda < 0.2)
+        return 1.0;
+    double sum = 0.0, sign = 1.0;
+    for (int k = 1; k <= 100; k++) {
+        double term = std::exp(-2.0 * k * k * lambda * lambda);
+        sum += sign * term;
+        if (term < 1e-12)
+            break;
+        sign = -sign;
+    }
+    return std::min(1.0, std::max(0.0, 2.0 * sum));
+}
+
+}  // namespace reu
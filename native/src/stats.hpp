@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+namespace reu {
+
+/*
+ * Distribution tails for the hypothesis tests run over result stores.
+ * All p-values are two-sided unless noted.
+ */
+
+// Regularized incomplete beta function I_x(a, b).
+double incomplete_beta(double a, double b, double x);
+
+// Student t with df degrees of freedom: P(|T| >= |t|).
+double student_t_p(double t, double df);
+
+// Regularized lower incomplete gamma function P(a, x).
+double incomplete_gamma(double a, double x);
+
+// Quantiles (inverse CDFs) for the confidence bounds of sigest.hpp; q in (0, 1).
+double normal_quantile(double q);
+double chi2_quantile(double q, double df);
+
+// Sign test: probability of a split at least as uneven as (k, n - k) under
+// p = 1/2.
+double sign_test_p(size_t k, size_t n);
+
+/*
+ * Two-sample Kolmogorov-Smirnov: probability of a statistic >= d for
+ * samples of sizes n and m (asymptotic, with Stephens' correction).
+ */
+double ks_p(double d, double n, double m);
+
+}  // namespace reu
@@ -0,0 +1,475 @@
+#include "store.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+#include "floatcodec.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+#include "textcodec.hpp"
+
+namespace reu {
+
+size_t Column::size() const {
+    switch (type) {
+    case ColType::F64: return f64.size();
+    case ColType::I64: return i64.size();
+    default: return codes.size();
+    }
+}
+
+bool Column::is_null(size_t row) const {
+    switch (type) {
+    case ColType::F64: return std::isnan(f64[row]);
+    case ColType::I64: return i64[row] == I64_NULL;
+    default: return codes[row] == 0;
+    }
+}
+
+uint32_t Column::find_code(const std::string& s) const {
+    auto it = lookup.find(s);
+    return it == lookup.end() ? UINT32_MAX : it->second;
+}
+
+uint32_t Column::intern(const std::string& s) {
+    auto it = lookup.find(s);
+    if (it != lookup.end())
+        return it->second;
+    uint32_t code = uint32_t(dict.size());
+    dict.push_back(s);
+    lookup.emplace(s, code);
+    return code;
+}
+
+double Column::num(size_t row) const {
+    if (is_null(row))
+        return NAN;
+    switch (type) {
+    case ColType::F64: return f64[row];
+    case ColType::I64: return double(i64[row]);
+    default: return NAN;
+    }
+}
+
+std::string Column::format(size_t row) const {
+    if (is_null(row))
+        return "";
+    char buf[32];
+    switch (type) {
+    case ColType::F64: return format_double(f64[row]);
+    case ColType::I64: snprintf(buf, sizeof buf, "%lld", (long long)i64[row]); return buf;
+    default: return str(row);
+    }
+}
+
+const Column* ResultStore::find(const std::string& name) const {
+    auto it = by_name_.find(name);
+    return it == by_name_.end() ? nullptr : &cols_[it->second];
+}
+
+Column* ResultStore::column(const std::string& name, ColType type) {
+    auto it = by_name_.find(name);
+    if (it != by_name_.end()) {
+        Column& c = cols_[it->second];
+        return c.type == type ? &c : nullptr;
+    }
+    Column c;
+    c.name = name;
+    c.type = type;
+    switch (type) {
+    case ColType::F64: c.f64.assign(nrows_, NAN); break;
+    case ColType::I64: c.i64.assign(nrows_, I64_NULL); break;
+    case ColType::STR:
+        c.intern("");
+        c.codes.assign(nrows_, 0);
+        break;
+    }
+    by_name_.emplace(name, cols_.size());
+    cols_.push_back(std::move(c));
+    return &cols_.back();
+}
+
+size_t ResultStore::add_row() {
+    for (auto& c : cols_) {
+        switch (c.type) {
+        case ColType::F64: c.f64.push_back(NAN); break;
+        case ColType::I64: c.i64.push_back(I64_NULL); break;
+        case ColType::STR: c.codes.push_back(0); break;
+        }
+    }
+    return nrows_++;
+}
+
+void ResultStore::set(const std::string& name, size_t row, double v) {
+    if (Column* c = column(name, ColType::F64))
+        c->f64[row] = v;
+}
+
+void ResultStore::set_int(const std::string& name, size_t row, int64_t v) {
+    if (Column* c = column(name, ColType::I64))
+        c->i64[row] = v;
+}
+
+void ResultStore::set_str(const std::string& name, size_t row, const std::string& v) {
+    if (Column* c = column(name, ColType::STR))
+        c->codes[row] = c->intern(v);
+}
+
+bool ResultStore::append(const ResultStore& other, std::string& err) {
+    size_t base = nrows_;
+    for (size_t r = 0; r < other.nrows_; r++)
+        add_row();
+    for (const auto& src : other.cols_) {
+        Column* dst = column(src.name, src.type);
+        if (!dst) {
+            err = "Column '" + src.name + "' has different types in the two stores";
+            return false;
+        }
+        switch (src.type) {
+        case ColType::F64:
+            std::copy(src.f64.begin(), src.f64.end(), dst->f64.begin() + base);
+            break;
+        case ColType::I64:
+            std::copy(src.i64.begin(), src.i64.end(), dst->i64.begin() + base);
+            break;
+        case ColType::STR: {
+            std::vector<uint32_t> remap(src.dict.size());
+            for (size_t i = 0; i < src.dict.size(); i++)
+                remap[i] = dst->intern(src.dict[i]);
+            for (size_t r = 0; r < src.codes.size(); r++)
+                dst->codes[base + r] = remap[src.codes[r]];
+            break;
+        }
+        }
+    }
+    for (const auto& sk : other.sketches_)
+        sketches_[sk.first].merge(sk.second);
+    return true;
+}
+
+bool SketchKey::operator<(const SketchKey& o) const {
+    return std::tie(tool, kernel, config, box, source, region, metric, output) <
+           std::tie(o.tool, o.kernel, o.config, o.box, o.source, o.region, o.metric, o.output);
+}
+
+bool SketchKey::field(const std::string& name, std::string& value) const {
+    const std::pair<const char*, const std::string*> fields[] = {
+        {"tool", &tool}, {"kernel", &kernel}, {"config", &config}, {"box", &box},
+        {"source", &source}, {"region", &region}, {"metric", &metric}};
+    for (const auto& f : fields) {
+        if (name == f.first) {
+            value = *f.second;
+            return true;
+        }
+    }
+    if (name == "output") {
+        value = std::to_string(output);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * File layout (little endian):
+ *   "RSTORE02"  u64 nrows  u32 ncols
+ *   per column: u8 type, u32 name length, name, then
+ *     F64:     u8 encoding: 0 then nrows x 8 bytes, or 1 then u64 length and
+ *              a floatcodec stream (written when it is smaller)
+ *     I64:     nrows x 8 bytes
+ *     STR:     u32 dict size, (u32 length, bytes) per entry, nrows x u32 codes
+ * then, optionally (older readers stop before it):
+ *   "RSKETCH1"  u32 count
+ *   per sketch: the 7 SketchKey strings as (u32 length, bytes), i64 output,
+ *               u32 length and a QuantileSketch encoding
+ * "RSTORE01" files are the same without the F64 encoding byte.
+ */
+static const char MAGIC[8] = {'R', 'S', 'T', 'O', 'R', 'E', '0', '2'};
+static const char MAGIC_V1[8] = {'R', 'S', 'T', 'O', 'R', 'E', '0', '1'};
+static const char MAGIC_SKETCH[8] = {'R', 'S', 'K', 'E', 'T', 'C', 'H', '1'};
+
+static void put(FILE* f, const void* p, size_t n) { fwrite(p, 1, n, f); }
+
+static void put_str(FILE* f, const std::string& s) {
+    uint32_t n = uint32_t(s.size());
+    put(f, &n, 4);
+    put(f, s.data(), n);
+}
+
+bool ResultStore::save(const std::string& path, std::string& err) const {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        err = "Cannot write '" + path + "'";
+        return false;
+    }
+    uint64_t nrows = nrows_;
+    uint32_t ncols = uint32_t(cols_.size());
+    put(f, MAGIC, 8);
+    put(f, &nrows, 8);
+    put(f, &ncols, 4);
+    for (const auto& c : cols_) {
+        uint8_t t = uint8_t(c.type);
+        put(f, &t, 1);
+        put_str(f, c.name);
+        switch (c.type) {
+        case ColType::F64: {
+            std::vector<uint8_t> z;
+            encode_doubles(c.f64.data(), nrows, CodecOptions(), default_jobs(), z);
+            uint8_t enc = z.size() < nrows * 8 ? 1 : 0;
+            put(f, &enc, 1);
+            if (enc) {
+                uint64_t len = z.size();
+                put(f, &len, 8);
+                put(f, z.data(), len);
+            } else {
+                put(f, c.f64.data(), nrows * 8);
+            }
+            break;
+        }
+        case ColType::I64: put(f, c.i64.data(), nrows * 8); break;
+        case ColType::STR: {
+            uint32_t nd = uint32_t(c.dict.size());
+            put(f, &nd, 4);
+            for (const auto& s : c.dict)
+                put_str(f, s);
+            put(f, c.codes.data(), nrows * 4);
+            break;
+        }
+        }
+    }
+    if (!sketches_.empty()) {
+        uint32_t n = uint32_t(sketches_.size());
+        put(f, MAGIC_SKETCH, 8);
+        put(f, &n, 4);
+        std::string enc;
+        for (const auto& sk : sketches_) {
+            const SketchKey& k = sk.first;
+            for (const std::string* s : {&k.tool, &k.kernel, &k.config, &k.box, &k.source,
+                                         &k.region, &k.metric})
+                put_str(f, *s);
+            put(f, &k.output, 8);
+            enc.clear();
+            sk.second.encode(enc);
+            put_str(f, enc);
+        }
+    }
+    bool ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    // Replace atomically so readers never see a half-written store.
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        err = "Failed writing '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+static bool get(FILE* f, void* p, size_t n) { return fread(p, 1, n, f) == n; }
+
+static bool get_str(FILE* f, std::string& s) {
+    uint32_t n;
+    if (!get(f, &n, 4) || n > (1u << 30))
+        return false;
+    s.resize(n);
+    return n == 0 || get(f, &s[0], n);
+}
+
+bool ResultStore::load(const std::string& path, ResultStore& out, std::string& err) {
+    out = ResultStore();
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    char magic[8];
+    uint64_t nrows;
+    uint32_t ncols;
+    bool ok = get(f, magic, 8) &&
+              (memcmp(magic, MAGIC, 8) == 0 || memcmp(magic, MAGIC_V1, 8) == 0) &&
+              get(f, &nrows, 8) && get(f, &ncols, 4);
+    bool v1 = ok && memcmp(magic, MAGIC_V1, 8) == 0;
+    for (uint32_t i = 0; ok && i < ncols; i++) {
+        uint8_t t;
+        Column c;
+        ok = get(f, &t, 1) && t <= uint8_t(ColType::STR) && get_str(f, c.name);
+        if (!ok)
+            break;
+        c.type = ColType(t);
+        switch (c.type) {
+        case ColType::F64: {
+            uint8_t enc = 0;
+            ok = v1 || get(f, &enc, 1);
+            if (ok && enc == 1) {
+                uint64_t len;
+                std::vector<uint8_t> z;
+                std::string cerr;
+                ok = get(f, &len, 8) && len <= nrows * 8 + (1u << 20);
+                if (ok) {
+                    z.resize(len);
+                    ok = get(f, z.data(), len) &&
+                         decode_doubles(z.data(), len, default_jobs(), c.f64, cerr) &&
+                         c.f64.size() == nrows;
+                }
+            } else if (ok) {
+                c.f64.resize(nrows);
+                ok = enc == 0 && get(f, c.f64.data(), nrows * 8);
+            }
+            break;
+        }
+        case ColType::I64:
+            c.i64.resize(nrows);
+            ok = get(f, c.i64.data(), nrows * 8);
+            break;
+        case ColType::STR: {
+            uint32_t nd;
+            ok = get(f, &nd, 4) && nd >= 1;
+            for (uint32_t d = 0; ok && d < nd; d++) {
+                std::string s;
+                ok = get_str(f, s);
+                c.intern(s);
+            }
+            c.codes.resize(nrows);
+            ok = ok && get(f, c.codes.data(), nrows * 4);
+            for (size_t r = 0; ok && r < nrows; r++)
+                ok = c.codes[r] < nd;
+            break;
+        }
+        }
+        out.by_name_.emplace(c.name, out.cols_.size());
+        out.cols_.push_back(std::move(c));
+    }
+    char tail[8];
+    uint32_t nsketches = 0;
+    if (ok && get(f, tail, 8) && memcmp(tail, MAGIC_SKETCH, 8) == 0)
+        ok = get(f, &nsketches, 4);
+    for (uint32_t i = 0; ok && i < nsketches; i++) {
+        SketchKey k;
+        std::string enc;
+        for (std::string* s : {&k.tool, &k.kernel, &k.config, &k.box, &k.source, &k.region,
+                               &k.metric})
+            ok = ok && get_str(f, *s);
+        ok = ok && get(f, &k.output, 8) && get_str(f, enc);
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(enc.data());
+        ok = ok && out.sketches_[k].decode(p, p + enc.size()) &&
+             p == reinterpret_cast<const uint8_t*>(enc.data()) + enc.size();
+    }
+    fclose(f);
+    if (!ok) {
+        err = "'" + path + "' is not a valid result store";
+        out = ResultStore();
+        return false;
+    }
+    out.nrows_ = nrows;
+    return true;
+}
+
+SampleUlp::SampleUlp(const ResultStore& store)
+    : lo(store.find("out_lo")), hi(store.find("out_hi")), mean(store.find("mean")),
+      prec(store.find("precision")), config(store.find("config")) {}
+
+double SampleUlp::distance(size_t r, double y) const {
+    double m = mean ? mean->num(r) : NAN;
+    if (std::isnan(m) || std::isnan(y))
+        return NAN;
+    bool single = config && config->type == ColType::STR &&
+                  config->str(r).compare(0, 5, "FLOAT") == 0;
+    double p = prec ? prec->num(r) : NAN;
+    if (std::isnan(p))
+        p = single ? 24 : 53;
+    int emin = single && !prec ? -126 : -1022;
+    return ulp_error(y, m, int(p) - 1, emin);
+}
+
+double SampleUlp::at(size_t r) const {
+    if (!lo || !hi)
+        return NAN;
+    double a = distance(r, lo->num(r));
+    double b = distance(r, hi->num(r));
+    return std::isnan(a) ? b : std::isnan(b) ? a : std::max(a, b);
+}
+
+StoreIndex::StoreIndex(const ResultStore& store) {
+    static const char* KEYS[3] = {"kernel", "opt", "box"};
+    for (int k = 0; k < 3; k++) {
+        const Column* c = store.find(KEYS[k]);
+        cols_[k] = c && c->type == ColType::STR ? c : nullptr;
+    }
+    for (size_t r = 0; r < store.rows(); r++) {
+        std::array<uint32_t, 3> key;
+        for (int k = 0; k < 3; k++)
+            key[k] = cols_[k] ? cols_[k]->codes[r] : 0;
+        groups_[key].push_back(uint32_t(r));
+    }
+}
+
+std::vector<uint32_t> StoreIndex::lookup(const std::string& kernel, const std::string& opt,
+                                         const std::string& box) const {
+    const std::string* want[3] = {&kernel, &opt, &box};
+    uint32_t code[3];
+    for (int k = 0; k < 3; k++) {
+        if (*want[k] == "*") {
+            code[k] = UINT32_MAX;  // any
+        } else if (!cols_[k]) {
+            if (!want[k]->empty())
+                return {};
+            code[k] = 0;
+        } else {
+            code[k] = cols_[k]->find_code(*want[k]);
+            if (code[k] == UINT32_MAX)
+                return {};
+        }
+    }
+    std::vector<uint32_t> rows;
+    for (const auto& g : groups_) {
+        bool match = true;
+        for (int k = 0; k < 3; k++)
+            match = match && (code[k] == UINT32_MAX || g.first[k] == code[k]);
+        if (match)
+            rows.insert(rows.end(), g.second.begin(), g.second.end());
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+bool select_rows(const ResultStore& store, const std::string& tool, const std::string& kernel,
+                 const std::string& opt, const std::string& box, const std::string& filters,
+                 std::vector<uint32_t>& rows, std::string& err) {
+    StoreIndex index(store);
+    rows = index.lookup(kernel, opt, box);
+    std::vector<std::pair<const Column*, std::string>> eq;
+    if (tool != "*")
+        eq.emplace_back(store.find("tool"), tool);
+    size_t start = 0;
+    while (start < filters.size()) {
+        size_t comma = filters.find(',', start);
+        std::string item = filters.substr(start, comma == std::string::npos ? comma : comma - start);
+        start = comma == std::string::npos ? filters.size() : comma + 1;
+        size_t pos = item.find('=');
+        const Column* c = pos == std::string::npos ? nullptr : store.find(item.substr(0, pos));
+        if (!c) {
+            err = "invalid filter '" + item + "' (expected an existing 'column=value')";
+            return false;
+        }
+        eq.emplace_back(c, item.substr(pos + 1));
+    }
+    for (const auto& f : eq) {
+        std::vector<uint32_t> kept;
+        if (f.first && f.first->type == ColType::STR) {
+            uint32_t code = f.first->find_code(f.second);
+            for (uint32_t r : rows)
+                if (f.first->codes[r] == code)
+                    kept.push_back(r);
+        } else if (f.first) {
+            for (uint32_t r : rows)
+                if (f.first->format(r) == f.second)
+                    kept.push_back(r);
+        }
+        rows.swap(kept);
+    }
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,140 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sketch.hpp"
+
+namespace reu {
+
+/*
+ * Column-oriented table of analysis results. Every tool writes into the same
+ * store, with one row per (source, kernel, input point or box, output):
+ * MCA .tab samples are reduced to per-point statistics, and CIRE results.json
+ * entries become one row per analysed output. Columns are created on first
+ * use and back-filled with nulls, so rows from different tools share a table
+ * and simply leave each other's columns empty.
+ *
+ * Nulls: NaN for F64, I64_NULL for I64, "" (code 0) for STR. String columns
+ * are dictionary coded.
+ */
+enum class ColType : uint8_t { F64 = 0, I64 = 1, STR = 2 };
+
+constexpr int64_t I64_NULL = INT64_MIN;
+
+struct Column {
+    std::string name;
+    ColType type = ColType::F64;
+    std::vector<double> f64;
+    std::vector<int64_t> i64;
+    std::vector<uint32_t> codes;     // STR: index into dict
+    std::vector<std::string> dict;   // STR: distinct values, dict[0] == ""
+
+    size_t size() const;
+    bool is_null(size_t row) const;
+    const std::string& str(size_t row) const { return dict[codes[row]]; }
+    // Code of s in dict, or UINT32_MAX if it never occurs.
+    uint32_t find_code(const std::string& s) const;
+    uint32_t intern(const std::string& s);
+    // Value as text for CSV output ("" for null).
+    std::string format(size_t row) const;
+    // Numeric value (NaN for null and for STR columns).
+    double num(size_t row) const;
+
+    std::unordered_map<std::string, uint32_t> lookup;  // STR: dict -> code
+};
+
+/*
+ * What a stored QuantileSketch summarizes: one metric ("ulp": per-sample
+ * distance from the point mean in ULPs, as SampleUlp; "sig_digits": per
+ * point) of one output of one source file, over one region of the inputs
+ * ("binade(x0)=-3", "binade(x0)=zero", or "" for all points).
+ */
+struct SketchKey {
+    std::string tool, kernel, config, box, source, region, metric;
+    int64_t output = 0;
+
+    bool operator<(const SketchKey& o) const;
+    // Field by name (tool, kernel, ..., output), for grouping and filters.
+    bool field(const std::string& name, std::string& value) const;
+};
+
+class ResultStore {
+public:
+    size_t rows() const { return nrows_; }
+    const std::vector<Column>& columns() const { return cols_; }
+
+    const Column* find(const std::string& name) const;
+    // Get or create a column. Returns nullptr if it exists with another type.
+    Column* column(const std::string& name, ColType type);
+
+    // Append a row of nulls and return its index.
+    size_t add_row();
+    void set(const std::string& name, size_t row, double v);
+    void set_int(const std::string& name, size_t row, int64_t v);
+    void set_str(const std::string& name, size_t row, const std::string& v);
+
+    // Append every row of other, matching columns by name, and merge its sketches.
+    bool append(const ResultStore& other, std::string& err);
+
+    // Error distributions stored with the rows, so quantiles need no raw samples.
+    const std::map<SketchKey, QuantileSketch>& sketches() const { return sketches_; }
+    QuantileSketch& sketch(const SketchKey& key) { return sketches_[key]; }
+
+    bool save(const std::string& path, std::string& err) const;
+    static bool load(const std::string& path, ResultStore& out, std::string& err);
+
+private:
+    std::vector<Column> cols_;
+    std::map<std::string, size_t> by_name_;
+    size_t nrows_ = 0;
+    std::map<SketchKey, QuantileSketch> sketches_;
+};
+
+/*
+ * Per-row error in ULPs derived from the sample range: the larger distance
+ * of out_lo / out_hi from mean, in ULPs of the row's precision (bits incl.
+ * the implicit one; FLOAT / DOUBLE from config when it has none). NaN when
+ * the row has no mean or range.
+ */
+struct SampleUlp {
+    const Column *lo, *hi, *mean, *prec, *config;
+
+    explicit SampleUlp(const ResultStore& store);
+    double at(size_t r) const;
+    // ULPs between y and the mean of row r, in the row's format.
+    double distance(size_t r, double y) const;
+};
+
+/*
+ * Row lists keyed by (kernel, opt, box), the axes results are compared
+ * along. Lookups take "*" as a wildcard on any component and only visit the
+ * matching groups.
+ */
+class StoreIndex {
+public:
+    explicit StoreIndex(const ResultStore& store);
+
+    std::vector<uint32_t> lookup(const std::string& kernel, const std::string& opt,
+                                 const std::string& box) const;
+    size_t groups() const { return groups_.size(); }
+
+private:
+    const Column* cols_[3];
+    std::map<std::array<uint32_t, 3>, std::vector<uint32_t>> groups_;
+};
+
+/*
+ * Rows of the (kernel, opt, box) selection from the index, narrowed by tool
+ * and by "col=value[,col=value]" equality filters (compared as formatted
+ * text, so "precision=24" matches the integer column). "*" selects any.
+ */
+bool select_rows(const ResultStore& store, const std::string& tool, const std::string& kernel,
+                 const std::string& opt, const std::string& box, const std::string& filters,
+                 std::vector<uint32_t>& rows, std::string& err);
+
+}  // namespace reu
@@ -0,0 +1,349 @@
+#include "storediff.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+#include "parallel.hpp"
+#include "stats.hpp"
+
+namespace reu {
+
+namespace {
+
+const int HIST_PER_DIGIT = 256;
+const int HIST_BINS = 20 * HIST_PER_DIGIT;
+
+int hist_bin(double sig) {
+    return std::min(HIST_BINS - 1, std::max(0, int(sig * HIST_PER_DIGIT)));
+}
+
+uint64_t bits_of(double v) {
+    if (std::isnan(v))
+        v = NAN;
+    else if (v == 0.0)
+        v = 0.0;
+    uint64_t u;
+    memcpy(&u, &v, 8);
+    return u;
+}
+
+uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+// The join key of a row: numeric columns by value, strings by text, so
+// two stores with different dictionaries still match.
+struct KeyCols {
+    std::vector<const Column*> cols;
+
+    uint64_t hash(uint32_t r) const {
+        uint64_t h = 0;
+        for (const Column* c : cols)
+            h = mix(h, c->type == ColType::STR ? std::hash<std::string>()(c->str(r))
+                                               : bits_of(c->num(r)));
+        return h;
+    }
+};
+
+bool same_key(const KeyCols& ka, uint32_t ra, const KeyCols& kb, uint32_t rb) {
+    for (size_t i = 0; i < ka.cols.size(); i++) {
+        const Column* a = ka.cols[i];
+        const Column* b = kb.cols[i];
+        if (a->type == ColType::STR) {
+            if (a->str(ra) != b->str(rb))
+                return false;
+        } else if (bits_of(a->num(ra)) != bits_of(b->num(rb))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The value c takes on every row (NaN for null), or false if it varies.
+bool single_value(const Column& c, const std::vector<uint32_t>& rows, uint64_t& v) {
+    for (size_t i = 0; i < rows.size(); i++) {
+        uint64_t x = c.type == ColType::STR ? std::hash<std::string>()(c.str(rows[i]))
+                                            : bits_of(c.num(rows[i]));
+        if (i && x != v)
+            return false;
+        v = x;
+    }
+    return !rows.empty();
+}
+
+struct RegionAcc {
+    double value = NAN;
+    size_t pairs = 0;
+    size_t n = 0;  // Welford on d_sig
+    double mean = 0.0, m2 = 0.0;
+    size_t worse = 0, better = 0;
+    double max_d_ulp = -INFINITY, max_mean_ulps = -INFINITY;
+    std::vector<uint32_t> hist_a, hist_b;
+};
+
+void merge(RegionAcc& d, const RegionAcc& s) {
+    if (s.n) {
+        size_t n = d.n + s.n;
+        double delta = s.mean - d.mean;
+        d.mean += delta * double(s.n) / double(n);
+        d.m2 += s.m2 + delta * delta * double(d.n) * double(s.n) / double(n);
+        d.n = n;
+    }
+    d.pairs += s.pairs;
+    d.worse += s.worse;
+    d.better += s.better;
+    d.max_d_ulp = std::max(d.max_d_ulp, s.max_d_ulp);
+    d.max_mean_ulps = std::max(d.max_mean_ulps, s.max_mean_ulps);
+    for (int i = 0; i < HIST_BINS; i++) {
+        d.hist_a[size_t(i)] += s.hist_a[size_t(i)];
+        d.hist_b[size_t(i)] += s.hist_b[size_t(i)];
+    }
+}
+
+struct Job {
+    std::unordered_map<uint64_t, RegionAcc> regions;
+    std::vector<DiffPair> heap;
+    size_t pairs = 0, unmatched = 0;
+};
+
+}  // namespace
+
+bool diff_rows(const ResultStore& a, const std::vector<uint32_t>& rows_a, const ResultStore& b,
+               const std::vector<uint32_t>& rows_b, const DiffSpec& spec, unsigned jobs,
+               DiffResult& out, std::string& err) {
+    out = DiffResult();
+    out.key = spec.key;
+    if (out.key.empty()) {
+        // Labels that vary within A (a whole run against another) join too;
+        // a single kernel against another one joins on the inputs alone.
+        for (const char* label : {"kernel", "opt", "box"}) {
+            const Column* c = a.find(label);
+            if (!c || c->type != ColType::STR || !b.find(label))
+                continue;
+            bool varies = false;
+            for (size_t i = 1; i < rows_a.size() && !varies; i++)
+                varies = c->codes[rows_a[i]] != c->codes[rows_a[0]];
+            if (varies)
+                out.key.push_back(label);
+        }
+        for (const auto& c : a.columns()) {
+            bool input = c.name.size() > 1 && c.name[0] == 'x' &&
+                         c.name.find_first_not_of("0123456789", 1) == std::string::npos;
+            bool used = false;  // inputs a kernel does not have stay null
+            for (size_t i = 0; i < rows_a.size() && !used; i++)
+                used = !c.is_null(rows_a[i]);
+            const Column* cb = b.find(c.name);
+            if (!(input || c.name == "output" || c.name == "precision") || !used || !cb)
+                continue;
+            // A column fixed to one value in A and another in B is what the
+            // two selections compare, e.g. precision=24 against precision=15.
+            uint64_t va, vb;
+            if (single_value(c, rows_a, va) && single_value(*cb, rows_b, vb) && va != vb)
+                continue;
+            out.key.push_back(c.name);
+        }
+    }
+    if (out.key.empty()) {
+        err = "no common key columns; name them with -J";
+        return false;
+    }
+    KeyCols ka, kb;
+    for (const auto& name : out.key) {
+        const Column* ca = a.find(name);
+        const Column* cb = b.find(name);
+        if (!ca || !cb || (ca->type == ColType::STR) != (cb->type == ColType::STR)) {
+            err = "key column '" + name + "' is missing or of another type on one side";
+            return false;
+        }
+        ka.cols.push_back(ca);
+        kb.cols.push_back(cb);
+    }
+    const Column* sig_a = a.find(spec.sig);
+    const Column* sig_b = b.find(spec.sig);
+    const Column* region = b.find(spec.region);
+    if (!spec.region.empty() && !region) {
+        err = "no region column '" + spec.region + "'";
+        return false;
+    }
+    bool region_text = region && region->type == ColType::STR;
+    if (spec.binade && region_text) {
+        err = "binade() needs a numeric column";
+        return false;
+    }
+    int rank = spec.rank == "d_sig" ? 0 : spec.rank == "d_ulp" ? 1 : -1;
+    if (spec.rank == "mean_ulps")
+        rank = 2;
+    if (rank < 0) {
+        err = "unknown ranking '" + spec.rank + "' (d_sig, d_ulp or mean_ulps)";
+        return false;
+    }
+    SampleUlp ulp_a(a), ulp_b(b);
+
+    // Hash of A's keys; chains run through `next` by position in rows_a.
+    std::unordered_map<uint64_t, uint32_t> head;
+    std::vector<uint32_t> next(rows_a.size(), UINT32_MAX);
+    head.reserve(rows_a.size());
+    for (uint32_t i = 0; i < rows_a.size(); i++) {
+        uint32_t r = rows_a[i];
+        auto ins = head.emplace(ka.hash(r), i);
+        if (ins.second)
+            continue;
+        bool dup = false;
+        uint32_t last = ins.first->second;
+        for (uint32_t j = last; j != UINT32_MAX && !dup; last = j, j = next[j])
+            dup = same_key(ka, rows_a[j], ka, r);
+        if (dup)
+            out.duplicates++;
+        else
+            next[last] = i;
+    }
+
+    const bool asc = spec.ascending;
+    auto metric = [rank](const DiffPair& p) {
+        return rank == 0 ? p.d_sig : rank == 1 ? p.d_ulp : p.mean_ulps;
+    };
+    auto worse_first = [&](const DiffPair& x, const DiffPair& y) {
+        double mx = metric(x), my = metric(y);
+        return (asc ? mx < my : mx > my) || (mx == my && x.b < y.b);
+    };
+    auto region_value = [&](uint32_t r) {
+        if (!region)
+            return 0.0;
+        if (region_text)
+            return double(region->codes[r]);
+        double v = region->num(r);
+        if (spec.binade)
+            return !std::isfinite(v) ? NAN : v == 0.0 ? -INFINITY : double(std::ilogb(v));
+        return v;
+    };
+
+    std::vector<Job> work(std::max(1u, jobs));
+    parallel_for(rows_b.size(), jobs, [&](size_t lo, size_t hi, unsigned j) {
+        Job& w = work[j];
+        for (size_t i = lo; i < hi; i++) {
+            uint32_t rb = rows_b[i];
+            auto it = head.find(kb.hash(rb));
+            uint32_t k = it == head.end() ? UINT32_MAX : it->second;
+            while (k != UINT32_MAX && !same_key(ka, rows_a[k], kb, rb))
+                k = next[k];
+            if (k == UINT32_MAX) {
+                w.unmatched++;
+                continue;
+            }
+            uint32_t ra = rows_a[k];
+            double mb = ulp_b.mean ? ulp_b.mean->num(rb) : NAN;
+            DiffPair p{ra, rb, ulp_a.distance(ra, mb),
+                       (sig_b ? sig_b->num(rb) : NAN) - (sig_a ? sig_a->num(ra) : NAN),
+                       ulp_b.at(rb) - ulp_a.at(ra)};
+            w.pairs++;
+
+            double g = region_value(rb);
+            RegionAcc& acc = w.regions[bits_of(g)];
+            if (acc.hist_a.empty()) {
+                acc.value = g;
+                acc.hist_a.assign(HIST_BINS, 0);
+                acc.hist_b.assign(HIST_BINS, 0);
+            }
+            acc.pairs++;
+            if (!std::isnan(p.d_sig)) {
+                acc.n++;
+                double delta = p.d_sig - acc.mean;
+                acc.mean += delta / double(acc.n);
+                acc.m2 += delta * (p.d_sig - acc.mean);
+                acc.worse += p.d_sig < 0.0;
+                acc.better += p.d_sig > 0.0;
+                acc.hist_a[size_t(hist_bin(sig_a->num(ra)))]++;
+                acc.hist_b[size_t(hist_bin(sig_b->num(rb)))]++;
+            }
+            if (!std::isnan(p.d_ulp))
+                acc.max_d_ulp = std::max(acc.max_d_ulp, p.d_ulp);
+            if (!std::isnan(p.mean_ulps))
+                acc.max_mean_ulps = std::max(acc.max_mean_ulps, p.mean_ulps);
+
+            if (!spec.top_k || std::isnan(metric(p)))
+                continue;
+            if (w.heap.size() < spec.top_k) {
+                w.heap.push_back(p);
+                std::push_heap(w.heap.begin(), w.heap.end(), worse_first);
+            } else if (worse_first(p, w.heap.front())) {
+                std::pop_heap(w.heap.begin(), w.heap.end(), worse_first);
+                w.heap.back() = p;
+                std::push_heap(w.heap.begin(), w.heap.end(), worse_first);
+            }
+        }
+    });
+
+    std::unordered_map<uint64_t, RegionAcc> regions;
+    for (auto& w : work) {
+        out.pairs += w.pairs;
+        out.unmatched += w.unmatched;
+        out.top.insert(out.top.end(), w.heap.begin(), w.heap.end());
+        for (auto& g : w.regions) {
+            auto ins = regions.emplace(g.first, RegionAcc());
+            if (ins.second)
+                ins.first->second = std::move(g.second);
+            else
+                merge(ins.first->second, g.second);
+        }
+    }
+    if (!out.pairs && !rows_a.empty() && !rows_b.empty()) {
+        std::string names;
+        for (const auto& name : out.key)
+            names += (names.empty() ? "" : ",") + name;
+        err = "no pairs joined on " + names + (spec.key.empty() ? "; pass -J" : "");
+        return false;
+    }
+    std::sort(out.top.begin(), out.top.end(), worse_first);
+    if (out.top.size() > spec.top_k)
+        out.top.resize(spec.top_k);
+
+    std::vector<const RegionAcc*> order;
+    for (const auto& g : regions)
+        order.push_back(&g.second);
+    std::sort(order.begin(), order.end(), [&](const RegionAcc* x, const RegionAcc* y) {
+        if (region_text)
+            return region->dict[size_t(x->value)] < region->dict[size_t(y->value)];
+        return x->value < y->value || (!std::isnan(x->value) && std::isnan(y->value));
+    });
+    for (const RegionAcc* acc : order) {
+        DiffRegion dr;
+        if (region_text) {
+            dr.key = region->dict[size_t(acc->value)];
+        } else if (region && !std::isnan(acc->value)) {
+            char buf[32];
+            snprintf(buf, sizeof buf, "%.17g", acc->value);
+            dr.key = buf;
+        }
+        dr.pairs = acc->pairs;
+        dr.worse = acc->worse;
+        dr.better = acc->better;
+        dr.max_d_ulp = acc->max_d_ulp > -INFINITY ? acc->max_d_ulp : NAN;
+        dr.max_mean_ulps = acc->max_mean_ulps > -INFINITY ? acc->max_mean_ulps : NAN;
+        if (acc->n) {
+            dr.d_sig_mean = acc->mean;
+            dr.sign_p = sign_test_p(acc->worse, acc->worse + acc->better);
+            double d = 0.0, ca = 0.0, cb = 0.0, n = double(acc->n);
+            for (int i = 0; i < HIST_BINS; i++) {
+                ca += acc->hist_a[size_t(i)];
+                cb += acc->hist_b[size_t(i)];
+                d = std::max(d, std::fabs(ca - cb) / n);
+            }
+            dr.ks_d = d;
+            dr.ks_p = ks_p(d, n, n);
+        }
+        if (acc->n > 1) {
+            dr.d_sig_sd = std::sqrt(acc->m2 / double(acc->n - 1));
+            double se = dr.d_sig_sd / std::sqrt(double(acc->n));
+            dr.t_p = se > 0.0 ? student_t_p(acc->mean / se, double(acc->n - 1))
+                              : acc->mean == 0.0 ? 1.0 : 0.0;
+        }
+        out.regions.push_back(dr);
+    }
+    return true;
+}
+
+}  // namespace reu
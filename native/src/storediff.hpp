@@ -0,0 +1,70 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "store.hpp"
+
+namespace reu {
+
+/*
+ * Paired comparison of two sets of result rows, e.g. ex1_original against
+ * ex1_alt1, or an old run against a new one. Rows are joined on their input
+ * key (by default the x<i> inputs, output and precision, less those fixed
+ * to a different value on each side): B is scanned in
+ * parallel against a hash of A's keys, so memory beyond the two stores is
+ * the hash, one accumulator per region and thread, and the top-K heap;
+ * no table of pairs is built.
+ *
+ * Per pair (B relative to A, so negative d_sig and positive d_ulp are
+ * regressions):
+ *   mean_ulps  distance between the two means in ULPs of A's format
+ *   d_sig      sig_B - sig_A
+ *   d_ulp      ulp_B - ulp_A (sample half-range around the mean, SampleUlp)
+ *
+ * Per region (a column, or the binade of one):
+ *   paired t test and sign test on d_sig, and a two-sample KS test on the
+ *   sig distributions, from 1/256-digit histograms over [0, 20] digits.
+ */
+struct DiffSpec {
+    std::vector<std::string> key;   // join columns, empty for the default
+    std::string region = "x0";
+    bool binade = true;             // region by floor(log2 |region|)
+    std::string sig = "sig_digits";
+    std::string rank = "d_sig";     // d_sig, d_ulp or mean_ulps
+    size_t top_k = 20;
+    bool ascending = true;          // rank from the most negative
+};
+
+struct DiffPair {
+    uint32_t a, b;
+    double mean_ulps, d_sig, d_ulp;
+};
+
+struct DiffRegion {
+    std::string key;
+    size_t pairs = 0;
+    double d_sig_mean = NAN, d_sig_sd = NAN;
+    double t_p = NAN;         // paired t test on d_sig
+    size_t worse = 0, better = 0;
+    double sign_p = NAN;      // sign test on d_sig
+    double ks_d = NAN, ks_p = NAN;
+    double max_d_ulp = NAN, max_mean_ulps = NAN;
+};
+
+struct DiffResult {
+    std::vector<std::string> key;  // join columns used
+    size_t pairs = 0;
+    size_t unmatched = 0;          // B rows without a partner in A
+    size_t duplicates = 0;         // A rows whose key was already taken
+    std::vector<DiffRegion> regions;  // in region order
+    std::vector<DiffPair> top;        // by spec.rank, worst first
+};
+
+bool diff_rows(const ResultStore& a, const std::vector<uint32_t>& rows_a, const ResultStore& b,
+               const std::vector<uint32_t>& rows_b, const DiffSpec& spec, unsigned jobs,
+               DiffResult& out, std::string& err);
+
+}  // namespace reu
@@ -0,0 +1,106 @@
+#include "subprocess.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+
+namespace reu {
+
+bool run_process(const std::vector<std::string>& argv, const std::string* input,
+                 ProcResult& res, std::string& err, double timeout) {
+    res = ProcResult();
+    if (argv.empty()) {
+        err = "empty command";
+        return false;
+    }
+    // Both pipes are close-on-exec so children started concurrently from
+    // other threads do not inherit them; the child re-enables what it needs.
+    int in_pipe[2] = {-1, -1}, out_pipe[2];
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+        err = std::string("pipe: ") + strerror(errno);
+        return false;
+    }
+    std::vector<std::string> args = argv;
+    if (input) {
+        // A spec is far below the pipe capacity, so it is written up front.
+        if (input->size() > 65536 || pipe2(in_pipe, O_CLOEXEC) != 0 ||
+            write(in_pipe[1], input->data(), input->size()) != ssize_t(input->size())) {
+            err = "cannot pass input through a pipe";
+            close(out_pipe[0]);
+            close(out_pipe[1]);
+            if (in_pipe[0] >= 0) {
+                close(in_pipe[0]);
+                close(in_pipe[1]);
+            }
+            return false;
+        }
+        close(in_pipe[1]);
+        std::string path = "/dev/fd/" + std::to_string(in_pipe[0]);
+        for (auto& a : args)
+            if (a == "{input}")
+                a = path;
+    }
+    std::vector<char*> cargv;
+    for (auto& a : args)
+        cargv.push_back(&a[0]);
+    cargv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        err = std::string("fork: ") + strerror(errno);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        if (input)
+            close(in_pipe[0]);
+        return false;
+    }
+    if (pid == 0) {
+        // Only async-signal-safe calls between fork and exec.
+        dup2(out_pipe[1], 1);
+        dup2(out_pipe[1], 2);
+        if (input)
+            fcntl(in_pipe[0], F_SETFD, 0);
+        execvp(cargv[0], cargv.data());
+        _exit(127);
+    }
+    close(out_pipe[1]);
+    if (input)
+        close(in_pipe[0]);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+    char buf[4096];
+    for (;;) {
+        if (timeout > 0) {
+            double left = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now())
+                              .count();
+            struct pollfd pfd = {out_pipe[0], POLLIN, 0};
+            int ready = left > 0 ? poll(&pfd, 1, int(left * 1000) + 1) : 0;
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready == 0) {
+                // Not waiting for EOF: a grandchild may still hold the pipe.
+                kill(pid, SIGKILL);
+                res.timed_out = true;
+                break;
+            }
+        }
+        ssize_t n = read(out_pipe[0], buf, sizeof buf);
+        if (n > 0)
+            res.output.append(buf, size_t(n));
+        else if (n == 0 || errno != EINTR)
+            break;
+    }
+    close(out_pipe[0]);
+    int st = 0;
+    while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {
+    }
+    res.status = WIFEXITED(st) ? WEXITSTATUS(st) : 128 + WTERMSIG(st);
+    return true;
+}
+
+}  // namespace reu
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace reu {
+
+struct ProcResult {
+    int status = -1;     // exit code, or 128 + signal number if killed
+    std::string output;  // stdout and stderr, interleaved
+    bool timed_out = false;  // killed after the time limit
+};
+
+/*
+ * Run argv[0] (searched in PATH) and wait for it. If input is given, it is
+ * handed to the child through a pipe instead of a file: every argv entry
+ * equal to "{input}" is replaced by the /dev/fd path of the pipe's read end.
+ * A child still running after timeout seconds (0 for no limit) is killed
+ * with SIGKILL and reported as timed_out, with the output it wrote so far.
+ * Safe to call from several threads at once. Returns false only if the
+ * process could not be started.
+ */
+bool run_process(const std::vector<std::string>& argv, const std::string* input,
+                 ProcResult& res, std::string& err, double timeout = 0);
+
+}  // namespace reu
@@ -0,0 +1,182 @@
+#include "supervisor.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace reu {
+
+const char* fate_name(TaskFate f) {
+    switch (f) {
+    case TaskFate::OK: return "ok";
+    case TaskFate::FAILED: return "failed";
+    case TaskFate::CRASHED: return "crashed";
+    case TaskFate::TIMED_OUT: return "timed_out";
+    }
+    return "?";
+}
+
+TaskFate classify(const TaskAttempt& a) {
+    if (!a.started)
+        return TaskFate::FAILED;
+    if (a.timed_out)
+        return TaskFate::TIMED_OUT;
+    if (a.status >= 128)
+        return TaskFate::CRASHED;
+    return a.status == 0 ? TaskFate::OK : TaskFate::FAILED;
+}
+
+std::string describe(const TaskAttempt& a, double timeout) {
+    char buf[256];
+    if (!a.started)
+        snprintf(buf, sizeof buf, "could not start: %s", a.error.c_str());
+    else if (a.timed_out)
+        snprintf(buf, sizeof buf, "timed out after %g s", timeout);
+    else if (a.status >= 128)
+        snprintf(buf, sizeof buf, "killed by signal %d (%s)", a.status - 128,
+                 strsignal(a.status - 128));
+    else
+        snprintf(buf, sizeof buf, "exited with status %d", a.status);
+    return buf;
+}
+
+static bool make_dirs(const std::string& dir) {
+    for (size_t at = 1; at <= dir.size(); at++) {
+        if (at < dir.size() && dir[at] != '/')
+            continue;
+        std::string prefix = dir.substr(0, at);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+
+std::string save_crash(const std::string& dir, const TaskAttempt& a, double timeout) {
+    if (dir.empty() || !make_dirs(dir))
+        return "";
+    std::string path = dir + "/" + a.name;
+    std::ofstream in(path, std::ios::binary);
+    in << a.input;
+    std::ofstream log(path + ".log", std::ios::binary);
+    log << "# " << describe(a, timeout) << "\n" << a.output;
+    return in && log ? path : "";
+}
+
+void supervise(size_t ntasks, unsigned jobs, const SupervisorPolicy& policy, const TaskFn& run,
+               std::vector<TaskReport>& reports) {
+    reports.assign(ntasks, TaskReport());
+    std::atomic<size_t> next{0};
+    auto worker = [&](unsigned w) {
+        for (size_t t; (t = next++) < ntasks;) {
+            TaskReport& r = reports[t];
+            for (;;) {
+                TaskAttempt a;
+                run(t, w, r.attempts++, a);
+                r.fate = classify(a);
+                r.status = a.status;
+                if (r.fate == TaskFate::OK) {
+                    r.detail.clear();
+                    break;
+                }
+                r.detail = describe(a, policy.timeout);
+                if (r.fate == TaskFate::FAILED)
+                    break;
+                if (r.attempts > policy.retries) {
+                    r.saved = save_crash(policy.crash_dir, a, policy.timeout);
+                    break;
+                }
+            }
+        }
+    };
+    if (jobs > ntasks)
+        jobs = unsigned(ntasks);
+    if (jobs <= 1) {
+        worker(0);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (unsigned w = 0; w < jobs; w++)
+        pool.emplace_back(worker, w);
+    for (auto& t : pool)
+        t.join();
+}
+
+void SupervisedServer::run(const std::vector<std::string>& inputs, uint64_t seed,
+                           const std::string& name, std::vector<std::string>& outputs,
+                           std::vector<TaskReport>& reports) {
+    size_t n = inputs.size();
+    outputs.assign(n, std::string());
+    reports.assign(n, TaskReport());
+    size_t next = 0;  // first run without an outcome
+    for (uint64_t round = 0; next < n; round++) {
+        if (!server_.running()) {
+            std::string err;
+            if (!server_.start(argv_, err)) {
+                if (start_error_.empty())
+                    start_error_ = err;
+                for (; next < n; next++)
+                    reports[next].detail = "could not start: " + err;
+                return;
+            }
+            if (starts_++)
+                restarts_++;
+        }
+        // Resumed batches get a fresh seed, so a crash that depends on the
+        // random stream is not replayed exactly.
+        std::vector<std::string> batch(inputs.begin() + long(next), inputs.end());
+        BatchResult br;
+        TaskAttempt a;
+        a.started = server_.run(batch, seed + round * 0x9E3779B97F4A7C15ull, policy_.timeout, br,
+                                a.error);
+        size_t done = std::min(br.outputs.size(), batch.size());
+        for (size_t i = 0; i < done; i++) {
+            outputs[next] = std::move(br.outputs[i]);
+            reports[next].fate = TaskFate::OK;
+            reports[next++].attempts++;
+        }
+        if (br.outputs.size() > done) {
+            // More records than runs: a run wrote the separator itself, so the
+            // records no longer line up with the runs. Charged to the last run,
+            // the one the child was in when the extra records came.
+            TaskReport& r = reports[n - 1];
+            r.fate = TaskFate::FAILED;
+            r.detail = "protocol error: " + std::to_string(br.outputs.size()) +
+                       " records for " + std::to_string(batch.size()) + " runs";
+        }
+        if (next == n)
+            break;
+        // Run `next` ended the child. A main that calls exit() ends it too,
+        // without the separator; with status 0 that is a completed run.
+        TaskReport& r = reports[next];
+        a.status = br.status;
+        a.timed_out = br.timed_out;
+        a.name = name + "-run" + std::to_string(next) + ".args";
+        a.input = inputs[next] + "\n";
+        a.output = br.partial;
+        r.attempts++;
+        r.status = a.status;
+        // A server lost mid-batch is charged to the run, so a run that keeps
+        // killing it cannot loop.
+        r.fate = a.started ? classify(a) : TaskFate::CRASHED;
+        outputs[next] = std::move(br.partial);
+        if (r.fate == TaskFate::OK) {
+            next++;
+            continue;
+        }
+        r.detail = a.started ? describe(a, policy_.timeout) : a.error;
+        if (r.fate == TaskFate::FAILED) {
+            next++;
+        } else if (r.attempts > policy_.retries) {
+            r.saved = save_crash(policy_.crash_dir, a, policy_.timeout);
+            next++;
+        }
+    }
+}
+
+}  // namespace reu
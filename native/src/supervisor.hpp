@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "forkserver.hpp"
+
+namespace reu {
+
+/*
+ * Supervision for the sweep engine's external processes (CIRE runs, fork
+ * server children). The shell drivers had none: cirecmany_consolidated.sh
+ * special-cases a CIRE segfault after the fact and runp.sh waits forever on
+ * a hung sample. Here every attempt has a time limit, a crash or hang is
+ * retried a bounded number of times, and an input that still fails is saved
+ * to a crash directory (as AFL does) with the output of its last attempt, so
+ * it can be replayed by hand while the rest of the sweep carries on.
+ *
+ * Exit status, as in ProcResult: >= 128 is a signal (a crash), any other
+ * non-zero status a plain failure, which is not retried.
+ */
+enum class TaskFate { OK, FAILED, CRASHED, TIMED_OUT };
+
+const char* fate_name(TaskFate f);  // "ok", "failed", "crashed", "timed_out"
+
+struct SupervisorPolicy {
+    double timeout = 0;     // seconds per attempt (per run for fork servers), 0 for none
+    unsigned retries = 1;   // further attempts after a crash or timeout
+    std::string crash_dir;  // where failing inputs are saved, empty for nowhere
+};
+
+// One attempt at a task, filled in by the caller's run function.
+struct TaskAttempt {
+    bool started = true;    // false if the process could not be started
+    int status = -1;        // exit code, or 128 + signal number
+    bool timed_out = false;
+    std::string name;       // file name for the saved input, e.g. "f-cell12.cire"
+    std::string input;      // what the process was given
+    std::string output;     // what it printed
+    std::string error;      // why it could not be started
+};
+
+struct TaskReport {
+    TaskFate fate = TaskFate::FAILED;
+    unsigned attempts = 0;
+    int status = -1;
+    std::string detail;  // failure description, empty if OK
+    std::string saved;   // path of the saved input, if any
+};
+
+TaskFate classify(const TaskAttempt& a);
+// "exited with status 1", "killed by signal 11 (Segmentation fault)", ...
+std::string describe(const TaskAttempt& a, double timeout);
+
+/*
+ * Save input to dir/name and the attempt's output and status to
+ * dir/name.log, creating dir. Returns the input's path, empty on failure.
+ */
+std::string save_crash(const std::string& dir, const TaskAttempt& a, double timeout);
+
+/*
+ * Run tasks [0, ntasks) on `jobs` threads. Threads take the next task from a
+ * shared counter, so one slow task holds up only its own thread. run(task,
+ * worker, attempt, out) makes one attempt; worker identifies the calling
+ * thread for per-thread state. Crashes and timeouts are retried up to
+ * policy.retries times, then the last attempt's input is saved. reports is
+ * resized to ntasks.
+ */
+using TaskFn = std::function<void(size_t task, unsigned worker, unsigned attempt, TaskAttempt&)>;
+void supervise(size_t ntasks, unsigned jobs, const SupervisorPolicy& policy, const TaskFn& run,
+               std::vector<TaskReport>& reports);
+
+/*
+ * A fork server (harness/forksrv.c) under supervision: a batch carries on
+ * past runs that crash or hang. The offending run is retried in a fresh
+ * child with another seed up to policy.retries times, then saved and
+ * skipped; a server that dies or stops answering is restarted. One per
+ * thread.
+ */
+class SupervisedServer {
+public:
+    SupervisedServer(std::vector<std::string> argv, SupervisorPolicy policy)
+        : argv_(std::move(argv)), policy_(std::move(policy)) {}
+
+    /*
+     * Run every input. outputs[i] is the text of run i (what it printed so
+     * far if it did not complete); reports[i] says how it ended. name
+     * prefixes the saved inputs ("<name>-run<i>.args").
+     */
+    void run(const std::vector<std::string>& inputs, uint64_t seed, const std::string& name,
+             std::vector<std::string>& outputs, std::vector<TaskReport>& reports);
+
+    size_t restarts() const { return restarts_; }
+    const std::string& start_error() const { return start_error_; }  // first failed start
+
+private:
+    std::vector<std::string> argv_;
+    SupervisorPolicy policy_;
+    ForkServer server_;
+    size_t starts_ = 0, restarts_ = 0;
+    std::string start_error_;
+};
+
+}  // namespace reu
@@ -0,0 +1,392 @@
+#include "symexpr.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "interval.hpp"
+
+namespace reu {
+
+thread_local SymGraph* sym_graph = nullptr;
+
+int SymGraph::node(SymOp op, int a, int b, int c, double k) {
+    auto is = [&](int id, double v) { return id >= 0 && is_const(id, v); };
+    auto val = [&](int id) { return nodes_[size_t(id)].k; };
+    bool folded = true;
+    for (int id : {a, b, c})
+        folded = folded && (id < 0 || nodes_[size_t(id)].op == SymOp::CONST);
+    if (op != SymOp::INPUT && op != SymOp::CONST && folded) {
+        double x = a >= 0 ? val(a) : 0, y = b >= 0 ? val(b) : 0, z = c >= 0 ? val(c) : 0;
+        switch (op) {
+        case SymOp::ADD: return constant(x + y);
+        case SymOp::SUB: return constant(x - y);
+        case SymOp::NEG: return constant(-x);
+        case SymOp::MUL: return constant(x * y);
+        case SymOp::DIV: return constant(x / y);
+        case SymOp::FMA: return constant(std::fma(x, y, z));
+        case SymOp::EXP: return constant(std::exp(x));
+        case SymOp::TANH: return constant(std::tanh(x));
+        case SymOp::SQRT: return constant(std::sqrt(x));
+        case SymOp::POWI: return constant(std::pow(x, k));
+        case SymOp::ABS: return constant(std::fabs(x));
+        default: break;
+        }
+    }
+    // Identities that hold exactly in floating point as well.
+    switch (op) {
+    case SymOp::ADD:
+        if (is(b, 0.0))
+            return a;
+        if (is(a, 0.0))
+            return b;
+        break;
+    case SymOp::SUB:
+        if (is(b, 0.0))
+            return a;
+        if (is(a, 0.0))
+            return node(SymOp::NEG, b);
+        break;
+    case SymOp::NEG:
+        if (nodes_[size_t(a)].op == SymOp::NEG)
+            return nodes_[size_t(a)].a;
+        break;
+    case SymOp::MUL:
+        if (is(a, 1.0))
+            return b;
+        if (is(b, 1.0))
+            return a;
+        if (is(a, -1.0))
+            return node(SymOp::NEG, b);
+        if (is(b, -1.0))
+            return node(SymOp::NEG, a);
+        break;
+    case SymOp::DIV:
+        if (is(b, 1.0))
+            return a;
+        break;
+    case SymOp::POWI:
+        if (k == 1.0)
+            return a;
+        if (k == 0.0)
+            return constant(1.0);
+        break;
+    default: break;
+    }
+
+    char key[64];
+    snprintf(key, sizeof key, "%d %d %d %d %a", int(op), a, b, c, k);
+    auto it = memo_.find(key);
+    if (it != memo_.end())
+        return it->second;
+    SymNode n;
+    n.op = op;
+    n.a = a;
+    n.b = b;
+    n.c = c;
+    n.k = k;
+    nodes_.push_back(n);
+    memo_.emplace(key, size() - 1);
+    return size() - 1;
+}
+
+Sym operator+(const Sym& a, const Sym& b) {
+    return {sym_graph->node(SymOp::ADD, a.id, b.id), a.v + b.v};
+}
+Sym operator-(const Sym& a, const Sym& b) {
+    return {sym_graph->node(SymOp::SUB, a.id, b.id), a.v - b.v};
+}
+Sym operator-(const Sym& a) { return {sym_graph->node(SymOp::NEG, a.id), -a.v}; }
+Sym operator*(const Sym& a, const Sym& b) {
+    return {sym_graph->node(SymOp::MUL, a.id, b.id), a.v * b.v};
+}
+Sym operator/(const Sym& a, const Sym& b) {
+    return {sym_graph->node(SymOp::DIV, a.id, b.id), a.v / b.v};
+}
+Sym fma(const Sym& a, const Sym& b, const Sym& c) {
+    return {sym_graph->node(SymOp::FMA, a.id, b.id, c.id), std::fma(a.v, b.v, c.v)};
+}
+Sym exp(const Sym& a) { return {sym_graph->node(SymOp::EXP, a.id), std::exp(a.v)}; }
+Sym tanh(const Sym& a) { return {sym_graph->node(SymOp::TANH, a.id), std::tanh(a.v)}; }
+Sym sqrt(const Sym& a) { return {sym_graph->node(SymOp::SQRT, a.id), std::sqrt(a.v)}; }
+
+Sym pow(const Sym& a, const Sym& b) {
+    const SymNode& e = (*sym_graph)[b.id];
+    if (e.op != SymOp::CONST || e.k != std::nearbyint(e.k) || std::fabs(e.k) > 64) {
+        if (sym_graph->unsupported.empty())
+            sym_graph->unsupported = "pow with a non-constant or non-integer exponent";
+        return {sym_graph->constant(0.0), std::pow(a.v, b.v)};
+    }
+    return {sym_graph->node(SymOp::POWI, a.id, -1, -1, e.k), std::pow(a.v, b.v)};
+}
+
+static bool guard(const Sym& a, const Sym& b, bool or_equal) {
+    bool taken = or_equal ? a.v <= b.v : a.v < b.v;
+    sym_graph->guards.push_back({a.id, b.id, or_equal, taken});
+    return taken;
+}
+bool operator<(const Sym& a, const Sym& b) { return guard(a, b, false); }
+bool operator>(const Sym& a, const Sym& b) { return guard(b, a, false); }
+bool operator<=(const Sym& a, const Sym& b) { return guard(a, b, true); }
+
+int sym_rounding_units(SymOp op) {
+    switch (op) {
+    case SymOp::ADD:
+    case SymOp::SUB:
+    case SymOp::MUL:
+    case SymOp::DIV:
+    case SymOp::FMA:
+    case SymOp::SQRT: return 1;
+    // libm: documented ulps, err_unit being half an ulp
+    case SymOp::EXP: return 2 * EXP_ULPS;
+    case SymOp::TANH: return 2 * TANH_ULPS;
+    case SymOp::POWI: return 2 * POW_ULPS;
+    default: return 0;
+    }
+}
+
+std::vector<SymError> first_order_error(SymGraph& g, const std::vector<int>& outputs) {
+    int traced = g.size();
+    std::vector<SymError> errors;
+    for (int out : outputs) {
+        // adj[k] = d out / d k, -1 where out does not depend on k.
+        std::vector<int> adj(size_t(traced), -1);
+        auto accumulate = [&](int k, int d) {
+            adj[size_t(k)] = adj[size_t(k)] < 0 ? d : g.node(SymOp::ADD, adj[size_t(k)], d);
+        };
+        adj[size_t(out)] = g.constant(1.0);
+        SymError sum = {g.constant(0.0), g.constant(0.0)};
+        for (int k = out; k >= 0; k--) {
+            int d = adj[size_t(k)];
+            if (d < 0)
+                continue;
+            SymNode n = g[k];
+            auto mul = [&](int x) { return g.node(SymOp::MUL, d, x); };
+            switch (n.op) {
+            case SymOp::ADD:
+                accumulate(n.a, d);
+                accumulate(n.b, d);
+                break;
+            case SymOp::SUB:
+                accumulate(n.a, d);
+                accumulate(n.b, g.node(SymOp::NEG, d));
+                break;
+            case SymOp::NEG: accumulate(n.a, g.node(SymOp::NEG, d)); break;
+            case SymOp::MUL:
+                accumulate(n.a, mul(n.b));
+                accumulate(n.b, mul(n.a));
+                break;
+            case SymOp::DIV:
+                // d(a/b)/da = 1/b, d(a/b)/db = -(a/b)/b
+                accumulate(n.a, g.node(SymOp::DIV, d, n.b));
+                accumulate(n.b, g.node(SymOp::NEG, g.node(SymOp::DIV, mul(k), n.b)));
+                break;
+            case SymOp::FMA:
+                accumulate(n.a, mul(n.b));
+                accumulate(n.b, mul(n.a));
+                accumulate(n.c, d);
+                break;
+            case SymOp::EXP: accumulate(n.a, mul(k)); break;
+            case SymOp::TANH:
+                accumulate(n.a, mul(g.node(SymOp::SUB, g.constant(1.0),
+                                           g.node(SymOp::MUL, k, k))));
+                break;
+            case SymOp::SQRT: accumulate(n.a, g.node(SymOp::DIV, mul(g.constant(0.5)), k)); break;
+            case SymOp::POWI:
+                accumulate(n.a, mul(g.node(SymOp::MUL, g.constant(n.k),
+                                           g.node(SymOp::POWI, n.a, -1, -1, n.k - 1))));
+                break;
+            default: break;
+            }
+            int units = sym_rounding_units(n.op);
+            if (units) {
+                int c = g.constant(units);
+                int rel = g.node(SymOp::ABS, g.node(SymOp::MUL, d, k));
+                sum.rel = g.node(SymOp::ADD, sum.rel, g.node(SymOp::MUL, c, rel));
+                sum.abs = g.node(SymOp::ADD, sum.abs, g.node(SymOp::MUL, c, g.node(SymOp::ABS, d)));
+            }
+        }
+        errors.push_back(sum);
+    }
+    return errors;
+}
+
+// --- code generation ---
+
+/*
+ * Interval primitives of the generated code. Bounds move outward by at
+ * least one ulp with plain arithmetic instead of nextafter, libm results
+ * one ulp more than the function's documented error (EXP_ULPS, TANH_ULPS
+ * in interval.hpp), so the loop over boxes stays branch-free and
+ * vectorizes. The
+ * pad is the smallest normal rather than the smallest subnormal: a
+ * subnormal operand costs a microcode assist on every bound. Division by
+ * an interval containing zero and sqrt of a negative part count into bad,
+ * which makes the box's error infinite; bad is a double, as is the status,
+ * so all lanes of the loop are 64-bit.
+ */
+static const char* PRELUDE = R"(#include <cmath>
+#include <cstddef>
+
+namespace {
+
+struct I {
+    double lo, hi;
+};
+
+inline double dn(double x) { return x - (std::fabs(x) * 0x1p-52 + 0x1p-1022); }
+inline double up(double x) { return x + (std::fabs(x) * 0x1p-52 + 0x1p-1022); }
+inline double mn(double a, double b) { return a < b ? a : b; }
+inline double mx(double a, double b) { return a > b ? a : b; }
+
+inline I add(I a, I b) { return {dn(a.lo + b.lo), up(a.hi + b.hi)}; }
+inline I sub(I a, I b) { return {dn(a.lo - b.hi), up(a.hi - b.lo)}; }
+inline I neg(I a) { return {-a.hi, -a.lo}; }
+inline I mul(I a, I b) {
+    double p = a.lo * b.lo, q = a.lo * b.hi, r = a.hi * b.lo, s = a.hi * b.hi;
+    return {dn(mn(mn(p, q), mn(r, s))), up(mx(mx(p, q), mx(r, s)))};
+}
+inline I div(I a, I b, double& bad) {
+    bad += mx(b.lo, -b.hi) <= 0.0 ? 1.0 : 0.0;
+    double p = a.lo / b.lo, q = a.lo / b.hi, r = a.hi / b.lo, s = a.hi / b.hi;
+    return {dn(mn(mn(p, q), mn(r, s))), up(mx(mx(p, q), mx(r, s)))};
+}
+inline I fma_(I a, I b, I c) { return add(mul(a, b), c); }
+inline I exp_(I a) { return {mx(dn(dn(std::exp(a.lo))), 0.0), up(up(std::exp(a.hi)))}; }
+inline I tanh_(I a) {
+    return {mx(dn(dn(dn(std::tanh(a.lo)))), -1.0), mn(up(up(up(std::tanh(a.hi)))), 1.0)};
+}
+inline I sqrt_(I a, double& bad) {
+    bad += a.lo < 0.0 ? 1.0 : 0.0;
+    return {mx(dn(std::sqrt(mx(a.lo, 0.0))), 0.0), up(std::sqrt(mx(a.hi, 0.0)))};
+}
+inline I abs_(I a) {
+    return {mx(mx(a.lo, -a.hi), 0.0), mx(-a.lo, a.hi)};
+}
+inline I even(I a) { return {mx(a.lo, 0.0), a.hi}; }
+inline I widen(I a, double e) { return {dn(a.lo - e), up(a.hi + e)}; }
+
+}  // namespace
+)";
+
+static std::string hexd(double v) {
+    char buf[40];
+    snprintf(buf, sizeof buf, "%a", v);
+    return buf;
+}
+
+std::string emit_evaluator(const SymGraph& g, const std::vector<int>& outputs,
+                           const std::vector<SymError>& errors,
+                           const std::vector<SymError>& guard_errors, const std::string& title) {
+    // Only the nodes the results and guards depend on.
+    std::vector<char> live(size_t(g.size()), 0);
+    std::vector<int> roots(outputs);
+    for (const auto* es : {&errors, &guard_errors}) {
+        for (const SymError& e : *es) {
+            roots.push_back(e.rel);
+            roots.push_back(e.abs);
+        }
+    }
+    for (const SymGuard& gd : g.guards) {
+        roots.push_back(gd.lhs);
+        roots.push_back(gd.rhs);
+    }
+    for (int r : roots)
+        live[size_t(r)] = 1;
+    for (int k = g.size() - 1; k >= 0; k--) {
+        if (!live[size_t(k)])
+            continue;
+        for (int id : {g[k].a, g[k].b, g[k].c})
+            if (id >= 0)
+                live[size_t(id)] = 1;
+    }
+
+    std::string src = "// " + title + "\n// Generated by reu (src/symexpr.cpp); do not edit.\n";
+    src += PRELUDE;
+    src += R"(
+extern "C" void reu_errexpr_eval(size_t n, size_t stride, const double* __restrict lo,
+                                 const double* __restrict hi, double unit, double tiny,
+                                 double* __restrict out_lo, double* __restrict out_hi,
+                                 double* __restrict err, int* __restrict status) {
+    for (size_t b = 0; b < n; b++) {
+        double bad = 0.0;
+)";
+    auto t = [](int id) { return "t" + std::to_string(id); };
+    for (int k = 0; k < g.size(); k++) {
+        if (!live[size_t(k)])
+            continue;
+        const SymNode& n = g[k];
+        std::string a = n.a >= 0 ? t(n.a) : "", b = n.b >= 0 ? t(n.b) : "";
+        std::string e;
+        switch (n.op) {
+        case SymOp::INPUT: {
+            std::string at = "[" + std::to_string(int(n.k)) + " * stride + b]";
+            e = "{lo" + at + ", hi" + at + "}";
+            break;
+        }
+        case SymOp::CONST: e = "{" + hexd(n.k) + ", " + hexd(n.k) + "}"; break;
+        case SymOp::ADD: e = "add(" + a + ", " + b + ")"; break;
+        case SymOp::SUB: e = "sub(" + a + ", " + b + ")"; break;
+        case SymOp::NEG: e = "neg(" + a + ")"; break;
+        case SymOp::MUL:
+            e = a == b ? "even(mul(" + a + ", " + a + "))" : "mul(" + a + ", " + b + ")";
+            break;
+        case SymOp::DIV: e = "div(" + a + ", " + b + ", bad)"; break;
+        case SymOp::FMA: e = "fma_(" + a + ", " + b + ", " + t(n.c) + ")"; break;
+        case SymOp::EXP: e = "exp_(" + a + ")"; break;
+        case SymOp::TANH: e = "tanh_(" + a + ")"; break;
+        case SymOp::SQRT: e = "sqrt_(" + a + ", bad)"; break;
+        case SymOp::ABS: e = "abs_(" + a + ")"; break;
+        case SymOp::POWI: {
+            int p = int(std::fabs(n.k));
+            e = a;
+            for (int i = 1; i < p; i++)
+                e = "mul(" + e + ", " + a + ")";
+            if (p % 2 == 0)
+                e = "even(" + e + ")";
+            if (n.k < 0)
+                e = "div({1.0, 1.0}, " + e + ", bad)";
+            break;
+        }
+        }
+        src += "        I " + t(k) + " = " + e + ";\n";
+    }
+
+    auto bound = [&](const SymError& e) {
+        return "up(up(unit * " + t(e.rel) + ".hi) + up(tiny * " + t(e.abs) + ".hi))";
+    };
+    // The first guard not decided the traced way over the whole box sets the
+    // status: 1 if it is decided the other way, 2 if it goes both ways. Both
+    // operands are widened by their error bound first, so a comparison the
+    // floating-point run may decide differently from the exact one is 2.
+    src += "        double st = 0.0;\n";
+    for (size_t i = 0; i < g.guards.size(); i++) {
+        const SymGuard& gd = g.guards[i];
+        std::string l = "gl" + std::to_string(i), r = "gr" + std::to_string(i);
+        src += "        I " + l + " = widen(" + t(gd.lhs) + ", " + bound(guard_errors[2 * i]) +
+               ");\n";
+        src += "        I " + r + " = widen(" + t(gd.rhs) + ", " +
+               bound(guard_errors[2 * i + 1]) + ");\n";
+        std::string yes = gd.or_equal ? l + ".hi <= " + r + ".lo" : l + ".hi < " + r + ".lo";
+        std::string no = gd.or_equal ? l + ".lo > " + r + ".hi" : l + ".lo >= " + r + ".hi";
+        if (!gd.taken)
+            std::swap(yes, no);
+        src += "        st = st != 0.0 ? st : " + yes + " ? 0.0 : " + no + " ? 1.0 : 2.0;\n";
+    }
+    src += "        status[b] = int(st);\n";
+    for (size_t o = 0; o < outputs.size(); o++) {
+        std::string at = "[" + std::to_string(o) + " * stride + b]";
+        std::string v = t(outputs[o]), e = "e" + std::to_string(o);
+        src += "        out_lo" + at + " = bad == 0.0 ? " + v + ".lo : -INFINITY;\n";
+        src += "        out_hi" + at + " = bad == 0.0 ? " + v + ".hi : INFINITY;\n";
+        src += "        double " + e + " = " + bound(errors[o]) + ";\n";
+        // NaN anywhere in the value or the bound also fails these tests.
+        src += "        " + e + " = bad == 0.0 && " + v + ".lo <= " + v + ".hi ? " + e +
+               " : INFINITY;\n";
+        src += "        err" + at + " = " + e + " >= 0.0 ? " + e + " : INFINITY;\n";
+    }
+    src += "    }\n}\n";
+    return src;
+}
+
+}  // namespace reu
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Symbolic expressions of a kernel, for compiling its first-order error
+ * model once (errexpr.hpp). Evaluating a kernel with Sym records each
+ * operation as a node of the thread's sym_graph and also computes it in
+ * double at the traced input. That value decides the kernel's branches, so
+ * a trace is one path through the kernel; every comparison on the way is
+ * kept as a guard. Nodes are hash-consed and folded, so equal
+ * subexpressions are one node and operands always precede their users.
+ */
+enum class SymOp : uint8_t {
+    INPUT,  // k = input index
+    CONST,  // k = value
+    ADD,
+    SUB,
+    NEG,
+    MUL,
+    DIV,
+    FMA,
+    EXP,
+    TANH,
+    SQRT,
+    POWI,  // a^k for an integer k
+    ABS,
+};
+
+struct SymNode {
+    SymOp op;
+    int a = -1, b = -1, c = -1;
+    double k = 0;
+};
+
+// lhs < rhs (or <=) at the traced input, with the outcome of the traced path.
+struct SymGuard {
+    int lhs, rhs;
+    bool or_equal;
+    bool taken;
+};
+
+class SymGraph {
+public:
+    int input(int i) { return node(SymOp::INPUT, -1, -1, -1, i); }
+    int constant(double v) { return node(SymOp::CONST, -1, -1, -1, v); }
+    // New or existing node; constant operands are folded.
+    int node(SymOp op, int a, int b = -1, int c = -1, double k = 0);
+
+    const SymNode& operator[](int id) const { return nodes_[size_t(id)]; }
+    int size() const { return int(nodes_.size()); }
+    bool is_const(int id, double v) const {
+        return nodes_[size_t(id)].op == SymOp::CONST && nodes_[size_t(id)].k == v;
+    }
+
+    std::vector<SymGuard> guards;
+    std::string unsupported;  // first operation the trace could not represent
+
+private:
+    std::vector<SymNode> nodes_;
+    std::unordered_map<std::string, int> memo_;
+};
+
+extern thread_local SymGraph* sym_graph;
+
+/*
+ * Traced number: a node of sym_graph and its double value at the traced
+ * input. sym_graph must be set while kernels are evaluated with Sym.
+ */
+struct Sym {
+    int id = -1;
+    double v = 0.0;
+
+    Sym() = default;
+    Sym(double x) : id(sym_graph->constant(x)), v(x) {}
+    Sym(int node, double value) : id(node), v(value) {}
+};
+
+Sym operator+(const Sym& a, const Sym& b);
+Sym operator-(const Sym& a, const Sym& b);
+Sym operator-(const Sym& a);
+Sym operator*(const Sym& a, const Sym& b);
+Sym operator/(const Sym& a, const Sym& b);
+Sym fma(const Sym& a, const Sym& b, const Sym& c);
+Sym exp(const Sym& a);
+Sym tanh(const Sym& a);
+Sym sqrt(const Sym& a);
+Sym pow(const Sym& a, const Sym& b);  // constant integer exponents only
+bool operator<(const Sym& a, const Sym& b);
+bool operator>(const Sym& a, const Sym& b);
+bool operator<=(const Sym& a, const Sym& b);
+
+// Units of err_unit one rounding of a node of this kind adds (0 if exact).
+int sym_rounding_units(SymOp op);
+
+/*
+ * First-order error expression of each output: for the rounded nodes k,
+ * with units_k from sym_rounding_units and the derivatives d out / d k built
+ * by reverse accumulation as new nodes of g,
+ *
+ *   |error| <= err_unit * sum units_k |d out / d k| |k|     (rel)
+ *            + err_tiny * sum units_k |d out / d k|         (abs, underflow)
+ *
+ * which is CIRE's first-order bound: higher-order terms are dropped.
+ */
+struct SymError {
+    int rel, abs;
+};
+
+std::vector<SymError> first_order_error(SymGraph& g, const std::vector<int>& outputs);
+
+/*
+ * C++ source of a batched interval evaluator of the outputs, their error
+ * expressions and the guards of g (ErrExprFn in errexpr.hpp), as one
+ * self-contained translation unit. guard_errors holds the error
+ * expressions of the guards' lhs and rhs, two per guard; each guard is
+ * tested on its operands widened by them.
+ */
+std::string emit_evaluator(const SymGraph& g, const std::vector<int>& outputs,
+                           const std::vector<SymError>& errors,
+                           const std::vector<SymError>& guard_errors, const std::string& title);
+
+}  // namespace reu
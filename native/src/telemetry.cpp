@@ -0,0 +1,338 @@
+#include "telemetry.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace reu {
+
+struct Telemetry::Totals {
+    double elapsed = 0;
+    uint64_t items = 0, samples = 0, failures = 0, busy_ns = 0, hits = 0, misses = 0;
+    uint64_t latency[WorkerCounters::LAT_BUCKETS] = {};
+    std::vector<uint64_t> worker_items, worker_busy;
+    double rate = 0, recent_rate = 0, eta = NAN, queue = NAN;
+    std::map<std::string, double> gauges;
+
+    // Per-sample latency quantile in seconds, interpolated geometrically
+    // inside the log2 bucket.
+    double quantile(double q) const {
+        if (!samples)
+            return NAN;
+        double want = q * double(samples), seen = 0;
+        for (int b = 0; b < WorkerCounters::LAT_BUCKETS; b++) {
+            if (seen + double(latency[b]) >= want && latency[b]) {
+                double f = (want - seen) / double(latency[b]);
+                return std::ldexp(std::pow(2.0, f), b) * 1e-9;
+            }
+            seen += double(latency[b]);
+        }
+        return std::ldexp(1.0, WorkerCounters::LAT_BUCKETS) * 1e-9;
+    }
+};
+
+Telemetry::Telemetry(std::string job, unsigned workers, uint64_t total)
+    : job_(std::move(job)), total_(total), t0_(telemetry_now_ns()),
+      slots_(workers ? workers : 1) {
+    last_t_ = t0_;
+}
+
+void Telemetry::set_gauge(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gauges_[name] = value;
+}
+
+Telemetry::Totals Telemetry::totals() {
+    Totals t;
+    auto rd = [](const std::atomic<uint64_t>& c) { return c.load(std::memory_order_relaxed); };
+    uint64_t now = telemetry_now_ns();
+    t.elapsed = double(now - t0_) * 1e-9;
+    for (const auto& w : slots_) {
+        uint64_t items = rd(w.items), busy = rd(w.busy_ns);
+        t.worker_items.push_back(items);
+        t.worker_busy.push_back(busy);
+        t.items += items;
+        t.busy_ns += busy;
+        t.samples += rd(w.samples);
+        t.failures += rd(w.failures);
+        t.hits += rd(w.cache_hits);
+        t.misses += rd(w.cache_misses);
+        for (int b = 0; b < WorkerCounters::LAT_BUCKETS; b++)
+            t.latency[b] += rd(w.latency[b]);
+    }
+    t.rate = t.elapsed > 0 ? double(t.samples) / t.elapsed : 0;
+    uint64_t total = total_;
+    if (total) {
+        t.queue = double(total > t.items ? total - t.items : 0);
+        double item_rate = t.elapsed > 0 ? double(t.items) / t.elapsed : 0;
+        t.eta = t.queue == 0 ? 0 : item_rate > 0 ? t.queue / item_rate : NAN;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Throughput over the last second or more, whoever asked last.
+    if (now - last_t_ >= 1000000000ull) {
+        recent_rate_ = double(t.samples - last_samples_) / (double(now - last_t_) * 1e-9);
+        last_t_ = now;
+        last_samples_ = t.samples;
+    }
+    t.recent_rate = recent_rate_;
+    t.gauges = gauges_;
+    return t;
+}
+
+std::string Telemetry::prometheus() {
+    Totals t = totals();
+    std::string out;
+    char line[512];
+    auto metric = [&](const char* name, const char* type, const char* help) {
+        snprintf(line, sizeof line, "# HELP reu_%s %s\n# TYPE reu_%s %s\n", name, help, name, type);
+        out += line;
+    };
+    auto value = [&](const char* name, const char* labels, double v) {
+        snprintf(line, sizeof line, "reu_%s{job=\"%s\"%s} %.17g\n", name, job_.c_str(), labels, v);
+        out += line;
+    };
+    metric("elapsed_seconds", "gauge", "Time since the run started");
+    value("elapsed_seconds", "", t.elapsed);
+    metric("items_total", "counter", "Work items finished (points, CIRE runs, stages)");
+    value("items_total", "", double(t.items));
+    metric("samples_total", "counter", "Samples finished");
+    value("samples_total", "", double(t.samples));
+    metric("failures_total", "counter", "Samples or items without a result");
+    value("failures_total", "", double(t.failures));
+    metric("samples_per_second", "gauge", "Sample throughput since the start");
+    value("samples_per_second", "", t.rate);
+    metric("recent_samples_per_second", "gauge", "Sample throughput over the last second or more");
+    value("recent_samples_per_second", "", t.recent_rate);
+    metric("queue_depth", "gauge", "Work items not finished yet");
+    value("queue_depth", "", t.queue);
+    metric("eta_seconds", "gauge", "Estimated time to finish at the average item rate");
+    value("eta_seconds", "", t.eta);
+    metric("cache_hits_total", "counter", "Work served from a cache");
+    value("cache_hits_total", "", double(t.hits));
+    metric("cache_misses_total", "counter", "Work that missed the cache");
+    value("cache_misses_total", "", double(t.misses));
+
+    metric("worker_items_total", "counter", "Work items finished per worker");
+    for (size_t w = 0; w < t.worker_items.size(); w++) {
+        snprintf(line, sizeof line, ",worker=\"%zu\"", w);
+        std::string l = line;
+        value("worker_items_total", l.c_str(), double(t.worker_items[w]));
+    }
+    metric("worker_utilization", "gauge", "Fraction of the elapsed time a worker was busy");
+    for (size_t w = 0; w < t.worker_busy.size(); w++) {
+        snprintf(line, sizeof line, ",worker=\"%zu\"", w);
+        std::string l = line;
+        value("worker_utilization", l.c_str(),
+              t.elapsed > 0 ? double(t.worker_busy[w]) * 1e-9 / t.elapsed : 0);
+    }
+
+    metric("sample_latency_seconds", "histogram", "Time per sample");
+    uint64_t cum = 0;
+    int top = WorkerCounters::LAT_BUCKETS - 1;
+    while (top > 0 && !t.latency[top])
+        top--;
+    for (int b = 0; b <= top; b++) {
+        cum += t.latency[b];
+        char le[64];
+        snprintf(le, sizeof le, ",le=\"%.9g\"", std::ldexp(1.0, b + 1) * 1e-9);
+        value("sample_latency_seconds_bucket", le, double(cum));
+    }
+    value("sample_latency_seconds_bucket", ",le=\"+Inf\"", double(t.samples));
+    value("sample_latency_seconds_sum", "", double(t.busy_ns) * 1e-9);
+    value("sample_latency_seconds_count", "", double(t.samples));
+
+    for (const auto& g : t.gauges) {
+        std::string name = "gauge_" + g.first;
+        metric(name.c_str(), "gauge", "Caller-defined gauge");
+        value(name.c_str(), "", g.second);
+    }
+    return out;
+}
+
+static std::string json_num(double v) {
+    if (!std::isfinite(v))
+        return "null";
+    char buf[32];
+    snprintf(buf, sizeof buf, "%.6g", v);
+    return buf;
+}
+
+std::string Telemetry::json() {
+    Totals t = totals();
+    std::string out = "{\"job\":\"" + job_ + "\"";
+    auto field = [&](const char* name, double v) {
+        out += std::string(",\"") + name + "\":" + json_num(v);
+    };
+    field("elapsed", t.elapsed);
+    field("items", double(t.items));
+    uint64_t total = total_;
+    field("total", total ? double(total) : NAN);
+    field("samples", double(t.samples));
+    field("failures", double(t.failures));
+    field("samples_per_sec", t.rate);
+    field("recent_samples_per_sec", t.recent_rate);
+    field("queue_depth", t.queue);
+    field("eta", t.eta);
+    uint64_t lookups = t.hits + t.misses;
+    field("cache_hit_rate", lookups ? double(t.hits) / double(lookups) : NAN);
+    field("latency_p50", t.quantile(0.5));
+    field("latency_p90", t.quantile(0.9));
+    field("latency_p99", t.quantile(0.99));
+    for (const auto& g : t.gauges)
+        field(g.first.c_str(), g.second);
+    out += ",\"utilization\":[";
+    for (size_t w = 0; w < t.worker_busy.size(); w++)
+        out += (w ? "," : "") +
+               json_num(t.elapsed > 0 ? double(t.worker_busy[w]) * 1e-9 / t.elapsed : 0);
+    return out + "]}";
+}
+
+bool Telemetry::start_http(int port, std::string& err) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        err = std::string("socket: ") + strerror(errno);
+        return false;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(uint16_t(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof addr;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 || listen(fd, 16) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        err = "cannot listen on 127.0.0.1:" + std::to_string(port) + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+    listen_fd_ = fd;
+    port_ = ntohs(addr.sin_port);
+    http_ = std::thread(&Telemetry::serve, this);
+    return true;
+}
+
+void Telemetry::serve() {
+    while (!stop_) {
+        struct pollfd p = {listen_fd_, POLLIN, 0};
+        if (poll(&p, 1, 200) <= 0)
+            continue;
+        int c = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (c < 0)
+            continue;
+        // The request line is all that matters; give a slow client a second.
+        std::string req;
+        char buf[2048];
+        while (req.find("\r\n") == std::string::npos && req.size() < 8192) {
+            struct pollfd q = {c, POLLIN, 0};
+            if (poll(&q, 1, 1000) <= 0)
+                break;
+            ssize_t n = read(c, buf, sizeof buf);
+            if (n <= 0)
+                break;
+            req.append(buf, size_t(n));
+        }
+        std::string path;
+        if (req.compare(0, 4, "GET ") == 0)
+            path = req.substr(4, req.find(' ', 4) - 4);
+        std::string body, type = "text/plain; version=0.0.4", status = "200 OK";
+        if (path == "/metrics") {
+            body = prometheus();
+        } else if (path == "/metrics.json") {
+            body = json() + "\n";
+            type = "application/json";
+        } else {
+            status = "404 Not Found";
+            body = "try /metrics or /metrics.json\n";
+            type = "text/plain";
+        }
+        std::string resp = "HTTP/1.0 " + status + "\r\nContent-Type: " + type +
+                           "\r\nContent-Length: " + std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+        for (size_t off = 0; off < resp.size();) {
+            ssize_t n = send(c, resp.data() + off, resp.size() - off, MSG_NOSIGNAL);
+            if (n <= 0)
+                break;
+            off += size_t(n);
+        }
+        close(c);
+    }
+}
+
+bool Telemetry::start_log(const std::string& path, double seconds, std::string& err) {
+    log_file_ = path == "-" ? stderr : fopen(path.c_str(), "a");
+    if (!log_file_) {
+        err = "Cannot write '" + path + "'";
+        return false;
+    }
+    log_period_ = seconds > 0 ? seconds : 10;
+    log_ = std::thread(&Telemetry::log_loop, this);
+    return true;
+}
+
+void Telemetry::log_loop() {
+    uint64_t next = telemetry_now_ns() + uint64_t(log_period_ * 1e9);
+    while (!stop_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (telemetry_now_ns() < next)
+            continue;
+        fprintf(log_file_, "%s\n", json().c_str());
+        fflush(log_file_);
+        next += uint64_t(log_period_ * 1e9);
+    }
+    fprintf(log_file_, "%s\n", json().c_str());
+    fflush(log_file_);
+}
+
+void Telemetry::stop() {
+    stop_ = true;
+    if (http_.joinable())
+        http_.join();
+    if (log_.joinable())
+        log_.join();
+    if (listen_fd_ >= 0)
+        close(listen_fd_);
+    listen_fd_ = -1;
+    if (log_file_ && log_file_ != stderr)
+        fclose(log_file_);
+    log_file_ = nullptr;
+}
+
+bool start_telemetry(Telemetry& t, int http_port, const std::string& log_spec) {
+    std::string err;
+    if (http_port >= 0) {
+        if (!t.start_http(http_port, err)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return false;
+        }
+        printf("Telemetry: http://127.0.0.1:%d/metrics\n", t.port());
+    }
+    if (!log_spec.empty()) {
+        std::string path = log_spec;
+        double seconds = 10;
+        size_t colon = path.rfind(':');
+        char* end = nullptr;
+        if (colon != std::string::npos) {
+            double s = strtod(path.c_str() + colon + 1, &end);
+            if (end && *end == '\0' && s > 0) {
+                seconds = s;
+                path.erase(colon);
+            }
+        }
+        if (!t.start_log(path, seconds, err)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace reu
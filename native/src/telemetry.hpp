@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Live progress of a long run (fpsweep, cirebatch, pipeline) instead of
+ * polling `wc -l` on output files: throughput, per-worker utilization,
+ * per-sample latency, queue depth, cache hit rate and ETA, served as
+ * Prometheus text on a local HTTP port and/or appended as JSON lines to a
+ * log every few seconds.
+ *
+ * The hot path only touches its own worker's counters: each worker writes
+ * plain relaxed loads and stores to a cache-line-aligned slot (no locked
+ * instructions, no sharing), once per work item rather than per sample.
+ * Readers sum the slots when a scrape or log line asks for them.
+ */
+struct alignas(64) WorkerCounters {
+    static constexpr int LAT_BUCKETS = 40;  // log2 of the latency in ns
+
+    std::atomic<uint64_t> items{0};    // points, CIRE runs, stages
+    std::atomic<uint64_t> samples{0};  // samples within the items
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> busy_ns{0};
+    std::atomic<uint64_t> cache_hits{0}, cache_misses{0};
+    std::atomic<uint64_t> latency[LAT_BUCKETS] = {};  // samples by per-sample latency
+
+    // One finished item of `n` samples that took `ns`. Owner thread only.
+    void record(uint64_t n, uint64_t ns) {
+        bump(items, 1);
+        bump(samples, n);
+        bump(busy_ns, ns);
+        if (n) {
+            uint64_t per = ns / n;
+            int b = per ? 63 - __builtin_clzll(per) : 0;
+            bump(latency[b < LAT_BUCKETS ? b : LAT_BUCKETS - 1], n);
+        }
+    }
+    static void bump(std::atomic<uint64_t>& c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+inline uint64_t telemetry_now_ns() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count());
+}
+
+class Telemetry {
+public:
+    // total: work items expected (for queue depth and ETA), 0 if unknown.
+    Telemetry(std::string job, unsigned workers, uint64_t total);
+    ~Telemetry() { stop(); }
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+    WorkerCounters& worker(unsigned w) { return slots_[w]; }
+    void set_total(uint64_t total) { total_ = total; }
+    unsigned workers() const { return unsigned(slots_.size()); }
+
+    // Named gauges for the caller's own queues ("ready", "running"); cold path.
+    void set_gauge(const std::string& name, double value);
+
+    std::string prometheus();
+    std::string json();  // one line, no newline
+
+    /*
+     * Serve GET /metrics (Prometheus text) and /metrics.json on
+     * 127.0.0.1:port from a background thread; port 0 picks a free one,
+     * returned by port(). Returns false if the socket cannot be bound.
+     */
+    bool start_http(int port, std::string& err);
+    int port() const { return port_; }
+    // Append json() to path ("-" for stderr) every `seconds`, and once more at stop().
+    bool start_log(const std::string& path, double seconds, std::string& err);
+    void stop();
+
+private:
+    struct Totals;
+    Totals totals();
+    void serve();
+    void log_loop();
+
+    std::string job_;
+    std::atomic<uint64_t> total_;
+    uint64_t t0_;
+    std::vector<WorkerCounters> slots_;
+    std::mutex mutex_;  // gauges_, rate window
+    std::map<std::string, double> gauges_;
+    uint64_t last_t_ = 0, last_samples_ = 0;
+    double recent_rate_ = 0;
+
+    std::atomic<bool> stop_{false};
+    int listen_fd_ = -1, port_ = 0;
+    std::thread http_, log_;
+    FILE* log_file_ = nullptr;
+    double log_period_ = 10;
+};
+
+/*
+ * "-H PORT" / "-J FILE[:SECONDS]" handling shared by the tools: starts what
+ * was asked for and reports where. Returns false (and prints) on failure.
+ */
+bool start_telemetry(Telemetry& t, int http_port, const std::string& log_spec);
+
+}  // namespace reu
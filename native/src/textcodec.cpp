@@ -0,0 +1,310 @@
+#include "textcodec.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "parallel.hpp"
+
+namespace reu {
+
+char* format_double(char* p, double v) {
+    if (std::isnan(v)) {
+        memcpy(p, "nan", 3);
+        return p + 3;
+    }
+    return std::to_chars(p, p + DOUBLE_CHARS, v).ptr;
+}
+
+std::string format_double(double v) {
+    char buf[DOUBLE_CHARS];
+    return std::string(buf, format_double(buf, v));
+}
+
+// The number at the start of [p, e): its end, or nullptr if there is none.
+static const char* scan_double(const char* p, const char* e, double& v) {
+    if (p < e && *p == '+' && ++p < e && *p == '-')
+        return nullptr;
+    auto r = std::from_chars(p, e, v);
+    if (r.ec == std::errc::result_out_of_range) {
+        // from_chars leaves v alone here; strtod saturates like printf wrote it.
+        std::string text(p, r.ptr);
+        v = strtod(text.c_str(), nullptr);
+        return r.ptr;
+    }
+    return r.ec == std::errc() ? r.ptr : nullptr;
+}
+
+bool parse_double(const char* p, const char* e, double& v) {
+    return scan_double(p, e, v) == e;
+}
+
+namespace {
+
+constexpr size_t CHUNK = size_t(8) << 20;  // bytes read per job and round
+constexpr size_t BLOCK = size_t(1) << 16;  // rows formatted per job and round
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline void trim(const char*& p, const char*& e) {
+    while (p < e && is_space(*p))
+        p++;
+    while (e > p && is_space(e[-1]))
+        e--;
+}
+
+// Fields of one line: 1 for a row of `n` numbers in row, 0 for a blank or
+// comment line, -1 for anything else.
+int parse_row(const char* p, const char* e, bool csv, size_t n, double* row) {
+    trim(p, e);
+    if (p == e || *p == '#')
+        return 0;
+    size_t k = 0;
+    if (csv) {
+        for (;;) {
+            while (p < e && is_space(*p))
+                p++;
+            if (k == n)
+                return -1;
+            const char* q = p;
+            if (p == e || *p == ',')
+                row[k] = NAN;
+            else if (!(q = scan_double(p, e, row[k])))
+                return -1;
+            while (q < e && is_space(*q))
+                q++;
+            k++;
+            if (q == e)
+                break;
+            if (*q != ',')
+                return -1;
+            p = q + 1;
+        }
+    } else {
+        // One pass per field: the number's end must be a separator.
+        while (p < e) {
+            const char* q = k < n ? scan_double(p, e, row[k]) : nullptr;
+            if (!q || (q < e && !is_space(*q)))
+                return -1;
+            k++;
+            for (p = q; p < e && is_space(*p);)
+                p++;
+        }
+    }
+    return k == n ? 1 : -1;
+}
+
+struct Part {
+    std::vector<std::vector<double>> cols;
+    size_t skipped = 0;
+};
+
+void parse_lines(const char* p, const char* e, bool csv, size_t n, Part& part) {
+    part.cols.assign(n, {});
+    part.skipped = 0;
+    std::vector<double> row(n);
+    while (p < e) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', size_t(e - p)));
+        const char* le = nl ? nl : e;
+        int r = parse_row(p, le, csv, n, row.data());
+        if (r > 0) {
+            for (size_t c = 0; c < n; c++)
+                part.cols[c].push_back(row[c]);
+        } else if (r < 0) {
+            part.skipped++;
+        }
+        p = nl ? nl + 1 : e;
+    }
+}
+
+/*
+ * Finds the header in [p, e), whole lines only. Returns where the data
+ * starts (the header line itself when it is all numbers), or nullptr if
+ * there are only comments so far.
+ */
+const char* parse_header(const char* p, const char* e, TextTable& t, bool& csv) {
+    while (p < e) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', size_t(e - p)));
+        const char *a = p, *b = nl ? nl : e;
+        const char* next = nl ? nl + 1 : e;
+        trim(a, b);
+        if (a == b || *a == '#') {
+            p = next;
+            continue;
+        }
+        csv = memchr(a, ',', size_t(b - a)) != nullptr;
+        bool numeric = true;
+        double v;
+        while (a <= b) {
+            const char* q = a;
+            while (q < b && (csv ? *q != ',' : !is_space(*q)))
+                q++;
+            const char *fa = a, *fb = q;
+            trim(fa, fb);
+            if (fb - fa >= 2 && *fa == '"' && fb[-1] == '"') {
+                fa++;
+                fb--;
+            }
+            numeric = numeric && parse_double(fa, fb, v);
+            t.names.emplace_back(fa, fb);
+            if (q == b)
+                break;
+            for (a = q + 1; !csv && a < b && is_space(*a);)
+                a++;
+        }
+        if (numeric) {
+            for (size_t c = 0; c < t.names.size(); c++)
+                t.names[c] = "c" + std::to_string(c);
+            next = p;
+        }
+        t.columns.assign(t.names.size(), {});
+        return next;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+bool read_text_table(const std::string& path, unsigned jobs, TextTable& out, std::string& err) {
+    out = TextTable();
+    bool use_stdin = path == "-";
+    FILE* f = use_stdin ? stdin : fopen(path.c_str(), "rb");
+    if (!f) {
+        err = "Cannot read '" + path + "'";
+        return false;
+    }
+    if (jobs < 1)
+        jobs = 1;
+    const size_t chunk = CHUNK * jobs;
+    std::vector<char> buf;
+    std::vector<Part> parts(jobs);
+    size_t len = 0;
+    bool eof = false, header = false, csv = false;
+    while (!eof) {
+        buf.resize(len + chunk);
+        size_t got = fread(buf.data() + len, 1, chunk, f);
+        len += got;
+        if (got < chunk) {
+            if (ferror(f)) {
+                err = "Error reading '" + path + "'";
+                if (!use_stdin)
+                    fclose(f);
+                return false;
+            }
+            eof = true;
+        }
+        const char* b = buf.data();
+        const char* stop = b + len;
+        if (!eof) {
+            const char* nl = static_cast<const char*>(memrchr(b, '\n', len));
+            if (!nl)
+                continue;  // a line longer than the chunk: read on
+            stop = nl + 1;
+        }
+        const char* start = b;
+        if (!header) {
+            start = parse_header(b, stop, out, csv);
+            if (!start)
+                continue;
+            header = true;
+        }
+
+        // Cut at line ends into one piece per job; pieces parse in parallel
+        // and append in order.
+        size_t ncols = out.names.size();
+        std::vector<const char*> cut(jobs + 1, stop);
+        cut[0] = start;
+        for (unsigned j = 1; j < jobs; j++) {
+            const char* c = start + size_t(stop - start) * j / jobs;
+            if (c <= cut[j - 1]) {
+                cut[j] = cut[j - 1];
+                continue;
+            }
+            // From c - 1, so a cut that already falls on a line start stays.
+            const char* nl = static_cast<const char*>(memchr(c - 1, '\n', size_t(stop - c + 1)));
+            cut[j] = nl ? nl + 1 : stop;
+        }
+        parallel_for(jobs, jobs, [&](size_t pb, size_t pe, unsigned) {
+            for (size_t j = pb; j < pe; j++)
+                parse_lines(cut[j], cut[j + 1], csv, ncols, parts[j]);
+        });
+        for (const Part& part : parts) {
+            for (size_t c = 0; c < ncols; c++)
+                out.columns[c].insert(out.columns[c].end(), part.cols[c].begin(),
+                                      part.cols[c].end());
+            out.skipped += part.skipped;
+        }
+
+        len = size_t(b + len - stop);
+        memmove(buf.data(), stop, len);
+    }
+    if (!use_stdin)
+        fclose(f);
+    if (!header) {
+        err = path + ": empty file";
+        return false;
+    }
+    return true;
+}
+
+bool write_text_table(const std::string& path, const std::vector<std::string>& names,
+                      const std::vector<const double*>& columns, size_t rows, char sep,
+                      unsigned jobs, std::string& err) {
+    bool use_stdout = path == "-";
+    FILE* f = use_stdout ? stdout : fopen(path.c_str(), "wb");
+    if (!f) {
+        err = "Cannot write '" + path + "'";
+        return false;
+    }
+    if (jobs < 1)
+        jobs = 1;
+    std::string head;
+    for (size_t c = 0; c < names.size(); c++)
+        (head += c ? std::string(1, sep) : "") += names[c];
+    head += '\n';
+    bool ok = fwrite(head.data(), 1, head.size(), f) == head.size();
+
+    size_t ncols = columns.size();
+    std::vector<std::string> text(jobs);
+    for (size_t r0 = 0; ok && r0 < rows; r0 += BLOCK * jobs) {
+        size_t n = rows - r0 < BLOCK * jobs ? rows - r0 : BLOCK * jobs;
+        parallel_for(n, jobs, [&](size_t b, size_t e, unsigned j) {
+            std::string& s = text[j];
+            s.resize((e - b) * ncols * (DOUBLE_CHARS + 1));
+            char* p = &s[0];
+            for (size_t r = r0 + b; r < r0 + e; r++) {
+                for (size_t c = 0; c < ncols; c++) {
+                    if (c)
+                        *p++ = sep;
+                    p = format_double(p, columns[c][r]);
+                }
+                *p++ = '\n';
+            }
+            s.resize(size_t(p - s.data()));
+        });
+        for (unsigned j = 0; ok && j < jobs; j++) {
+            ok = fwrite(text[j].data(), 1, text[j].size(), f) == text[j].size();
+            text[j].clear();
+        }
+    }
+    ok = fflush(f) == 0 && ok;
+    if (!use_stdout)
+        ok = fclose(f) == 0 && ok;
+    if (!ok)
+        err = "Error writing '" + path + "'";
+    return ok;
+}
+
+bool write_text_table(const std::string& path, const TextTable& t, char sep, unsigned jobs,
+                      std::string& err) {
+    std::vector<const double*> cols;
+    for (const auto& c : t.columns)
+        cols.push_back(c.data());
+    return write_text_table(path, t.names, cols, t.rows(), sep, jobs, err);
+}
+
+}  // namespace reu
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace reu {
+
+/*
+ * Text import and export of numeric result tables (.tab, rstore CSVs),
+ * which stay the interchange format for pandas, gnuplot and the example
+ * scripts.
+ *
+ * format_double writes the shortest decimal that parses back to the same
+ * double (std::to_chars, Ryu in libstdc++): "0.1" rather than "%.17e"'s
+ * "1.00000000000000006e-01", about half the bytes and an order of
+ * magnitude faster than printf. parse_double reads it back with
+ * std::from_chars (fast_float's algorithm), exact and locale-independent.
+ */
+constexpr size_t DOUBLE_CHARS = 32;  // enough for any format_double output
+
+// Writes v at p and returns the end; NaN and infinities as "nan", "inf", "-inf".
+char* format_double(char* p, double v);
+std::string format_double(double v);
+
+// Parses a number spanning exactly [p, e): decimal, a leading '+', "nan",
+// "inf"/"infinity" in any case. Out-of-range values give +-inf or 0, as strtod.
+bool parse_double(const char* p, const char* e, double& v);
+
+/*
+ * A table of double columns with a header line of names. Fields are split
+ * by whitespace, or by commas when the header has one (then an empty field
+ * is NaN). Lines starting with '#' are comments. A first line that is all
+ * numbers is data, and the columns are named c0, c1, ...
+ */
+struct TextTable {
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+    size_t skipped = 0;  // rows of the wrong width or with a non-number
+
+    size_t rows() const { return columns.empty() ? 0 : columns[0].size(); }
+};
+
+/*
+ * The file is read in chunks of a few MiB per job, each cut at line ends
+ * and parsed on its own thread; rows keep file order. path "-" is stdin.
+ */
+bool read_text_table(const std::string& path, unsigned jobs, TextTable& out, std::string& err);
+
+// sep ' ' (.tab style) or ','; rows are formatted in blocks on `jobs` threads
+// and written in order. columns[c] points to `rows` values. path "-" is stdout.
+bool write_text_table(const std::string& path, const std::vector<std::string>& names,
+                      const std::vector<const double*>& columns, size_t rows, char sep,
+                      unsigned jobs, std::string& err);
+bool write_text_table(const std::string& path, const TextTable& t, char sep, unsigned jobs,
+                      std::string& err);
+
+}  // namespace reu
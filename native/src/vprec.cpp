@@ -0,0 +1,8 @@
+#include "vprec.hpp"
+
+namespace reu {
+
+thread_local VprecConfig vprec_config;
+thread_local unsigned vprec_overflows = 0;
+
+}  // namespace reu
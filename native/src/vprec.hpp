@@ -0,0 +1,76 @@
+#pragma once
+#include <cmath>
+
+namespace reu {
+
+/*
+ * In-process equivalent of verificarlo's VPREC backend: every operation is
+ * computed in double and rounded to nearest onto a custom format with
+ * `precision` explicit mantissa bits and `range` exponent bits (the -b and -R
+ * options of run_vprec.sh). Gradual underflow is kept; overflow goes to inf.
+ *
+ * The format is thread-local so that different threads can evaluate
+ * different formats concurrently.
+ */
+struct VprecConfig {
+    int precision = 52;
+    int range = 11;
+};
+
+extern thread_local VprecConfig vprec_config;
+extern thread_local unsigned vprec_overflows;  // finite -> inf events
+
+inline double vprec_round(double x, int precision, int range) {
+    if (!std::isfinite(x) || x == 0.0)
+        return x;
+    int emax = (1 << (range - 1)) - 1;
+    int emin = 1 - emax;
+    int e = std::ilogb(x);
+    int ue = (e < emin ? emin : e) - precision;
+    double q = std::ldexp(std::nearbyint(std::ldexp(x, -ue)), ue);
+    if (std::fabs(q) >= std::ldexp(2.0, emax)) {
+        vprec_overflows++;
+        return std::copysign(INFINITY, x);
+    }
+    return q;
+}
+
+inline double vprec_round(double x) {
+    return vprec_round(x, vprec_config.precision, vprec_config.range);
+}
+
+// Number type whose every operation rounds to the current VPREC format.
+struct Vprec {
+    double v = 0.0;
+
+    Vprec() = default;
+    Vprec(double x) : v(vprec_round(x)) {}
+};
+
+inline Vprec operator+(Vprec a, Vprec b) { return Vprec(a.v + b.v); }
+inline Vprec operator-(Vprec a, Vprec b) { return Vprec(a.v - b.v); }
+inline Vprec operator*(Vprec a, Vprec b) { return Vprec(a.v * b.v); }
+inline Vprec operator/(Vprec a, Vprec b) { return Vprec(a.v / b.v); }
+inline Vprec operator-(Vprec a) { return Vprec(-a.v); }
+inline bool operator<(Vprec a, Vprec b) { return a.v < b.v; }
+inline bool operator>(Vprec a, Vprec b) { return a.v > b.v; }
+inline bool operator<=(Vprec a, Vprec b) { return a.v <= b.v; }
+inline Vprec exp(Vprec a) { return Vprec(std::exp(a.v)); }
+inline Vprec tanh(Vprec a) { return Vprec(std::tanh(a.v)); }
+inline Vprec sqrt(Vprec a) { return Vprec(std::sqrt(a.v)); }
+inline Vprec pow(Vprec a, Vprec b) { return Vprec(std::pow(a.v, b.v)); }
+inline Vprec fma(Vprec a, Vprec b, Vprec c) { return Vprec(std::fma(a.v, b.v, c.v)); }
+
+// Quantizer that stores values at the selected kernel points in a custom
+// format while the arithmetic in between stays in double.
+struct VprecQuant {
+    unsigned mask;
+    int precision;
+    int range;
+
+    double operator()(unsigned pt, double v) const {
+        return (mask & pt) ? vprec_round(v, precision, range) : v;
+    }
+};
+
+}  // namespace reu
@@ -0,0 +1,225 @@
+// Map catastrophic cancellation of a kernel across an input grid.
+//
+// Evaluates the kernel once per point with the cancellation-tracking number
+// type (src/cancel.hpp), which records the bits each addition and
+// subtraction cancels. Prints per-site histograms and the worst inputs, and
+// writes one CSV row per point with the bits per site, which rstore ingest
+// reads as keyed records for rstore bins / pyramid / grid. One exact pass
+// instead of inferring hot spots from MCA variance over many samples.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "cancel.hpp"
+#include "grid.hpp"
+#include "kernels.hpp"
+#include "parallel.hpp"
+#include "textcodec.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s -k KERNEL [-r RANGE | -R RANGES] [-s STEP | -S STEPS] [options]\n", prog);
+    printf("\n");
+    printf("Required arguments:\n");
+    printf("  -k KERNEL       : Registered kernel name (see fpsweep -l)\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -r RANGE        : Test range as 'start:end' for all inputs (default: '-1.0:1.0')\n");
+    printf("  -R RANGES       : Individual ranges as 'x0=start:end,x1=start:end'\n");
+    printf("  -C SPEC         : Take the input box from a CIRE .cire file (-R/-F still override)\n");
+    printf("  -s STEP         : Step size for all inputs (default: 0.5)\n");
+    printf("  -S STEPS        : Individual steps as 'x0=step,x1=step'\n");
+    printf("  -F FIXED        : Fixed values for some inputs as 'x1=0.0,x2=0.0'\n");
+    printf("  -T BITS         : Count points cancelling at least BITS bits as hot spots (default: 10)\n");
+    printf("  -j JOBS         : Number of threads (default: number of CPU cores)\n");
+    printf("  -o OUTPUT_DIR   : Output directory (default: './results')\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  # Where sqrt(x + 1) - sqrt(x) loses its bits:\n");
+    printf("  %s -k ex1_original -r '0:1e6' -s 10\n", prog);
+    printf("\n");
+    printf("  # The x0 + x1 anti-diagonal of the harmonic mean, mapped with rstore:\n");
+    printf("  %s -k harmonic0 -r '-1:1' -s 0.01\n", prog);
+    printf("  rstore ingest results/harmonic0-2inputs-grid-cancel.csv\n");
+    printf("  rstore bins -k harmonic0 -x x0:100 -y x1:100 -v cancel_max\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    std::string kernel, range, ranges, step, steps, fixed, spec_path, outdir = "./results";
+    int threshold = 10;
+    unsigned jobs = default_jobs();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:r:R:C:s:S:F:T:j:o:h")) != -1) {
+        switch (opt) {
+        case 'k': kernel = optarg; break;
+        case 'r': range = optarg; break;
+        case 'R': ranges = optarg; break;
+        case 'C': spec_path = optarg; break;
+        case 's': step = optarg; break;
+        case 'S': steps = optarg; break;
+        case 'F': fixed = optarg; break;
+        case 'T': threshold = atoi(optarg); break;
+        case 'j': jobs = unsigned(atoi(optarg)); break;
+        case 'o': outdir = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    if (kernel.empty()) {
+        fprintf(stderr, "Error: Missing required arguments\n");
+        usage(argv[0]);
+    }
+    const KernelDef* k = find_kernel(kernel);
+    if (!k) {
+        fprintf(stderr, "Error: Unknown kernel '%s' (use fpsweep -l to list)\n", kernel.c_str());
+        return 1;
+    }
+    Grid grid;
+    std::string err;
+    CireSpec spec;
+    if (!spec_path.empty() && !load_cire(spec_path, spec, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (!make_grid(k->n_in, range, ranges, step, steps, fixed, grid, err,
+                   spec_path.empty() ? nullptr : &spec)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    size_t npoints = grid.size();
+    jobs = jobs ? jobs : 1;
+
+    printf("=== cancelmap Configuration ===\n");
+    printf("Kernel: %s (examples/%s)\n", k->name, k->source);
+    for (const auto& a : grid.axes)
+        printf("  %s: [%g, %g] step %g (%zu values)\n", a.name.c_str(), a.lo, a.hi,
+               a.step, a.size());
+    printf("Input points: %zu\n", npoints);
+    printf("Hot spot threshold: %d bits\n", threshold);
+    printf("Threads: %u\n", jobs);
+    printf("===============================\n");
+    fflush(stdout);
+
+    // Pass 1: evaluate. Jobs own contiguous blocks of points and keep each
+    // point's tracked sites as a count byte followed by one byte per site.
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<CancelHistogram> hists(jobs);
+    std::vector<std::vector<uint8_t>> traces(jobs);
+    std::vector<size_t> hot(jobs);
+    parallel_for(npoints, jobs, [&](size_t b, size_t e, unsigned j) {
+        double x[MAX_IN], y[MAX_OUT];
+        std::vector<uint8_t>& tr = traces[j];
+        for (size_t p = b; p < e; p++) {
+            grid.point(p, x);
+            k->eval_cancel(x, y);
+            hists[j].add_trace(p);
+            const CancelTrace& t = cancel_trace;
+            int n = t.sites < CANCEL_SITES ? t.sites : CANCEL_SITES;
+            tr.push_back(uint8_t(n));
+            tr.insert(tr.end(), t.bits, t.bits + n);
+            int worst = 0;
+            for (int s = 0; s < n; s++)
+                worst = t.bits[s] > worst ? t.bits[s] : worst;
+            hot[j] += worst >= threshold;
+        }
+    });
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    CancelHistogram all;
+    size_t n_hot = 0;
+    for (unsigned j = 0; j < jobs; j++) {
+        all.merge(hists[j]);
+        n_hot += hot[j];
+    }
+    int sites = all.sites();
+
+    // Pass 2: one CSV row per point, sites the point did not reach left empty.
+    mkdir(outdir.c_str(), 0755);
+    std::string outfile = outdir + "/" + k->name +
+        (k->n_in > 1 ? "-" + std::to_string(k->n_in) + "inputs-grid" : std::string()) +
+        "-cancel.csv";
+    FILE* f = fopen(outfile.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", outfile.c_str());
+        return 1;
+    }
+    fputs("tool,kernel", f);
+    for (int d = 0; d < k->n_in; d++)
+        fprintf(f, ",x%d", d);
+    fputs(",cancel_max,cancel_site", f);
+    for (int s = 0; s < sites; s++)
+        fprintf(f, ",cancel_s%d", s);
+    fputs("\n", f);
+    std::vector<std::string> chunks(jobs);
+    parallel_for(npoints, jobs, [&](size_t b, size_t e, unsigned j) {
+        // The same blocks as pass 1, so job j reads its own trace.
+        std::string& out = chunks[j];
+        const uint8_t* tr = traces[j].data();
+        char num[DOUBLE_CHARS];
+        double x[MAX_IN];
+        for (size_t p = b; p < e; p++) {
+            grid.point(p, x);
+            out += "cancel,";
+            out += k->name;
+            for (int d = 0; d < k->n_in; d++)
+                (out += ',').append(num, format_double(num, x[d]));
+            int n = *tr++, worst = 0, at = -1;
+            for (int s = 0; s < n; s++) {
+                if (tr[s] > worst || at < 0) {
+                    worst = tr[s];
+                    at = s;
+                }
+            }
+            if (at >= 0)
+                out += "," + std::to_string(worst) + "," + std::to_string(at);
+            else
+                out += ",,";
+            for (int s = 0; s < sites; s++)
+                (out += ',') += s < n ? std::to_string(tr[s]) : std::string();
+            out += '\n';
+            tr += n;
+        }
+    });
+    for (const auto& c : chunks)
+        fwrite(c.data(), 1, c.size(), f);
+    fclose(f);
+
+    printf("Results saved to: %s\n", outfile.c_str());
+    printf("\n=== Cancelled Bits by Site (%d = cancelled to zero) ===\n", CANCEL_ZERO);
+    printf("%-5s %-4s %10s %4s %4s %4s %10s  %s\n", "site", "op", "reached", "p50", "p99", "max",
+           (">=" + std::to_string(threshold)).c_str(), "worst at");
+    for (int s = 0; s < sites; s++) {
+        uint64_t over = 0;
+        for (int bits = threshold < 0 ? 0 : threshold; bits < CANCEL_BINS; bits++)
+            over += all.counts(s)[size_t(bits)];
+        std::string at;
+        if (all.max_bits(s) > 0) {
+            double x[MAX_IN];
+            grid.point(size_t(all.max_point(s)), x);
+            for (int d = 0; d < k->n_in; d++)
+                (at += d ? ", " : "x = (") += format_double(x[d]);
+            at += ")";
+        }
+        printf("%-5d %-4s %10llu %4d %4d %4d %10llu  %s\n", s, all.sub(s) ? "sub" : "add",
+               (unsigned long long)all.executed(s), all.quantile(s, 0.5), all.quantile(s, 0.99),
+               all.max_bits(s), (unsigned long long)over, at.c_str());
+    }
+    if (all.untracked())
+        fprintf(stderr, "Warning: %llu additions past the first %d per evaluation not tracked\n",
+                (unsigned long long)all.untracked(), CANCEL_SITES);
+    printf("\nHot spots: %zu of %zu points (%.2f%%) cancel >= %d bits at some site\n", n_hot,
+           npoints, npoints ? 100.0 * double(n_hot) / double(npoints) : 0.0, threshold);
+    printf("\n=== Execution Time ===\n");
+    printf("Total time: %.3fs (%.3g evaluations/s)\n", secs, double(npoints) / secs);
+    printf("\nDone!\n");
+    return 0;
+}
@@ -0,0 +1,321 @@
+// Run CIRE over a grid of sub-boxes of one .cire spec.
+//
+// cire2.sh writes a temporary .cire file per cell with a heredoc, runs
+// CIRE_LLVM on it, and scrapes Output/Error with awk into two one-column
+// CSVs. This driver parses the spec once, splits its input box into cells,
+// and hands each cell's spec to CIRE through a pipe (no per-cell files).
+// CIRE runs in parallel under supervision (src/supervisor.hpp): a run that
+// crashes or hangs is retried, then its cell spec is saved for replay, and
+// the bounds go straight into the result store with the cell box as columns.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cire_spec.hpp"
+#include "ingest.hpp"
+#include "parallel.hpp"
+#include "store.hpp"
+#include "subprocess.hpp"
+#include "supervisor.hpp"
+#include "telemetry.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s -l IR.ll -C SPEC.cire [-g CELLS] [options]\n", prog);
+    printf("\n");
+    printf("Required arguments:\n");
+    printf("  -l IR           : LLVM IR file to analyse\n");
+    printf("  -C SPEC         : CIRE input spec whose box is split into cells\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -g CELLS        : Cells per input as 'N' or 'x0=N,x1=M' (default: 1)\n");
+    printf("  -f FUNCTIONS    : Comma-separated functions to analyse (default: first definition in IR)\n");
+    printf("  -k KERNEL       : Kernel name stored with the rows (default: from the IR file name)\n");
+    printf("  -O OPT          : Optimization level stored with the rows (default: from the IR file name)\n");
+    printf("  -c CIRE         : CIRE executable (default: $CIRE or CIRE_LLVM in PATH)\n");
+    printf("  -j JOBS         : Concurrent CIRE processes (default: number of CPU cores)\n");
+    printf("  -o STORE        : Result store to append to (default: './results.rstore')\n");
+    printf("  -W SECONDS      : Kill a CIRE run that takes longer than SECONDS (default: no limit)\n");
+    printf("  -Y RETRIES      : Retry a crashed or killed CIRE run up to RETRIES times (default: 1)\n");
+    printf("  -D DIR          : Where the specs of cells that still crash are saved\n");
+    printf("                    (default: the store path without extension + '-crashes')\n");
+    printf("  -H PORT         : Serve live metrics (Prometheus text) on http://127.0.0.1:PORT/metrics\n");
+    printf("  -J FILE[:SECS]  : Append a JSON metrics line to FILE ('-' for stderr) every SECS (default: 10)\n");
+    printf("  -n              : Print the cell specs and commands without running CIRE\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  # The cire2.sh sweep: 100 x 100 cells of [0,1]^2\n");
+    printf("  %s -l harmonic0_O1.ll -C inputs/harmonic1.cire -g 'x0=100,x1=100' -W 600\n", prog);
+    printf("  # Every FP function of a module in one run\n");
+    printf("  %s -l kernels_O2.ll -C spec.cire -f \"$(irfuncs -n kernels_O2.ll | paste -sd,)\"\n", prog);
+    exit(1);
+}
+
+// First function defined in an LLVM IR file, as cire2.sh greps for it.
+// irfuncs picks the kernel more reliably but needs LLVM.
+static std::string first_function(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 7, "define ") != 0)
+            continue;
+        size_t at = line.find('@');
+        if (at == std::string::npos)
+            continue;
+        size_t end = at + 1;
+        while (end < line.size() && (isalnum((unsigned char)line[end]) || line[end] == '_' ||
+                                     line[end] == '.' || line[end] == '$'))
+            end++;
+        return line.substr(at + 1, end - at - 1);
+    }
+    return "";
+}
+
+static std::string stem(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = base.find_last_of('.');
+    return dot == std::string::npos ? base : base.substr(0, dot);
+}
+
+int main(int argc, char** argv) {
+    std::string ir, spec_path, cells_spec = "1", func, kernel, opt, outpath = "./results.rstore";
+    const char* env = getenv("CIRE");
+    std::string cire = env ? env : "CIRE_LLVM";
+    unsigned jobs = default_jobs();
+    bool dry_run = false;
+    SupervisorPolicy policy;
+    int http_port = -1;
+    std::string metrics_log;
+
+    int c;
+    while ((c = getopt(argc, argv, "l:C:g:f:k:O:c:j:o:W:Y:D:H:J:nh")) != -1) {
+        switch (c) {
+        case 'l': ir = optarg; break;
+        case 'C': spec_path = optarg; break;
+        case 'g': cells_spec = optarg; break;
+        case 'f': func = optarg; break;
+        case 'k': kernel = optarg; break;
+        case 'O': opt = optarg; break;
+        case 'c': cire = optarg; break;
+        case 'j': jobs = unsigned(atoi(optarg)); break;
+        case 'o': outpath = optarg; break;
+        case 'W': policy.timeout = atof(optarg); break;
+        case 'Y': policy.retries = unsigned(atoi(optarg)); break;
+        case 'D': policy.crash_dir = optarg; break;
+        case 'H': http_port = atoi(optarg); break;
+        case 'J': metrics_log = optarg; break;
+        case 'n': dry_run = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (ir.empty() || spec_path.empty()) {
+        fprintf(stderr, "Error: Missing required arguments\n");
+        usage(argv[0]);
+    }
+
+    CireSpec spec;
+    std::string err;
+    if (!load_cire(spec_path, spec, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (func.empty())
+        func = first_function(ir);
+    std::vector<std::string> funcs;
+    std::stringstream fs(func);
+    for (std::string f; std::getline(fs, f, ',');)
+        if (!f.empty())
+            funcs.push_back(f);
+    if (funcs.empty()) {
+        fprintf(stderr, "Error: Couldn't find any function in %s\n", ir.c_str());
+        return 1;
+    }
+    std::string ir_kernel, ir_opt;
+    split_cire_key(stem(ir), ir_kernel, ir_opt);
+    if (kernel.empty())
+        kernel = ir_kernel;
+    if (opt.empty())
+        opt = ir_opt;
+
+    // Cells per input; degenerate inputs (lo == hi) always get one.
+    size_t n_in = spec.inputs.size();
+    std::vector<size_t> splits(n_in, 1);
+    if (cells_spec.find('=') == std::string::npos) {
+        long n = atol(cells_spec.c_str());
+        if (n < 1) {
+            fprintf(stderr, "Error: Invalid cell count '%s'\n", cells_spec.c_str());
+            return 1;
+        }
+        for (auto& s : splits)
+            s = size_t(n);
+    } else {
+        std::stringstream ss(cells_spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            size_t eq = item.find('=');
+            size_t d = 0;
+            while (d < n_in && (eq == std::string::npos || spec.inputs[d].name != item.substr(0, eq)))
+                d++;
+            long n = d < n_in ? atol(item.c_str() + eq + 1) : 0;
+            if (n < 1) {
+                fprintf(stderr, "Error: Invalid cell split '%s'\n", item.c_str());
+                return 1;
+            }
+            splits[d] = size_t(n);
+        }
+    }
+    size_t ncells = 1;
+    for (size_t d = 0; d < n_in; d++) {
+        if (spec.inputs[d].lo == spec.inputs[d].hi)
+            splits[d] = 1;
+        ncells *= splits[d];
+    }
+
+    // Cell boxes, first input varying slowest like the nested loops in cire2.sh.
+    std::vector<CireSpec> cell_specs(ncells, spec);
+    for (size_t cell = 0; cell < ncells; cell++) {
+        size_t rem = cell;
+        for (size_t d = n_in; d-- > 0;) {
+            size_t k = rem % splits[d];
+            rem /= splits[d];
+            double lo = spec.inputs[d].lo, hi = spec.inputs[d].hi;
+            CireVar& v = cell_specs[cell].inputs[d];
+            v.lo = lo + (hi - lo) * double(k) / double(splits[d]);
+            v.hi = k + 1 == splits[d] ? hi : lo + (hi - lo) * double(k + 1) / double(splits[d]);
+        }
+    }
+
+    // Task t runs function t / ncells on cell t % ncells.
+    size_t ntasks = funcs.size() * ncells;
+    auto command = [&](size_t t) {
+        return std::vector<std::string>{cire, ir, "--function", funcs[t / ncells], "--input",
+                                        "{input}", "--debug-level", "1"};
+    };
+    printf("=== cirebatch Configuration ===\n");
+    printf("IR: %s (%s %s)\n", ir.c_str(), funcs.size() > 1 ? "functions" : "function",
+           func.c_str());
+    printf("Kernel: %s, opt: %s, box: %s\n", kernel.c_str(), opt.empty() ? "-" : opt.c_str(),
+           stem(spec_path).c_str());
+    for (size_t d = 0; d < n_in; d++)
+        printf("  %s: [%g, %g] in %zu cells\n", spec.inputs[d].name.c_str(), spec.inputs[d].lo,
+               spec.inputs[d].hi, splits[d]);
+    printf("Cells: %zu, CIRE runs: %zu, concurrent: %u\n", ncells, ntasks, jobs);
+    if (policy.timeout > 0)
+        printf("Time limit: %g s per run, %u retries\n", policy.timeout, policy.retries);
+    printf("===============================\n");
+
+    if (dry_run) {
+        for (size_t t = 0; t < ntasks; t++) {
+            printf("# cell %zu:", t % ncells);
+            for (const auto& a : command(t))
+                printf(" %s", a == "{input}" ? "<spec>" : a.c_str());
+            printf("\n%s", format_cire(cell_specs[t % ncells]).c_str());
+        }
+        return 0;
+    }
+
+    if (policy.crash_dir.empty()) {
+        size_t dot = outpath.find_last_of('.'), slash = outpath.find_last_of('/');
+        bool ext = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+        policy.crash_dir = (ext ? outpath.substr(0, dot) : outpath) + "-crashes";
+    }
+    struct CellResult {
+        double output[2] = {NAN, NAN}, error[2] = {NAN, NAN};
+        std::string failure;
+    };
+    std::vector<CellResult> results(ntasks);
+    std::vector<TaskReport> reports;
+    std::unique_ptr<Telemetry> telemetry;
+    if (http_port >= 0 || !metrics_log.empty()) {
+        telemetry.reset(new Telemetry("cirebatch", jobs, ntasks));
+        if (!start_telemetry(*telemetry, http_port, metrics_log))
+            return 1;
+    }
+    fflush(stdout);
+    auto t0 = std::chrono::steady_clock::now();
+    // One thread per concurrent process; cells are independent and handed
+    // out one at a time, so a slow cell holds up only its own thread.
+    supervise(ntasks, jobs, policy, [&](size_t t, unsigned w, unsigned, TaskAttempt& a) {
+        uint64_t start = telemetry ? telemetry_now_ns() : 0;
+        size_t cell = t % ncells;
+        a.name = funcs[t / ncells] + "-cell" + std::to_string(cell) + ".cire";
+        a.input = format_cire(cell_specs[cell]);
+        ProcResult pr;
+        a.started = run_process(command(t), &a.input, pr, a.error, policy.timeout);
+        a.status = pr.status;
+        a.timed_out = pr.timed_out;
+        a.output = std::move(pr.output);
+        CellResult& r = results[t];
+        if (classify(a) == TaskFate::OK && !parse_cire_log(a.output, r.output, r.error))
+            r.failure = "no Output/Error in CIRE output";
+        if (telemetry) {
+            // Retried attempts count as items of their own.
+            WorkerCounters& wc = telemetry->worker(w);
+            wc.record(1, telemetry_now_ns() - start);
+            if (classify(a) != TaskFate::OK)
+                WorkerCounters::bump(wc.failures, 1);
+        }
+    }, reports);
+    if (telemetry)
+        telemetry->stop();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    ResultStore store;
+    if (access(outpath.c_str(), F_OK) == 0 && !ResultStore::load(outpath, store, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    size_t failed = 0;
+    for (size_t t = 0; t < ntasks; t++) {
+        size_t cell = t % ncells;
+        const CellResult& r = results[t];
+        size_t row = store.add_row();
+        store.set_str("tool", row, "cire");
+        store.set_str("kernel", row, kernel);
+        store.set_str("opt", row, opt);
+        store.set_str("box", row, stem(spec_path));
+        store.set_str("source", row, ir);
+        store.set_str("op", row, funcs[t / ncells]);
+        store.set_int("cell", row, int64_t(cell));
+        store.set_int("status", row, reports[t].status);
+        for (size_t d = 0; d < n_in; d++) {
+            std::string x = "x" + std::to_string(d);
+            store.set(x + "_lo", row, cell_specs[cell].inputs[d].lo);
+            store.set(x + "_hi", row, cell_specs[cell].inputs[d].hi);
+        }
+        store.set("out_lo", row, r.output[0]);
+        store.set("out_hi", row, r.output[1]);
+        store.set("err_lo", row, r.error[0]);
+        store.set("err_hi", row, r.error[1]);
+        const TaskReport& rep = reports[t];
+        std::string failure = rep.fate != TaskFate::OK ? "CIRE " + rep.detail : r.failure;
+        if (rep.fate != TaskFate::OK)
+            store.set_str("failure", row, fate_name(rep.fate));
+        if (!failure.empty()) {
+            if (failed++ < 5)
+                fprintf(stderr, "Warning: %s cell %zu: %s%s\n", funcs[t / ncells].c_str(), cell,
+                        failure.c_str(),
+                        rep.saved.empty() ? "" : (", spec saved as " + rep.saved).c_str());
+        }
+    }
+    if (!store.save(outpath, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    printf("%zu CIRE runs, %zu failed, rows appended to %s\n", ntasks, failed, outpath.c_str());
+    printf("\n=== Execution Time ===\n");
+    printf("Total time: %.3fs (%.3g runs/s)\n", secs, double(ntasks) / secs);
+    printf("\nDone!\n");
+    return failed ? 2 : 0;
+}
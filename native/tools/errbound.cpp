@@ -0,0 +1,372 @@
+// Certified maximum rounding error of a kernel over an input box.
+//
+// CIRE bounds the symbolic first-order error expression of each output by
+// running a global optimizer per box, and cire2.sh / cirebatch start one
+// CIRE process per cell. This evaluates the kernel's native error model
+// (src/interval.hpp) and maximizes it with a parallel branch-and-bound
+// (src/bnb.hpp) in-process. The result is an enclosure [lower, upper] of
+// the maximum: lower is attained at the reported input, upper is certified
+// by interval bounds over every part of the box.
+//
+// -x instead bounds CIRE's first-order error expression directly, with no
+// search: it is derived once per kernel and path, compiled to a native
+// batched interval evaluator and cached (src/errexpr.hpp), so each cell
+// costs one evaluation. Bounds are looser than the refined ones over wide
+// cells and drop higher-order terms, as CIRE's do.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bnb.hpp"
+#include "errexpr.hpp"
+#include "grid.hpp"
+#include "kernels.hpp"
+#include "parallel.hpp"
+#include "store.hpp"
+#include "textcodec.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s -k KERNEL [-C SPEC | -r RANGE | -R RANGES] [options]\n", prog);
+    printf("\n");
+    printf("Required arguments:\n");
+    printf("  -k KERNEL       : Registered kernel name (see fpsweep -l)\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -C SPEC         : Take the input box from a CIRE .cire file (-R/-F still override)\n");
+    printf("  -r RANGE        : Box as 'start:end' for all inputs (default: '-1.0:1.0')\n");
+    printf("  -R RANGES       : Individual ranges as 'x0=start:end,x1=start:end'\n");
+    printf("  -F FIXED        : Fixed values for some inputs as 'x1=0.0,x2=0.0'\n");
+    printf("  -t TYPE         : Arithmetic [FLOAT | DOUBLE] (default: DOUBLE)\n");
+    printf("  -v PRECISION    : Significand bits instead of the type's, as MCA/VPREC -v\n");
+    printf("  -g CELLS        : Cells per input as 'N' or 'x0=N,x1=M', each bounded separately (default: 1)\n");
+    printf("  -e TOLERANCE    : Stop refining once upper <= lower * (1 + TOLERANCE) (default: 1e-3)\n");
+    printf("  -n BOXES        : Bound evaluations per output and cell (default: 1000000)\n");
+    printf("  -x              : First-order error expression per cell from a compiled evaluator, no search\n");
+    printf("  -j JOBS         : Number of threads (default: number of CPU cores)\n");
+    printf("  -o STORE        : Also append one row per cell and output to STORE\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  # The cancellation in sqrt(x + 1) - sqrt(x), against the rewritten form:\n");
+    printf("  %s -k ex1_original -r '1:1000'\n", prog);
+    printf("  %s -k ex1_alt1 -r '1:1000'\n", prog);
+    printf("\n");
+    printf("  # The cirebatch cells of a CIRE spec, in fp32, into the store:\n");
+    printf("  %s -k softmax3 -C ../examples/softmax/inputs/softmax5.cire -t FLOAT -g 4 -o results.rstore\n", prog);
+    printf("\n");
+    printf("  # First-order bounds over a million cells, as cire2.sh per cell:\n");
+    printf("  %s -k harmonic0 -r '0.1:1' -g 1000 -x\n", prog);
+    exit(1);
+}
+
+static std::string stem(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string s = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = s.rfind('.');
+    return dot == std::string::npos ? s : s.substr(0, dot);
+}
+
+// Cells per input from 'N' or 'x0=N,x1=M', as cirebatch -g; 0 entries on error.
+static std::vector<size_t> parse_cells(const std::string& text, const Grid& grid) {
+    size_t n_in = grid.axes.size();
+    std::vector<size_t> splits(n_in, 1);
+    if (text.find('=') == std::string::npos) {
+        long n = atol(text.c_str());
+        for (auto& s : splits)
+            s = n < 1 ? 0 : size_t(n);
+    } else {
+        std::stringstream ss(text);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            size_t eq = item.find('='), d = 0;
+            while (d < n_in && (eq == std::string::npos || grid.axes[d].name != item.substr(0, eq)))
+                d++;
+            long n = d < n_in ? atol(item.c_str() + eq + 1) : 0;
+            if (n < 1)
+                return std::vector<size_t>(n_in, 0);
+            splits[d] = size_t(n);
+        }
+    }
+    for (size_t d = 0; d < n_in; d++)
+        if (grid.axes[d].lo == grid.axes[d].hi)
+            splits[d] = 1;
+    return splits;
+}
+
+int main(int argc, char** argv) {
+    std::string kernel, type = "DOUBLE", spec_path, range, ranges, fixed, cells_spec = "1";
+    std::string outpath;
+    int precision = 0;
+    bool expr = false;
+    BnbOptions bopt;
+    bopt.jobs = default_jobs();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:C:r:R:F:t:v:g:e:n:xj:o:h")) != -1) {
+        switch (opt) {
+        case 'k': kernel = optarg; break;
+        case 'C': spec_path = optarg; break;
+        case 'r': range = optarg; break;
+        case 'R': ranges = optarg; break;
+        case 'F': fixed = optarg; break;
+        case 't': type = optarg; break;
+        case 'v': precision = atoi(optarg); break;
+        case 'g': cells_spec = optarg; break;
+        case 'e': bopt.rel_tol = atof(optarg); break;
+        case 'n': bopt.max_boxes = size_t(atoll(optarg)); break;
+        case 'x': expr = true; break;
+        case 'j': bopt.jobs = unsigned(atoi(optarg)); break;
+        case 'o': outpath = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    if (kernel.empty()) {
+        fprintf(stderr, "Error: Missing required arguments\n");
+        usage(argv[0]);
+    }
+    const KernelDef* k = find_kernel(kernel);
+    if (!k) {
+        fprintf(stderr, "Error: Unknown kernel '%s' (use fpsweep -l to list)\n", kernel.c_str());
+        return 1;
+    }
+    if (type != "FLOAT" && type != "DOUBLE") {
+        fprintf(stderr, "Error: Invalid precision type '%s'. Choose between [FLOAT | DOUBLE]\n",
+                type.c_str());
+        return 1;
+    }
+    if (precision == 0)
+        precision = type == "FLOAT" ? 24 : 53;
+    if (precision < 2 || precision > 53 || !(bopt.rel_tol >= 0) || bopt.max_boxes < 1) {
+        fprintf(stderr, "Error: -v needs [2, 53], -e a tolerance >= 0 and -n at least 1 box\n");
+        return 1;
+    }
+
+    Grid grid;
+    std::string err;
+    CireSpec spec;
+    if (!spec_path.empty() && !load_cire(spec_path, spec, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (!make_grid(k->n_in, range, ranges, "", "", fixed, grid, err,
+                   spec_path.empty() ? nullptr : &spec)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    std::vector<size_t> splits = parse_cells(cells_spec, grid);
+    size_t ncells = 1;
+    for (size_t s : splits)
+        ncells *= s;
+    if (ncells == 0) {
+        fprintf(stderr, "Error: Invalid cells '%s'\n", cells_spec.c_str());
+        return 1;
+    }
+
+    int n_in = k->n_in, n_out = k->n_out;
+    printf("=== errbound Configuration ===\n");
+    printf("Kernel: %s (examples/%s)\n", k->name, k->source);
+    for (size_t d = 0; d < grid.axes.size(); d++) {
+        const Axis& a = grid.axes[d];
+        printf("  %s: [%g, %g]", a.name.c_str(), a.lo, a.hi);
+        printf(splits[d] > 1 ? " in %zu cells\n" : "\n", splits[d]);
+    }
+    printf("Arithmetic: %d-bit significand (u = 2^-%d)\n", precision, precision);
+    if (expr)
+        printf("Bound: first-order error expression (cache: %s)\n", errexpr_cache_dir().c_str());
+    else
+        printf("Tolerance: %g relative, %zu boxes per output and cell\n", bopt.rel_tol,
+               bopt.max_boxes);
+    printf("Threads: %u\n", bopt.jobs);
+    printf("==============================\n");
+    fflush(stdout);
+
+    ResultStore store;
+    if (!outpath.empty() && access(outpath.c_str(), F_OK) == 0 &&
+        !ResultStore::load(outpath, store, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    double unit = std::ldexp(1.0, -precision);
+    double tiny = type == "FLOAT" ? 0x1p-149 : 0x1p-1074;
+    // Cell box, first input varying slowest as in cirebatch.
+    auto cell_box = [&](size_t cell, std::vector<double>& lo, std::vector<double>& hi) {
+        lo.resize(size_t(n_in));
+        hi.resize(size_t(n_in));
+        size_t rem = cell;
+        for (size_t d = size_t(n_in); d-- > 0;) {
+            size_t c = rem % splits[d];
+            rem /= splits[d];
+            const Axis& a = grid.axes[d];
+            lo[d] = a.lo + (a.hi - a.lo) * double(c) / double(splits[d]);
+            hi[d] = c + 1 == splits[d] ? a.hi
+                                       : a.lo + (a.hi - a.lo) * double(c + 1) / double(splits[d]);
+        }
+    };
+    auto add_row = [&](size_t cell, const std::string& label, const std::vector<double>& lo,
+                       const std::vector<double>& hi) {
+        size_t row = store.add_row();
+        store.set_str("tool", row, expr ? "errexpr" : "bnb");
+        store.set_str("kernel", row, k->name);
+        store.set_str("box", row, spec_path.empty() ? std::string() : stem(spec_path));
+        store.set_str("source", row, spec_path.empty() ? std::string("-") : spec_path);
+        store.set_str("op", row, label);
+        store.set_int("cell", row, int64_t(cell));
+        store.set_int("precision", row, precision);
+        for (int d = 0; d < n_in; d++) {
+            std::string xn = "x" + std::to_string(d);
+            store.set(xn + "_lo", row, lo[size_t(d)]);
+            store.set(xn + "_hi", row, hi[size_t(d)]);
+        }
+        return row;
+    };
+    auto t0 = std::chrono::steady_clock::now();
+
+    if (expr) {
+        std::vector<double> lo, hi, xlo(size_t(n_in) * ncells), xhi(xlo.size());
+        for (size_t cell = 0; cell < ncells; cell++) {
+            cell_box(cell, lo, hi);
+            for (size_t d = 0; d < size_t(n_in); d++) {
+                xlo[d * ncells + cell] = lo[d];
+                xhi[d * ncells + cell] = hi[d];
+            }
+        }
+        std::vector<double> out_lo(size_t(n_out) * ncells), out_hi(out_lo.size());
+        std::vector<double> bound(out_lo.size());
+        ErrExprStats st;
+        if (!eval_error_expr(*k, ncells, xlo.data(), xhi.data(), unit, tiny, bopt.jobs,
+                             out_lo.data(), out_hi.data(), bound.data(), err, &st)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return 1;
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        // Every cell when there are few, else the worst cell of each output.
+        printf("%-5s %-7s %-12s %s\n", "cell", "output", "|error| <=", "exact output in");
+        for (int o = 0; o < n_out; o++) {
+            const double* b = bound.data() + size_t(o) * ncells;
+            size_t worst = 0;
+            for (size_t cell = 1; cell < ncells; cell++)
+                if (!(b[cell] <= b[worst]))
+                    worst = cell;
+            std::string label = n_out == 1 ? "result" : "y" + std::to_string(o);
+            for (size_t cell = 0; cell < ncells; cell++) {
+                if (ncells > 16 && cell != worst)
+                    continue;
+                size_t at = size_t(o) * ncells + cell;
+                printf("%-5zu %-7s %-12.4g [%.6g, %.6g]%s\n", cell, label.c_str(), b[cell],
+                       out_lo[at], out_hi[at], ncells > 16 ? "  (worst cell)" : "");
+            }
+            if (outpath.empty())
+                continue;
+            for (size_t cell = 0; cell < ncells; cell++) {
+                cell_box(cell, lo, hi);
+                size_t row = add_row(cell, label, lo, hi);
+                size_t at = size_t(o) * ncells + cell;
+                store.set("out_lo", row, out_lo[at]);
+                store.set("out_hi", row, out_hi[at]);
+                store.set("err_hi", row, b[cell]);
+            }
+        }
+        printf("Paths: %zu (%zu nodes), %zu compiled, %zu from the cache (%.3fs)\n", st.paths,
+               st.nodes, st.compiled, st.paths - st.compiled, st.compile_seconds);
+
+        if (!outpath.empty()) {
+            if (!store.save(outpath, err)) {
+                fprintf(stderr, "Error: %s\n", err.c_str());
+                return 1;
+            }
+            printf("Rows appended to %s\n", outpath.c_str());
+        }
+        if (st.unresolved)
+            fprintf(stderr, "Warning: %zu cells left unbounded, a branch goes both ways over "
+                            "them (raise -g)\n", st.unresolved);
+        double eval = secs - st.compile_seconds;
+        printf("\n=== Execution Time ===\n");
+        printf("Total time: %.3fs (%.3fs evaluating, %.3g ns per cell)\n", secs, eval,
+               eval * 1e9 / double(ncells));
+        printf("\nDone!\n");
+        return 0;
+    }
+
+    size_t total_boxes = 0, open = 0;
+    printf("%-5s %-7s %-25s %-12s %s\n", "cell", "output", "max |error| [lower, upper]",
+           "boxes", "at");
+    std::vector<double> lo, hi;
+    for (size_t cell = 0; cell < ncells; cell++) {
+        cell_box(cell, lo, hi);
+        // Enclosure of the exact outputs over the cell, for the store.
+        Interval x[MAX_IN], v[MAX_OUT], e[MAX_OUT];
+        for (int d = 0; d < n_in; d++)
+            x[d] = Interval(lo[size_t(d)], hi[size_t(d)]);
+        err_unit = unit;
+        err_tiny = tiny;
+        k->eval_error(x, v, e);
+
+        for (int o = 0; o < n_out; o++) {
+            unsigned flags = 0;
+            BnbResult r = max_kernel_error(*k, o, lo, hi, unit, tiny, bopt, &flags);
+            total_boxes += r.boxes;
+
+            std::string label = n_out == 1 ? "result" : "y" + std::to_string(o);
+            std::string at = "x = (";
+            for (int d = 0; d < n_in; d++)
+                (at += d ? ", " : "") += format_double(r.argmax[size_t(d)]);
+            at += ")";
+            if (r.budget_hit || r.narrow) {
+                std::string why = r.budget_hit ? "budget hit" : "";
+                if (r.narrow)
+                    why += (why.empty() ? "" : ", ") + std::to_string(r.narrow) + " too narrow";
+                if (flags & INTERVAL_BRANCH)
+                    why += ", branches both ways";
+                if (flags & INTERVAL_DOMAIN)
+                    why += ", outside the domain of sqrt, log, pow or /";
+                at += "  [" + why + "]";
+                open++;
+            }
+            char span[64];
+            snprintf(span, sizeof span, "[%.4g, %.4g]", r.lower, r.upper);
+            printf("%-5zu %-7s %-25s %-12zu %s\n", cell, label.c_str(), span, r.boxes, at.c_str());
+
+            if (outpath.empty())
+                continue;
+            size_t row = add_row(cell, label, lo, hi);
+            for (int d = 0; d < n_in; d++) {
+                std::string xn = "x" + std::to_string(d);
+                store.set("optima_" + xn + "_0", row, r.argmax[size_t(d)]);
+                store.set("optima_" + xn + "_1", row, r.argmax[size_t(d)]);
+            }
+            store.set("out_lo", row, v[o].lo);
+            store.set("out_hi", row, v[o].hi);
+            store.set("err_lo", row, r.lower);
+            store.set("err_hi", row, r.upper);
+            store.set_int("optimizer_calls", row, int64_t(r.boxes));
+            store.set("t_opt", row, r.seconds);
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if (!outpath.empty()) {
+        if (!store.save(outpath, err)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return 1;
+        }
+        printf("Rows appended to %s\n", outpath.c_str());
+    }
+    if (open)
+        fprintf(stderr, "Warning: %zu bounds not refined to the tolerance (raise -n, or the "
+                        "error is unbounded near a singularity or branch)\n", open);
+    printf("\n=== Execution Time ===\n");
+    printf("Total time: %.3fs (%.3g boxes/s)\n", secs, double(total_boxes) / secs);
+    printf("\nDone!\n");
+    return 0;
+}
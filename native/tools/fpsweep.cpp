@@ -0,0 +1,664 @@
+// In-process sweep of a registered kernel over an input grid.
+//
+// Produces the same .tab layout as run.sh / runp.sh ("i x result" or
+// "i x0 x1 x2 result"), so the existing plot.py and ulpscript.py scripts
+// read its output unchanged. Kernels with several outputs write one column
+// per output instead ("i x0 x1 x2 y0 y1 y2"), each line holding one sample.
+// With -Z the samples go to a compressed binary .rsmp file instead, which
+// rstore ingest reads like the .tab. With -X the samples come from a
+// verificarlo-compiled build of the kernel's example, driven through the
+// fork-server harness (harness/forksrv.c), to cross-check the emulation.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "grid.hpp"
+#include "kernels.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+#include "samplefile.hpp"
+#include "sigest.hpp"
+#include "sketch.hpp"
+#include "supervisor.hpp"
+#include "telemetry.hpp"
+#include "textcodec.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s -k KERNEL [-t TYPE] [-v VPRECISION -M MODE | -q FORMAT [-P POINTS] [-N]] [options]\n", prog);
+    printf("\n");
+    printf("Required arguments:\n");
+    printf("  -k KERNEL       : Registered kernel name (see -l)\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -t TYPE         : Compute type [FLOAT | DOUBLE] (default: FLOAT)\n");
+    printf("  -v VPRECISION   : MCA virtual precision, as for run.sh (requires -M)\n");
+    printf("  -M MODE         : MCA mode [mca | pb | rr], emulated in-process on DOUBLE\n");
+    printf("  -q FORMAT       : Round at kernel points to [bf16 | fp16 | e4m3 | e5m2]\n");
+    printf("  -P POINTS       : Rounding points, comma separated [in,exp,acc,out] or 'all' (default: all)\n");
+    printf("  -N              : Round to nearest instead of stochastically\n");
+    printf("  -r RANGE        : Test range as 'start:end' for all inputs (default: '-1.0:1.0')\n");
+    printf("  -R RANGES       : Individual ranges as 'x0=start:end,x1=start:end'\n");
+    printf("  -C SPEC         : Take the input box from a CIRE .cire file (-R/-F still override)\n");
+    printf("  -s STEP         : Step size for all inputs (default: 0.5)\n");
+    printf("  -S STEPS        : Individual steps as 'x0=step,x1=step'\n");
+    printf("  -F FIXED        : Fixed values for some inputs as 'x1=0.0,x2=0.0'\n");
+    printf("  -i ITERATIONS   : Number of samples per input point (default: 20)\n");
+    printf("  -p PROB[:CONF]  : Probability and confidence of the confident digits (default: 0.9:0.95)\n");
+    printf("  -e DIGITS[:MIN] : Adaptive sampling: stop a point after at least MIN samples (default: 5)\n");
+    printf("                    once its CNH digits are known to be above or below DIGITS;\n");
+    printf("                    -i is then the maximum\n");
+    printf("  -x SEED         : Random seed (default: 1)\n");
+    printf("  -j JOBS         : Number of threads (default: number of CPU cores)\n");
+    printf("  -o OUTPUT_DIR   : Output directory for results (default: './results')\n");
+    printf("  -Z              : Write XOR-compressed binary samples (.rsmp) instead of a .tab\n");
+    printf("  -z LEVEL        : zstd level on top of -Z (builds with ZSTD=1 only)\n");
+    printf("  -X BINARY       : Sample BINARY, built from the kernel's example with harness/forksrv.c,\n");
+    printf("                    instead of the in-process port (VFC_BACKENDS from -v/-M, as run.sh)\n");
+    printf("  -a ARGS         : Extra arguments for BINARY after the inputs, as run.sh -a\n");
+    printf("  -W SECONDS      : Kill a -X run that takes longer than SECONDS (default: no limit)\n");
+    printf("  -Y RETRIES      : Retry a crashed or killed -X run up to RETRIES times (default: 1);\n");
+    printf("                    runs that still fail are saved in OUTPUT_DIR/crashes and count as NaN\n");
+    printf("  -H PORT         : Serve live metrics (Prometheus text) on http://127.0.0.1:PORT/metrics\n");
+    printf("  -J FILE[:SECS]  : Append a JSON metrics line to FILE ('-' for stderr) every SECS (default: 10)\n");
+    printf("  -l              : List registered kernels and exit\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  # bf16 storage of the exp results and the sum, fp32 compute:\n");
+    printf("  %s -k softmax_og0 -R 'x0=-10:10' -F 'x1=0,x2=0' -s 0.1 -q bf16 -P exp,acc\n", prog);
+    printf("\n");
+    printf("  # MCA at 24 bits, as run.sh -t DOUBLE -v 24 -M mca:\n");
+    printf("  %s -k ex1_original -t DOUBLE -v 24 -M mca -r '0:1' -s 0.01\n", prog);
+    printf("\n");
+    printf("  # MCA digits to 95%% confidence, with as few samples as decide 5 digits:\n");
+    printf("  %s -k ex1_original -t DOUBLE -v 24 -M mca -r '0:1' -s 0.01 -e 5 -i 200\n", prog);
+    printf("\n");
+    printf("  # e4m3 activations for GELU:\n");
+    printf("  %s -k gelu_tanh0 -r '-4:4' -s 0.01 -q e4m3 -P out -i 50\n", prog);
+    printf("\n");
+    printf("  # The same MCA sweep through the verificarlo build, for rstore diff:\n");
+    printf("  %s -k ex1_original -t DOUBLE -v 24 -M mca -r '0:1' -s 0.01 -X ./ex1_original_verificarlo -o results_vfc -W 10\n", prog);
+    exit(1);
+}
+
+static void list_kernels() {
+    printf("%-16s %-8s %-18s %s\n", "kernel", "inputs", "points", "source");
+    for (const auto& k : kernel_registry())
+        printf("%-16s %-8d %-18s examples/%s\n", k.name, k.n_in,
+               points_name(k.points).c_str(), k.source);
+    exit(0);
+}
+
+// The last n numbers on the last non-empty line, where run.sh finds a result.
+static bool parse_result(const std::string& text, int n, double* y) {
+    size_t end = text.find_last_not_of(" \t\r\n");
+    if (end == std::string::npos)
+        return false;
+    size_t start = text.rfind('\n', end);
+    std::string line = text.substr(start == std::string::npos ? 0 : start + 1,
+                                   end + 1 - (start == std::string::npos ? 0 : start + 1));
+    std::vector<double> nums;
+    const char* p = line.c_str();
+    while (*p) {
+        bool word_start = p == line.c_str() || !isalnum((unsigned char)p[-1]);
+        if (strchr("+-.0123456789", *p) || (word_start && (*p == 'n' || *p == 'i'))) {
+            char* q;
+            double v = strtod(p, &q);
+            if (q != p && !isalnum((unsigned char)*q)) {
+                nums.push_back(v);
+                p = q;
+                continue;
+            }
+        }
+        p++;
+    }
+    if (nums.size() < size_t(n))
+        return false;
+    std::copy(nums.end() - n, nums.end(), y);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string kernel, type = "FLOAT", format, points = "all", mca_mode;
+    int vprecision = 0;
+    std::string range, ranges, step, steps, fixed, spec_path, outdir = "./results";
+    std::string external, extra_args;
+    SupervisorPolicy policy;
+    int http_port = -1;
+    std::string metrics_log;
+    bool nearest = false, binary = false;
+    int iterations = 20, zstd_level = 0;
+    SigLevel level;
+    double target = NAN;  // -e, digits
+    int min_samples = 5;
+    uint64_t seed = 1;
+    unsigned jobs = default_jobs();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:t:v:M:q:P:Nr:R:C:s:S:F:i:p:e:x:j:o:Zz:X:a:W:Y:H:J:lh")) != -1) {
+        switch (opt) {
+        case 'k': kernel = optarg; break;
+        case 't': type = optarg; break;
+        case 'v': vprecision = atoi(optarg); break;
+        case 'M': mca_mode = optarg; break;
+        case 'q': format = optarg; break;
+        case 'P': points = optarg; break;
+        case 'N': nearest = true; break;
+        case 'r': range = optarg; break;
+        case 'R': ranges = optarg; break;
+        case 'C': spec_path = optarg; break;
+        case 's': step = optarg; break;
+        case 'S': steps = optarg; break;
+        case 'F': fixed = optarg; break;
+        case 'i': iterations = atoi(optarg); break;
+        case 'p':
+            if (sscanf(optarg, "%lf:%lf", &level.probability, &level.confidence) < 1)
+                usage(argv[0]);
+            break;
+        case 'e':
+            if (sscanf(optarg, "%lf:%d", &target, &min_samples) < 1)
+                usage(argv[0]);
+            break;
+        case 'x': seed = strtoull(optarg, nullptr, 10); break;
+        case 'j': jobs = unsigned(atoi(optarg)); break;
+        case 'o': outdir = optarg; break;
+        case 'Z': binary = true; break;
+        case 'z': zstd_level = atoi(optarg); break;
+        case 'X': external = optarg; break;
+        case 'a': extra_args = optarg; break;
+        case 'W': policy.timeout = atof(optarg); break;
+        case 'Y': policy.retries = unsigned(atoi(optarg)); break;
+        case 'H': http_port = atoi(optarg); break;
+        case 'J': metrics_log = optarg; break;
+        case 'l': list_kernels(); break;
+        default: usage(argv[0]);
+        }
+    }
+
+    if (kernel.empty()) {
+        fprintf(stderr, "Error: Missing required arguments\n");
+        usage(argv[0]);
+    }
+    const KernelDef* k = find_kernel(kernel);
+    if (!k) {
+        fprintf(stderr, "Error: Unknown kernel '%s' (use -l to list)\n", kernel.c_str());
+        return 1;
+    }
+    if (type != "FLOAT" && type != "DOUBLE") {
+        fprintf(stderr, "Error: Invalid precision type '%s'. Choose between [FLOAT | DOUBLE]\n",
+                type.c_str());
+        return 1;
+    }
+
+    McaConfig mca;
+    if (!mca_mode.empty()) {
+        if (!parse_mca_mode(mca_mode.c_str(), mca.mode)) {
+            fprintf(stderr, "Error: Invalid MCA mode '%s'. Choose between [mca | pb | rr]\n",
+                    mca_mode.c_str());
+            return 1;
+        }
+        if (vprecision <= 0 || vprecision > 53 || !format.empty()) {
+            fprintf(stderr, "Error: -M needs -v in [1, 53] and cannot be combined with -q\n");
+            return 1;
+        }
+        mca.precision = vprecision;
+        if (external.empty())
+            type = "DOUBLE";
+    }
+
+    Lowp fmt = Lowp::BF16;
+    unsigned mask = 0;
+    if (!format.empty()) {
+        if (!parse_lowp(format, fmt)) {
+            fprintf(stderr, "Error: Invalid format '%s'. Choose between [bf16 | fp16 | e4m3 | e5m2]\n",
+                    format.c_str());
+            return 1;
+        }
+        if (type == "DOUBLE") {
+            fprintf(stderr, "Error: -q emulates fp32 compute with low-precision storage; use -t FLOAT\n");
+            return 1;
+        }
+        mask = parse_points(points) & k->points;
+        if (mask == 0) {
+            fprintf(stderr, "Error: No valid rounding points in '%s' for %s (has: %s)\n",
+                    points.c_str(), k->name, points_name(k->points).c_str());
+            return 1;
+        }
+    }
+    if (!(level.probability > 0 && level.probability < 1 && level.confidence > 0 &&
+          level.confidence < 1)) {
+        fprintf(stderr, "Error: -p needs a probability and a confidence in (0, 1)\n");
+        return 1;
+    }
+    bool adaptive = !std::isnan(target);
+    if (adaptive && (binary || !external.empty() || min_samples < 2)) {
+        fprintf(stderr, "Error: -e needs MIN >= 2 and cannot be combined with -Z or -X, "
+                        "which take a fixed number of samples per point\n");
+        return 1;
+    }
+    if (zstd_level && !codec_has_zstd()) {
+        fprintf(stderr, "Error: -z needs a build with ZSTD=1\n");
+        return 1;
+    }
+    if (!external.empty()) {
+        if (!format.empty()) {
+            fprintf(stderr, "Error: -X runs the binary's own arithmetic; it cannot be combined with -q\n");
+            return 1;
+        }
+        // As run.sh configures the verificarlo build.
+        if (!mca_mode.empty()) {
+            std::string backends = "libinterflop_mca.so --precision-binary32=" +
+                                   std::to_string(vprecision) + " --precision-binary64=" +
+                                   std::to_string(vprecision) + " --mode " + mca_mode;
+            setenv("VFC_BACKENDS", backends.c_str(), 1);
+        }
+        setenv("VFC_BACKENDS_SILENT_LOAD", "True", 0);
+        setenv("VFC_BACKENDS_LOGGER", "False", 0);
+    } else if ((format.empty() && mca_mode.empty()) || nearest) {
+        // Without a stochastic quantizer or MCA every sample is identical.
+        iterations = 1;
+        adaptive = false;
+    }
+    min_samples = std::min(min_samples, iterations);
+
+    Grid grid;
+    std::string err;
+    CireSpec spec;
+    if (!spec_path.empty() && !load_cire(spec_path, spec, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (!make_grid(k->n_in, range, ranges, step, steps, fixed, grid, err,
+                   spec_path.empty() ? nullptr : &spec)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    std::string tag = !mca_mode.empty() ? "vp" + std::to_string(vprecision) + "-" + mca_mode
+        : format.empty() ? std::string("native")
+        : format + (nearest ? "-rn-" : "-sr-") + points_name(mask);
+    std::string outfile = outdir + "/" + k->name +
+        (k->n_in > 1 ? "-" + std::to_string(k->n_in) + "inputs-grid" : std::string()) +
+        "-" + type + "-" + tag + (binary ? ".rsmp" : ".tab");
+    mkdir(outdir.c_str(), 0755);
+
+    printf("=== fpsweep Configuration ===\n");
+    printf("Kernel: %s (examples/%s)\n", k->name, k->source);
+    if (!external.empty()) {
+        printf("Binary: %s (fork server per thread)\n", external.c_str());
+        if (policy.timeout > 0)
+            printf("Time limit: %g s per run, %u retries\n", policy.timeout, policy.retries);
+    }
+    printf("Precision Type: %s\n", type.c_str());
+    if (!mca_mode.empty())
+        printf("MCA: precision %d, mode %s\n", vprecision, mca_mode.c_str());
+    if (!format.empty())
+        printf("Storage format: %s, %s rounding at %s\n", format.c_str(),
+               nearest ? "nearest" : "stochastic", points_name(mask).c_str());
+    for (const auto& a : grid.axes)
+        printf("  %s: [%g, %g] step %g (%zu values)\n", a.name.c_str(), a.lo, a.hi,
+               a.step, a.size());
+    if (adaptive)
+        printf("Iterations per point: %d to %d, until the digits are known against %g\n",
+               min_samples, iterations, target);
+    else
+        printf("Iterations per point: %d\n", iterations);
+    printf("Threads: %u\n", jobs);
+    printf("Output File: %s\n", outfile.c_str());
+    printf("==============================\n");
+
+    std::unique_ptr<Telemetry> telemetry;
+    if (http_port >= 0 || !metrics_log.empty()) {
+        telemetry.reset(new Telemetry("fpsweep", jobs, grid.size()));
+        if (!start_telemetry(*telemetry, http_port, metrics_log))
+            return 1;
+    }
+    fflush(stdout);
+    auto t0 = std::chrono::steady_clock::now();
+
+    // Samples of one point are kept as fixed-width output vectors so the
+    // per-output and norm-wise digits come out of the same pass.
+    int n_out = k->n_out;
+    double cap = digits_of_bits(!mca_mode.empty() ? vprecision : type == "FLOAT" ? 24 : 53);
+    int ulp_bits = !mca_mode.empty() ? vprecision : type == "FLOAT" ? 24 : 53;
+    int ulp_emin = mca_mode.empty() && type == "FLOAT" ? -126 : -1022;
+    struct Digits {
+        double min[MAX_OUT + 1], sum[MAX_OUT + 1];  // per output, then norm-wise
+        // Per-thread distributions, merged for the quantiles in the summary.
+        QuantileSketch sig[MAX_OUT + 1], ulp[MAX_OUT];
+        // Confident digits at -p; Bernoulli only over points with enough samples.
+        double cnh_min[MAX_OUT], cnh_sum[MAX_OUT], bern_min[MAX_OUT], bern_sum[MAX_OUT];
+        size_t bern_points[MAX_OUT];
+        size_t samples = 0, undecided = 0;
+    };
+    double target_bits = target / std::log10(2.0);
+    size_t npoints = grid.size();
+    std::vector<std::string> chunks(jobs);
+    std::vector<std::vector<double>> xs(jobs), ys(jobs);  // -Z
+    std::vector<double> sums(jobs), sumsqs(jobs);
+    std::vector<size_t> finite(jobs);  // results summed into sums and sumsqs
+    std::vector<Digits> digits(jobs);
+    // -X: samples without a result, runs that crashed or hung to the end,
+    // server restarts, a failure report
+    std::vector<size_t> failed(jobs), crashed(jobs), restarts(jobs);
+    std::vector<std::string> errors(jobs);
+    policy.crash_dir = outdir + "/crashes";
+    for (auto& dg : digits) {
+        std::fill(dg.min, dg.min + MAX_OUT + 1, INFINITY);
+        std::fill(dg.sum, dg.sum + MAX_OUT + 1, 0.0);
+        std::fill(dg.cnh_min, dg.cnh_min + MAX_OUT, INFINITY);
+        std::fill(dg.bern_min, dg.bern_min + MAX_OUT, INFINITY);
+        std::fill(dg.cnh_sum, dg.cnh_sum + MAX_OUT, 0.0);
+        std::fill(dg.bern_sum, dg.bern_sum + MAX_OUT, 0.0);
+        std::fill(dg.bern_points, dg.bern_points + MAX_OUT, size_t(0));
+    }
+    parallel_for(npoints, jobs, [&](size_t b, size_t e, unsigned j) {
+        std::string& out = chunks[j];
+        Digits& dg = digits[j];
+        std::vector<double> samples(size_t(iterations) * n_out);
+        std::vector<SigEstimator> est;
+        char line[512];
+        double xd[MAX_IN], yd[MAX_OUT], sig[MAX_OUT];
+        float xf[MAX_IN], yf[MAX_OUT];
+        mca_config = mca;
+        SupervisedServer server({external}, policy);
+        std::vector<std::string> runs, outputs;
+        std::vector<TaskReport> reports;
+        // Telemetry: one clock read and a few uncontended stores per point.
+        WorkerCounters* wc = telemetry ? &telemetry->worker(j) : nullptr;
+        uint64_t t_point = wc ? telemetry_now_ns() : 0;
+        size_t failed_seen = 0;
+        for (size_t p = b; p < e; p++) {
+            grid.point(p, xd);
+            if (!external.empty()) {
+                // One child per point runs all of its samples.
+                std::string args;
+                for (int d = 0; d < k->n_in; d++)
+                    (args += d ? " " : "") += format_double(xd[d]);
+                if (!extra_args.empty())
+                    args += " " + extra_args;
+                runs.assign(size_t(iterations), args);
+                server.run(runs, seed * 1000003 + p, k->name + std::string("-p") + std::to_string(p),
+                           outputs, reports);
+                for (const auto& r : reports) {
+                    if (r.fate == TaskFate::CRASHED || r.fate == TaskFate::TIMED_OUT)
+                        crashed[j]++;
+                    if (r.fate != TaskFate::OK && errors[j].empty())
+                        errors[j] = "point " + std::to_string(p) + " (" + args + "): " + r.detail +
+                            (r.saved.empty() ? "" : ", saved as " + r.saved);
+                }
+            }
+            for (int d = 0; d < k->n_in; d++)
+                xf[d] = float(xd[d]);
+            // The inputs as run.sh prints them, the same on every sample line.
+            char xtext[MAX_IN * 32] = "";
+            for (int d = 0, n = 0; d < k->n_in && !binary && n < int(sizeof xtext); d++)
+                n += snprintf(xtext + n, sizeof xtext - size_t(n), " %.6f", xd[d]);
+            if (binary)
+                xs[j].insert(xs[j].end(), xd, xd + k->n_in);
+            // Estimators fed as samples arrive, so -e can stop early; the
+            // counters of the samples drawn do not depend on -e.
+            est.assign(size_t(n_out), SigEstimator(level, ulp_bits));
+            int ns = 0;
+            bool settled = false;
+            for (int it = 0; it < iterations && !settled; it++) {
+                ns = it + 1;
+                if (!external.empty()) {
+                    size_t run = size_t(it);
+                    if (reports[run].fate != TaskFate::OK ||
+                        !parse_result(outputs[run], n_out, yd)) {
+                        std::fill(yd, yd + n_out, NAN);
+                        failed[j]++;
+                    }
+                } else if (!mca_mode.empty()) {
+                    mca_rng = CounterRng(seed, (uint64_t(p) * iterations + it) << 20);
+                    k->eval_mca(xd, yd);
+                } else if (!format.empty()) {
+                    // Counter space per sample: 2^20 draws, far more than any kernel uses.
+                    LowpQuant q{&lowp_spec(fmt), mask, !nearest,
+                                CounterRng(seed, (uint64_t(p) * iterations + it) << 20)};
+                    k->eval_lowp(xf, yf, q);
+                    for (int o = 0; o < n_out; o++)
+                        yd[o] = yf[o];
+                } else if (type == "FLOAT") {
+                    k->eval_f32(xf, yf);
+                    for (int o = 0; o < n_out; o++)
+                        yd[o] = yf[o];
+                } else {
+                    k->eval_f64(xd, yd);
+                }
+                for (int o = 0; o < n_out; o++)
+                    est[size_t(o)].add(yd[o]);
+                if (binary) {
+                    ys[j].insert(ys[j].end(), yd, yd + n_out);
+                    for (int o = 0; o < n_out; o++) {
+                        samples[size_t(it) * n_out + o] = yd[o];
+                        if (std::isfinite(yd[o])) {
+                            sums[j] += yd[o];
+                            sumsqs[j] += yd[o] * yd[o];
+                            finite[j]++;
+                        }
+                    }
+                    continue;
+                }
+                int n = snprintf(line, sizeof line, "%d%s", it + 1, xtext);
+                for (int o = 0; o < n_out; o++) {
+                    double y = yd[o];
+                    line[n++] = ' ';
+                    n = int(format_double(line + n, y) - line);
+                    samples[size_t(it) * n_out + o] = y;
+                    if (std::isfinite(y)) {
+                        sums[j] += y;
+                        sumsqs[j] += y * y;
+                        finite[j]++;
+                    }
+                }
+                snprintf(line + n, sizeof line - n, "\n");
+                out += line;
+                settled = adaptive && ns >= min_samples &&
+                          std::all_of(est.begin(), est.end(), [&](const SigEstimator& s) {
+                              return s.decided(target_bits);
+                          });
+            }
+            dg.samples += size_t(ns);
+            dg.undecided += adaptive && !settled;
+            if (ns > 1) {
+                sig[0] = mca_sig_digits(samples.data(), ns, cap);
+                double norm = n_out > 1
+                    ? mca_sig_digits_vec(samples.data(), ns, n_out, cap, sig)
+                    : sig[0];
+                for (int o = 0; o < n_out; o++) {
+                    dg.min[o] = std::min(dg.min[o], sig[o]);
+                    dg.sum[o] += sig[o];
+                    dg.sig[o].add(sig[o]);
+                    // Each sample's distance from the point mean, as rstore's "ulp".
+                    double m = 0;
+                    for (int it = 0; it < ns; it++)
+                        m += samples[size_t(it) * n_out + o];
+                    m /= ns;
+                    for (int it = 0; it < ns; it++)
+                        dg.ulp[o].add(ulp_error(samples[size_t(it) * n_out + o], m,
+                                                ulp_bits - 1, ulp_emin));
+                    double cnh = digits_of_bits(est[size_t(o)].cnh_bits());
+                    double bern = digits_of_bits(est[size_t(o)].bernoulli_bits());
+                    dg.cnh_min[o] = std::min(dg.cnh_min[o], cnh);
+                    dg.cnh_sum[o] += cnh;
+                    if (!std::isnan(bern)) {
+                        dg.bern_min[o] = std::min(dg.bern_min[o], bern);
+                        dg.bern_sum[o] += bern;
+                        dg.bern_points[o]++;
+                    }
+                }
+                dg.min[MAX_OUT] = std::min(dg.min[MAX_OUT], norm);
+                dg.sum[MAX_OUT] += norm;
+                dg.sig[MAX_OUT].add(norm);
+            }
+            if (wc) {
+                uint64_t now = telemetry_now_ns();
+                wc->record(uint64_t(ns), now - t_point);
+                WorkerCounters::bump(wc->failures, failed[j] - failed_seen);
+                failed_seen = failed[j];
+                t_point = now;
+            }
+        }
+        restarts[j] = server.restarts();
+    });
+    if (telemetry)
+        telemetry->stop();
+
+    size_t n_failed = 0, n_crashed = 0, n_restarts = 0;
+    for (unsigned j = 0; j < jobs; j++) {
+        n_failed += failed[j];
+        n_crashed += crashed[j];
+        n_restarts += restarts[j];
+        if (!errors[j].empty())
+            fprintf(stderr, "Warning: %s\n", errors[j].c_str());
+    }
+    if (n_failed)
+        fprintf(stderr, "Warning: %zu samples without a result from %s (NaN)\n", n_failed,
+                external.c_str());
+    if (n_crashed)
+        fprintf(stderr, "Warning: %zu runs crashed or timed out after %u retries, inputs in %s\n",
+                n_crashed, policy.retries, policy.crash_dir.c_str());
+    if (n_restarts)
+        fprintf(stderr, "Warning: %zu fork server restarts\n", n_restarts);
+
+    double sum = 0, sumsq = 0;
+    size_t n_finite = 0;
+    for (unsigned j = 0; j < jobs; j++) {
+        sum += sums[j];
+        sumsq += sumsqs[j];
+        n_finite += finite[j];
+    }
+    if (binary) {
+        // Jobs hold contiguous blocks of points, in order.
+        SampleFile sf;
+        for (const auto& a : grid.axes)
+            sf.inputs.push_back(k->n_in == 1 ? std::string("x") : a.name);
+        sf.n_out = n_out;
+        sf.samples = iterations;
+        sf.points = npoints;
+        for (unsigned j = 0; j < jobs; j++) {
+            sf.x.insert(sf.x.end(), xs[j].begin(), xs[j].end());
+            sf.y.insert(sf.y.end(), ys[j].begin(), ys[j].end());
+        }
+        CodecOptions copt;
+        copt.zstd_level = zstd_level;
+        std::string werr;
+        if (!write_samples(outfile, sf, copt, jobs, werr)) {
+            fprintf(stderr, "Error: %s\n", werr.c_str());
+            return 1;
+        }
+    } else {
+        FILE* f = fopen(outfile.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "Error: Cannot write '%s'\n", outfile.c_str());
+            return 1;
+        }
+        if (k->n_in == 1) {
+            fputs("i x", f);
+        } else {
+            fputs("i", f);
+            for (const auto& a : grid.axes)
+                fprintf(f, " %s", a.name.c_str());
+        }
+        if (n_out == 1) {
+            fputs(" result\n", f);
+        } else {
+            for (int o = 0; o < n_out; o++)
+                fprintf(f, " y%d", o);
+            fputs("\n", f);
+        }
+        for (unsigned j = 0; j < jobs; j++)
+            fputs(chunks[j].c_str(), f);
+        fclose(f);
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    size_t total = 0, undecided = 0;
+    for (unsigned j = 0; j < jobs; j++) {
+        total += digits[j].samples;
+        undecided += digits[j].undecided;
+    }
+    // Over the finite results only; NaN and inf results are counted apart.
+    double mean = sum / double(n_finite);
+    double var = sumsq / double(n_finite) - mean * mean;
+
+    printf("Tests completed. Results saved to: %s\n", outfile.c_str());
+    printf("\n=== Summary Statistics ===\n");
+    printf("Total test points: %zu\n", npoints);
+    printf("Total runs: %zu\n", total);
+    printf("Mean result: %.6e\n", mean);
+    printf("Std deviation: %.6e\n", std::sqrt(var > 0 ? var : 0));
+    if (n_finite < total * n_out)
+        printf("Non-finite results: %zu\n", total * n_out - n_finite);
+    if (iterations > 1) {
+        printf("\n=== Significant Digits (min / mean over points) ===\n");
+        for (int o = 0; o <= n_out; o++) {
+            int slot = o < n_out ? o : MAX_OUT;
+            if (o == n_out && n_out == 1)
+                break;
+            double lo = INFINITY, acc = 0.0;
+            for (unsigned j = 0; j < jobs; j++) {
+                lo = std::min(lo, digits[j].min[slot]);
+                acc += digits[j].sum[slot];
+            }
+            std::string label = o == n_out ? "norm-wise" : n_out == 1 ? "result"
+                                                                       : "y" + std::to_string(o);
+            printf("%-10s %.2f / %.2f\n", label.c_str(), lo, acc / double(npoints));
+        }
+        printf("\n=== Error Quantiles (digits p50 / p1 / p0.1, ULPs from mean p50 / p99 / p99.9) ===\n");
+        for (int o = 0; o < n_out; o++) {
+            QuantileSketch sg, ul;
+            for (unsigned j = 0; j < jobs; j++) {
+                sg.merge(digits[j].sig[o]);
+                ul.merge(digits[j].ulp[o]);
+            }
+            printf("%-10s %.2f / %.2f / %.2f    %.3g / %.3g / %.3g\n",
+                   n_out == 1 ? "result" : ("y" + std::to_string(o)).c_str(), sg.quantile(0.5),
+                   sg.quantile(0.01), sg.quantile(0.001), ul.quantile(0.5), ul.quantile(0.99),
+                   ul.quantile(0.999));
+        }
+        printf("\n=== Confident Digits (probability %g, confidence %g; CNH / Bernoulli, "
+               "min / mean over points) ===\n", level.probability, level.confidence);
+        for (int o = 0; o < n_out; o++) {
+            double cnh_lo = INFINITY, cnh_acc = 0, bern_lo = INFINITY, bern_acc = 0;
+            size_t bern_n = 0;
+            for (unsigned j = 0; j < jobs; j++) {
+                cnh_lo = std::min(cnh_lo, digits[j].cnh_min[o]);
+                cnh_acc += digits[j].cnh_sum[o];
+                bern_lo = std::min(bern_lo, digits[j].bern_min[o]);
+                bern_acc += digits[j].bern_sum[o];
+                bern_n += digits[j].bern_points[o];
+            }
+            std::string label = n_out == 1 ? "result" : "y" + std::to_string(o);
+            printf("%-10s %.2f / %.2f    ", label.c_str(), cnh_lo, cnh_acc / double(npoints));
+            if (bern_n)
+                printf("%.2f / %.2f%s\n", bern_lo, bern_acc / double(bern_n),
+                       bern_n < npoints ? " (points with enough samples)" : "");
+            else
+                printf("needs >= %llu samples\n",
+                       (unsigned long long)bernoulli_min_samples(level));
+        }
+        if (adaptive)
+            printf("Adaptive sampling: %.1f samples per point (of up to %d), %zu points "
+                   "undecided against %g digits\n",
+                   double(total) / double(npoints), iterations, undecided, target);
+    }
+    printf("\n=== Execution Time ===\n");
+    printf("Total time: %.3fs (%.3g samples/s)\n", secs, double(total) / secs);
+    printf("\nDone!\n");
+    return 0;
+}
@@ -0,0 +1,247 @@
+// List the floating-point functions defined in LLVM modules.
+//
+// The CIRE scripts pick the function to analyse with
+//   grep -m1 -oP 'define\s+.*?@(\w+)'
+// which takes whatever is defined first: a static helper, main, or nothing
+// useful once the optimizer reorders definitions. This tool parses each
+// module once with LLVM and reports every defined function with its
+// signature and FP operation counts. It also picks the kernel the scripts
+// should analyse (-1), or lists all FP kernels of a module for a batch run
+// (-n).
+//
+// Needs LLVM; build.sh links it against llvm-config's libraries.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-a] [-1 | -n] MODULE...\n", prog);
+    printf("\n");
+    printf("Arguments:\n");
+    printf("  MODULE          : LLVM IR (.ll) or bitcode (.bc) file\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -a              : Also list functions without floating-point work\n");
+    printf("  -1              : Print only the kernel to analyse, one line per module\n");
+    printf("  -n              : Print only the names of the FP functions, one per line\n");
+    printf("\n");
+    printf("The kernel (marked '*') is the FP function not called from any other\n");
+    printf("function of the module with the most FP operations; main is never chosen.\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s softmax_og0_O1.ll softmax_og0_O2.ll\n", prog);
+    printf("  FUNC=$(%s -1 harmonic0_O1.ll)\n", prog);
+    exit(1);
+}
+
+struct FuncInfo {
+    std::string name;
+    std::string signature;
+    bool external = false;
+    int fp_args = 0;
+    bool fp_ret = false;
+    long arith = 0;      // fadd fsub fmul fdiv frem fneg
+    long cmp = 0;        // fcmp
+    long convert = 0;    // fptrunc fpext fptosi fptoui sitofp uitofp
+    long math = 0;       // FP intrinsics and calls to undefined FP functions (libm)
+    long calls = 0;      // calls to functions defined in the module
+    long vector = 0;     // FP instructions on vector types
+    bool called = false; // called from another function of the module
+
+    long fp_ops() const { return arith + cmp + convert + math; }
+    bool is_fp() const { return fp_args > 0 || fp_ret || fp_ops() > 0; }
+};
+
+static bool fp_type(const llvm::Type* t) {
+    return t->isFPOrFPVectorTy();
+}
+
+static void count(const llvm::Function& f, FuncInfo& info, std::set<const llvm::Function*>& callees) {
+    for (const auto& bb : f) {
+        for (const auto& inst : bb) {
+            bool fp = fp_type(inst.getType()) ||
+                      (inst.getNumOperands() > 0 && fp_type(inst.getOperand(0)->getType()));
+            switch (inst.getOpcode()) {
+            case llvm::Instruction::FAdd:
+            case llvm::Instruction::FSub:
+            case llvm::Instruction::FMul:
+            case llvm::Instruction::FDiv:
+            case llvm::Instruction::FRem:
+            case llvm::Instruction::FNeg: info.arith++; break;
+            case llvm::Instruction::FCmp: info.cmp++; break;
+            case llvm::Instruction::FPTrunc:
+            case llvm::Instruction::FPExt:
+            case llvm::Instruction::FPToSI:
+            case llvm::Instruction::FPToUI:
+            case llvm::Instruction::SIToFP:
+            case llvm::Instruction::UIToFP: info.convert++; break;
+            case llvm::Instruction::Call:
+            case llvm::Instruction::Invoke: {
+                const auto& call = llvm::cast<llvm::CallBase>(inst);
+                const llvm::Function* callee = call.getCalledFunction();
+                if (callee && !callee->isDeclaration()) {
+                    info.calls++;
+                    callees.insert(callee);
+                    fp = false;
+                    break;
+                }
+                // Intrinsics (llvm.fmuladd, llvm.sqrt) and libm calls (expf, tanh)
+                fp = fp_type(call.getType());
+                for (const auto& a : call.args())
+                    fp = fp || fp_type(a->getType());
+                if (fp && !llvm::isa<llvm::DbgInfoIntrinsic>(inst))
+                    info.math++;
+                else
+                    fp = false;
+                break;
+            }
+            default: fp = false;
+            }
+            if (fp && inst.getType()->isVectorTy())
+                info.vector++;
+        }
+    }
+}
+
+static bool inspect(const char* path, std::vector<FuncInfo>& out, std::string& err) {
+    llvm::LLVMContext ctx;
+    llvm::SMDiagnostic diag;
+    std::unique_ptr<llvm::Module> mod = llvm::parseIRFile(path, diag, ctx);
+    if (!mod) {
+        std::string msg;
+        llvm::raw_string_ostream os(msg);
+        diag.print(nullptr, os, false);
+        err = os.str();
+        while (!err.empty() && err.back() == '\n')
+            err.pop_back();
+        return false;
+    }
+    std::set<const llvm::Function*> callees;
+    std::vector<const llvm::Function*> defined;
+    for (const auto& f : *mod) {
+        if (f.isDeclaration())
+            continue;
+        FuncInfo info;
+        info.name = f.getName().str();
+        llvm::raw_string_ostream sig(info.signature);
+        f.getFunctionType()->print(sig);
+        sig.flush();
+        info.external = f.hasExternalLinkage();
+        info.fp_ret = fp_type(f.getReturnType());
+        for (const auto& a : f.args())
+            info.fp_args += fp_type(a.getType()) ||
+                            (a.getType()->isPointerTy() && !a.hasStructRetAttr());
+        // A kernel called from main's test harness is still an entry point
+        std::set<const llvm::Function*> from_main;
+        count(f, info, info.name == "main" ? from_main : callees);
+        out.push_back(info);
+        defined.push_back(&f);
+    }
+    // Pointer arguments only count as FP inputs in functions that do FP work.
+    for (auto& info : out) {
+        if (info.fp_ops() == 0 && !info.fp_ret)
+            info.fp_args = 0;
+    }
+    for (size_t i = 0; i < defined.size(); i++)
+        out[i].called = callees.count(defined[i]) > 0;
+    return true;
+}
+
+// Index of the kernel to analyse, or -1.
+static int pick_kernel(const std::vector<FuncInfo>& funcs) {
+    int best = -1;
+    for (size_t i = 0; i < funcs.size(); i++) {
+        const FuncInfo& f = funcs[i];
+        if (!f.is_fp() || f.name == "main")
+            continue;
+        if (best < 0) {
+            best = int(i);
+            continue;
+        }
+        const FuncInfo& b = funcs[size_t(best)];
+        // Entry points first, then external linkage, then the most FP work
+        if (std::make_tuple(!f.called, f.external, f.fp_ops()) >
+            std::make_tuple(!b.called, b.external, b.fp_ops()))
+            best = int(i);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    bool all = false, first = false, names = false;
+    int c;
+    while ((c = getopt(argc, argv, "a1nh")) != -1) {
+        switch (c) {
+        case 'a': all = true; break;
+        case '1': first = true; break;
+        case 'n': names = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind >= argc || (first && names)) {
+        fprintf(stderr, "Error: %s\n", optind >= argc ? "No module given" : "-1 and -n are exclusive");
+        usage(argv[0]);
+    }
+
+    int status = 0;
+    bool header = false;
+    for (int a = optind; a < argc; a++) {
+        std::vector<FuncInfo> funcs;
+        std::string err;
+        if (!inspect(argv[a], funcs, err)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            status = 1;
+            continue;
+        }
+        int kernel = pick_kernel(funcs);
+        if (first) {
+            if (kernel < 0) {
+                fprintf(stderr, "Error: No FP function in %s\n", argv[a]);
+                status = 1;
+            } else {
+                printf("%s\n", funcs[size_t(kernel)].name.c_str());
+            }
+            continue;
+        }
+        if (names) {
+            for (const auto& f : funcs)
+                if (f.is_fp() && f.name != "main")
+                    printf("%s\n", f.name.c_str());
+            continue;
+        }
+        if (!header) {
+            printf("%-24s %-24s %5s %5s %4s %4s %4s %5s %4s  %s\n", "module", "function", "arith",
+                   "fcmp", "cvt", "math", "vec", "calls", "in", "signature");
+            header = true;
+        }
+        const char* base = strrchr(argv[a], '/');
+        base = base ? base + 1 : argv[a];
+        for (size_t i = 0; i < funcs.size(); i++) {
+            const FuncInfo& f = funcs[i];
+            if (!all && !f.is_fp())
+                continue;
+            printf("%-24s %c%-23s %5ld %5ld %4ld %4ld %4ld %5ld %4d  %s%s\n", base,
+                   int(i) == kernel ? '*' : ' ', f.name.c_str(), f.arith, f.cmp, f.convert, f.math,
+                   f.vector, f.calls, f.fp_args, f.signature.c_str(),
+                   f.external ? "" : " (internal)");
+        }
+    }
+    return status;
+}
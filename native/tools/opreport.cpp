@@ -0,0 +1,277 @@
+// Static FP operation report per kernel build, next to its measured speed.
+//
+// For each registered kernel, finds the compiled float and double
+// evaluators in this executable, disassembles them, and counts FP ops by
+// kind (add, mul, div, sqrt, fma, ...) and vector width, separating libm
+// calls from inlined code. Each build is also timed on the same inputs, so
+// a row answers e.g. whether ex1_alt3's fma became a vfmadd under these
+// flags and what that bought. Build into separate BUILD_DIRs with different
+// CXXFLAGS and append each build's rows to one store with -o and -T.
+//
+// With -d FILE the same counts are reported for every FP function of any
+// executable or object file, e.g. the example programs built with gcc/clang.
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "disasm.hpp"
+#include "kernels.hpp"
+#include "store.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-k KERNELS] [-t TYPES] [-n POINTS] [-o STORE -T TAG]\n", prog);
+    printf("       %s -d FILE [-f FILTER]\n", prog);
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -k KERNELS      : Comma-separated registered kernels (default: all)\n");
+    printf("  -t TYPES        : Builds to report [float,double] (default: both)\n");
+    printf("  -r RANGE        : Input range for the timing as 'start:end' (default: '0.0:1.0')\n");
+    printf("  -n POINTS       : Points per timing run, 0 skips timing (default: 65536)\n");
+    printf("  -T TAG          : Build label stored as 'opt' (default: the target ISA, e.g. 'x86-64+avx2+fma')\n");
+    printf("  -o STORE        : Append one row per kernel build to a result store\n");
+    printf("  -d FILE         : Report every FP function of an executable or object file instead\n");
+    printf("  -f FILTER       : With -d, only functions whose name contains FILTER\n");
+    printf("\n");
+    printf("Columns: FP ops by kind, then the same ops by width (scalar / 128 / 256 / 512 bit),\n");
+    printf("x87 (long double) ops, and the libm functions still called out of line.\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s -k ex1_original,ex1_alt3 -t double\n", prog);
+    printf("  CXXFLAGS='-O2 -std=c++17 -pthread' BUILD_DIR=bin-O2 ./build.sh opreport\n");
+    printf("  bin-O2/opreport -T O2 -o ops.rstore && bin/opreport -T O3-native -o ops.rstore\n");
+    printf("  %s -d ../examples/gelu/gelu_exp0 -f gelu\n", prog);
+    exit(1);
+}
+
+// ISA features this translation unit was compiled for.
+static std::string default_tag() {
+    std::string tag;
+#if defined(__x86_64__)
+    tag = "x86-64";
+#if defined(__AVX512F__)
+    tag += "+avx512f";
+#elif defined(__AVX2__)
+    tag += "+avx2";
+#elif defined(__AVX__)
+    tag += "+avx";
+#endif
+#if defined(__FMA__)
+    tag += "+fma";
+#endif
+#elif defined(__aarch64__)
+    tag = "aarch64";
+#else
+    tag = "unknown";
+#endif
+#if !defined(__OPTIMIZE__)
+    tag += "-O0";
+#endif
+    return tag;
+}
+
+// Disassembled function holding the code at ptr in this executable.
+static const DisasmFunction* locate(const Disassembly& dis, const void* ptr) {
+    Dl_info info;
+    if (!dladdr(ptr, &info))
+        return nullptr;
+    uint64_t addr = uint64_t(uintptr_t(ptr));
+    // PIE executables are disassembled at their link address, 0-based.
+    if (const DisasmFunction* f = dis.at(addr - uint64_t(uintptr_t(info.dli_fbase))))
+        return f;
+    return dis.at(addr);
+}
+
+template <class T>
+static double ns_per_eval(void (*fn)(const T*, T*), int n_in, int n_out, const double* x,
+                          size_t n) {
+    std::vector<T> in(x, x + n * n_in), out(n * n_out);
+    double best = 1e300;
+    for (int r = 0; r < 5; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t p = 0; p < n; p++)
+            fn(&in[p * n_in], &out[p * n_out]);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        best = s < best ? s : best;
+    }
+    return best / double(n) * 1e9;
+}
+
+static void print_header(const char* first, const char* second) {
+    printf("%-16s %-7s %8s %4s %4s %4s %4s %4s %4s %4s %4s  %6s %4s %4s %4s %4s  %s\n", first,
+           second, "ns/eval", "add", "mul", "div", "sqrt", "fma", "mnmx", "cmp", "cvt", "scalar",
+           "128", "256", "512", "x87", "libm");
+}
+
+static void print_row(const char* first, const char* second, double ns, const FpOps& o) {
+    char nsbuf[32];
+    if (std::isnan(ns))
+        snprintf(nsbuf, sizeof nsbuf, "-");
+    else
+        snprintf(nsbuf, sizeof nsbuf, "%.2f", ns);
+    printf("%-16s %-7s %8s %4ld %4ld %4ld %4ld %4ld %4ld %4ld %4ld  %6ld %4ld %4ld %4ld %4ld  %s\n",
+           first, second, nsbuf, o.add, o.mul, o.div, o.sqrt, o.fma, o.minmax, o.cmp, o.cvt,
+           o.scalar, o.v128, o.v256, o.v512, o.x87, o.libm_list().c_str());
+}
+
+static void store_row(ResultStore& store, const std::string& kernel, const std::string& tag,
+                      const std::string& config, const std::string& source, double ns,
+                      const FpOps& o) {
+    size_t row = store.add_row();
+    store.set_str("tool", row, "oprep");
+    store.set_str("kernel", row, kernel);
+    store.set_str("opt", row, tag);
+    store.set_str("config", row, config);
+    store.set_str("source", row, source);
+    store.set("ns_per_eval", row, ns);
+    const std::pair<const char*, long> counts[] = {
+        {"fp_add", o.add},    {"fp_mul", o.mul},       {"fp_div", o.div},   {"fp_sqrt", o.sqrt},
+        {"fp_fma", o.fma},    {"fp_minmax", o.minmax}, {"fp_cmp", o.cmp},   {"fp_cvt", o.cvt},
+        {"fp_scalar", o.scalar}, {"fp_v128", o.v128},  {"fp_v256", o.v256}, {"fp_v512", o.v512},
+        {"fp_x87", o.x87},
+    };
+    for (const auto& c : counts)
+        store.set_int(c.first, row, c.second);
+    store.set_str("libm", row, o.libm_list());
+}
+
+int main(int argc, char** argv) {
+    std::string kernels, types = "float,double", range = "0.0:1.0", tag = default_tag();
+    std::string outpath, file, filter;
+    size_t npoints = 65536;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:t:r:n:T:o:d:f:h")) != -1) {
+        switch (opt) {
+        case 'k': kernels = optarg; break;
+        case 't': types = optarg; break;
+        case 'r': range = optarg; break;
+        case 'n': npoints = strtoull(optarg, nullptr, 10); break;
+        case 'T': tag = optarg; break;
+        case 'o': outpath = optarg; break;
+        case 'd': file = optarg; break;
+        case 'f': filter = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    ResultStore store;
+    std::string err;
+    if (!outpath.empty() && access(outpath.c_str(), F_OK) == 0 &&
+        !ResultStore::load(outpath, store, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    // objdump would resolve /proc/self/exe to itself; pass our own path.
+    std::string target = file;
+    if (target.empty()) {
+        char self[4096];
+        ssize_t len = readlink("/proc/self/exe", self, sizeof self - 1);
+        target = len > 0 ? std::string(self, size_t(len)) : std::string(argv[0]);
+    }
+    Disassembly dis;
+    if (!disassemble(target, dis, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    if (!file.empty()) {
+        // Every function with FP work, counted with the functions it calls.
+        print_header("function", "");
+        for (const auto& f : dis.funcs) {
+            if (!filter.empty() && f.name.find(filter) == std::string::npos)
+                continue;
+            if (f.name.find("@plt") != std::string::npos)
+                continue;
+            FpOps o;
+            count_fp_ops(dis, f, o);
+            if (o.total() == 0 && o.libm.empty() && o.x87 == 0)
+                continue;
+            printf("%s\n", f.name.c_str());
+            print_row("", "", NAN, o);
+            if (!outpath.empty())
+                store_row(store, f.name, tag, "", file, NAN, o);
+        }
+    } else {
+        double lo = 0.0, hi = 1.0;
+        if (sscanf(range.c_str(), "%lf:%lf", &lo, &hi) != 2 || lo > hi) {
+            fprintf(stderr, "Error: Invalid range '%s'\n", range.c_str());
+            return 1;
+        }
+        bool want_f32 = types.find("float") != std::string::npos;
+        bool want_f64 = types.find("double") != std::string::npos;
+        std::vector<const KernelDef*> selected;
+        if (kernels.empty()) {
+            for (const auto& k : kernel_registry())
+                selected.push_back(&k);
+        } else {
+            std::stringstream ss(kernels);
+            std::string name;
+            while (std::getline(ss, name, ',')) {
+                const KernelDef* k = find_kernel(name);
+                if (!k) {
+                    fprintf(stderr, "Error: Unknown kernel '%s' (use fpsweep -l to list)\n",
+                            name.c_str());
+                    return 1;
+                }
+                selected.push_back(k);
+            }
+        }
+
+        // Same inputs for every kernel, enough for the widest one.
+        std::mt19937_64 gen(42);
+        std::uniform_real_distribution<double> dist(lo, hi);
+        std::vector<double> x(npoints * MAX_IN);
+        for (auto& v : x)
+            v = dist(gen);
+
+        printf("=== opreport Configuration ===\n");
+        printf("Build: %s\n", tag.c_str());
+        printf("Timing: %zu points in [%g, %g], best of 5\n", npoints, lo, hi);
+        printf("==============================\n");
+        print_header("kernel", "type");
+        for (const KernelDef* k : selected) {
+            for (int t = 0; t < 2; t++) {
+                bool f32 = t == 0;
+                if (f32 ? !want_f32 : !want_f64)
+                    continue;
+                const void* fn = f32 ? (const void*)k->eval_f32 : (const void*)k->eval_f64;
+                const DisasmFunction* f = locate(dis, fn);
+                FpOps o;
+                if (f)
+                    count_fp_ops(dis, *f, o);
+                else
+                    fprintf(stderr, "Warning: %s: evaluator not found in the disassembly\n",
+                            k->name);
+                double ns = NAN;
+                if (npoints > 0)
+                    ns = f32 ? ns_per_eval(k->eval_f32, k->n_in, k->n_out, x.data(), npoints)
+                             : ns_per_eval(k->eval_f64, k->n_in, k->n_out, x.data(), npoints);
+                const char* type = f32 ? "float" : "double";
+                print_row(k->name, type, ns, o);
+                if (!outpath.empty())
+                    store_row(store, k->name, tag, type, k->source, ns, o);
+            }
+        }
+    }
+
+    if (!outpath.empty()) {
+        if (!store.save(outpath, err)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return 1;
+        }
+        printf("\nRows appended to %s\n", outpath.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Run a study pipeline: compile, sweep, aggregate and plot stages declared
+// in a pipeline file (src/pipeline.hpp), in parallel and in dependency
+// order, rerunning only the stages whose inputs changed since the last run.
+//
+// The studies were manual chains of run.sh, ulpscript.py (with a hard-coded
+// raw_data_filename) and plot.py, each step rerun from scratch. Stage output
+// goes to FILE.logs/STAGE.log; the content hashes to FILE.cache.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "parallel.hpp"
+#include "pipeline.hpp"
+#include "telemetry.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-j JOBS] [-n] [-f] [-D NAME=VALUE] [-c CACHE] [-H PORT] [-J LOG] FILE [STAGE...]\n", prog);
+    printf("\n");
+    printf("Required arguments:\n");
+    printf("  FILE            : Pipeline file\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  STAGE...        : Stages to bring up to date, names or globs like 'softmax.*',\n");
+    printf("                    with everything they depend on (default: all)\n");
+    printf("  -j JOBS         : Stages run concurrently (default: number of CPU cores)\n");
+    printf("  -n              : Show which stages would run, run nothing\n");
+    printf("  -f              : Rerun the selected stages even if they are up to date\n");
+    printf("  -D NAME=VALUE   : Override a 'set' variable of the pipeline file\n");
+    printf("  -c CACHE        : Hash cache (default: FILE.cache; logs go next to it in .logs)\n");
+    printf("  -H PORT         : Serve live metrics (Prometheus text) on http://127.0.0.1:PORT/metrics\n");
+    printf("  -J FILE[:SECS]  : Append a JSON metrics line to FILE ('-' for stderr) every SECS (default: 10)\n");
+    printf("  -l              : List the stages with their dependencies and exit\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  # Reproduce every example study, as parallel as the DAG allows:\n");
+    printf("  %s ../examples/studies.pipeline\n", prog);
+    printf("\n");
+    printf("  # Replot softmax after editing plot options; the sweeps stay cached:\n");
+    printf("  %s ../examples/studies.pipeline 'softmax.plot.*'\n", prog);
+    printf("\n");
+    printf("  # Every sweep at 53 bits, with a JSON progress line every 30 s:\n");
+    printf("  %s -D PREC=53 -J studies.metrics:30 ../examples/studies.pipeline\n", prog);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    PipelineOptions opts;
+    opts.jobs = default_jobs();
+    std::vector<std::pair<std::string, std::string>> defines;
+    bool list = false;
+    int http_port = -1;
+    std::string metrics_log;
+
+    int c;
+    while ((c = getopt(argc, argv, "j:nfD:c:H:J:lh")) != -1) {
+        switch (c) {
+        case 'j': opts.jobs = unsigned(atoi(optarg)); break;
+        case 'n': opts.dry_run = true; break;
+        case 'f': opts.force = true; break;
+        case 'D': {
+            std::string d = optarg;
+            size_t eq = d.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                fprintf(stderr, "Error: Invalid definition '%s', expected NAME=VALUE\n", optarg);
+                return 1;
+            }
+            defines.emplace_back(d.substr(0, eq), d.substr(eq + 1));
+            break;
+        }
+        case 'c': opts.cache_path = optarg; break;
+        case 'H': http_port = atoi(optarg); break;
+        case 'J': metrics_log = optarg; break;
+        case 'l': list = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Error: Missing required arguments\n");
+        usage(argv[0]);
+    }
+    std::string file = argv[optind];
+    for (int i = optind + 1; i < argc; i++)
+        opts.targets.push_back(argv[i]);
+    if (opts.cache_path.empty())
+        opts.cache_path = file + ".cache";
+    std::string base = opts.cache_path;
+    if (base.size() > 6 && base.compare(base.size() - 6, 6, ".cache") == 0)
+        base.erase(base.size() - 6);
+    opts.log_dir = base + ".logs";
+
+    Pipeline p;
+    std::string err;
+    if (!load_pipeline(file, defines, p, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (list) {
+        for (const auto& s : p.stages) {
+            printf("%s", s.name.c_str());
+            for (size_t i = 0; i < s.deps.size(); i++)
+                printf("%s%s", i ? " " : " <- ", p.stages[s.deps[i]].name.c_str());
+            printf("\n");
+        }
+        return 0;
+    }
+    PipelineCache cache;
+    if (!cache.load(opts.cache_path, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    std::unique_ptr<Telemetry> telemetry;
+    if (!opts.dry_run && (http_port >= 0 || !metrics_log.empty())) {
+        telemetry.reset(new Telemetry("pipeline", opts.jobs, p.stages.size()));
+        if (!start_telemetry(*telemetry, http_port, metrics_log))
+            return 1;
+        opts.telemetry = telemetry.get();
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t done = 0, total = p.stages.size();
+    std::vector<StageResult> results;
+    auto progress = [&](size_t i, const StageResult& r) {
+        printf("[%3zu] %-9s %s", ++done, state_name(r.state), p.stages[i].name.c_str());
+        if (r.state == StageState::RAN)
+            printf(" (%.1f s)", r.seconds);
+        if (!r.detail.empty())
+            printf(": %s", r.detail.c_str());
+        printf("\n");
+        fflush(stdout);
+    };
+    if (!run_pipeline(p, cache, opts, results, progress, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (telemetry)
+        telemetry->stop();
+
+    size_t count[6] = {};
+    for (const auto& r : results)
+        count[int(r.state)]++;
+    // The end of each failed stage's log, where the reason usually is.
+    for (size_t i = 0; i < total; i++) {
+        if (results[i].state != StageState::FAILED || results[i].log.empty())
+            continue;
+        std::ifstream in(results[i].log);
+        std::vector<std::string> tail;
+        for (std::string line; std::getline(in, line);) {
+            tail.push_back(line);
+            if (tail.size() > 10)
+                tail.erase(tail.begin());
+        }
+        fprintf(stderr, "\n--- %s (%s) ---\n", p.stages[i].name.c_str(),
+                results[i].log.c_str());
+        for (const auto& line : tail)
+            fprintf(stderr, "%s\n", line.c_str());
+    }
+    printf("\n=== Pipeline Summary ===\n");
+    if (opts.dry_run) {
+        printf("%zu stages would run, %zu up to date\n", count[int(StageState::WOULD_RUN)],
+               count[int(StageState::CACHED)]);
+        return 0;
+    }
+    printf("Ran: %zu, cached: %zu, failed: %zu, blocked: %zu\n", count[int(StageState::RAN)],
+           count[int(StageState::CACHED)], count[int(StageState::FAILED)],
+           count[int(StageState::BLOCKED)]);
+    printf("Total time: %.3fs\n", secs);
+    return count[int(StageState::FAILED)] || count[int(StageState::BLOCKED)] ? 2 : 0;
+}
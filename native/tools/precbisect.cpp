@@ -0,0 +1,417 @@
+// Bisect the virtual precision a kernel needs, region by region.
+//
+// The results directories hold hand-picked precisions (vp2, vp15, vp24,
+// vp53). This splits the input grid into regions and, for each one, bisects
+// the MCA or VPREC precision down to the smallest value whose worst input
+// still meets a significant-digit target. All regions advance together: each
+// round gathers the probe precision of every unfinished region and evaluates
+// them in one threaded sweep, so a round costs one pass over the grid no
+// matter how many regions it contains.
+//
+// The search assumes digits grow with precision, which holds up to MCA noise.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "grid.hpp"
+#include "kernels.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s -k KERNEL [-M MODE] [-d DIGITS] [-g REGIONS] [options]\n", prog);
+    printf("\n");
+    printf("Required arguments:\n");
+    printf("  -k KERNEL       : Registered kernel name (see fpsweep -l)\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -M MODE         : [mca | pb | rr] for MCA, or vprec (default: mca)\n");
+    printf("  -d DIGITS       : Required significant digits in every input (default: 3)\n");
+    printf("  -g REGIONS      : Regions per input as 'N' or 'x0=N,x1=M' (default: 8)\n");
+    printf("  -b BOUNDS       : Precision search bounds as 'min:max' (default: '1:53', vprec '1:52')\n");
+    printf("  -e EXP_BITS     : VPREC exponent bits (default: 11)\n");
+    printf("  -i ITERATIONS   : MCA samples per input point (default: 20)\n");
+    printf("  -r RANGE        : Test range as 'start:end' for all inputs (default: '-1.0:1.0')\n");
+    printf("  -R RANGES       : Individual ranges as 'x0=start:end,x1=start:end'\n");
+    printf("  -C SPEC         : Take the input box from a CIRE .cire file (-R/-F still override)\n");
+    printf("  -s STEP         : Step size for all inputs (default: 0.5)\n");
+    printf("  -S STEPS        : Individual steps as 'x0=step,x1=step'\n");
+    printf("  -F FIXED        : Fixed values for some inputs as 'x1=0.0,x2=0.0'\n");
+    printf("  -x SEED         : Random seed (default: 1)\n");
+    printf("  -j JOBS         : Number of threads (default: number of CPU cores)\n");
+    printf("  -o OUTPUT_DIR   : Output directory (default: './precbisect_results')\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  # MCA bits needed for 4 digits across 16 slices of the ex1 range:\n");
+    printf("  %s -k ex1_original -r '0:100000' -s 100 -g 16 -d 4\n", prog);
+    printf("\n");
+    printf("  # VPREC mantissa bits over a 2D softmax input plane:\n");
+    printf("  %s -k softmax_stable -M vprec -R 'x0=-10:10,x1=-10:10' -F 'x2=0' -s 0.25 -g 8\n", prog);
+    exit(1);
+}
+
+static bool parse_span(const char* s, int& lo, int& hi) {
+    return sscanf(s, "%d:%d", &lo, &hi) == 2 && lo <= hi;
+}
+
+// Region counts per axis from 'N' (every axis) or 'x0=N,x1=M'.
+static bool parse_splits(const std::string& spec, const Grid& grid, std::vector<size_t>& splits,
+                         std::string& err) {
+    splits.assign(grid.axes.size(), 1);
+    if (spec.find('=') == std::string::npos) {
+        long n = atol(spec.c_str());
+        if (n < 1) {
+            err = "Invalid region count '" + spec + "'";
+            return false;
+        }
+        for (auto& s : splits)
+            s = size_t(n);
+    } else {
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            size_t eq = item.find('=');
+            std::string name = item.substr(0, eq);
+            long n = eq == std::string::npos ? 0 : atol(item.c_str() + eq + 1);
+            size_t d = 0;
+            while (d < grid.axes.size() && grid.axes[d].name != name)
+                d++;
+            if (d == grid.axes.size() || n < 1) {
+                err = "Invalid region split '" + item + "'";
+                return false;
+            }
+            splits[d] = size_t(n);
+        }
+    }
+    // An axis cannot have more regions than values.
+    for (size_t d = 0; d < splits.size(); d++)
+        splits[d] = std::min(splits[d], grid.axes[d].size());
+    return true;
+}
+
+struct Region {
+    std::vector<size_t> first, last;  // per-axis value index span, inclusive
+    std::vector<size_t> points;       // grid indices inside the region
+    int lo, hi;                       // bisection bracket on the precision
+    int probes = 0;
+    int bits = -1;                    // answer, -1 if not met at the upper bound
+    double sig_at_bits = 0.0;         // worst-input digits at `bits`
+    size_t worst = 0;                 // grid index of that input
+};
+
+int main(int argc, char** argv) {
+    std::string kernel, mode = "mca", splits_spec = "8", outdir = "./precbisect_results";
+    std::string range, ranges, step, steps, fixed, spec_path;
+    double digits = 3.0;
+    int tmin = 1, tmax = 0, exp_bits = 11, iterations = 20;
+    uint64_t seed = 1;
+    unsigned jobs = default_jobs();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:M:d:g:b:e:i:r:R:C:s:S:F:x:j:o:h")) != -1) {
+        switch (opt) {
+        case 'k': kernel = optarg; break;
+        case 'M': mode = optarg; break;
+        case 'd': digits = atof(optarg); break;
+        case 'g': splits_spec = optarg; break;
+        case 'b':
+            if (!parse_span(optarg, tmin, tmax)) usage(argv[0]);
+            break;
+        case 'e': exp_bits = atoi(optarg); break;
+        case 'i': iterations = atoi(optarg); break;
+        case 'r': range = optarg; break;
+        case 'R': ranges = optarg; break;
+        case 'C': spec_path = optarg; break;
+        case 's': step = optarg; break;
+        case 'S': steps = optarg; break;
+        case 'F': fixed = optarg; break;
+        case 'x': seed = strtoull(optarg, nullptr, 10); break;
+        case 'j': jobs = unsigned(atoi(optarg)); break;
+        case 'o': outdir = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    if (kernel.empty()) {
+        fprintf(stderr, "Error: Missing required arguments\n");
+        usage(argv[0]);
+    }
+    const KernelDef* k = find_kernel(kernel);
+    if (!k) {
+        fprintf(stderr, "Error: Unknown kernel '%s' (use fpsweep -l to list)\n", kernel.c_str());
+        return 1;
+    }
+    bool vprec = mode == "vprec";
+    McaConfig mca;
+    if (!vprec && !parse_mca_mode(mode.c_str(), mca.mode)) {
+        fprintf(stderr, "Error: Invalid mode '%s'. Choose between [mca | pb | rr | vprec]\n",
+                mode.c_str());
+        return 1;
+    }
+    int limit = vprec ? 52 : 53;
+    if (tmax == 0)
+        tmax = limit;
+    if (tmin < 1 || tmax > limit || exp_bits < 2 || exp_bits > 11 || iterations < 2) {
+        fprintf(stderr, "Error: Bounds must lie in [1, %d], exponent bits in [2, 11] and "
+                "iterations be at least 2\n", limit);
+        return 1;
+    }
+    if (vprec)
+        iterations = 1;
+
+    Grid grid;
+    std::string err;
+    CireSpec spec;
+    if (!spec_path.empty() && !load_cire(spec_path, spec, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    std::vector<size_t> splits;
+    if (!make_grid(k->n_in, range, ranges, step, steps, fixed, grid, err,
+                   spec_path.empty() ? nullptr : &spec) ||
+        !parse_splits(splits_spec, grid, splits, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    // Inputs and (for VPREC) oracle values are shared by every probe.
+    size_t npoints = grid.size();
+    int n_in = k->n_in, n_out = k->n_out;
+    std::vector<double> inputs(npoints * n_in);
+    std::vector<long double> refs(vprec ? npoints * n_out : 0);
+    for (size_t p = 0; p < npoints; p++) {
+        double* x = &inputs[p * n_in];
+        grid.point(p, x);
+        if (vprec) {
+            long double xl[MAX_IN];
+            for (int d = 0; d < n_in; d++)
+                xl[d] = x[d];
+            k->eval_ref(xl, &refs[p * n_out]);
+        }
+    }
+
+    // Regions are the cartesian product of contiguous index spans per axis.
+    size_t nregions = 1;
+    for (size_t s : splits)
+        nregions *= s;
+    std::vector<Region> regions(nregions);
+    for (size_t r = 0; r < nregions; r++) {
+        Region& reg = regions[r];
+        size_t rem = r;
+        reg.first.resize(n_in);
+        reg.last.resize(n_in);
+        for (int d = n_in - 1; d >= 0; d--) {
+            size_t c = rem % splits[d], n = grid.axes[d].size();
+            rem /= splits[d];
+            reg.first[d] = n * c / splits[d];
+            reg.last[d] = n * (c + 1) / splits[d] - 1;
+        }
+        reg.lo = tmin;
+        reg.hi = tmax;
+    }
+    for (size_t p = 0; p < npoints; p++) {
+        size_t rem = p, r = 0, mul = 1;
+        for (int d = n_in - 1; d >= 0; d--) {
+            size_t n = grid.axes[d].size(), idx = rem % n;
+            rem /= n;
+            r += mul * (idx * splits[d] / n);
+            mul *= splits[d];
+        }
+        regions[r].points.push_back(p);
+    }
+
+    printf("=== precbisect Configuration ===\n");
+    printf("Kernel: %s (examples/%s)\n", k->name, k->source);
+    if (vprec)
+        printf("Mode: vprec (%d exponent bits), mantissa bits %d..%d\n", exp_bits, tmin, tmax);
+    else
+        printf("Mode: %s, %d samples per input, precision %d..%d\n", mode.c_str(), iterations,
+               tmin, tmax);
+    printf("Target: %.2f significant digits\n", digits);
+    for (size_t d = 0; d < grid.axes.size(); d++)
+        printf("  %s: [%g, %g] step %g (%zu values, %zu regions)\n", grid.axes[d].name.c_str(),
+               grid.axes[d].lo, grid.axes[d].hi, grid.axes[d].step, grid.axes[d].size(),
+               splits[d]);
+    printf("Regions: %zu, input points: %zu\n", nregions, npoints);
+    printf("Threads: %u\n", jobs);
+    printf("================================\n");
+
+    // Digits of one grid point at precision t, worst over the outputs; y has
+    // room for iterations * n_out samples.
+    auto point_digits = [&](size_t p, int t, double* y) {
+        const double* x = &inputs[p * n_in];
+        double s = INFINITY;
+        if (vprec) {
+            vprec_config = {t, exp_bits};
+            k->eval_vprec(x, y);
+            for (int o = 0; o < n_out; o++)
+                s = std::min(s, sig_digits(y[o], refs[p * n_out + o], digits_of_bits(t + 1)));
+            return s;
+        }
+        mca_config = {t, mca.mode};
+        for (int it = 0; it < iterations; it++) {
+            // Keyed by precision so each probe draws an independent stream.
+            mca_rng = CounterRng(seed + (uint64_t(t) << 56),
+                                 (uint64_t(p) * uint64_t(iterations) + uint64_t(it)) << 20);
+            k->eval_mca(x, y + it * n_out);
+        }
+        for (int o = 0; o < n_out; o++)
+            s = std::min(s, mca_sig_digits(y + o, iterations, digits_of_bits(t), n_out));
+        return s;
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t evaluations = 0;
+    int rounds = 0;
+    std::vector<int> probe(nregions);
+    std::vector<double> sig(nregions);
+    std::vector<size_t> worst(nregions);
+
+    // Round 0 probes every region at the upper bound; later rounds probe the
+    // midpoint of each open bracket.
+    for (bool first = true;; first = false) {
+        struct Task {
+            int t;
+            size_t region, point;
+        };
+        std::vector<size_t> active;
+        for (size_t r = 0; r < nregions; r++) {
+            Region& reg = regions[r];
+            if (first || reg.lo < reg.hi) {
+                probe[r] = first ? reg.hi : (reg.lo + reg.hi) / 2;
+                active.push_back(r);
+            }
+        }
+        if (active.empty())
+            break;
+        // Group by probe precision so one sweep covers every region at that t.
+        std::stable_sort(active.begin(), active.end(),
+                         [&](size_t a, size_t b) { return probe[a] < probe[b]; });
+        std::vector<Task> tasks;
+        for (size_t r : active)
+            for (size_t p : regions[r].points)
+                tasks.push_back({probe[r], r, p});
+
+        std::vector<double> task_sig(tasks.size());
+        parallel_for(tasks.size(), jobs, [&](size_t b, size_t e, unsigned) {
+            std::vector<double> y(size_t(iterations) * size_t(n_out));
+            for (size_t i = b; i < e; i++)
+                task_sig[i] = point_digits(tasks[i].point, tasks[i].t, y.data());
+        });
+        evaluations += tasks.size() * size_t(iterations);
+        rounds++;
+
+        for (size_t r : active) {
+            sig[r] = INFINITY;
+            worst[r] = 0;
+        }
+        for (size_t i = 0; i < tasks.size(); i++) {
+            size_t r = tasks[i].region;
+            if (task_sig[i] < sig[r]) {
+                sig[r] = task_sig[i];
+                worst[r] = tasks[i].point;
+            }
+        }
+        for (size_t r : active) {
+            Region& reg = regions[r];
+            reg.probes++;
+            bool ok = sig[r] >= digits;
+            if (ok) {
+                reg.hi = probe[r];
+                reg.bits = probe[r];
+                reg.sig_at_bits = sig[r];
+                reg.worst = worst[r];
+            } else if (first) {
+                reg.lo = reg.hi;  // unreachable within the bounds: close the bracket
+                reg.sig_at_bits = sig[r];
+                reg.worst = worst[r];
+            } else {
+                reg.lo = probe[r] + 1;
+            }
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    mkdir(outdir.c_str(), 0755);
+    char dtag[32];
+    snprintf(dtag, sizeof dtag, "d%g", digits);
+    std::string outfile = outdir + "/" + k->name + "-bits-" + mode + "-" + dtag + ".csv";
+    FILE* f = fopen(outfile.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", outfile.c_str());
+        return 1;
+    }
+    fputs("region", f);
+    for (const auto& a : grid.axes)
+        fprintf(f, ",%s_lo,%s_hi", a.name.c_str(), a.name.c_str());
+    fputs(",points,bits_needed,sig_digits_at_bits,probes", f);
+    for (const auto& a : grid.axes)
+        fprintf(f, ",worst_%s", a.name.c_str());
+    fputs("\n", f);
+    double xw[MAX_IN];
+    for (size_t r = 0; r < nregions; r++) {
+        const Region& reg = regions[r];
+        fprintf(f, "%zu", r);
+        for (int d = 0; d < n_in; d++)
+            fprintf(f, ",%.6f,%.6f", grid.axes[d].value(reg.first[d]),
+                    grid.axes[d].value(reg.last[d]));
+        fprintf(f, ",%zu,%d,%.4f,%d", reg.points.size(), reg.bits, reg.sig_at_bits, reg.probes);
+        grid.point(reg.worst, xw);
+        for (int d = 0; d < n_in; d++)
+            fprintf(f, ",%.6f", xw[d]);
+        fputs("\n", f);
+    }
+    fclose(f);
+
+    printf("Results saved to: %s\n", outfile.c_str());
+    printf("\n=== Bits needed for %.2f digits (-1: not met at %d) ===\n", digits, tmax);
+    // Axes with more than one region, in grid order.
+    std::vector<int> shown;
+    for (int d = 0; d < n_in; d++)
+        if (splits[d] > 1)
+            shown.push_back(d);
+    if (shown.size() == 2) {
+        int dr = shown[0], dc = shown[1];
+        size_t stride_c = 1;
+        for (int d = dc + 1; d < n_in; d++)
+            stride_c *= splits[d];
+        size_t stride_r = stride_c * splits[dc];
+        printf("%12s", (grid.axes[dr].name + "\\" + grid.axes[dc].name).c_str());
+        for (size_t c = 0; c < splits[dc]; c++)
+            printf(" %6.3g", grid.axes[dc].value(regions[c * stride_c].first[dc]));
+        printf("\n");
+        for (size_t rr = 0; rr < splits[dr]; rr++) {
+            printf("%12.4g", grid.axes[dr].value(regions[rr * stride_r].first[dr]));
+            for (size_t c = 0; c < splits[dc]; c++)
+                printf(" %6d", regions[rr * stride_r + c * stride_c].bits);
+            printf("\n");
+        }
+    } else {
+        for (const auto& reg : regions) {
+            for (int d : shown)
+                printf("%s [%.4g, %.4g]  ", grid.axes[d].name.c_str(),
+                       grid.axes[d].value(reg.first[d]), grid.axes[d].value(reg.last[d]));
+            printf("%3d bits (%.2f digits, %d probes)\n", reg.bits, reg.sig_at_bits, reg.probes);
+        }
+    }
+    int overall = 0;
+    for (const auto& reg : regions)
+        overall = reg.bits < 0 || overall < 0 ? -1 : std::max(overall, reg.bits);
+    printf("Whole grid: %d bits\n", overall);
+    printf("\n=== Execution Time ===\n");
+    printf("Total time: %.3fs, %d rounds (%.3g kernel evaluations/s)\n", secs, rounds,
+           double(evaluations) / secs);
+    printf("\nDone!\n");
+    return 0;
+}
@@ -0,0 +1,240 @@
+// Sweep a kernel over the whole (exponent bits, mantissa bits) plane.
+//
+// run_vprec.sh -P CUSTOM -b P -R E evaluates one custom format per run. This
+// evaluates every (E, P) cell of a range for one kernel and input grid in a
+// single process, threads over cells, and writes one CSV row per cell with
+// max/mean ULP error, overflow rate and significant digits against a long
+// double oracle. native/python/precision_heatmap.py plots the CSV.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "grid.hpp"
+#include "kernels.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s -k KERNEL [-e EXP_BITS] [-b MANT_BITS] [-P POINTS] [options]\n", prog);
+    printf("\n");
+    printf("Required arguments:\n");
+    printf("  -k KERNEL       : Registered kernel name (see fpsweep -l)\n");
+    printf("\n");
+    printf("Optional arguments:\n");
+    printf("  -e EXP_BITS     : Exponent bits as 'min:max' (default: '3:11')\n");
+    printf("  -b MANT_BITS    : Explicit mantissa bits as 'min:max' (default: '1:52')\n");
+    printf("  -P POINTS       : 'ops' rounds every operation like VPREC (default);\n");
+    printf("                    a point list [in,exp,acc,out] only rounds values stored there\n");
+    printf("  -r RANGE        : Test range as 'start:end' for all inputs (default: '-1.0:1.0')\n");
+    printf("  -R RANGES       : Individual ranges as 'x0=start:end,x1=start:end'\n");
+    printf("  -C SPEC         : Take the input box from a CIRE .cire file (-R/-F still override)\n");
+    printf("  -s STEP         : Step size for all inputs (default: 0.5)\n");
+    printf("  -S STEPS        : Individual steps as 'x0=step,x1=step'\n");
+    printf("  -F FIXED        : Fixed values for some inputs as 'x1=0.0,x2=0.0'\n");
+    printf("  -d DIGITS       : Required significant digits for the minimum-format search (default: 2)\n");
+    printf("  -u ULPS         : Also require max ULP error (in the format) <= ULPS\n");
+    printf("  -j JOBS         : Number of threads (default: number of CPU cores)\n");
+    printf("  -o OUTPUT_DIR   : Output directory (default: './precgrid_results')\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  # Storage format for GELU activations:\n");
+    printf("  %s -k gelu_tanh0 -r '-6:6' -s 0.01 -P out -e 2:8 -b 1:23 -d 3\n", prog);
+    printf("\n");
+    printf("  # Full VPREC arithmetic for the stable softmax:\n");
+    printf("  %s -k softmax_stable -R 'x0=-10:10,x1=-10:10' -F 'x2=0' -s 0.25\n", prog);
+    exit(1);
+}
+
+static bool parse_span(const char* s, int& lo, int& hi) {
+    return sscanf(s, "%d:%d", &lo, &hi) == 2 && lo <= hi;
+}
+
+struct Cell {
+    int exp_bits, man_bits;
+    double max_ulp = 0, mean_ulp = 0, overflow_rate = 0;
+    double min_sig = INFINITY, mean_sig = 0;
+    double min_norm_sig = INFINITY;  // norm-wise over the outputs
+};
+
+int main(int argc, char** argv) {
+    std::string kernel, points = "ops", outdir = "./precgrid_results";
+    std::string range, ranges, step, steps, fixed, spec_path;
+    int emin_bits = 3, emax_bits = 11, mmin_bits = 1, mmax_bits = 52;
+    double digits = 2.0, ulps = INFINITY;
+    unsigned jobs = default_jobs();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:e:b:P:r:R:C:s:S:F:d:u:j:o:h")) != -1) {
+        switch (opt) {
+        case 'k': kernel = optarg; break;
+        case 'e':
+            if (!parse_span(optarg, emin_bits, emax_bits)) usage(argv[0]);
+            break;
+        case 'b':
+            if (!parse_span(optarg, mmin_bits, mmax_bits)) usage(argv[0]);
+            break;
+        case 'P': points = optarg; break;
+        case 'r': range = optarg; break;
+        case 'R': ranges = optarg; break;
+        case 'C': spec_path = optarg; break;
+        case 's': step = optarg; break;
+        case 'S': steps = optarg; break;
+        case 'F': fixed = optarg; break;
+        case 'd': digits = atof(optarg); break;
+        case 'u': ulps = atof(optarg); break;
+        case 'j': jobs = unsigned(atoi(optarg)); break;
+        case 'o': outdir = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    if (kernel.empty()) {
+        fprintf(stderr, "Error: Missing required arguments\n");
+        usage(argv[0]);
+    }
+    const KernelDef* k = find_kernel(kernel);
+    if (!k) {
+        fprintf(stderr, "Error: Unknown kernel '%s' (use fpsweep -l to list)\n", kernel.c_str());
+        return 1;
+    }
+    if (emin_bits < 2 || emax_bits > 11 || mmin_bits < 1 || mmax_bits > 52) {
+        fprintf(stderr, "Error: Exponent bits must lie in [2, 11] and mantissa bits in [1, 52]\n");
+        return 1;
+    }
+    bool all_ops = points == "ops";
+    unsigned mask = all_ops ? 0 : parse_points(points) & k->points;
+    if (!all_ops && mask == 0) {
+        fprintf(stderr, "Error: No valid points in '%s' for %s (has: %s)\n", points.c_str(),
+                k->name, points_name(k->points).c_str());
+        return 1;
+    }
+
+    Grid grid;
+    std::string err;
+    CireSpec spec;
+    if (!spec_path.empty() && !load_cire(spec_path, spec, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (!make_grid(k->n_in, range, ranges, step, steps, fixed, grid, err,
+                   spec_path.empty() ? nullptr : &spec)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    // Inputs and oracle values are shared by every cell.
+    size_t npoints = grid.size();
+    int n_out = k->n_out;
+    std::vector<double> inputs(npoints * k->n_in);
+    std::vector<long double> refs(npoints * n_out);
+    for (size_t p = 0; p < npoints; p++) {
+        double* x = &inputs[p * k->n_in];
+        grid.point(p, x);
+        long double xl[MAX_IN];
+        for (int d = 0; d < k->n_in; d++)
+            xl[d] = x[d];
+        k->eval_ref(xl, &refs[p * n_out]);
+    }
+
+    std::vector<Cell> cells;
+    for (int e = emin_bits; e <= emax_bits; e++)
+        for (int m = mmin_bits; m <= mmax_bits; m++)
+            cells.push_back({e, m});
+
+    std::string mode = all_ops ? "ops" : points_name(mask);
+    printf("=== precgrid Configuration ===\n");
+    printf("Kernel: %s (examples/%s)\n", k->name, k->source);
+    printf("Rounding: %s\n", all_ops ? "every operation (VPREC)" : ("stores at " + mode).c_str());
+    printf("Exponent bits: %d..%d, mantissa bits: %d..%d (%zu formats)\n", emin_bits,
+           emax_bits, mmin_bits, mmax_bits, cells.size());
+    printf("Input points: %zu\n", npoints);
+    printf("Threads: %u\n", jobs);
+    printf("==============================\n");
+
+    auto t0 = std::chrono::steady_clock::now();
+    parallel_for(cells.size(), jobs, [&](size_t b, size_t e, unsigned) {
+        for (size_t c = b; c < e; c++) {
+            Cell& cell = cells[c];
+            int fmt_emin = 2 - (1 << (cell.exp_bits - 1));
+            double cap = digits_of_bits(cell.man_bits + 1);
+            vprec_config = {cell.man_bits, cell.exp_bits};
+            VprecQuant q{mask, cell.man_bits, cell.exp_bits};
+            size_t overflowed = 0, finite = 0;
+            double ulp_sum = 0, sig_sum = 0;
+            double y[MAX_OUT];
+            for (size_t p = 0; p < npoints; p++) {
+                const double* x = &inputs[p * k->n_in];
+                const long double* ref = &refs[p * n_out];
+                vprec_overflows = 0;
+                if (all_ops)
+                    k->eval_vprec(x, y);
+                else
+                    k->eval_vprec_at(x, y, q);
+                overflowed += vprec_overflows > 0;
+                for (int o = 0; o < n_out; o++) {
+                    double u = ulp_error(y[o], ref[o], cell.man_bits, fmt_emin);
+                    double s = sig_digits(y[o], ref[o], cap);
+                    cell.max_ulp = u > cell.max_ulp ? u : cell.max_ulp;
+                    cell.min_sig = s < cell.min_sig ? s : cell.min_sig;
+                    sig_sum += s;
+                    if (std::isfinite(u)) {
+                        ulp_sum += u;
+                        finite++;
+                    }
+                }
+                double ns = sig_digits_norm(y, ref, n_out, cap);
+                cell.min_norm_sig = ns < cell.min_norm_sig ? ns : cell.min_norm_sig;
+            }
+            cell.mean_ulp = finite ? ulp_sum / double(finite) : INFINITY;
+            cell.mean_sig = sig_sum / double(npoints * n_out);
+            cell.overflow_rate = double(overflowed) / double(npoints);
+        }
+    });
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    mkdir(outdir.c_str(), 0755);
+    std::string outfile = outdir + "/" + k->name + "-precgrid-" + mode + ".csv";
+    FILE* f = fopen(outfile.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", outfile.c_str());
+        return 1;
+    }
+    fprintf(f, "exp_bits,man_bits,total_bits,max_ulp,mean_ulp,overflow_rate,min_sig_digits,mean_sig_digits,min_norm_sig_digits\n");
+    const Cell* best = nullptr;
+    for (const auto& c : cells) {
+        fprintf(f, "%d,%d,%d,%.6e,%.6e,%.6f,%.4f,%.4f,%.4f\n", c.exp_bits, c.man_bits,
+                1 + c.exp_bits + c.man_bits, c.max_ulp, c.mean_ulp, c.overflow_rate,
+                c.min_sig, c.mean_sig, c.min_norm_sig);
+        bool ok = c.overflow_rate == 0.0 && c.min_sig >= digits && c.max_ulp <= ulps;
+        int bits = c.exp_bits + c.man_bits;
+        if (ok && (!best || bits < best->exp_bits + best->man_bits ||
+                   (bits == best->exp_bits + best->man_bits && c.man_bits > best->man_bits)))
+            best = &c;
+    }
+    fclose(f);
+
+    printf("Results saved to: %s\n", outfile.c_str());
+    printf("\n=== Minimum format ===\n");
+    if (best) {
+        printf("%d exponent + %d mantissa bits (%d bits total): max ULP %.3g, min digits %.2f\n",
+               best->exp_bits, best->man_bits, 1 + best->exp_bits + best->man_bits,
+               best->max_ulp, best->min_sig);
+        printf("run_vprec.sh equivalent: -P CUSTOM -b %d -R %d\n", best->man_bits, best->exp_bits);
+    } else {
+        printf("No format in the searched range meets %.2f digits without overflow\n", digits);
+    }
+    printf("\n=== Execution Time ===\n");
+    printf("Total time: %.3fs (%.3g evaluations/s)\n", secs,
+           double(cells.size() * npoints) / secs);
+    printf("\nDone!\n");
+    return 0;
+}
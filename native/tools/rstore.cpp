@@ -0,0 +1,971 @@
+// Build and query the columnar result store.
+//
+// cire2.sh and cirecmany_consolidated.sh scrape CIRE's text output with awk
+// and concatenate it into reports; MCA results live in scattered .tab files.
+// `rstore ingest` loads CIRE results.json files and MCA/VPREC .tab files
+// into one store, and `rstore query` selects rows by kernel, optimization
+// level and box through the store index, so comparing tools is a query.
+// `rstore bins` aggregates the selected rows into x-bins or 2D tiles for
+// plotting, so plot time does not grow with the number of points,
+// `rstore pyramid` writes multi-resolution error-map tiles over 2 or 3 inputs,
+// `rstore grid` rebuilds dense .npy arrays of keyed sweep records and
+// `rstore scan` answers filter / aggregate / top-K questions with
+// multi-threaded scans, pruned by the zone maps and indices `rstore index`
+// saves next to the store, and `rstore diff` compares two runs point by
+// point instead of two PDFs side by side.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "binagg.hpp"
+#include "ingest.hpp"
+#include "parallel.hpp"
+#include "pyramid.hpp"
+#include "query.hpp"
+#include "regrid.hpp"
+#include "store.hpp"
+#include "storediff.hpp"
+#include "textcodec.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s ingest [-o STORE] [-B BOX] [-j JOBS] FILE...\n", prog);
+    printf("       %s query  [-o STORE] [-t TOOL] [-k KERNEL] [-O OPT] [-b BOX] [-w FILTERS] [-c COLUMNS]\n", prog);
+    printf("       %s bins   [-o STORE] [selection] -x COL[:N[:LO:HI]] [-y COL[:N[:LO:HI]]] [-v VALUE] [-s SIG] [-L POINTS]\n", prog);
+    printf("       %s pyramid [-o STORE] [selection] -x COL[:LO:HI] -y COL[:LO:HI] [-z COL[:LO:HI]] -d DIR [-T CELLS] [-l LEVELS]\n", prog);
+    printf("       %s grid   [-o STORE] [selection] -x COL[:LO:HI[:STEP]] [-y ...] [-z ...] -v VALUES [-a REDUCE] -d PREFIX\n", prog);
+    printf("       %s scan   [-o STORE] [selection] [-e WHERE] [-g GROUP] [-A AGGREGATES] [-K COL:N[:asc]] [-c COLUMNS]\n", prog);
+    printf("       %s index  [-o STORE] [-I COLUMNS]\n", prog);
+    printf("       %s diff   [-o STORE] [selection] [-J KEYS] [-g REGION] [-s SIG] [-K RANK:N[:asc]] [-c COLUMNS] A B\n", prog);
+    printf("       %s quantiles [-o STORE] [-t TOOL] [-k KERNEL] [-b BOX] [-w FILTERS] [-g FIELDS] [-Q QUANTILES]\n", prog);
+    printf("       %s info   [-o STORE]\n", prog);
+    printf("\n");
+    printf("Commands:\n");
+    printf("  ingest          : Append CIRE results (*.json), sweep results (*.tab) and keyed\n");
+    printf("                    records (*.csv with a header naming the columns) to STORE\n");
+    printf("  query           : Print matching rows as CSV\n");
+    printf("  bins            : Print per-bin count, min/max/mean of VALUE, sample envelope and\n");
+    printf("                    significant-digit quantiles over x-bins or (x, y) tiles as CSV\n");
+    printf("  pyramid         : Write a tile pyramid (count, max ULP, min significant digits per\n");
+    printf("                    cell) over 2 or 3 inputs to DIR for zoomable error maps\n");
+    printf("  grid            : Write VALUES on a regular grid over 1 to 3 coordinate columns as\n");
+    printf("                    PREFIX.<value>.npy, PREFIX.count.npy and PREFIX.json\n");
+    printf("  scan            : Print aggregates of the rows matching WHERE, per GROUP, or the top N\n");
+    printf("                    rows by COL as CSV; 'ulp' is the sample half-range around the mean\n");
+    printf("  index           : Save zone maps of every numeric column, and sorted indices (numeric)\n");
+    printf("                    or bitmaps (string) over COLUMNS, to STORE.qidx for scan\n");
+    printf("  diff            : Join the rows of A and B on their inputs and report per region the\n");
+    printf("                    change in significant digits (paired t, sign and KS tests) and\n");
+    printf("                    ULPs, then the largest regressions of B against A. A and B are\n");
+    printf("                    '[STORE:]col=value[,col=value]' selections or whole STOREs\n");
+    printf("  quantiles       : Merge the stored error sketches (per-sample ULPs from the point\n");
+    printf("                    mean, per-point significant digits) per FIELDS and print their\n");
+    printf("                    quantiles as CSV, without the raw samples\n");
+    printf("  info            : Print the schema and the (kernel, opt, box) groups\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -o STORE        : Store file (default: './results.rstore')\n");
+    printf("  -B BOX          : Box label for every ingested file (default: parent directory)\n");
+    printf("  -j JOBS         : Parser threads (default: number of CPU cores)\n");
+    printf("  -t TOOL         : Only rows from [cire | mca | vprec | sweep]\n");
+    printf("  -k, -O, -b      : Kernel, optimization level and box to select ('*' = any, default)\n");
+    printf("  -w FILTERS      : Only rows with 'col=value[,col=value]' (e.g. 'output=0,precision=24')\n");
+    printf("  -c COLUMNS      : Comma separated columns to print (default: all non-empty)\n");
+    printf("  -x, -y AXIS     : Bin column, bin count (default: 100) and range (default: data range)\n");
+    printf("  -v VALUE        : Column aggregated per bin (default: mean); grid: comma separated columns\n");
+    printf("  -a REDUCE       : Grid reduction of rows on the same node [max | min | mean] (default: max)\n");
+    printf("  -s SIG          : Significant-digit column, '' for none (default: sig_digits)\n");
+    printf("  -L POINTS       : Downsample the x-bins to POINTS with LTTB on the bin means\n");
+    printf("  -d DIR          : Pyramid output directory, or grid output prefix\n");
+    printf("  -T CELLS        : Pyramid cells per tile and axis (default: 64 in 2D, 16 in 3D)\n");
+    printf("  -l LEVELS       : Pyramid levels; the finest has CELLS * 2^(LEVELS-1) cells per axis (default: 5)\n");
+    printf("  -u ULP          : Pyramid ULP column (default: sample half-range around the mean)\n");
+    printf("  -e WHERE        : Comma separated 'col OP value', OP in < <= > >= = != (all must hold)\n");
+    printf("  -g GROUP        : Group by a column, or by binade(COL) = floor(log2 |COL|)\n");
+    printf("                    quantiles: comma separated tool, kernel, config, box, source,\n");
+    printf("                    output, region (default: kernel,config,output); -w filters them\n");
+    printf("  -A AGGREGATES   : Comma separated count, min(COL), max(COL), sum(COL), mean(COL) (default: count)\n");
+    printf("  -K COL:N[:asc]  : Print the N rows with the largest (or smallest) COL instead\n");
+    printf("  -I COLUMNS      : Comma separated columns to index\n");
+    printf("  -Q QUANTILES    : Comma separated, in [0, 1] (default: 0.001,0.01,0.5,0.99,0.999;\n");
+    printf("                    the low ones are the bad tail of significant digits)\n");
+    printf("  -J KEYS         : Diff join columns (default: x0, x1, ..., output, precision)\n");
+    printf("                    diff: -g REGION (default: binade(x0)), -K d_sig|d_ulp|mean_ulps:N\n");
+    printf("                    (default: d_sig:20, most negative first), -c extra columns of B\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  %s ingest examples/softmax/cire_results/*/*.json examples/softmax/verificarlo_results/*/*.tab\n", prog);
+    printf("  %s query -t cire -k softmax_og0 -O O2 -c box,op,err_hi\n", prog);
+    printf("  %s query -k softmax_og0 -b softmax2 -c tool,opt,config,err_hi,sig_digits\n", prog);
+    printf("  %s bins -t mca -k gelu_tanh0 -w precision=24 -x x0:2000 -L 400\n", prog);
+    printf("  %s bins -k softmax_og0 -b softmax2 -x x0:256 -y x1:256 -s sig_digits\n", prog);
+    printf("  %s pyramid -k softmax_og0 -b softmax8 -w precision=24 -x x0 -y x2 -d softmax8.tiles\n", prog);
+    printf("  %s grid -t cire -k harmonic0 -x x0_lo -y x1_lo:0:0.5:0.02 -v out_lo,err_hi -d harmonic\n", prog);
+    printf("  %s index -I x0,sig_digits,kernel,config\n", prog);
+    printf("  %s scan -e 'sig_digits<10,precision=24' -g kernel -A count,min(sig_digits)\n", prog);
+    printf("  %s scan -k gelu_tanh0 -g 'binade(x0)' -A 'count,max(ulp),mean(sig_digits)'\n", prog);
+    printf("  %s scan -e config=DOUBLE-vp24-mca -K ulp:20 -c kernel,x0,mean,ulp\n", prog);
+    printf("  %s diff kernel=ex1_original kernel=ex1_alt1\n", prog);
+    printf("  %s diff -k softmax_og0 -g box -K d_ulp:10 old.rstore new.rstore\n", prog);
+    printf("  %s quantiles -k gelu_tanh0 -g config,region -w metric=ulp\n", prog);
+    exit(1);
+}
+
+static bool file_exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static int cmd_ingest(const std::string& store_path, const std::string& box, unsigned jobs,
+                      const std::vector<std::string>& files) {
+    ResultStore store;
+    std::string err;
+    if (file_exists(store_path) && !ResultStore::load(store_path, store, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    std::vector<std::string> errors;
+    size_t added = ingest_files(files, box, jobs, store, errors);
+    for (const auto& e : errors)
+        fprintf(stderr, "Warning: %s\n", e.c_str());
+    if (!store.save(store_path, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    printf("Ingested %zu rows from %zu files into %s (%zu rows total)\n", added,
+           files.size() - errors.size(), store_path.c_str(), store.rows());
+    return errors.empty() ? 0 : 2;
+}
+
+// "x0", "x0:200" or "x0:200:-1:1"
+static bool parse_axis(const std::string& spec, BinAxis& ax) {
+    std::stringstream ss(spec);
+    std::string part;
+    std::vector<std::string> parts;
+    while (std::getline(ss, part, ':'))
+        parts.push_back(part);
+    if (parts.empty() || parts.size() == 3 || parts.size() > 4 || parts[0].empty())
+        return false;
+    ax.column = parts[0];
+    if (parts.size() > 1) {
+        long n = atol(parts[1].c_str());
+        if (n < 1)
+            return false;
+        ax.bins = size_t(n);
+    }
+    if (parts.size() == 4) {
+        ax.lo = atof(parts[2].c_str());
+        ax.hi = atof(parts[3].c_str());
+    }
+    return true;
+}
+
+// Shortest round-trip text; empty for non-finite values.
+static void print_num(double v, const char* sep = ",") {
+    fputs(sep, stdout);
+    if (std::isfinite(v))
+        fputs(format_double(v).c_str(), stdout);
+}
+
+static int cmd_bins(const ResultStore& store, const std::vector<uint32_t>& rows,
+                    const std::string& xspec, const std::string& yspec, const std::string& value,
+                    const std::string& sig, size_t lttb_points, unsigned jobs) {
+    std::vector<BinAxis> axes(1);
+    if (xspec.empty() || !parse_axis(xspec, axes[0])) {
+        fprintf(stderr, "Error: Missing or invalid -x axis '%s'\n", xspec.c_str());
+        return 1;
+    }
+    if (!yspec.empty()) {
+        axes.emplace_back();
+        if (!parse_axis(yspec, axes[1])) {
+            fprintf(stderr, "Error: Invalid -y axis '%s'\n", yspec.c_str());
+            return 1;
+        }
+        if (lttb_points) {
+            fprintf(stderr, "Error: -L downsamples x-bins; it does not apply to tiles\n");
+            return 1;
+        }
+    }
+    std::vector<Bin> bins;
+    std::string err;
+    if (!aggregate_bins(store, rows, axes, value, sig, jobs, bins, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    // Non-empty bins in x-major order; LTTB picks among them on (x mid, mean).
+    size_t ny = axes.size() > 1 ? axes[1].bins : 1;
+    std::vector<size_t> used;
+    for (size_t i = 0; i < bins.size(); i++)
+        if (bins[i].count && !std::isnan(bins[i].mean()))
+            used.push_back(i);
+    if (lttb_points) {
+        std::vector<double> xm(used.size()), ym(used.size());
+        for (size_t k = 0; k < used.size(); k++) {
+            xm[k] = 0.5 * (axes[0].edge(used[k]) + axes[0].edge(used[k] + 1));
+            ym[k] = bins[used[k]].mean();
+        }
+        std::vector<size_t> keep = lttb(xm.data(), ym.data(), used.size(), lttb_points);
+        std::vector<size_t> picked;
+        for (size_t k : keep)
+            picked.push_back(used[k]);
+        used.swap(picked);
+    }
+
+    printf("x_lo,x_hi%s,count,min,max,mean,env_lo,env_hi,sig_min,sig_p10,sig_p50,sig_p90\n",
+           axes.size() > 1 ? ",y_lo,y_hi" : "");
+    for (size_t i : used) {
+        const Bin& b = bins[i];
+        size_t ix = i / ny, iy = i % ny;
+        print_num(axes[0].edge(ix), "");
+        print_num(axes[0].edge(ix + 1));
+        if (axes.size() > 1) {
+            print_num(axes[1].edge(iy));
+            print_num(axes[1].edge(iy + 1));
+        }
+        printf(",%llu", (unsigned long long)b.count);
+        print_num(b.min);
+        print_num(b.max);
+        print_num(b.mean());
+        print_num(b.env_lo);
+        print_num(b.env_hi);
+        print_num(b.sig_min);
+        print_num(b.sig_quantile(0.1));
+        print_num(b.sig_quantile(0.5));
+        print_num(b.sig_quantile(0.9));
+        printf("\n");
+    }
+    fprintf(stderr, "%zu rows in %zu of %zu bins, %zu printed\n", rows.size(),
+            size_t(std::count_if(bins.begin(), bins.end(), [](const Bin& b) { return b.count; })),
+            bins.size(), used.size());
+    return 0;
+}
+
+// "x0" or "x0:-1:1"
+static bool parse_range_axis(const std::string& spec, BinAxis& ax) {
+    size_t c = spec.find(':');
+    ax.column = spec.substr(0, c);
+    if (c == std::string::npos)
+        return !ax.column.empty();
+    return !ax.column.empty() &&
+           sscanf(spec.c_str() + c + 1, "%lf:%lf", &ax.lo, &ax.hi) == 2;
+}
+
+static int cmd_pyramid(const ResultStore& store, const std::vector<uint32_t>& rows,
+                       const std::vector<std::string>& specs, const std::string& dir, int tile,
+                       int levels, const std::string& ulp, const std::string& sig,
+                       unsigned jobs) {
+    PyramidSpec ps;
+    for (const auto& s : specs) {
+        if (s.empty())
+            continue;
+        ps.axes.emplace_back();
+        if (!parse_range_axis(s, ps.axes.back())) {
+            fprintf(stderr, "Error: Invalid axis '%s'\n", s.c_str());
+            return 1;
+        }
+    }
+    if (ps.axes.size() < 2 || specs[1].empty() || dir.empty()) {
+        fprintf(stderr, "Error: pyramid needs -x, -y and -d\n");
+        return 1;
+    }
+    ps.tile = tile ? tile : ps.axes.size() == 3 ? 16 : 64;
+    ps.levels = levels;
+    PyramidStats stats;
+    std::string err;
+    if (!build_pyramid(store, rows, ps, ulp, sig, dir, jobs, stats, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    printf("%zu of %zu rows in [", stats.rows, rows.size());
+    for (size_t a = 0; a < ps.axes.size(); a++)
+        printf("%s%s %g:%g", a ? ", " : "", ps.axes[a].column.c_str(), ps.axes[a].lo,
+               ps.axes[a].hi);
+    printf("]\n");
+    printf("%-6s %-14s %s\n", "level", "cells/axis", "tiles");
+    for (int l = 0; l < ps.levels; l++)
+        printf("%-6d %-14lld %zu\n", l, (long long)ps.tile << l, stats.tiles[size_t(l)]);
+    printf("Wrote %.1f MB to %s\n", double(stats.bytes) / 1e6, dir.c_str());
+    return 0;
+}
+
+// "x0_lo", "x0_lo:0:1" or "x0_lo:0:1:0.02"; missing parts come from the data.
+static bool parse_grid_axis(const std::string& spec, Axis& ax) {
+    std::stringstream ss(spec);
+    std::string part;
+    std::vector<std::string> parts;
+    while (std::getline(ss, part, ':'))
+        parts.push_back(part);
+    if (parts.empty() || parts.size() == 2 || parts.size() > 4 || parts[0].empty())
+        return false;
+    ax.name = parts[0];
+    ax.lo = parts.size() > 1 ? atof(parts[1].c_str()) : NAN;
+    ax.hi = parts.size() > 1 ? atof(parts[2].c_str()) : NAN;
+    ax.step = parts.size() > 3 ? atof(parts[3].c_str()) : NAN;
+    return parts.size() < 4 || ax.step > 0.0;
+}
+
+static int cmd_grid(const ResultStore& store, const std::vector<uint32_t>& rows,
+                    const std::vector<std::string>& specs, const std::string& value_list,
+                    const std::string& reduce_name, const std::string& prefix, unsigned jobs) {
+    std::vector<Axis> axes;
+    std::string err;
+    for (const auto& s : specs) {
+        if (s.empty())
+            continue;
+        axes.emplace_back();
+        if (!parse_grid_axis(s, axes.back())) {
+            fprintf(stderr, "Error: Invalid axis '%s'\n", s.c_str());
+            return 1;
+        }
+        if (!infer_axis(store, rows, axes.back(), err)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return 1;
+        }
+    }
+    if (axes.empty() || specs[0].empty() || prefix.empty()) {
+        fprintf(stderr, "Error: grid needs -x and -d\n");
+        return 1;
+    }
+    Reduce reduce;
+    if (reduce_name == "max")
+        reduce = Reduce::MAX;
+    else if (reduce_name == "min")
+        reduce = Reduce::MIN;
+    else if (reduce_name == "mean")
+        reduce = Reduce::MEAN;
+    else {
+        fprintf(stderr, "Error: Unknown reduction '%s'\n", reduce_name.c_str());
+        return 1;
+    }
+    std::vector<std::string> values;
+    std::stringstream vs(value_list);
+    std::string v;
+    while (std::getline(vs, v, ','))
+        if (!v.empty())
+            values.push_back(v);
+
+    std::vector<std::vector<double>> out;
+    std::vector<uint32_t> count;
+    RegridStats stats;
+    if (!regrid(store, rows, axes, values, reduce, jobs, out, count, stats, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    // First axis fastest: the numpy shape lists the axes last to first.
+    std::vector<size_t> shape;
+    for (size_t a = axes.size(); a-- > 0;)
+        shape.push_back(axes[a].size());
+    for (size_t i = 0; i < values.size(); i++)
+        if (!write_npy(prefix + "." + values[i] + ".npy", out[i].data(), "<f8", sizeof(double),
+                       shape, err)) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return 1;
+        }
+    if (!write_npy(prefix + ".count.npy", count.data(), "<u4", sizeof(uint32_t), shape, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    std::string meta = prefix + ".json";
+    FILE* f = fopen(meta.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", meta.c_str());
+        return 1;
+    }
+    size_t filled = size_t(std::count_if(count.begin(), count.end(), [](uint32_t c) { return c; }));
+    fprintf(f, "{\n  \"axes\": [");
+    for (size_t a = 0; a < axes.size(); a++)
+        fprintf(f, "%s{\"column\": \"%s\", \"lo\": %.17g, \"hi\": %.17g, \"step\": %.17g, \"size\": %zu}",
+                a ? ", " : "", axes[a].name.c_str(), axes[a].lo, axes[a].hi, axes[a].step,
+                axes[a].size());
+    fprintf(f, "],\n  \"values\": [");
+    for (size_t i = 0; i < values.size(); i++)
+        fprintf(f, "%s\"%s\"", i ? ", " : "", values[i].c_str());
+    fprintf(f, "],\n  \"reduce\": \"%s\",\n  \"rows\": %zu,\n  \"nodes_filled\": %zu\n}\n",
+            reduce_name.c_str(), stats.rows, filled);
+    fclose(f);
+
+    for (const auto& a : axes)
+        printf("%-12s %g:%g step %g (%zu nodes)\n", a.name.c_str(), a.lo, a.hi, a.step, a.size());
+    printf("%zu rows on %zu of %zu nodes", stats.rows, filled, count.size());
+    if (stats.off_grid || stats.outside)
+        printf(" (%zu between nodes, %zu outside)", stats.off_grid, stats.outside);
+    printf("\nWrote %s.{%s,count}.npy and %s\n", prefix.c_str(), value_list.c_str(), meta.c_str());
+    return 0;
+}
+
+// Modification time of a file in nanoseconds, 0 if it does not exist.
+static int64_t file_stamp(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return 0;
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+static int cmd_index(const ResultStore& store, const std::string& store_path,
+                     const std::string& cols, unsigned jobs) {
+    std::vector<std::string> names;
+    std::stringstream ss(cols);
+    std::string name;
+    while (std::getline(ss, name, ','))
+        if (!name.empty())
+            names.push_back(name);
+    QueryIndex index;
+    std::string err, path = store_path + ".qidx";
+    if (!index.build(store, names, file_stamp(store_path), jobs, err) || !index.save(path, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    struct stat st;
+    stat(path.c_str(), &st);
+    printf("Indexed %zu rows (zone maps%s%s) into %s (%.1f MB)\n", store.rows(),
+           names.empty() ? "" : ", ", cols.c_str(), path.c_str(), double(st.st_size) / 1e6);
+    return 0;
+}
+
+static int cmd_scan(const ResultStore& store, const std::string& store_path,
+                    const std::vector<uint32_t>* rows, const std::string& where,
+                    const std::string& group, const std::string& aggs, const std::string& top,
+                    const std::string& cols, unsigned jobs) {
+    QuerySpec spec;
+    std::string err;
+    if (!parse_predicates(where, spec.where, err) ||
+        !parse_aggregates(aggs.empty() ? "count" : aggs, spec.aggs, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    spec.group = group;
+    if (group.compare(0, 7, "binade(") == 0 && group.back() == ')') {
+        spec.group = group.substr(7, group.size() - 8);
+        spec.binade = true;
+    }
+    if (!top.empty()) {
+        char col[256], dir[8] = "";
+        unsigned long k = 0;
+        int got = sscanf(top.c_str(), "%255[^:]:%lu:%7s", col, &k, dir);
+        if (got < 2 || k == 0 || (got == 3 && strcmp(dir, "asc") != 0)) {
+            fprintf(stderr, "Error: Invalid -K '%s' (expected COL:N or COL:N:asc)\n", top.c_str());
+            return 1;
+        }
+        if (!group.empty()) {
+            fprintf(stderr, "Error: -K ranks rows; it does not combine with -g\n");
+            return 1;
+        }
+        spec.top = col;
+        spec.top_k = k;
+        spec.ascending = got == 3;
+        spec.aggs.clear();
+    }
+
+    // Zone maps and indices, if saved for this version of the store.
+    QueryIndex index;
+    std::string path = store_path + ".qidx";
+    bool indexed = file_exists(path) && QueryIndex::load(path, index, err) &&
+                   index.matches(store, file_stamp(store_path));
+    if (file_exists(path) && !indexed)
+        fprintf(stderr, "Warning: %s is stale or invalid, scanning without it\n", path.c_str());
+
+    auto t0 = std::chrono::steady_clock::now();
+    QueryResult res;
+    if (!run_query(store, indexed ? &index : nullptr, rows, spec, jobs, res, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+                    .count();
+
+    if (spec.top_k) {
+        // Columns of the ranked rows, "ulp" derived unless stored.
+        SampleUlp ulp(store);
+        std::vector<std::string> names;
+        std::stringstream ss(cols.empty() ? "" : cols);
+        std::string name;
+        while (std::getline(ss, name, ','))
+            names.push_back(name);
+        if (cols.empty()) {
+            for (const auto& c : store.columns()) {
+                bool any = false;
+                for (size_t i = 0; i < res.top.size() && !any; i++)
+                    any = !c.is_null(res.top[i]);
+                if (any)
+                    names.push_back(c.name);
+            }
+            if (!store.find(spec.top))
+                names.push_back(spec.top);
+        }
+        for (const auto& n : names)
+            if (!store.find(n) && n != "ulp") {
+                fprintf(stderr, "Error: Unknown column '%s' (see info)\n", n.c_str());
+                return 1;
+            }
+        for (size_t i = 0; i < names.size(); i++)
+            printf("%s%s", i ? "," : "", names[i].c_str());
+        printf("\n");
+        for (uint32_t r : res.top) {
+            for (size_t i = 0; i < names.size(); i++) {
+                const Column* c = store.find(names[i]);
+                if (c)
+                    printf("%s%s", i ? "," : "", c->format(r).c_str());
+                else if (i)
+                    print_num(ulp.at(r));
+                else
+                    printf("%.17g", ulp.at(r));
+            }
+            printf("\n");
+        }
+    } else {
+        if (!group.empty())
+            printf("%s,", group.c_str());
+        for (size_t a = 0; a < spec.aggs.size(); a++)
+            printf("%s%s", a ? "," : "", spec.aggs[a].label().c_str());
+        printf("\n");
+        for (const auto& g : res.groups) {
+            if (!group.empty())
+                printf("%s,", g.key.c_str());
+            for (size_t a = 0; a < g.values.size(); a++) {
+                if (a)
+                    print_num(g.values[a]);
+                else if (std::isfinite(g.values[a]))
+                    printf("%.17g", g.values[a]);
+            }
+            printf("\n");
+        }
+    }
+    fprintf(stderr, "%zu of %zu rows matched in %.1f ms (%s: %zu candidate rows", res.stats.matched,
+            rows ? rows->size() : store.rows(), ms, res.stats.plan.c_str(), res.stats.candidates);
+    if (res.stats.blocks_skipped)
+        fprintf(stderr, ", %zu of %zu blocks skipped", res.stats.blocks_skipped, res.stats.blocks);
+    fprintf(stderr, ")\n");
+    return 0;
+}
+
+// "old.rstore", "kernel=ex1_alt1" (in the -o store) or "old.rstore:kernel=ex1_alt1"
+static void parse_side(const std::string& arg, const std::string& default_store,
+                       std::string& path, std::string& filters) {
+    size_t eq = arg.find('='), colon = arg.find(':');
+    path = eq == std::string::npos ? arg : colon < eq ? arg.substr(0, colon) : default_store;
+    filters = eq == std::string::npos ? "" : colon < eq ? arg.substr(colon + 1) : arg;
+}
+
+static int cmd_diff(const std::string& store_path, const std::vector<std::string>& sides,
+                    const std::string& tool, const std::string& kernel, const std::string& opt,
+                    const std::string& box, const std::string& filters, const std::string& keys,
+                    const std::string& group, const std::string& sig, const std::string& top,
+                    const std::string& cols, unsigned jobs) {
+    if (sides.size() != 2) {
+        fprintf(stderr, "Error: diff needs two sides, A and B\n");
+        return 1;
+    }
+    std::string path[2], side_filters[2], errs[2];
+    for (int s = 0; s < 2; s++) {
+        parse_side(sides[size_t(s)], store_path, path[s], side_filters[s]);
+        if (!filters.empty())
+            side_filters[s] += (side_filters[s].empty() ? "" : ",") + filters;
+    }
+    // Load both stores concurrently (once if they are the same file).
+    ResultStore stores[2];
+    bool shared = path[0] == path[1];
+    std::thread loader;
+    if (!shared)
+        loader = std::thread([&] { ResultStore::load(path[1], stores[1], errs[1]); });
+    ResultStore::load(path[0], stores[0], errs[0]);
+    if (loader.joinable())
+        loader.join();
+    const ResultStore& sa = stores[0];
+    const ResultStore& sb = shared ? stores[0] : stores[1];
+    std::vector<uint32_t> rows[2];
+    for (int s = 0; s < 2; s++) {
+        std::string err = errs[s];
+        if ((err.empty() && !select_rows(s && !shared ? sb : sa, tool, kernel, opt, box,
+                                         side_filters[s], rows[s], err)) || !err.empty()) {
+            fprintf(stderr, "Error: %s\n", err.c_str());
+            return 1;
+        }
+    }
+
+    DiffSpec spec;
+    std::stringstream ks(keys);
+    std::string name;
+    while (std::getline(ks, name, ','))
+        if (!name.empty())
+            spec.key.push_back(name);
+    std::string region = group.empty() ? "binade(x0)" : group;
+    spec.region = region;
+    spec.binade = false;
+    if (region.compare(0, 7, "binade(") == 0 && region.back() == ')') {
+        spec.region = region.substr(7, region.size() - 8);
+        spec.binade = true;
+    }
+    spec.sig = sig;
+    if (!top.empty()) {
+        char rank[32], dir[8] = "";
+        unsigned long k = 0;
+        int got = sscanf(top.c_str(), "%31[^:]:%lu:%7s", rank, &k, dir);
+        if (got < 2 || (got == 3 && strcmp(dir, "asc") != 0 && strcmp(dir, "desc") != 0)) {
+            fprintf(stderr, "Error: Invalid -K '%s' (expected RANK:N[:asc|desc])\n", top.c_str());
+            return 1;
+        }
+        spec.rank = rank;
+        spec.top_k = k;
+        spec.ascending = got == 3 ? strcmp(dir, "asc") == 0 : spec.rank == "d_sig";
+    }
+    DiffResult res;
+    std::string err;
+    if (!diff_rows(sa, rows[0], sb, rows[1], spec, jobs, res, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+
+    std::string key_list;
+    for (const auto& k : res.key)
+        key_list += (key_list.empty() ? "" : ",") + k;
+    printf("A: %s (%zu rows)\nB: %s (%zu rows)\n", sides[0].c_str(), rows[0].size(),
+           sides[1].c_str(), rows[1].size());
+    printf("Joined %zu pairs on %s; %zu rows of B unmatched, %zu duplicate keys in A\n",
+           res.pairs, key_list.c_str(), res.unmatched, res.duplicates);
+
+    // Significant at 1% by the paired t or the sign test.
+    printf("\n=== Regions (%s) ===\n", region.c_str());
+    printf("%-12s %8s %10s %9s %7s %7s %9s %9s %7s %9s %10s %10s %s\n", "region", "pairs",
+           "d_sig", "sd", "worse", "better", "t_p", "sign_p", "ks_d", "ks_p", "max_d_ulp",
+           "mean_ulps", "verdict");
+    for (const auto& r : res.regions) {
+        bool sig_change = r.t_p < 0.01 || r.sign_p < 0.01;
+        const char* verdict = !sig_change ? "" : r.d_sig_mean < 0 ? "regressed" : "improved";
+        printf("%-12s %8zu %10.3g %9.3g %7zu %7zu %9.3g %9.3g %7.3f %9.3g %10.3g %10.3g %s\n",
+               r.key.empty() ? "-" : r.key.c_str(), r.pairs, r.d_sig_mean, r.d_sig_sd, r.worse,
+               r.better, r.t_p, r.sign_p, r.ks_d, r.ks_p, r.max_d_ulp, r.max_mean_ulps, verdict);
+    }
+
+    std::vector<const Column*> shown;
+    for (const auto& k : res.key)
+        shown.push_back(sb.find(k));
+    std::stringstream cs(cols);
+    while (std::getline(cs, name, ',')) {
+        const Column* c = sb.find(name);
+        if (!c) {
+            fprintf(stderr, "Error: Unknown column '%s' (see info)\n", name.c_str());
+            return 1;
+        }
+        shown.push_back(c);
+    }
+    const Column* sig_a = sa.find(sig);
+    const Column* sig_b = sb.find(sig);
+    SampleUlp ulp_a(sa), ulp_b(sb);
+    printf("\n=== Largest changes by %s ===\n", spec.rank.c_str());
+    for (const Column* c : shown)
+        printf("%s,", c->name.c_str());
+    printf("sig_a,sig_b,d_sig,ulp_a,ulp_b,d_ulp,mean_ulps\n");
+    for (const auto& p : res.top) {
+        for (const Column* c : shown)
+            printf("%s,", c->format(p.b).c_str());
+        printf("%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g\n", sig_a ? sig_a->num(p.a) : NAN,
+               sig_b ? sig_b->num(p.b) : NAN, p.d_sig, ulp_a.at(p.a), ulp_b.at(p.b), p.d_ulp,
+               p.mean_ulps);
+    }
+    return 0;
+}
+
+static int cmd_query(const ResultStore& store, const std::vector<uint32_t>& rows,
+                     const std::string& cols) {
+
+    std::vector<const Column*> shown;
+    if (cols.empty()) {
+        for (const auto& c : store.columns()) {
+            bool any = false;
+            for (size_t i = 0; i < rows.size() && !any; i++)
+                any = !c.is_null(rows[i]);
+            if (any)
+                shown.push_back(&c);
+        }
+    } else {
+        std::stringstream ss(cols);
+        std::string name;
+        while (std::getline(ss, name, ',')) {
+            const Column* c = store.find(name);
+            if (!c) {
+                fprintf(stderr, "Error: Unknown column '%s' (see info)\n", name.c_str());
+                return 1;
+            }
+            shown.push_back(c);
+        }
+    }
+
+    for (size_t i = 0; i < shown.size(); i++)
+        printf("%s%s", i ? "," : "", shown[i]->name.c_str());
+    printf("\n");
+    for (uint32_t r : rows) {
+        for (size_t i = 0; i < shown.size(); i++)
+            printf("%s%s", i ? "," : "", shown[i]->format(r).c_str());
+        printf("\n");
+    }
+    fprintf(stderr, "%zu rows\n", rows.size());
+    return 0;
+}
+
+// Natural order for group fields: "binade(x0)=-10" < "binade(x0)=-2" < "binade(x0)=3".
+static bool field_less(const std::string& a, const std::string& b) {
+    auto number = [](const std::string& s, double& v) {
+        size_t eq = s.rfind('=');
+        std::string t = eq == std::string::npos ? s : s.substr(eq + 1);
+        if (t == "zero") {
+            v = -INFINITY;
+            return true;
+        }
+        char* end = nullptr;
+        v = strtod(t.c_str(), &end);
+        return !t.empty() && *end == '\0';
+    };
+    auto prefix = [](const std::string& s) {
+        size_t eq = s.rfind('=');
+        return eq == std::string::npos ? std::string() : s.substr(0, eq);
+    };
+    double x, y;
+    if (prefix(a) == prefix(b) && number(a, x) && number(b, y) && x != y)
+        return x < y;
+    return a < b;
+}
+
+static int cmd_quantiles(const ResultStore& store, const std::string& tool,
+                         const std::string& kernel, const std::string& box,
+                         const std::string& filters, const std::string& group,
+                         const std::string& qlist) {
+    // Equality filters on the sketch key fields, plus -t/-k/-b.
+    std::vector<std::pair<std::string, std::string>> want;
+    for (const auto& kv : {std::make_pair("tool", tool), std::make_pair("kernel", kernel),
+                           std::make_pair("box", box)})
+        if (kv.second != "*")
+            want.emplace_back(kv.first, kv.second);
+    std::stringstream fs(filters);
+    for (std::string f; std::getline(fs, f, ',');) {
+        size_t eq = f.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            fprintf(stderr, "Error: Invalid filter '%s', expected FIELD=VALUE\n", f.c_str());
+            return 1;
+        }
+        want.emplace_back(f.substr(0, eq), f.substr(eq + 1));
+    }
+    std::vector<std::string> fields;
+    std::stringstream gs(group.empty() ? "kernel,config,output" : group);
+    for (std::string g; std::getline(gs, g, ',');)
+        fields.push_back(g);
+    fields.push_back("metric");
+    std::vector<double> qs;
+    std::stringstream qss(qlist.empty() ? "0.001,0.01,0.5,0.99,0.999" : qlist);
+    for (std::string q; std::getline(qss, q, ',');) {
+        char* end = nullptr;
+        double v = strtod(q.c_str(), &end);
+        if (q.empty() || *end || !(v >= 0 && v <= 1)) {
+            fprintf(stderr, "Error: Invalid quantile '%s', expected a number in [0, 1]\n",
+                    q.c_str());
+            return 1;
+        }
+        qs.push_back(v);
+    }
+
+    // Merge the matching sketches per group.
+    auto less = [](const std::vector<std::string>& a, const std::vector<std::string>& b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), field_less);
+    };
+    std::map<std::vector<std::string>, QuantileSketch, decltype(less)> groups(less);
+    size_t merged = 0;
+    for (const auto& sk : store.sketches()) {
+        std::string v;
+        bool match = true;
+        for (const auto& w : want) {
+            if (!sk.first.field(w.first, v)) {
+                fprintf(stderr, "Error: Unknown sketch field '%s' (tool, kernel, config, box, "
+                        "source, output, region, metric)\n", w.first.c_str());
+                return 1;
+            }
+            match = match && v == w.second;
+        }
+        if (!match)
+            continue;
+        std::vector<std::string> g(fields.size());
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (!sk.first.field(fields[i], g[i])) {
+                fprintf(stderr, "Error: Unknown sketch field '%s' in -g\n", fields[i].c_str());
+                return 1;
+            }
+        }
+        groups[g].merge(sk.second);
+        merged++;
+    }
+    if (store.sketches().empty())
+        fprintf(stderr, "Warning: No sketches in the store; re-ingest the .tab/.rsmp files\n");
+
+    for (const auto& f : fields)
+        printf("%s,", f.c_str());
+    printf("count,nan,min,mean,max");
+    for (double q : qs)
+        printf(",p%g", q * 100);
+    printf("\n");
+    for (const auto& g : groups) {
+        for (const auto& v : g.first)
+            printf("%s,", v.c_str());
+        const QuantileSketch& sk = g.second;
+        printf("%llu,%llu", (unsigned long long)sk.count(), (unsigned long long)sk.nan_count());
+        print_num(sk.min());
+        print_num(sk.mean());
+        print_num(sk.max());
+        for (double q : qs)
+            print_num(sk.quantile(q));
+        printf("\n");
+    }
+    fprintf(stderr, "%zu sketches merged into %zu groups\n", merged, groups.size());
+    return 0;
+}
+
+static int cmd_info(const ResultStore& store, const std::string& path) {
+    printf("Store: %s\n", path.c_str());
+    printf("Rows: %zu\n", store.rows());
+    printf("\n=== Columns ===\n");
+    static const char* TYPES[] = {"f64", "i64", "str"};
+    for (const auto& c : store.columns()) {
+        size_t filled = 0;
+        for (size_t r = 0; r < store.rows(); r++)
+            filled += !c.is_null(r);
+        printf("%-20s %-4s %zu non-null", c.name.c_str(), TYPES[int(c.type)], filled);
+        if (c.type == ColType::STR)
+            printf(", %zu distinct", c.dict.size() - 1);
+        printf("\n");
+    }
+
+    // Group counts per (tool, kernel, opt, box).
+    const char* keys[] = {"tool", "kernel", "opt", "box"};
+    const Column* kc[4];
+    for (int k = 0; k < 4; k++)
+        kc[k] = store.find(keys[k]);
+    std::map<std::vector<std::string>, size_t> count;
+    for (size_t r = 0; r < store.rows(); r++) {
+        std::vector<std::string> g;
+        for (int k = 0; k < 4; k++)
+            g.push_back(kc[k] ? kc[k]->str(r) : "");
+        count[g]++;
+    }
+    printf("\n=== Groups ===\n");
+    printf("%-8s %-20s %-14s %-14s %s\n", "tool", "kernel", "opt", "box", "rows");
+    for (const auto& g : count)
+        printf("%-8s %-20s %-14s %-14s %zu\n", g.first[0].c_str(), g.first[1].c_str(),
+               g.first[2].empty() ? "-" : g.first[2].c_str(),
+               g.first[3].empty() ? "-" : g.first[3].c_str(), g.second);
+    if (!store.sketches().empty()) {
+        uint64_t values = 0;
+        for (const auto& sk : store.sketches())
+            values += sk.second.count();
+        printf("\n=== Sketches ===\n%zu sketches over %llu values (see quantiles)\n",
+               store.sketches().size(), (unsigned long long)values);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2)
+        usage(argv[0]);
+    std::string cmd = argv[1];
+    if (cmd != "ingest" && cmd != "query" && cmd != "bins" && cmd != "pyramid" && cmd != "grid" &&
+        cmd != "scan" && cmd != "index" && cmd != "diff" && cmd != "quantiles" && cmd != "info")
+        usage(argv[0]);
+
+    std::string store_path = "./results.rstore", box, tool = "*", kernel = "*", opt = "*";
+    std::string qbox = "*", cols, filters, xspec, yspec, value = "mean", sig = "sig_digits";
+    size_t lttb_points = 0;
+    std::string zspec, dest, ulp, reduce = "max";
+    std::string where, group, aggs, top, index_cols, keys, quantiles;
+    int tile = 0, levels = 5;
+    unsigned jobs = default_jobs();
+
+    optind = 2;
+    int opt_c;
+    while ((opt_c = getopt(argc, argv, "o:B:j:t:k:O:b:c:w:x:y:v:s:L:z:d:T:l:u:a:e:g:A:K:I:J:Q:h")) != -1) {
+        switch (opt_c) {
+        case 'o': store_path = optarg; break;
+        case 'B': box = optarg; break;
+        case 'j': jobs = unsigned(atoi(optarg)); break;
+        case 't': tool = optarg; break;
+        case 'k': kernel = optarg; break;
+        case 'O': opt = optarg; break;
+        case 'b': qbox = optarg; break;
+        case 'c': cols = optarg; break;
+        case 'w': filters = optarg; break;
+        case 'x': xspec = optarg; break;
+        case 'y': yspec = optarg; break;
+        case 'v': value = optarg; break;
+        case 's': sig = optarg; break;
+        case 'L': lttb_points = strtoull(optarg, nullptr, 10); break;
+        case 'z': zspec = optarg; break;
+        case 'd': dest = optarg; break;
+        case 'T': tile = atoi(optarg); break;
+        case 'l': levels = atoi(optarg); break;
+        case 'u': ulp = optarg; break;
+        case 'a': reduce = optarg; break;
+        case 'e': where = optarg; break;
+        case 'g': group = optarg; break;
+        case 'A': aggs = optarg; break;
+        case 'K': top = optarg; break;
+        case 'I': index_cols = optarg; break;
+        case 'J': keys = optarg; break;
+        case 'Q': quantiles = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    if (cmd == "ingest") {
+        std::vector<std::string> files(argv + optind, argv + argc);
+        if (files.empty()) {
+            fprintf(stderr, "Error: No files to ingest\n");
+            usage(argv[0]);
+        }
+        return cmd_ingest(store_path, box, jobs, files);
+    }
+
+    if (cmd == "diff")
+        return cmd_diff(store_path, std::vector<std::string>(argv + optind, argv + argc), tool,
+                        kernel, opt, qbox, filters, keys, group, sig, top, cols, jobs);
+
+    ResultStore store;
+    std::string err;
+    if (!ResultStore::load(store_path, store, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (cmd == "info")
+        return cmd_info(store, store_path);
+    if (cmd == "index")
+        return cmd_index(store, store_path, index_cols, jobs);
+    if (cmd == "quantiles")
+        return cmd_quantiles(store, tool, kernel, qbox, filters, group, quantiles);
+    // An unrestricted scan goes over the whole store, where it can use the index.
+    if (cmd == "scan" && tool == "*" && kernel == "*" && opt == "*" && qbox == "*" &&
+        filters.empty())
+        return cmd_scan(store, store_path, nullptr, where, group, aggs, top, cols, jobs);
+    std::vector<uint32_t> rows;
+    if (!select_rows(store, tool, kernel, opt, qbox, filters, rows, err)) {
+        fprintf(stderr, "Error: %s\n", err.c_str());
+        return 1;
+    }
+    if (cmd == "scan")
+        return cmd_scan(store, store_path, &rows, where, group, aggs, top, cols, jobs);
+    if (cmd == "bins")
+        return cmd_bins(store, rows, xspec, yspec, value, sig, lttb_points, jobs);
+    if (cmd == "pyramid")
+        return cmd_pyramid(store, rows, {xspec, yspec, zspec}, dest, tile, levels, ulp, sig,
+                           jobs);
+    if (cmd == "grid")
+        return cmd_grid(store, rows, {xspec, yspec, zspec}, value, reduce, dest, jobs);
+    return cmd_query(store, rows, cols);
+}
@@ -0,0 +1,121 @@
+// Throughput of the stochastic-rounding conversion kernels.
+//
+// Converts N fp32 values drawn from a normal distribution (scaled into the
+// interesting range of each format) and reports elements/s and the input
+// bandwidth for SR quantize, SR convert-to-bits, and RN quantize as the
+// deterministic baseline. Also checks that SR is unbiased on this data.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "lowp.hpp"
+#include "parallel.hpp"
+
+using namespace reu;
+
+static void usage(const char* prog) {
+    printf("Usage: %s [-n COUNT] [-r REPS] [-j JOBS] [-q FORMAT]\n", prog);
+    printf("\n");
+    printf("  -n COUNT        : Elements per conversion (default: 16777216)\n");
+    printf("  -r REPS         : Timed repetitions, best is reported (default: 5)\n");
+    printf("  -j JOBS         : Threads converting disjoint slices (default: 1)\n");
+    printf("  -q FORMAT       : Only benchmark one of [bf16 | fp16 | e4m3 | e5m2]\n");
+    exit(1);
+}
+
+template <class F>
+static double best_seconds(int reps, F fn) {
+    double best = 1e300;
+    for (int r = 0; r < reps; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        best = s < best ? s : best;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t n = size_t(1) << 24;
+    int reps = 5;
+    unsigned jobs = 1;
+    std::string only;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:j:q:h")) != -1) {
+        switch (opt) {
+        case 'n': n = strtoull(optarg, nullptr, 10); break;
+        case 'r': reps = atoi(optarg); break;
+        case 'j': jobs = unsigned(atoi(optarg)); break;
+        case 'q': only = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+
+    std::vector<float> in(n), out(n);
+    std::vector<uint16_t> bits16(n);
+    std::vector<uint8_t> bits8(n);
+
+    printf("=== SR conversion throughput (%zu elements, %u thread%s) ===\n", n, jobs,
+           jobs == 1 ? "" : "s");
+    printf("%-6s %-14s %12s %10s\n", "format", "kernel", "Melem/s", "GB/s in");
+
+    for (int fi = 0; fi < 4; fi++) {
+        Lowp f = Lowp(fi);
+        const LowpSpec& s = lowp_spec(f);
+        if (!only.empty() && only != s.name)
+            continue;
+
+        // Values spread over a few binades around 1, scaled to stay in range.
+        std::mt19937 gen(42);
+        std::normal_distribution<float> dist(0.0f, s.max > 1e4f ? 8.0f : 2.0f);
+        for (auto& v : in)
+            v = dist(gen);
+
+        auto run = [&](const char* name, auto body) {
+            double secs = best_seconds(reps, [&] {
+                parallel_for(n, jobs, [&](size_t b, size_t e, unsigned) { body(b, e); });
+            });
+            printf("%-6s %-14s %12.1f %10.2f\n", s.name, name, double(n) / secs * 1e-6,
+                   double(n) * sizeof(float) / secs * 1e-9);
+        };
+
+        run("sr_quantize", [&](size_t b, size_t e) {
+            sr_quantize(f, in.data() + b, out.data() + b, e - b, 7, b);
+        });
+        run("sr_convert", [&](size_t b, size_t e) {
+            if (f == Lowp::BF16)
+                sr_convert_bf16(in.data() + b, bits16.data() + b, e - b, 7, b);
+            else if (f == Lowp::FP16)
+                sr_convert_fp16(in.data() + b, bits16.data() + b, e - b, 7, b);
+            else
+                sr_convert_fp8(f, in.data() + b, bits8.data() + b, e - b, 7, b);
+        });
+        run("rn_quantize", [&](size_t b, size_t e) {
+            rn_quantize(f, in.data() + b, out.data() + b, e - b);
+        });
+
+        // SR is unbiased: the mean rounding error over many values should be
+        // far below the mean |error| of a single rounding.
+        sr_quantize(f, in.data(), out.data(), n, 7, 0);
+        double bias = 0, mag = 0;
+        size_t used = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (std::fabs(in[i]) > s.max)
+                continue;
+            double d = double(out[i]) - double(in[i]);
+            bias += d;
+            mag += std::fabs(d);
+            used++;
+        }
+        printf("%-6s %-14s mean err %.3e, mean |err| %.3e\n", s.name, "sr_bias",
+               bias / double(used), mag / double(used));
+    }
+    return 0;
+}